@@ -164,6 +164,8 @@ typedef struct _st_stack {
     /* http://valgrind.org/docs/manual/manual-core-adv.html */
     unsigned long valgrind_stack_id;
 #endif
+    int  dirty_size;            /* Size of the dirty portion, from the top */
+    int  guarded;               /* Whether the redzones are protected */
 } _st_stack_t;
 
 
@@ -191,9 +193,9 @@ struct _st_thread {
 #endif
 
     st_utime_t due;             /* Wakeup time when thread is sleeping */
-    _st_thread_t *left;         /* For putting in timeout heap */
-    _st_thread_t *right;          /* -- see docs/timeout_heap.txt for details */
-    int heap_index;
+    _st_thread_t *left;         /* For putting in timeout heap, or the prev in timing wheel slot */
+    _st_thread_t *right;          /* -- see docs/timeout_heap.txt for details, or the next in slot */
+    int heap_index;             /* The index in heap, or the slot in timing wheel */
 
     void **private_data;        /* Per thread private data */
 
@@ -231,6 +233,21 @@ typedef struct _st_eventsys_ops {
 } _st_eventsys_t;
 
 
+#ifndef ST_NO_TIMING_WHEEL
+/*
+ * The hierarchical timing wheel for sleep queue, the tick is 1ms. The level 0
+ * has 256 slots for the next 256ms, and each of level 1 to 4 has 64 slots, so
+ * the wheel covers about 49 days. See _st_add_sleep_q() for details.
+ */
+#define _ST_TW_TICK     1000
+#define _ST_TW_L0_BITS  8
+#define _ST_TW_LN_BITS  6
+#define _ST_TW_L0_SIZE  (1 << _ST_TW_L0_BITS)
+#define _ST_TW_LN_SIZE  (1 << _ST_TW_LN_BITS)
+#define _ST_TW_LEVELS   5
+#define _ST_TW_SLOTS    (_ST_TW_L0_SIZE + (_ST_TW_LEVELS - 1) * _ST_TW_LN_SIZE)
+#endif
+
 typedef struct _st_vp {
     _st_thread_t *idle_thread;  /* Idle thread for this vp */
     st_utime_t last_clock;      /* The last time we went into vp_check_clock() */
@@ -243,7 +260,13 @@ typedef struct _st_vp {
 #endif
     int pagesize;
 
+#ifndef ST_NO_TIMING_WHEEL
+    _st_thread_t *wheel[_ST_TW_SLOTS]; /* slots of timing wheel for this vp */
+    unsigned long long wheel_bits[_ST_TW_L0_SIZE / 64]; /* the non-empty slots of level 0 */
+    st_utime_t wheel_tick;      /* the current tick of timing wheel */
+#else
     _st_thread_t *sleep_q;      /* sleep queue for this vp */
+#endif
     int sleepq_size;          /* number of threads on sleep queue */
 
 #ifdef ST_SWITCH_CB
@@ -285,8 +308,17 @@ extern _st_eventsys_t *_st_eventsys;
 
 #define _ST_PAGE_SIZE                   (_st_this_vp.pagesize)
 
-#define _ST_SLEEPQ                      (_st_this_vp.sleep_q)
+#ifndef ST_NO_TIMING_WHEEL
+    #define _ST_WHEEL                       (_st_this_vp.wheel)
+    #define _ST_WHEEL_BITS                  (_st_this_vp.wheel_bits)
+    #define _ST_WHEEL_TICK                  (_st_this_vp.wheel_tick)
+    #define _ST_SLEEPQ_DUE()                _st_sleep_q_due()
+#else
+    #define _ST_SLEEPQ                      (_st_this_vp.sleep_q)
+    #define _ST_SLEEPQ_DUE()                (_ST_SLEEPQ->due)
+#endif
 #define _ST_SLEEPQ_SIZE                 (_st_this_vp.sleepq_size)
+#define _ST_SLEEPQ_EMPTY()              (_ST_SLEEPQ_SIZE == 0)
 
 #define _ST_VP_IDLE()                   (*_st_eventsys->dispatch)()
 
@@ -462,6 +494,9 @@ void _st_thread_main(void);
 void _st_thread_cleanup(_st_thread_t *thread);
 void _st_add_sleep_q(_st_thread_t *thread, st_utime_t timeout);
 void _st_del_sleep_q(_st_thread_t *thread);
+#ifndef ST_NO_TIMING_WHEEL
+st_utime_t _st_sleep_q_due(void);
+#endif
 _st_stack_t *_st_stack_new(int stack_size);
 void _st_stack_free(_st_stack_t *ts);
 int _st_io_init(void);
@@ -308,7 +308,7 @@ ST_HIDDEN void _st_select_dispatch(void)
     fd_set *rp, *wp, *ep;
     int nfd, pq_max_osfd, osfd;
     _st_clist_t *q;
-    st_utime_t min_timeout;
+    st_utime_t min_timeout, due;
     _st_pollq_t *pq;
     int notify;
     struct pollfd *pds, *epds;
@@ -325,11 +325,11 @@ ST_HIDDEN void _st_select_dispatch(void)
     wp = &w;
     ep = &e;
 
-    if (_ST_SLEEPQ == NULL) {
+    if (_ST_SLEEPQ_EMPTY()) {
         tvp = NULL;
     } else {
-        min_timeout = (_ST_SLEEPQ->due <= _ST_LAST_CLOCK) ? 0 :
-            (_ST_SLEEPQ->due - _ST_LAST_CLOCK);
+        due = _ST_SLEEPQ_DUE();
+        min_timeout = (due <= _ST_LAST_CLOCK) ? 0 : (due - _ST_LAST_CLOCK);
         timeout.tv_sec  = (int) (min_timeout / 1000000);
         timeout.tv_usec = (int) (min_timeout % 1000000);
         tvp = &timeout;
@@ -505,7 +505,7 @@ ST_HIDDEN void _st_poll_dispatch(void)
 {
     int timeout, nfd;
     _st_clist_t *q;
-    st_utime_t min_timeout;
+    st_utime_t min_timeout, due;
     _st_pollq_t *pq;
     struct pollfd *pds, *epds, *pollfds;
 
@@ -531,11 +531,11 @@ ST_HIDDEN void _st_poll_dispatch(void)
     }
     ST_ASSERT(pollfds <= _ST_POLLFDS + _ST_POLLFDS_SIZE);
 
-    if (_ST_SLEEPQ == NULL) {
+    if (_ST_SLEEPQ_EMPTY()) {
         timeout = -1;
     } else {
-        min_timeout = (_ST_SLEEPQ->due <= _ST_LAST_CLOCK) ? 0 :
-            (_ST_SLEEPQ->due - _ST_LAST_CLOCK);
+        due = _ST_SLEEPQ_DUE();
+        min_timeout = (due <= _ST_LAST_CLOCK) ? 0 : (due - _ST_LAST_CLOCK);
         timeout = (int) (min_timeout / 1000);
     }
 
@@ -846,17 +846,18 @@ ST_HIDDEN void _st_kq_dispatch(void)
 {
     struct timespec timeout, *tsp;
     struct kevent kev;
-    st_utime_t min_timeout;
+    st_utime_t min_timeout, due;
     _st_clist_t *q;
     _st_pollq_t *pq;
     struct pollfd *pds, *epds;
     int nfd, i, osfd, notify, filter;
     short events, revents;
 
-    if (_ST_SLEEPQ == NULL) {
+    if (_ST_SLEEPQ_EMPTY()) {
         tsp = NULL;
     } else {
-        min_timeout = (_ST_SLEEPQ->due <= _ST_LAST_CLOCK) ? 0 : (_ST_SLEEPQ->due - _ST_LAST_CLOCK);
+        due = _ST_SLEEPQ_DUE();
+        min_timeout = (due <= _ST_LAST_CLOCK) ? 0 : (due - _ST_LAST_CLOCK);
         timeout.tv_sec  = (time_t) (min_timeout / 1000000);
         timeout.tv_nsec = (long) ((min_timeout % 1000000) * 1000);
         tsp = &timeout;
@@ -1204,7 +1205,7 @@ ST_HIDDEN int _st_epoll_pollset_add(struct pollfd *pds, int npds)
 
 ST_HIDDEN void _st_epoll_dispatch(void)
 {
-    st_utime_t min_timeout;
+    st_utime_t min_timeout, due;
     _st_clist_t *q;
     _st_pollq_t *pq;
     struct pollfd *pds, *epds;
@@ -1217,10 +1218,11 @@ ST_HIDDEN void _st_epoll_dispatch(void)
     ++_st_stat_epoll;
     #endif
 
-    if (_ST_SLEEPQ == NULL) {
+    if (_ST_SLEEPQ_EMPTY()) {
         timeout = -1;
     } else {
-        min_timeout = (_ST_SLEEPQ->due <= _ST_LAST_CLOCK) ? 0 : (_ST_SLEEPQ->due - _ST_LAST_CLOCK);
+        due = _ST_SLEEPQ_DUE();
+        min_timeout = (due <= _ST_LAST_CLOCK) ? 0 : (due - _ST_LAST_CLOCK);
         timeout = (int) (min_timeout / 1000);
 
         // At least wait 1ms when <1ms, to avoid epoll_wait spin loop.
@@ -70,6 +70,9 @@ unsigned long long _st_stat_sendmsg = 0;
 unsigned long long _st_stat_sendmsg_eagain = 0;
 #endif
 
+// The number of writes blocked by the full send buffer, always enabled to detect the overload.
+unsigned long long _st_stat_writev_blocked = 0;
+
 #if EAGAIN != EWOULDBLOCK
     #define _IO_NOT_READY_ERROR  ((errno == EAGAIN) || (errno == EWOULDBLOCK))
 #else
@@ -659,6 +662,7 @@ ssize_t st_writev(_st_netfd_t *fd, const struct iovec *iov, int iov_size, st_uti
         #if defined(DEBUG) && defined(DEBUG_STATS)
         ++_st_stat_writev_eagain;
         #endif
+        ++_st_stat_writev_blocked;
 
         /* Wait until the socket becomes writable */
         if (st_netfd_poll(fd, POLLOUT, timeout) < 0) {
@@ -711,6 +715,7 @@ int st_writev_resid(_st_netfd_t *fd, struct iovec **iov, int *iov_size, st_utime
         #if defined(DEBUG) && defined(DEBUG_STATS)
         ++_st_stat_writev_eagain;
         #endif
+        ++_st_stat_writev_blocked;
 
         /* Wait until the socket becomes writable */
         if (st_netfd_poll(fd, POLLOUT, timeout) < 0)
@@ -101,6 +101,10 @@ extern void st_thread_interrupt(st_thread_t thread);
 extern void st_thread_yield();
 extern st_thread_t st_thread_create(void *(*start)(void *arg), void *arg, int joinable, int stack_size);
 extern int st_randomize_stacks(int on);
+extern int st_set_stack_pool(int max_free);
+extern int st_set_stack_guard(int on);
+extern int st_set_stack_watermark(int on);
+extern int st_thread_stack_usage(st_thread_t thread);
 extern int st_set_utime_function(st_utime_t (*func)(void));
 
 extern st_utime_t st_utime(void);
@@ -191,6 +191,9 @@ int st_init(void)
     
     _st_this_vp.pagesize = getpagesize();
     _st_this_vp.last_clock = st_utime();
+#ifndef ST_NO_TIMING_WHEEL
+    _st_this_vp.wheel_tick = _st_this_vp.last_clock / _ST_TW_TICK;
+#endif
     
     /*
      * Create idle thread
@@ -367,6 +370,7 @@ void _st_thread_main(void)
 }
 
 
+#ifdef ST_NO_TIMING_WHEEL
 /*
  * Insert "thread" into the timeout heap, in the position
  * specified by thread->heap_index.  See docs/timeout_heap.txt
@@ -498,11 +502,206 @@ void _st_del_sleep_q(_st_thread_t *thread)
     heap_delete(thread);
     thread->flags &= ~_ST_FL_ON_SLEEPQ;
 }
+#else
+/*
+ * The slot of level n (n >= 1) in timing wheel, for the tick. The level 0 is
+ * indexed by the low 8 bits of tick, and level n by the next 6 bits.
+ */
+#define _ST_TW_SHIFT(n)         (_ST_TW_L0_BITS + ((n) - 1) * _ST_TW_LN_BITS)
+#define _ST_TW_SLOT(n, tick)    (_ST_TW_L0_SIZE + ((n) - 1) * _ST_TW_LN_SIZE + \
+    (int)(((tick) >> _ST_TW_SHIFT(n)) & (_ST_TW_LN_SIZE - 1)))
+
+/*
+ * Insert "thread" into the timing wheel, at the slot by thread->due. The
+ * thread which will expire in 256ms is put in level 0, a slot for each tick,
+ * otherwise it's put in the higher level, and moved to the lower level when
+ * the wheel turns to it, see wheel_cascade().
+ */
+static void wheel_insert(_st_thread_t *thread)
+{
+    st_utime_t tick = thread->due / _ST_TW_TICK;
+    st_utime_t delta;
+    int n, slot;
+
+    /* The thread which is already expired, is put in the current slot. */
+    if (tick < _ST_WHEEL_TICK)
+        tick = _ST_WHEEL_TICK;
+    delta = tick - _ST_WHEEL_TICK;
+
+    if (delta < _ST_TW_L0_SIZE) {
+        slot = (int)(tick & (_ST_TW_L0_SIZE - 1));
+        _ST_WHEEL_BITS[slot >> 6] |= 1ULL << (slot & 63);
+    } else {
+        for (n = 1; n < _ST_TW_LEVELS - 1; n++) {
+            if (delta < (1ULL << _ST_TW_SHIFT(n + 1)))
+                break;
+        }
+        /* Out of the wheel, put in the farthest slot, and insert again when cascade. */
+        if (delta >= (1ULL << _ST_TW_SHIFT(_ST_TW_LEVELS)))
+            tick = _ST_WHEEL_TICK + (1ULL << _ST_TW_SHIFT(_ST_TW_LEVELS)) - 1;
+        slot = _ST_TW_SLOT(n, tick);
+    }
+
+    thread->heap_index = slot;
+    thread->left = NULL;
+    thread->right = _ST_WHEEL[slot];
+    if (thread->right)
+        thread->right->left = thread;
+    _ST_WHEEL[slot] = thread;
+}
+
+
+/*
+ * Delete "thread" from the timing wheel, in O(1).
+ */
+static void wheel_delete(_st_thread_t *thread)
+{
+    int slot = thread->heap_index;
+
+    if (thread->left)
+        thread->left->right = thread->right;
+    else
+        _ST_WHEEL[slot] = thread->right;
+    if (thread->right)
+        thread->right->left = thread->left;
+    thread->left = thread->right = NULL;
+
+    if (slot < _ST_TW_L0_SIZE && _ST_WHEEL[slot] == NULL)
+        _ST_WHEEL_BITS[slot >> 6] &= ~(1ULL << (slot & 63));
+}
+
+
+/*
+ * Move the threads in the higher levels to the lower levels, when the level 0
+ * turns a round. The level n+1 is cascaded when level n turns a round.
+ */
+static void wheel_cascade(void)
+{
+    _st_thread_t *thread, *next;
+    int n, slot;
+
+    for (n = 1; n < _ST_TW_LEVELS; n++) {
+        slot = _ST_TW_SLOT(n, _ST_WHEEL_TICK);
+        thread = _ST_WHEEL[slot];
+        _ST_WHEEL[slot] = NULL;
+        for (; thread; thread = next) {
+            next = thread->right;
+            wheel_insert(thread);
+        }
+
+        if (((_ST_WHEEL_TICK >> _ST_TW_SHIFT(n)) & (_ST_TW_LN_SIZE - 1)) != 0)
+            break;
+    }
+}
+
+
+/*
+ * Get the next tick that level 0 has threads in this round, or the tick of
+ * next round to cascade the higher levels.
+ */
+static st_utime_t wheel_next_tick(void)
+{
+    int i = (int)(_ST_WHEEL_TICK & (_ST_TW_L0_SIZE - 1));
+    int w = i >> 6;
+    unsigned long long bits = _ST_WHEEL_BITS[w] & (~0ULL << (i & 63));
+
+    for (;;) {
+        if (bits)
+            return _ST_WHEEL_TICK - i + (w << 6) + __builtin_ctzll(bits);
+        if (++w == _ST_TW_L0_SIZE / 64)
+            break;
+        bits = _ST_WHEEL_BITS[w];
+    }
+
+    return _ST_WHEEL_TICK - i + _ST_TW_L0_SIZE;
+}
+
+
+void _st_add_sleep_q(_st_thread_t *thread, st_utime_t timeout)
+{
+    thread->due = _ST_LAST_CLOCK + timeout;
+    thread->flags |= _ST_FL_ON_SLEEPQ;
+    ++_ST_SLEEPQ_SIZE;
+    wheel_insert(thread);
+}
+
+
+void _st_del_sleep_q(_st_thread_t *thread)
+{
+    wheel_delete(thread);
+    --_ST_SLEEPQ_SIZE;
+    thread->flags &= ~_ST_FL_ON_SLEEPQ;
+}
+
+
+/*
+ * The earliest time to wakeup for the event system, which is the due of the
+ * first thread in level 0, or the time to cascade the higher levels.
+ */
+st_utime_t _st_sleep_q_due(void)
+{
+    st_utime_t tick = wheel_next_tick();
+    st_utime_t due;
+    _st_thread_t *thread;
+
+    if (tick >= (_ST_WHEEL_TICK | (_ST_TW_L0_SIZE - 1)) + 1)
+        return tick * _ST_TW_TICK;
+
+    thread = _ST_WHEEL[tick & (_ST_TW_L0_SIZE - 1)];
+    for (due = thread->due; thread; thread = thread->right) {
+        if (due > thread->due)
+            due = thread->due;
+    }
+    return due;
+}
+#endif
+
+
+/*
+ * Make the sleeping "thread" runnable, when it's expired.
+ */
+static void _st_vp_expire(_st_thread_t *thread)
+{
+    ST_ASSERT(thread->flags & _ST_FL_ON_SLEEPQ);
+    _ST_DEL_SLEEPQ(thread);
+
+    /* If thread is waiting on condition variable, set the time out flag */
+    if (thread->state == _ST_ST_COND_WAIT)
+        thread->flags |= _ST_FL_TIMEDOUT;
+
+    /* Make thread runnable */
+    ST_ASSERT(!(thread->flags & _ST_FL_IDLE_THREAD));
+    thread->state = _ST_ST_RUNNABLE;
+    // Insert at the head of RunQ, to execute timer first.
+    _ST_INSERT_RUNQ(thread);
+}
+
+
+#ifndef ST_NO_TIMING_WHEEL
+/*
+ * Expire the threads in the slot of level 0, which are due before "now".
+ */
+static void wheel_expire(st_utime_t now)
+{
+    _st_thread_t *thread = _ST_WHEEL[_ST_WHEEL_TICK & (_ST_TW_L0_SIZE - 1)];
+    _st_thread_t *next;
+
+    for (; thread; thread = next) {
+        next = thread->right;
+        if (thread->due <= now)
+            _st_vp_expire(thread);
+    }
+}
+#endif
 
 
 void _st_vp_check_clock(void)
 {
+#ifndef ST_NO_TIMING_WHEEL
+    st_utime_t tick, next;
+#else
     _st_thread_t *thread;
+#endif
     st_utime_t elapsed, now;
     
     now = st_utime();
@@ -536,23 +735,35 @@ void _st_vp_check_clock(void)
         _st_last_tset = now;
     }
     
+#ifndef ST_NO_TIMING_WHEEL
+    /*
+     * Turn the wheel to now, all threads in the passed ticks are expired, and
+     * skip the empty ticks. Note that the clock might step back.
+     */
+    tick = now / _ST_TW_TICK;
+    while (_ST_WHEEL_TICK < tick) {
+        next = wheel_next_tick();
+        if (next > _ST_WHEEL_TICK) {
+            _ST_WHEEL_TICK = (next < tick) ? next : tick;
+        } else {
+            wheel_expire(now);
+            _ST_WHEEL_TICK++;
+        }
+
+        if ((_ST_WHEEL_TICK & (_ST_TW_L0_SIZE - 1)) == 0)
+            wheel_cascade();
+    }
+
+    /* The threads in current tick, might not expired. */
+    wheel_expire(now);
+#else
     while (_ST_SLEEPQ != NULL) {
         thread = _ST_SLEEPQ;
-        ST_ASSERT(thread->flags & _ST_FL_ON_SLEEPQ);
         if (thread->due > now)
             break;
-        _ST_DEL_SLEEPQ(thread);
-        
-        /* If thread is waiting on condition variable, set the time out flag */
-        if (thread->state == _ST_ST_COND_WAIT)
-            thread->flags |= _ST_FL_TIMEDOUT;
-        
-        /* Make thread runnable */
-        ST_ASSERT(!(thread->flags & _ST_FL_IDLE_THREAD));
-        thread->state = _ST_ST_RUNNABLE;
-        // Insert at the head of RunQ, to execute timer first.
-        _ST_INSERT_RUNQ(thread);
+        _st_vp_expire(thread);
     }
+#endif
 }
 
 
@@ -44,6 +44,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <string.h>
 #include "common.h"
 
 
@@ -53,27 +54,51 @@
 _st_clist_t _st_free_stacks = ST_INIT_STATIC_CLIST(&_st_free_stacks);
 int _st_num_free_stacks = 0;
 int _st_randomize_stacks = 0;
+/* The max number of free stacks to reuse, -1 for no limit */
+int _st_max_free_stacks = -1;
+/* Whether protect the redzones, to crash when stack overflow */
+#if defined(DEBUG) && !defined(MALLOC_STACK)
+int _st_stack_guard = 1;
+#else
+int _st_stack_guard = 0;
+#endif
+/* Whether zero the stack, to get the high water-level of stack usage */
+int _st_stack_watermark = 0;
 
 static char *_st_new_stk_segment(int size);
+static void _st_delete_stk_segment(char *vaddr, int size);
+static int _st_stack_dirty_size(_st_stack_t *ts);
 
 _st_stack_t *_st_stack_new(int stack_size)
 {
     _st_clist_t *qp;
-    _st_stack_t *ts;
+    _st_stack_t *ts, *best = NULL;
     int extra;
     
+    /* Find the smallest stack that is big enough, for stacks in different size */
     for (qp = _st_free_stacks.next; qp != &_st_free_stacks; qp = qp->next) {
         ts = _ST_THREAD_STACK_PTR(qp);
-        if (ts->stk_size >= stack_size) {
-            /* Found a stack that is big enough */
-            ST_REMOVE_LINK(&ts->links);
-            _st_num_free_stacks--;
-            ts->links.next = NULL;
-            ts->links.prev = NULL;
-            return ts;
+        if (ts->stk_size >= stack_size && (!best || ts->stk_size < best->stk_size)) {
+            best = ts;
+            if (ts->stk_size == stack_size)
+                break;
         }
     }
     
+    if ((ts = best) != NULL) {
+        ST_REMOVE_LINK(&ts->links);
+        _st_num_free_stacks--;
+        ts->links.next = NULL;
+        ts->links.prev = NULL;
+        
+        /* Only zero the dirty portion, which is used by the previous thread */
+        if (_st_stack_watermark) {
+            memset(ts->stk_top - ts->dirty_size, 0, ts->dirty_size);
+            ts->dirty_size = 0;
+        }
+        return ts;
+    }
+    
     /* Make a new thread stack object. */
     if ((ts = (_st_stack_t *)calloc(1, sizeof(_st_stack_t))) == NULL)
         return NULL;
@@ -88,10 +113,11 @@ _st_stack_t *_st_stack_new(int stack_size)
     ts->stk_bottom = ts->vaddr + REDZONE;
     ts->stk_top = ts->stk_bottom + stack_size;
     
-#ifdef DEBUG
-    mprotect(ts->vaddr, REDZONE, PROT_NONE);
-    mprotect(ts->stk_top + extra, REDZONE, PROT_NONE);
-#endif
+    if (_st_stack_guard) {
+        mprotect(ts->vaddr, REDZONE, PROT_NONE);
+        mprotect(ts->stk_top + extra, REDZONE, PROT_NONE);
+        ts->guarded = 1;
+    }
     
     if (extra) {
         long offset = (random() % extra) & ~0xf;
@@ -100,6 +126,12 @@ _st_stack_t *_st_stack_new(int stack_size)
         ts->stk_top += offset;
     }
     
+    ts->dirty_size = stack_size;
+    if (_st_stack_watermark) {
+        memset(ts->stk_bottom, 0, stack_size);
+        ts->dirty_size = 0;
+    }
+    
     return ts;
 }
 
@@ -109,19 +141,51 @@ _st_stack_t *_st_stack_new(int stack_size)
  */
 void _st_stack_free(_st_stack_t *ts)
 {
+    _st_stack_t *oldest;
+    
     if (!ts)
         return;
     
+    /* The whole stack is dirty, if not zeroed when reused */
+    ts->dirty_size = _st_stack_watermark ? _st_stack_dirty_size(ts) : ts->stk_size;
+    
     /* Put the stack on the free list */
     ST_APPEND_LINK(&ts->links, _st_free_stacks.prev);
     _st_num_free_stacks++;
+    
+    /*
+     * Release the oldest stacks if exceed the max free stacks. Note that the
+     * stack is still used by current thread, so we never release it here.
+     */
+    while (_st_max_free_stacks >= 0 && _st_num_free_stacks > _st_max_free_stacks) {
+        oldest = _ST_THREAD_STACK_PTR(_st_free_stacks.next);
+        if (oldest == ts)
+            break;
+        
+        ST_REMOVE_LINK(&oldest->links);
+        _st_num_free_stacks--;
+        
+        if (oldest->guarded) {
+            mprotect(oldest->vaddr, oldest->vaddr_size, PROT_READ | PROT_WRITE);
+        }
+        _st_delete_stk_segment(oldest->vaddr, oldest->vaddr_size);
+        free(oldest);
+    }
 }
 
 
 static char *_st_new_stk_segment(int size)
 {
 #ifdef MALLOC_STACK
-    void *vaddr = malloc(size);
+    void *vaddr = NULL;
+    
+    /* The redzones should be aligned to page, to protect them. */
+    if (_st_stack_guard) {
+        if (posix_memalign(&vaddr, _ST_PAGE_SIZE, size) != 0)
+            return NULL;
+    } else {
+        vaddr = malloc(size);
+    }
 #else
     static int zero_fd = -1;
     int mmap_flags = MAP_PRIVATE;
@@ -149,9 +213,7 @@ static char *_st_new_stk_segment(int size)
 }
 
 
-/* Not used */
-#if 0
-void _st_delete_stk_segment(char *vaddr, int size)
+static void _st_delete_stk_segment(char *vaddr, int size)
 {
 #ifdef MALLOC_STACK
     free(vaddr);
@@ -159,7 +221,62 @@ void _st_delete_stk_segment(char *vaddr, int size)
     (void) munmap(vaddr, size);
 #endif
 }
-#endif
+
+
+/*
+ * The size of dirty portion of stack, from the top to the lowest non-zero
+ * word, which is the high water-level of usage if the stack is zeroed.
+ */
+static int _st_stack_dirty_size(_st_stack_t *ts)
+{
+    long *p = (long *)ts->stk_bottom;
+    long *end = (long *)ts->stk_top;
+    
+    while (p < end && *p == 0)
+        p++;
+    
+    return (int)(ts->stk_top - (char *)p);
+}
+
+
+int st_set_stack_pool(int max_free)
+{
+    int old = _st_max_free_stacks;
+    
+    _st_max_free_stacks = max_free;
+    
+    return old;
+}
+
+
+int st_set_stack_guard(int on)
+{
+    int wason = _st_stack_guard;
+    
+    _st_stack_guard = on;
+    
+    return wason;
+}
+
+
+int st_set_stack_watermark(int on)
+{
+    int wason = _st_stack_watermark;
+    
+    _st_stack_watermark = on;
+    
+    return wason;
+}
+
+
+int st_thread_stack_usage(_st_thread_t *thread)
+{
+    /* The primordial thread uses the stack of process */
+    if (!_st_stack_watermark || !thread->stack)
+        return -1;
+    
+    return _st_stack_dirty_size(thread->stack);
+}
 
 int st_randomize_stacks(int on)
 {
@@ -0,0 +1,107 @@
+/*
+g++ timer-wheel.cpp ../../objs/st/libst.a -g -O2 -o timer-wheel && ./timer-wheel 100000
+
+To compare with the timeout heap, build ST with ST_NO_TIMING_WHEEL, for example:
+    cp -r ../../3rdparty/st-srs /tmp/st-heap && (cd /tmp/st-heap && make linux-debug EXTRA_CFLAGS="-O0 -DMALLOC_STACK -DST_NO_TIMING_WHEEL")
+    g++ timer-wheel.cpp /tmp/st-heap/obj/libst.a -g -O2 -o timer-heap && ./timer-heap 100000
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <stdint.h>
+#include "../../objs/st/st.h"
+
+st_cond_t cond;
+int nn_rounds = 10;
+bool quit = false;
+
+// The lateness of expired timers, in us.
+int64_t nn_expired = 0;
+int64_t total_late = 0;
+int64_t max_late = 0;
+
+int64_t now_us() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+// Wait on condition with long timeout, which is canceled by broadcast, like a
+// recv with timeout and the data arrives.
+void* waiter(void* arg) {
+    while (!quit) {
+        st_utime_t timeout = (1 + random() % 60) * 1000 * 1000;
+        st_cond_timedwait(cond, timeout);
+    }
+    return NULL;
+}
+
+// Sleep for random short time, which is expired by the timer.
+void* sleeper(void* arg) {
+    int64_t timeout = (1 + random() % 1000) * 1000;
+    // The timer is due from the last clock of ST, not now.
+    int64_t due = (int64_t)st_utime_last_clock() + timeout;
+    st_usleep(timeout);
+
+    int64_t late = (int64_t)st_utime() - due;
+    nn_expired++;
+    total_late += late;
+    if (max_late < late) {
+        max_late = late;
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("Usage: %s nn_timers [nn_rounds]\n", argv[0]);
+        exit(-1);
+    }
+
+    st_init();
+    int nn = ::atoi(argv[1]);
+    if (argc > 2) {
+        nn_rounds = ::atoi(argv[2]);
+    }
+    cond = st_cond_new();
+
+    // Insert and cancel the timers.
+    for (int i = 0; i < nn; i++) {
+        if (!st_thread_create(waiter, NULL, 0, 0)) {
+            printf("create thread fail, i=%d\n", i);
+            return -1;
+        }
+    }
+    st_usleep(0);
+
+    int64_t starttime = now_us();
+    for (int i = 0; i < nn_rounds; i++) {
+        st_cond_broadcast(cond);
+        st_usleep(0);
+    }
+    int64_t cost = now_us() - starttime;
+    printf("insert/cancel: %d timers, %d rounds, cost=%dms, %.1fns/timer\n",
+        nn, nn_rounds, (int)(cost / 1000), cost * 1000.0 / nn / nn_rounds);
+
+    quit = true;
+    st_cond_broadcast(cond);
+    st_usleep(0);
+
+    // Expire the timers.
+    st_thread_t* threads = new st_thread_t[nn];
+    for (int i = 0; i < nn; i++) {
+        threads[i] = st_thread_create(sleeper, NULL, 1, 0);
+    }
+
+    starttime = now_us();
+    for (int i = 0; i < nn; i++) {
+        st_thread_join(threads[i], NULL);
+    }
+    cost = now_us() - starttime;
+    printf("expire: %d timers, cost=%dms, late avg=%dus, max=%dus\n",
+        (int)nn_expired, (int)(cost / 1000), (int)(total_late / nn_expired), (int)max_late);
+
+    delete[] threads;
+    return 0;
+}
@@ -0,0 +1,315 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_app_admission.hpp>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_hybrid.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_app_statistic.hpp>
+
+// The interval to cleanup the idle buckets and print the stat.
+#define SRS_ADMISSION_CLEANUP_INTERVAL (1 * SRS_UTIME_SECONDS)
+
+SrsTokenBucket::SrsTokenBucket(double rate, double burst, srs_utime_t now)
+{
+    rate_ = rate;
+    burst_ = srs_max(1, burst);
+    tokens_ = burst_;
+    last_ = now;
+}
+
+SrsTokenBucket::~SrsTokenBucket()
+{
+}
+
+bool SrsTokenBucket::consume(srs_utime_t now)
+{
+    refill(now);
+
+    if (tokens_ < 1) {
+        return false;
+    }
+
+    tokens_--;
+    return true;
+}
+
+bool SrsTokenBucket::full(srs_utime_t now)
+{
+    refill(now);
+    return tokens_ >= burst_;
+}
+
+void SrsTokenBucket::refill(srs_utime_t now)
+{
+    // Ignore if clock step back.
+    if (now <= last_) {
+        return;
+    }
+
+    tokens_ = srs_min(burst_, tokens_ + rate_ * (now - last_) / SRS_UTIME_SECONDS);
+    last_ = now;
+}
+
+ISrsAdmissionHandler::ISrsAdmissionHandler()
+{
+}
+
+ISrsAdmissionHandler::~ISrsAdmissionHandler()
+{
+}
+
+SrsDeferredClient::SrsDeferredClient(int t, srs_netfd_t fd, srs_utime_t now)
+{
+    type = t;
+    stfd = fd;
+    starttime = now;
+}
+
+SrsDeferredClient::~SrsDeferredClient()
+{
+}
+
+SrsAdmission* _srs_admission = NULL;
+
+SrsAdmission::SrsAdmission()
+{
+    enabled_ = false;
+    rate_ = burst_ = ip_rate_ = ip_burst_ = max_deferred_ = 0;
+    defer_timeout_ = 0;
+
+    handler_ = NULL;
+    global_ = NULL;
+    last_cleanup_ = 0;
+
+    nn_accepted_ = nn_deferred_ = nn_admitted_ = nn_rejected_ = nn_expired_ = 0;
+    nn_last_deferred_ = nn_last_rejected_ = 0;
+}
+
+SrsAdmission::~SrsAdmission()
+{
+    srs_freep(global_);
+
+    std::map<std::string, SrsTokenBucket*>::iterator it;
+    for (it = ips_.begin(); it != ips_.end(); ++it) {
+        SrsTokenBucket* bucket = it->second;
+        srs_freep(bucket);
+    }
+    ips_.clear();
+
+    std::deque<SrsDeferredClient*>::iterator itc;
+    for (itc = deferred_.begin(); itc != deferred_.end(); ++itc) {
+        SrsDeferredClient* c = *itc;
+        srs_close_stfd(c->stfd);
+        srs_freep(c);
+    }
+    deferred_.clear();
+}
+
+srs_error_t SrsAdmission::initialize(ISrsAdmissionHandler* h)
+{
+    srs_error_t err = srs_success;
+
+    setup(h, _srs_config->get_admission_rate(), _srs_config->get_admission_burst(),
+        _srs_config->get_admission_ip_rate(), _srs_config->get_admission_ip_burst(),
+        _srs_config->get_admission_max_deferred(), _srs_config->get_admission_defer_timeout());
+    enabled_ = _srs_config->get_admission_enabled();
+
+    // Admit the deferred clients in the global rate.
+    if (enabled_) {
+        _srs_hybrid->timer100ms()->subscribe(this);
+    }
+
+    srs_trace("Admission: enabled=%d, rate=%d/%d, ip=%d/%d, defer=%d/%dms", enabled_, rate_, burst_,
+        ip_rate_, ip_burst_, max_deferred_, srsu2msi(defer_timeout_));
+
+    return err;
+}
+
+void SrsAdmission::setup(ISrsAdmissionHandler* h, int rate, int burst, int ip_rate, int ip_burst, int max_deferred, srs_utime_t defer_timeout)
+{
+    handler_ = h;
+    enabled_ = true;
+    rate_ = rate;
+    burst_ = burst;
+    ip_rate_ = ip_rate;
+    ip_burst_ = ip_burst;
+    max_deferred_ = max_deferred;
+    defer_timeout_ = defer_timeout;
+
+    srs_freep(global_);
+    global_ = new SrsTokenBucket(rate_, burst_, srs_get_system_time());
+}
+
+bool SrsAdmission::enabled()
+{
+    return enabled_;
+}
+
+SrsAdmissionResult SrsAdmission::admit(string ip, int type, srs_netfd_t stfd)
+{
+    if (!enabled_ || ip.empty()) {
+        nn_accepted_++;
+        return SrsAdmissionAccept;
+    }
+
+    // Reject all new clients, to save the live streams.
+    if (_srs_circuit_breaker && _srs_circuit_breaker->hybrid_dying_water_level()) {
+        nn_rejected_++;
+        return SrsAdmissionReject;
+    }
+
+    srs_utime_t now = srs_get_system_time();
+
+    // Reject the client which reconnects too fast.
+    SrsTokenBucket* bucket = NULL;
+    std::map<std::string, SrsTokenBucket*>::iterator it = ips_.find(ip);
+    if (it != ips_.end()) {
+        bucket = it->second;
+    } else {
+        bucket = ips_[ip] = new SrsTokenBucket(ip_rate_, ip_burst_, now);
+    }
+    if (!bucket->consume(now)) {
+        nn_rejected_++;
+        return SrsAdmissionReject;
+    }
+
+    // Accept the client if not overload, and no client is waiting before it.
+    bool high = _srs_circuit_breaker && _srs_circuit_breaker->hybrid_high_water_level();
+    if (!high && deferred_.empty() && global_->consume(now)) {
+        nn_accepted_++;
+        return SrsAdmissionAccept;
+    }
+
+    // Defer the handshake of client, util admitted by timer.
+    if ((int)deferred_.size() < max_deferred_) {
+        deferred_.push_back(new SrsDeferredClient(type, stfd, now));
+        nn_deferred_++;
+        return SrsAdmissionDefer;
+    }
+
+    nn_rejected_++;
+    return SrsAdmissionReject;
+}
+
+int SrsAdmission::nn_deferred()
+{
+    return (int)deferred_.size();
+}
+
+void SrsAdmission::dumps(SrsJsonObject* obj)
+{
+    obj->set("enabled", SrsJsonAny::boolean(enabled_));
+    obj->set("accepted", SrsJsonAny::integer(nn_accepted_));
+    obj->set("deferred", SrsJsonAny::integer(nn_deferred_));
+    obj->set("admitted", SrsJsonAny::integer(nn_admitted_));
+    obj->set("rejected", SrsJsonAny::integer(nn_rejected_));
+    obj->set("expired", SrsJsonAny::integer(nn_expired_));
+    obj->set("waiting", SrsJsonAny::integer((int)deferred_.size()));
+}
+
+void SrsAdmission::dumps_metrics(string& out)
+{
+    srs_metrics_family(out, "srs_admission_accepted", "counter", "The clients accepted by admission.");
+    srs_metrics_sample(out, "srs_admission_accepted_total", "", nn_accepted_);
+    srs_metrics_family(out, "srs_admission_deferred", "counter", "The clients deferred by admission.");
+    srs_metrics_sample(out, "srs_admission_deferred_total", "", nn_deferred_);
+    srs_metrics_family(out, "srs_admission_admitted", "counter", "The deferred clients admitted.");
+    srs_metrics_sample(out, "srs_admission_admitted_total", "", nn_admitted_);
+    srs_metrics_family(out, "srs_admission_rejected", "counter", "The clients rejected by admission.");
+    srs_metrics_sample(out, "srs_admission_rejected_total", "", nn_rejected_);
+    srs_metrics_family(out, "srs_admission_waiting", "gauge", "The number of deferred clients waiting.");
+    srs_metrics_sample(out, "srs_admission_waiting", "", (int64_t)deferred_.size());
+}
+
+srs_error_t SrsAdmission::consume_deferred(srs_utime_t now)
+{
+    srs_error_t err = srs_success;
+
+    bool critical = _srs_circuit_breaker && _srs_circuit_breaker->hybrid_critical_water_level();
+    bool dying = _srs_circuit_breaker && _srs_circuit_breaker->hybrid_dying_water_level();
+
+    while (!deferred_.empty()) {
+        SrsDeferredClient* c = deferred_.front();
+
+        // Reject the client which waits for too long, the client might already give up.
+        if (dying || now - c->starttime > defer_timeout_) {
+            deferred_.pop_front();
+            srs_close_stfd(c->stfd);
+            srs_freep(c);
+            nn_expired_++;
+            nn_rejected_++;
+            continue;
+        }
+
+        // Keep waiting if critical, or no token.
+        if (critical || !global_->consume(now)) {
+            break;
+        }
+
+        deferred_.pop_front();
+        int type = c->type;
+        srs_netfd_t stfd = c->stfd;
+        srs_freep(c);
+
+        nn_admitted_++;
+        if (handler_ && (err = handler_->on_admit_client(type, stfd)) != srs_success) {
+            srs_warn("Admission: admit client failed, err is %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsAdmission::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    srs_utime_t now = srs_get_system_time();
+    if ((err = consume_deferred(now)) != srs_success) {
+        return srs_error_wrap(err, "consume deferred");
+    }
+
+    if (now - last_cleanup_ > SRS_ADMISSION_CLEANUP_INTERVAL) {
+        last_cleanup_ = now;
+        cleanup(now);
+    }
+
+    return err;
+}
+
+void SrsAdmission::cleanup(srs_utime_t now)
+{
+    std::map<std::string, SrsTokenBucket*>::iterator it;
+    for (it = ips_.begin(); it != ips_.end();) {
+        SrsTokenBucket* bucket = it->second;
+        if (!bucket->full(now)) {
+            ++it;
+            continue;
+        }
+
+        ips_.erase(it++);
+        srs_freep(bucket);
+    }
+
+    // Show the stat when clients are deferred or rejected.
+    if (nn_deferred_ != nn_last_deferred_ || nn_rejected_ != nn_last_rejected_) {
+        srs_trace("Admission: accepted=%" PRId64 ", deferred=%" PRId64 "/%d, admitted=%" PRId64 ", rejected=%" PRId64 ", expired=%" PRId64 ", ips=%d",
+            nn_accepted_, nn_deferred_ - nn_last_deferred_, (int)deferred_.size(), nn_admitted_,
+            nn_rejected_ - nn_last_rejected_, nn_expired_, (int)ips_.size());
+        nn_last_deferred_ = nn_deferred_;
+        nn_last_rejected_ = nn_rejected_;
+    }
+}
+
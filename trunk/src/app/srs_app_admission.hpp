@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SRS_APP_ADMISSION_HPP
+#define SRS_APP_ADMISSION_HPP
+
+#include <srs_core.hpp>
+
+#include <map>
+#include <deque>
+#include <string>
+
+#include <srs_service_st.hpp>
+#include <srs_app_hourglass.hpp>
+
+class SrsJsonObject;
+
+// The token bucket to limit the rate, which allows a burst.
+class SrsTokenBucket
+{
+private:
+    // The tokens generated per second.
+    double rate_;
+    // The max tokens in bucket, for burst.
+    double burst_;
+    double tokens_;
+    srs_utime_t last_;
+public:
+    // The bucket is full when created.
+    SrsTokenBucket(double rate, double burst, srs_utime_t now);
+    virtual ~SrsTokenBucket();
+public:
+    // Consume a token at now, return false if no token.
+    bool consume(srs_utime_t now);
+    // Whether bucket is full at now, which means idle.
+    bool full(srs_utime_t now);
+private:
+    void refill(srs_utime_t now);
+};
+
+// The result of admission for new client.
+enum SrsAdmissionResult
+{
+    // Accept the client, to serve it right now.
+    SrsAdmissionAccept = 0,
+    // Defer the client, which is admitted later.
+    SrsAdmissionDefer,
+    // Reject the client, user should close it.
+    SrsAdmissionReject,
+};
+
+// The handler for deferred clients.
+class ISrsAdmissionHandler
+{
+public:
+    ISrsAdmissionHandler();
+    virtual ~ISrsAdmissionHandler();
+public:
+    // When the deferred client is admitted, to serve it.
+    virtual srs_error_t on_admit_client(int type, srs_netfd_t stfd) = 0;
+};
+
+// The client deferred by admission.
+class SrsDeferredClient
+{
+public:
+    int type;
+    srs_netfd_t stfd;
+    srs_utime_t starttime;
+public:
+    SrsDeferredClient(int t, srs_netfd_t fd, srs_utime_t now);
+    virtual ~SrsDeferredClient();
+};
+
+// The admission control for the accept storm, for example, 20k viewers reconnect after an origin
+// blip. The new client consumes a token from the bucket of its IP and the global bucket:
+//      Reject it if no token of its IP, or the circuit breaker is dying water-level.
+//      Defer it if no global token, or the circuit breaker is high water-level, then admit the
+//          deferred clients by timer in the global rate, except critical water-level.
+//      Reject the deferred clients if the queue is full, or wait for too long.
+class SrsAdmission : public ISrsFastTimer
+{
+private:
+    bool enabled_;
+    int rate_;
+    int burst_;
+    int ip_rate_;
+    int ip_burst_;
+    int max_deferred_;
+    srs_utime_t defer_timeout_;
+private:
+    ISrsAdmissionHandler* handler_;
+    SrsTokenBucket* global_;
+    // The token buckets of IPs, removed when idle.
+    std::map<std::string, SrsTokenBucket*> ips_;
+    std::deque<SrsDeferredClient*> deferred_;
+    srs_utime_t last_cleanup_;
+private:
+    // The stat of clients.
+    int64_t nn_accepted_;
+    int64_t nn_deferred_;
+    int64_t nn_admitted_;
+    int64_t nn_rejected_;
+    int64_t nn_expired_;
+    // The stat of last interval to print, to show the change.
+    int64_t nn_last_deferred_;
+    int64_t nn_last_rejected_;
+public:
+    SrsAdmission();
+    virtual ~SrsAdmission();
+public:
+    // Initialize by the config, and admit the deferred clients by handler.
+    srs_error_t initialize(ISrsAdmissionHandler* h);
+    // Setup the handler and limits, and enable the admission.
+    void setup(ISrsAdmissionHandler* h, int rate, int burst, int ip_rate, int ip_burst, int max_deferred, srs_utime_t defer_timeout);
+public:
+    // Whether admission is enabled, the ip of client is not required if disabled.
+    bool enabled();
+    // Admit the new client of ip, the stfd is owned by admission if deferred.
+    // @remark The client without ip is always accepted, for example, the TCP probe of keepalived.
+    SrsAdmissionResult admit(std::string ip, int type, srs_netfd_t stfd);
+    // The number of deferred clients.
+    int nn_deferred();
+    // Dumps the stat of admission to json.
+    void dumps(SrsJsonObject* obj);
+    // Dumps the stat of admission in OpenMetrics text, append to out.
+    void dumps_metrics(std::string& out);
+    // Admit or expire the deferred clients.
+    srs_error_t consume_deferred(srs_utime_t now);
+// Interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
+private:
+    // Remove the idle buckets of IPs.
+    void cleanup(srs_utime_t now);
+};
+
+extern SrsAdmission* _srs_admission;
+
+#endif
+
@@ -21,7 +21,7 @@ class SrsPithyPrint;
 class ISrsHttpResponseReader;
 class SrsFlvDecoder;
 class SrsTcpClient;
-class SrsSimpleRtmpClient;
+class SrsLivePublisher;
 
 #include <srs_app_st.hpp>
 #include <srs_app_listener.hpp>
@@ -61,7 +61,7 @@ private:
     ISrsResourceManager* manager;
     std::string output;
     SrsPithyPrint* pprint;
-    SrsSimpleRtmpClient* sdk;
+    SrsLivePublisher* publisher;
     SrsTcpConnection* skt;
     SrsHttpConn* conn;
 private:
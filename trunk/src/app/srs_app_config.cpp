@@ -1156,6 +1156,28 @@ srs_error_t SrsConfDirective::read_token(SrsConfigBuffer* buffer, vector<string>
     return err;
 }
 
+SrsVhostConfig::SrsVhostConfig()
+{
+    enabled = false;
+    edge = false;
+    atc = false;
+    atc_auto = false;
+    mix_correct = false;
+    time_jitter = 0;
+    gop_cache = false;
+    queue_length = 0;
+    reduce_sequence_header = false;
+    parse_sps = false;
+    rtc_nack_enabled = false;
+    rtc_nack_no_copy = false;
+    rtc_realtime = false;
+    rtc_mw_msgs = 0;
+}
+
+SrsVhostConfig::~SrsVhostConfig()
+{
+}
+
 SrsConfig::SrsConfig()
 {
     dolphin = false;
@@ -1168,10 +1190,15 @@ SrsConfig::SrsConfig()
     root = new SrsConfDirective();
     root->conf_line = 0;
     root->name = "root";
+    
+    generation_ = 0;
+    vhosts_generation_ = 0;
+    vhost_config_default_ = NULL;
 }
 
 SrsConfig::~SrsConfig()
 {
+    clear_vhosts();
     srs_freep(root);
 }
 
@@ -1491,6 +1518,7 @@ srs_error_t SrsConfig::reload_conf(SrsConfig* conf)
     
     root = conf->root;
     conf->root = NULL;
+    generation_++;
     
     // never support reload:
     //      daemon
@@ -2207,6 +2235,8 @@ srs_error_t SrsConfig::global_to_json(SrsJsonObject* obj)
                     sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
                 } else if (sdir->name == "rtp_idle_timeout") {
                     sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
+                } else if (sdir->name == "idle_timeout") {
+                    sobj->set(sdir->name, sdir->dumps_arg0_to_integer());
                 } else if (sdir->name == "audio_enable") {
                     sobj->set(sdir->name, sdir->dumps_arg0_to_boolean());
                 } else if (sdir->name == "jitterbuffer_enable") {
@@ -2294,6 +2324,9 @@ srs_error_t SrsConfig::global_to_json(SrsJsonObject* obj)
         if (get_exec_enabled(dir->arg0())) {
             sobj->set("exec", SrsJsonAny::boolean(true));
         }
+        if (get_shm_fanout_enabled(dir->arg0())) {
+            sobj->set("shm_fanout", SrsJsonAny::boolean(true));
+        }
         if (get_bw_check_enabled(dir->arg0())) {
             sobj->set("bandcheck", SrsJsonAny::boolean(true));
         }
@@ -2431,6 +2464,10 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 cluster->set("vhost", sdir->dumps_arg0_to_str());
             } else if (sdir->name == "debug_srs_upnode") {
                 cluster->set("debug_srs_upnode", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "hot_standby") {
+                cluster->set("hot_standby", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "load_balance") {
+                cluster->set("load_balance", sdir->dumps_arg0_to_str());
             }
         }
     }
@@ -2471,6 +2508,10 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 play->set("mw_latency", sdir->dumps_arg0_to_integer());
             } else if (sdir->name == "gop_cache") {
                 play->set("gop_cache", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "gop_cache_max_size") {
+                play->set("gop_cache_max_size", sdir->dumps_arg0_to_integer());
+            } else if (sdir->name == "gop_cache_max_duration") {
+                play->set("gop_cache_max_duration", sdir->dumps_arg0_to_number());
             } else if (sdir->name == "queue_length") {
                 play->set("queue_length", sdir->dumps_arg0_to_integer());
             } else if (sdir->name == "reduce_sequence_header") {
@@ -2699,6 +2740,12 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 hls->set("hls_key_file_path", sdir->dumps_arg0_to_str());
             } else if (sdir->name == "hls_key_url") {
                 hls->set("hls_key_url", sdir->dumps_arg0_to_str());
+            } else if (sdir->name == "hls_ll") {
+                hls->set("hls_ll", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "hls_part_duration") {
+                hls->set("hls_part_duration", sdir->dumps_arg0_to_number());
+            } else if (sdir->name == "hls_fmp4") {
+                hls->set("hls_fmp4", sdir->dumps_arg0_to_boolean());
             }
         }
     }
@@ -2743,6 +2790,10 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
                 dvr->set("dvr_duration", sdir->dumps_arg0_to_number());
             } else if (sdir->name == "dvr_wait_keyframe") {
                 dvr->set("dvr_wait_keyframe", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "dvr_fmp4") {
+                dvr->set("dvr_fmp4", sdir->dumps_arg0_to_boolean());
+            } else if (sdir->name == "dvr_fmp4_fragment") {
+                dvr->set("dvr_fmp4_fragment", sdir->dumps_arg0_to_number());
             } else if (sdir->name == "time_jitter") {
                 dvr->set("time_jitter", sdir->dumps_arg0_to_str());
             }
@@ -2765,6 +2816,16 @@ srs_error_t SrsConfig::vhost_to_json(SrsConfDirective* vhost, SrsJsonObject* obj
         }
     }
     
+    // shm_fanout
+    if ((dir = vhost->get("shm_fanout")) != NULL) {
+        SrsJsonObject* shm = SrsJsonAny::object();
+        obj->set("shm_fanout", shm);
+        
+        shm->set("enabled", SrsJsonAny::boolean(get_shm_fanout_enabled(vhost->name)));
+        shm->set("dir", SrsJsonAny::str(get_shm_fanout_dir(vhost->name).c_str()));
+        shm->set("size", SrsJsonAny::integer(get_shm_fanout_size(vhost->name) / 1024));
+    }
+    
     // ingest
     SrsJsonArray* ingests = NULL;
     for (int i = 0; i < (int)vhost->directives.size(); i++) {
@@ -3117,6 +3178,7 @@ srs_error_t SrsConfig::raw_create_vhost(string vhost, bool& applied)
     srs_error_t err = srs_success;
     
     applied = false;
+    generation_++;
     
     SrsConfDirective* conf = root->get_or_create("vhost", vhost);
     conf->get_or_create("enabled")->set_arg0("on");
@@ -3135,6 +3197,7 @@ srs_error_t SrsConfig::raw_update_vhost(string vhost, string name, bool& applied
     srs_error_t err = srs_success;
     
     applied = false;
+    generation_++;
     
     // the vhost must be disabled, so we donot need to reload.
     SrsConfDirective* conf = root->get_or_create("vhost", vhost);
@@ -3150,6 +3213,7 @@ srs_error_t SrsConfig::raw_delete_vhost(string vhost, bool& applied)
     srs_error_t err = srs_success;
     
     applied = false;
+    generation_++;
     
     // the vhost must be disabled, so we donot need to reload.
     SrsConfDirective* conf = root->get("vhost", vhost);
@@ -3169,6 +3233,7 @@ srs_error_t SrsConfig::raw_disable_vhost(string vhost, bool& applied)
     srs_error_t err = srs_success;
     
     applied = false;
+    generation_++;
     
     SrsConfDirective* conf = root->get("vhost", vhost);
     srs_assert(conf);
@@ -3189,6 +3254,7 @@ srs_error_t SrsConfig::raw_enable_vhost(string vhost, bool& applied)
     srs_error_t err = srs_success;
     
     applied = false;
+    generation_++;
     
     SrsConfDirective* conf = root->get("vhost", vhost);
     srs_assert(conf);
@@ -3209,6 +3275,7 @@ srs_error_t SrsConfig::raw_enable_dvr(string vhost, string stream, bool& applied
     srs_error_t err = srs_success;
     
     applied = false;
+    generation_++;
     
     SrsConfDirective* conf = root->get("vhost", vhost);
     srs_assert(conf);
@@ -3237,6 +3304,7 @@ srs_error_t SrsConfig::raw_disable_dvr(string vhost, string stream, bool& applie
     srs_error_t err = srs_success;
     
     applied = false;
+    generation_++;
     
     SrsConfDirective* conf = root->get("vhost", vhost);
     srs_assert(conf);
@@ -3593,6 +3661,9 @@ srs_error_t SrsConfig::check_normal_config()
 {
     srs_error_t err = srs_success;
     
+    // The config might be transformed after parsed, so we rebuild the vhosts.
+    generation_++;
+    
     srs_trace("srs checking config...");
     
     ////////////////////////////////////////////////////////////////////////
@@ -3617,17 +3688,54 @@ srs_error_t SrsConfig::check_normal_config()
             && n != "ff_log_level" && n != "grace_final_wait" && n != "force_grace_quit"
             && n != "grace_start_wait" && n != "empty_ip_ok" && n != "disable_daemon_for_docker"
             && n != "inotify_auto_reload" && n != "auto_reload_for_docker" && n != "tcmalloc_release_rate"
-            && n != "circuit_breaker" && n != "is_full"
+            && n != "circuit_breaker" && n != "is_full" && n != "coroutine_stack"
+            && n != "admission"
             ) {
             return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal directive %s", n.c_str());
         }
     }
+    if (true) {
+        SrsConfDirective* conf = root->get("admission");
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "enabled" && n != "rate" && n != "burst" && n != "ip_rate" && n != "ip_burst"
+                && n != "max_deferred" && n != "defer_timeout") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal admission.%s", n.c_str());
+            }
+        }
+    }
+    if (true) {
+        SrsConfDirective* conf = root->get("coroutine_stack");
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "pool" && n != "guard" && n != "watermark" && n != "sizes") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal coroutine_stack.%s", n.c_str());
+            }
+        }
+
+        // The stack size must be a number of bytes, aligned to page, and large enough for
+        // the coroutine, or it crashes when stack overflow.
+        SrsConfDirective* sizes = conf? conf->get("sizes") : NULL;
+        for (int i = 0; sizes && i < (int)sizes->directives.size(); i++) {
+            SrsConfDirective* obj = sizes->at(i);
+            string v = obj->arg0();
+            if (v.empty() || v.length() > 9 || v.find_first_not_of("0123456789") != string::npos) {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal coroutine_stack.sizes.%s=%s", obj->name.c_str(), v.c_str());
+            }
+
+            int size = ::atoi(v.c_str());
+            if (size < SRS_CONSTS_MIN_STACK_SIZE || size > SRS_CONSTS_MAX_STACK_SIZE || (size % ::getpagesize()) != 0) {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "coroutine_stack.sizes.%s=%d should be in [%d, %d] and aligned to %d",
+                    obj->name.c_str(), size, SRS_CONSTS_MIN_STACK_SIZE, SRS_CONSTS_MAX_STACK_SIZE, ::getpagesize());
+            }
+        }
+    }
     if (true) {
         SrsConfDirective* conf = root->get("http_api");
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             SrsConfDirective* obj = conf->at(i);
             string n = obj->name;
-            if (n != "enabled" && n != "listen" && n != "crossdomain" && n != "raw_api" && n != "https") {
+            if (n != "enabled" && n != "listen" && n != "crossdomain" && n != "raw_api" && n != "https" && n != "metrics") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_api.%s", n.c_str());
             }
             
@@ -3639,6 +3747,23 @@ srs_error_t SrsConfig::check_normal_config()
                     }
                 }
             }
+
+            if (n == "metrics") {
+                for (int j = 0; j < (int)obj->directives.size(); j++) {
+                    SrsConfDirective* sdir = obj->at(j);
+                    string m = sdir->name;
+                    if (m != "enabled" && m != "labels" && m != "max_streams") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_api.metrics.%s", m.c_str());
+                    }
+
+                    for (int k = 0; m == "labels" && k < (int)sdir->args.size(); k++) {
+                        string label = sdir->args.at(k);
+                        if (label != "vhost" && label != "app" && label != "stream") {
+                            return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_api.metrics.labels %s", label.c_str());
+                        }
+                    }
+                }
+            }
         }
     }
     if (true) {
@@ -3677,7 +3802,7 @@ srs_error_t SrsConfig::check_normal_config()
         SrsConfDirective* conf = get_stats();
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             string n = conf->at(i)->name;
-            if (n != "enabled" && n != "network" && n != "disk") {
+            if (n != "enabled" && n != "network" && n != "disk" && n != "cpu_accounting") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal stats.%s", n.c_str());
             }
         }
@@ -3790,7 +3915,7 @@ srs_error_t SrsConfig::check_normal_config()
             string n = conf->name;
             if (n != "enabled" && n != "caster" && n != "output"
                 && n != "listen" && n != "tcp_enable" && n != "rtp_port_min" && n != "rtp_port_max"
-                && n != "rtp_idle_timeout" && n != "sip"
+                && n != "rtp_idle_timeout" && n != "idle_timeout" && n != "sip"
                 && n != "audio_enable" && n != "wait_keyframe" && n != "jitterbuffer_enable"
                 && n != "host" && n != "auto_create_channel") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal stream_caster.%s", n.c_str());
@@ -3826,7 +3951,7 @@ srs_error_t SrsConfig::check_normal_config()
                 && n != "play" && n != "publish" && n != "cluster"
                 && n != "security" && n != "http_remux" && n != "dash"
                 && n != "http_static" && n != "hds" && n != "exec"
-                && n != "in_ack_size" && n != "out_ack_size" && n != "rtc") {
+                && n != "in_ack_size" && n != "out_ack_size" && n != "rtc" && n != "shm_fanout") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.%s", n.c_str());
             }
             // for each sub directives of vhost.
@@ -3834,7 +3959,8 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "enabled"  && m != "dvr_apply" && m != "dvr_path" && m != "dvr_plan"
-                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter") {
+                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter"
+                        && m != "dvr_fmp4" && m != "dvr_fmp4_fragment") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.dvr.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3852,12 +3978,19 @@ srs_error_t SrsConfig::check_normal_config()
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.exec.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
+            } else if (n == "shm_fanout") {
+                for (int j = 0; j < (int)conf->directives.size(); j++) {
+                    string m = conf->at(j)->name;
+                    if (m != "enabled" && m != "dir" && m != "size") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.shm_fanout.%s of %s", m.c_str(), vhost->arg0().c_str());
+                    }
+                }
             } else if (n == "play") {
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "time_jitter" && m != "mix_correct" && m != "atc" && m != "atc_auto" && m != "mw_latency"
                         && m != "gop_cache" && m != "queue_length" && m != "send_min_interval" && m != "reduce_sequence_header"
-                        && m != "mw_msgs") {
+                        && m != "mw_msgs" && m != "gop_cache_max_size" && m != "gop_cache_max_duration") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.play.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3865,7 +3998,7 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "mode" && m != "origin" && m != "token_traverse" && m != "vhost" && m != "debug_srs_upnode" && m != "coworkers"
-                        && m != "origin_cluster") {
+                        && m != "origin_cluster" && m != "hot_standby" && m != "load_balance") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.cluster.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -3912,7 +4045,8 @@ srs_error_t SrsConfig::check_normal_config()
                         && m != "hls_storage" && m != "hls_mount" && m != "hls_td_ratio" && m != "hls_aof_ratio" && m != "hls_acodec" && m != "hls_vcodec"
                         && m != "hls_m3u8_file" && m != "hls_ts_file" && m != "hls_ts_floor" && m != "hls_cleanup" && m != "hls_nb_notify"
                         && m != "hls_wait_keyframe" && m != "hls_dispose" && m != "hls_keys" && m != "hls_fragments_per_key" && m != "hls_key_file"
-                        && m != "hls_key_file_path" && m != "hls_key_url" && m != "hls_dts_directly") {
+                        && m != "hls_key_file_path" && m != "hls_key_url" && m != "hls_dts_directly" && m != "hls_ll"
+                        && m != "hls_part_duration" && m != "hls_fmp4") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.hls.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                     
@@ -4115,6 +4249,8 @@ srs_error_t SrsConfig::parse_buffer(SrsConfigBuffer* buffer)
         set_config_directive(root, "srs_log_tank", "console");
     }
     
+    generation_++;
+    
     return err;
 }
 
@@ -4474,320 +4610,584 @@ int SrsConfig::get_dying_pulse()
     return ::atoi(conf->arg0().c_str());
 }
 
-vector<SrsConfDirective*> SrsConfig::get_stream_casters()
+srs_utime_t SrsConfig::get_lag_limit()
 {
-    srs_assert(root);
-    
-    std::vector<SrsConfDirective*> stream_casters;
-    
-    for (int i = 0; i < (int)root->directives.size(); i++) {
-        SrsConfDirective* conf = root->at(i);
-        
-        if (!conf->is_stream_caster()) {
-            continue;
-        }
-        
-        stream_casters.push_back(conf);
-    }
-    
-    return stream_casters;
-}
+    static srs_utime_t DEFAULT = 0;
 
-bool SrsConfig::get_stream_caster_enabled(SrsConfDirective* conf)
-{
-    static bool DEFAULT = false;
-    
+    SrsConfDirective* conf = root->get("circuit_breaker");
     if (!conf) {
         return DEFAULT;
     }
-    
-    conf = conf->get("enabled");
-    if (!conf || conf->arg0().empty()) {
+
+    conf = conf->get("lag_limit");
+    if (!conf) {
         return DEFAULT;
     }
-    
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
 }
 
-string SrsConfig::get_stream_caster_engine(SrsConfDirective* conf)
+int SrsConfig::get_memory_limit()
 {
-    static string DEFAULT = "";
-    
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("circuit_breaker");
     if (!conf) {
         return DEFAULT;
     }
-    
-    conf = conf->get("caster");
-    if (!conf || conf->arg0().empty()) {
+
+    conf = conf->get("memory_limit");
+    if (!conf) {
         return DEFAULT;
     }
-    
-    return conf->arg0();
+
+    return ::atoi(conf->arg0().c_str());
 }
 
-string SrsConfig::get_stream_caster_output(SrsConfDirective* conf)
+srs_utime_t SrsConfig::get_queue_limit()
 {
-    static string DEFAULT = "";
-    
+    static srs_utime_t DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("circuit_breaker");
     if (!conf) {
         return DEFAULT;
     }
-    
-    conf = conf->get("output");
-    if (!conf || conf->arg0().empty()) {
+
+    conf = conf->get("queue_limit");
+    if (!conf) {
         return DEFAULT;
     }
-    
-    return conf->arg0();
+
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
 }
 
-int SrsConfig::get_stream_caster_listen(SrsConfDirective* conf)
+int SrsConfig::get_sndbuf_limit()
 {
     static int DEFAULT = 0;
-    
+
+    SrsConfDirective* conf = root->get("circuit_breaker");
     if (!conf) {
         return DEFAULT;
     }
-    
-    conf = conf->get("listen");
-    if (!conf || conf->arg0().empty()) {
+
+    conf = conf->get("sndbuf_limit");
+    if (!conf) {
         return DEFAULT;
     }
-    
+
     return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_stream_caster_tcp_enable(SrsConfDirective* conf)
+int SrsConfig::get_coroutine_stack_pool()
 {
-	static bool DEFAULT = false;
-
-	if (!conf) {
-		return DEFAULT;
-	}
-
-	conf = conf->get("tcp_enable");
-	if (!conf || conf->arg0().empty()) {
-		return DEFAULT;
-	}
-
-	return SRS_CONF_PERFER_FALSE(conf->arg0());
-}
+    static int DEFAULT = 1024;
 
-int SrsConfig::get_stream_caster_rtp_port_min(SrsConfDirective* conf)
-{
-    static int DEFAULT = 0;
-    
+    SrsConfDirective* conf = root->get("coroutine_stack");
     if (!conf) {
         return DEFAULT;
     }
-    
-    conf = conf->get("rtp_port_min");
-    if (!conf || conf->arg0().empty()) {
+
+    conf = conf->get("pool");
+    if (!conf) {
         return DEFAULT;
     }
-    
+
     return ::atoi(conf->arg0().c_str());
 }
 
-int SrsConfig::get_stream_caster_rtp_port_max(SrsConfDirective* conf)
+bool SrsConfig::get_coroutine_stack_guard()
 {
-    static int DEFAULT = 0;
-    
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("coroutine_stack");
     if (!conf) {
         return DEFAULT;
     }
-    
-    conf = conf->get("rtp_port_max");
-    if (!conf || conf->arg0().empty()) {
+
+    conf = conf->get("guard");
+    if (!conf) {
         return DEFAULT;
     }
-    
-    return ::atoi(conf->arg0().c_str());
-}
 
-bool SrsConfig::get_rtc_server_enabled()
-{
-    SrsConfDirective* conf = root->get("rtc_server");
-    return get_rtc_server_enabled(conf);
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-bool SrsConfig::get_rtc_server_enabled(SrsConfDirective* conf)
+bool SrsConfig::get_coroutine_stack_watermark()
 {
     static bool DEFAULT = false;
 
+    SrsConfDirective* conf = root->get("coroutine_stack");
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("enabled");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("watermark");
+    if (!conf) {
         return DEFAULT;
     }
 
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-int SrsConfig::get_rtc_server_listen()
+SrsConfDirective* SrsConfig::get_coroutine_stack_sizes()
 {
-    static int DEFAULT = 8000;
-
-    SrsConfDirective* conf = root->get("rtc_server");
+    SrsConfDirective* conf = root->get("coroutine_stack");
     if (!conf) {
-        return DEFAULT;
-    }
-
-    conf = conf->get("listen");
-    if (!conf || conf->arg0().empty()) {
-        return DEFAULT;
+        return NULL;
     }
 
-    return ::atoi(conf->arg0().c_str());
+    return conf->get("sizes");
 }
 
-std::string SrsConfig::get_rtc_server_candidates()
+bool SrsConfig::get_admission_enabled()
 {
-    static string DEFAULT = "*";
+    static bool DEFAULT = false;
 
-    SrsConfDirective* conf = root->get("rtc_server");
+    SrsConfDirective* conf = root->get("admission");
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("candidate");
-    if (!conf || conf->arg0().empty()) {
-        return DEFAULT;
-    }
-
-    string eip = srs_getenv(conf->arg0());
-    if (!eip.empty()) {
-        return eip;
-    }
-
-    // If configed as ENV, but no ENV set, use default value.
-    if (srs_string_starts_with(conf->arg0(), "$")) {
+    conf = conf->get("enabled");
+    if (!conf) {
         return DEFAULT;
     }
 
-    return conf->arg0();
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-std::string SrsConfig::get_rtc_server_ip_family()
+int SrsConfig::get_admission_rate()
 {
-    static string DEFAULT = "ipv4";
+    static int DEFAULT = 1000;
 
-    SrsConfDirective* conf = root->get("rtc_server");
+    SrsConfDirective* conf = root->get("admission");
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("ip_family");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("rate");
+    if (!conf) {
         return DEFAULT;
     }
 
-    return conf->arg0();
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_rtc_server_ecdsa()
+int SrsConfig::get_admission_burst()
 {
-    static bool DEFAULT = true;
+    static int DEFAULT = 2000;
 
-    SrsConfDirective* conf = root->get("rtc_server");
+    SrsConfDirective* conf = root->get("admission");
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("ecdsa");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("burst");
+    if (!conf) {
         return DEFAULT;
     }
 
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_rtc_server_encrypt()
+int SrsConfig::get_admission_ip_rate()
 {
-    static bool DEFAULT = true;
+    static int DEFAULT = 10;
 
-    SrsConfDirective* conf = root->get("rtc_server");
+    SrsConfDirective* conf = root->get("admission");
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("encrypt");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("ip_rate");
+    if (!conf) {
         return DEFAULT;
     }
 
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
-}
-
-int SrsConfig::get_rtc_server_reuseport()
-{
-    int v = get_rtc_server_reuseport2();
-
-#if !defined(SO_REUSEPORT)
-    if (v > 1) {
-        srs_warn("REUSEPORT not supported, reset %d to %d", reuseport, DEFAULT);
-        v = 1
-    }
-#endif
-
-    return v;
+    return ::atoi(conf->arg0().c_str());
 }
 
-int SrsConfig::get_rtc_server_reuseport2()
+int SrsConfig::get_admission_ip_burst()
 {
-    static int DEFAULT = 1;
+    static int DEFAULT = 30;
 
-    SrsConfDirective* conf = root->get("rtc_server");
+    SrsConfDirective* conf = root->get("admission");
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("reuseport");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("ip_burst");
+    if (!conf) {
         return DEFAULT;
     }
 
     return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_rtc_server_merge_nalus()
+int SrsConfig::get_admission_max_deferred()
 {
-    static int DEFAULT = false;
+    static int DEFAULT = 10000;
 
-    SrsConfDirective* conf = root->get("rtc_server");
+    SrsConfDirective* conf = root->get("admission");
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("merge_nalus");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("max_deferred");
+    if (!conf) {
         return DEFAULT;
     }
 
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+    return ::atoi(conf->arg0().c_str());
 }
 
-bool SrsConfig::get_rtc_server_black_hole()
+srs_utime_t SrsConfig::get_admission_defer_timeout()
 {
-    static bool DEFAULT = false;
+    static srs_utime_t DEFAULT = 3 * SRS_UTIME_SECONDS;
 
-    SrsConfDirective* conf = root->get("rtc_server");
+    SrsConfDirective* conf = root->get("admission");
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("black_hole");
+    conf = conf->get("defer_timeout");
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("enabled");
-    if (!conf || conf->arg0().empty()) {
-        return DEFAULT;
-    }
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
+}
+
+vector<SrsConfDirective*> SrsConfig::get_stream_casters()
+{
+    srs_assert(root);
+    
+    std::vector<SrsConfDirective*> stream_casters;
+    
+    for (int i = 0; i < (int)root->directives.size(); i++) {
+        SrsConfDirective* conf = root->at(i);
+        
+        if (!conf->is_stream_caster()) {
+            continue;
+        }
+        
+        stream_casters.push_back(conf);
+    }
+    
+    return stream_casters;
+}
+
+bool SrsConfig::get_stream_caster_enabled(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_stream_caster_engine(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("caster");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+string SrsConfig::get_stream_caster_output(SrsConfDirective* conf)
+{
+    static string DEFAULT = "";
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("output");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
+int SrsConfig::get_stream_caster_listen(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("listen");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+bool SrsConfig::get_stream_caster_tcp_enable(SrsConfDirective* conf)
+{
+	static bool DEFAULT = false;
+
+	if (!conf) {
+		return DEFAULT;
+	}
+
+	conf = conf->get("tcp_enable");
+	if (!conf || conf->arg0().empty()) {
+		return DEFAULT;
+	}
+
+	return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int SrsConfig::get_stream_caster_rtp_port_min(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("rtp_port_min");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_stream_caster_rtp_port_max(SrsConfDirective* conf)
+{
+    static int DEFAULT = 0;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("rtp_port_max");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return ::atoi(conf->arg0().c_str());
+}
+
+srs_utime_t SrsConfig::get_stream_caster_idle_timeout(SrsConfDirective* conf)
+{
+    static srs_utime_t DEFAULT = 30 * SRS_UTIME_SECONDS;
+    
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("idle_timeout");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_rtc_server_enabled()
+{
+    SrsConfDirective* conf = root->get("rtc_server");
+    return get_rtc_server_enabled(conf);
+}
+
+bool SrsConfig::get_rtc_server_enabled(SrsConfDirective* conf)
+{
+    static bool DEFAULT = false;
+
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int SrsConfig::get_rtc_server_listen()
+{
+    static int DEFAULT = 8000;
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("listen");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+std::string SrsConfig::get_rtc_server_candidates()
+{
+    static string DEFAULT = "*";
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("candidate");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    string eip = srs_getenv(conf->arg0());
+    if (!eip.empty()) {
+        return eip;
+    }
+
+    // If configed as ENV, but no ENV set, use default value.
+    if (srs_string_starts_with(conf->arg0(), "$")) {
+        return DEFAULT;
+    }
+
+    return conf->arg0();
+}
+
+std::string SrsConfig::get_rtc_server_ip_family()
+{
+    static string DEFAULT = "ipv4";
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("ip_family");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0();
+}
+
+bool SrsConfig::get_rtc_server_ecdsa()
+{
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("ecdsa");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+bool SrsConfig::get_rtc_server_encrypt()
+{
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("encrypt");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+int SrsConfig::get_rtc_server_reuseport()
+{
+    int v = get_rtc_server_reuseport2();
+
+#if !defined(SO_REUSEPORT)
+    if (v > 1) {
+        srs_warn("REUSEPORT not supported, reset %d to %d", reuseport, DEFAULT);
+        v = 1
+    }
+#endif
+
+    return v;
+}
+
+int SrsConfig::get_rtc_server_reuseport2()
+{
+    static int DEFAULT = 1;
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("reuseport");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+bool SrsConfig::get_rtc_server_merge_nalus()
+{
+    static int DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("merge_nalus");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+bool SrsConfig::get_rtc_server_black_hole()
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("black_hole");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
 
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
@@ -5058,16 +5458,13 @@ SrsConfDirective* SrsConfig::get_vhost(string vhost, bool try_default_vhost)
 {
     srs_assert(root);
     
-    for (int i = 0; i < (int)root->directives.size(); i++) {
-        SrsConfDirective* conf = root->at(i);
-        
-        if (!conf->is_vhost()) {
-            continue;
-        }
-        
-        if (conf->arg0() == vhost) {
-            return conf;
-        }
+    if (vhosts_generation_ != generation_) {
+        build_vhosts();
+    }
+    
+    std::map<std::string, SrsConfDirective*>::iterator it = vhosts_.find(vhost);
+    if (it != vhosts_.end()) {
+        return it->second;
     }
     
     if (try_default_vhost && vhost != SRS_CONSTS_RTMP_DEFAULT_VHOST) {
@@ -5092,6 +5489,91 @@ void SrsConfig::get_vhosts(vector<SrsConfDirective*>& vhosts)
     }
 }
 
+SrsVhostConfig* SrsConfig::get_vhost_config(string vhost)
+{
+    srs_assert(root);
+    
+    if (vhosts_generation_ != generation_) {
+        build_vhosts();
+    }
+    
+    std::map<std::string, SrsVhostConfig*>::iterator it = vhost_configs_.find(vhost);
+    if (it != vhost_configs_.end()) {
+        return it->second;
+    }
+    
+    it = vhost_configs_.find(SRS_CONSTS_RTMP_DEFAULT_VHOST);
+    if (it != vhost_configs_.end()) {
+        return it->second;
+    }
+    
+    return vhost_config_default_;
+}
+
+uint64_t SrsConfig::generation()
+{
+    return generation_;
+}
+
+void SrsConfig::build_vhosts()
+{
+    // Update the generation first, because we build the typed config by getters.
+    vhosts_generation_ = generation_;
+    
+    clear_vhosts();
+    
+    // Use the first one, if there are vhosts with the same name.
+    for (int i = 0; i < (int)root->directives.size(); i++) {
+        SrsConfDirective* conf = root->at(i);
+        if (conf->is_vhost() && vhosts_.find(conf->arg0()) == vhosts_.end()) {
+            vhosts_[conf->arg0()] = conf;
+        }
+    }
+    
+    std::map<std::string, SrsConfDirective*>::iterator it;
+    for (it = vhosts_.begin(); it != vhosts_.end(); ++it) {
+        vhost_configs_[it->first] = create_vhost_config(it->first);
+    }
+    
+    // The vhost is not found, so all getters return the default value.
+    vhost_config_default_ = create_vhost_config("");
+}
+
+void SrsConfig::clear_vhosts()
+{
+    std::map<std::string, SrsVhostConfig*>::iterator it;
+    for (it = vhost_configs_.begin(); it != vhost_configs_.end(); ++it) {
+        SrsVhostConfig* conf = it->second;
+        srs_freep(conf);
+    }
+    vhost_configs_.clear();
+    vhosts_.clear();
+    
+    srs_freep(vhost_config_default_);
+}
+
+SrsVhostConfig* SrsConfig::create_vhost_config(string vhost)
+{
+    SrsVhostConfig* conf = new SrsVhostConfig();
+    
+    conf->enabled = get_vhost_enabled(vhost);
+    conf->edge = get_vhost_is_edge(vhost);
+    conf->atc = get_atc(vhost);
+    conf->atc_auto = get_atc_auto(vhost);
+    conf->mix_correct = get_mix_correct(vhost);
+    conf->time_jitter = get_time_jitter(vhost);
+    conf->gop_cache = get_gop_cache(vhost);
+    conf->queue_length = get_queue_length(vhost);
+    conf->reduce_sequence_header = get_reduce_sequence_header(vhost);
+    conf->parse_sps = get_parse_sps(vhost);
+    conf->rtc_nack_enabled = get_rtc_nack_enabled(vhost);
+    conf->rtc_nack_no_copy = get_rtc_nack_no_copy(vhost);
+    conf->rtc_realtime = get_realtime_enabled(vhost, true);
+    conf->rtc_mw_msgs = get_mw_msgs(vhost, conf->rtc_realtime, true);
+    
+    return conf;
+}
+
 bool SrsConfig::get_vhost_enabled(string vhost)
 {
     SrsConfDirective* conf = get_vhost(vhost);
@@ -5113,28 +5595,72 @@ bool SrsConfig::get_vhost_enabled(SrsConfDirective* conf)
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
-    
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+bool SrsConfig::get_gop_cache(string vhost)
+{
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return SRS_PERF_GOP_CACHE;
+    }
+    
+    conf = conf->get("play");
+    if (!conf) {
+        return SRS_PERF_GOP_CACHE;
+    }
+    
+    conf = conf->get("gop_cache");
+    if (!conf || conf->arg0().empty()) {
+        return SRS_PERF_GOP_CACHE;
+    }
+    
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+int64_t SrsConfig::get_gop_cache_max_size(string vhost)
+{
+    static int64_t DEFAULT = 0;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("play");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("gop_cache_max_size");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoll(conf->arg0().c_str()) * 1024;
 }
 
-bool SrsConfig::get_gop_cache(string vhost)
+srs_utime_t SrsConfig::get_gop_cache_max_duration(string vhost)
 {
+    static srs_utime_t DEFAULT = 0;
+
     SrsConfDirective* conf = get_vhost(vhost);
     if (!conf) {
-        return SRS_PERF_GOP_CACHE;
+        return DEFAULT;
     }
-    
+
     conf = conf->get("play");
     if (!conf) {
-        return SRS_PERF_GOP_CACHE;
+        return DEFAULT;
     }
-    
-    conf = conf->get("gop_cache");
+
+    conf = conf->get("gop_cache_max_duration");
     if (!conf || conf->arg0().empty()) {
-        return SRS_PERF_GOP_CACHE;
+        return DEFAULT;
     }
-    
-    return SRS_CONF_PERFER_TRUE(conf->arg0());
+
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
 bool SrsConfig::get_debug_srs_upnode(string vhost)
@@ -5709,6 +6235,72 @@ SrsConfDirective* SrsConfig::get_forwards(string vhost)
     return conf->get("destination");
 }
 
+bool SrsConfig::get_shm_fanout_enabled(string vhost)
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("shm_fanout");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_shm_fanout_dir(string vhost)
+{
+    static string DEFAULT = "/dev/shm";
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("shm_fanout");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dir");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0();
+}
+
+int SrsConfig::get_shm_fanout_size(string vhost)
+{
+    static int DEFAULT = 8 * 1024 * 1024;
+
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("shm_fanout");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("size");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str()) * 1024;
+}
+
 SrsConfDirective* SrsConfig::get_vhost_http_hooks(string vhost)
 {
     SrsConfDirective* conf = get_vhost(vhost);
@@ -6001,6 +6593,50 @@ string SrsConfig::get_vhost_edge_transform_vhost(string vhost)
     return conf->arg0();
 }
 
+bool SrsConfig::get_vhost_edge_hot_standby(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hot_standby");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+string SrsConfig::get_vhost_edge_load_balance(string vhost)
+{
+    static string DEFAULT = "round_robin";
+    
+    SrsConfDirective* conf = get_vhost(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("cluster");
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("load_balance");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return conf->arg0();
+}
+
 bool SrsConfig::get_vhost_origin_cluster(string vhost)
 {
     static bool DEFAULT = false;
@@ -7192,6 +7828,57 @@ int SrsConfig::get_hls_fragments_per_key(string vhost)
     return ::atoi(conf->arg0().c_str());
 }
 
+bool SrsConfig::get_hls_ll(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_ll");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_hls_part_duration(string vhost)
+{
+    static srs_utime_t DEFAULT = 500 * SRS_UTIME_MILLISECONDS;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_part_duration");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_hls_fmp4(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_hls(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("hls_fmp4");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 string SrsConfig::get_hls_key_file(string vhost)
 {
     static string DEFAULT = "[app]/[stream]-[seq].key";
@@ -7435,6 +8122,40 @@ bool SrsConfig::get_dvr_wait_keyframe(string vhost)
     return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
+bool SrsConfig::get_dvr_fmp4(string vhost)
+{
+    static bool DEFAULT = false;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_fmp4");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_dvr_fmp4_fragment(string vhost)
+{
+    static srs_utime_t DEFAULT = 2 * SRS_UTIME_SECONDS;
+    
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+    
+    conf = conf->get("dvr_fmp4_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+    
+    return srs_utime_t(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
 int SrsConfig::get_dvr_time_jitter(string vhost)
 {
     static string DEFAULT = "full";
@@ -7598,6 +8319,70 @@ bool SrsConfig::get_raw_api_allow_update()
     return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
+SrsConfDirective* SrsConfig::get_http_api_metrics()
+{
+    SrsConfDirective* conf = root->get("http_api");
+    if (!conf) {
+        return NULL;
+    }
+
+    return conf->get("metrics");
+}
+
+bool SrsConfig::get_http_api_metrics_enabled()
+{
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_http_api_metrics();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+vector<string> SrsConfig::get_http_api_metrics_labels()
+{
+    vector<string> DEFAULT;
+    DEFAULT.push_back("vhost");
+    DEFAULT.push_back("app");
+    DEFAULT.push_back("stream");
+
+    SrsConfDirective* conf = get_http_api_metrics();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("labels");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    return conf->args;
+}
+
+int SrsConfig::get_http_api_metrics_max_streams()
+{
+    static int DEFAULT = 1000;
+
+    SrsConfDirective* conf = get_http_api_metrics();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("max_streams");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
 SrsConfDirective* SrsConfig::get_https_api()
 {
     SrsConfDirective* conf = root->get("http_api");
@@ -8316,3 +9101,20 @@ SrsConfDirective* SrsConfig::get_stats_disk_device()
     
     return conf;
 }
+
+bool SrsConfig::get_stats_cpu_accounting()
+{
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = get_stats();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("cpu_accounting");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
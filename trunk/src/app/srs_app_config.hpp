@@ -244,6 +244,30 @@ private:
     virtual srs_error_t read_token(srs_internal::SrsConfigBuffer* buffer, std::vector<std::string>& args, int& line_start);
 };
 
+// The typed config of vhost, parsed from directives, for hot path to avoid looking up and parsing
+// the directives every time. It's rebuilt when config changed, see SrsConfig::generation().
+class SrsVhostConfig
+{
+public:
+    bool enabled;
+    bool edge;
+    bool atc;
+    bool atc_auto;
+    bool mix_correct;
+    int time_jitter;
+    bool gop_cache;
+    srs_utime_t queue_length;
+    bool reduce_sequence_header;
+    bool parse_sps;
+    bool rtc_nack_enabled;
+    bool rtc_nack_no_copy;
+    bool rtc_realtime;
+    int rtc_mw_msgs;
+public:
+    SrsVhostConfig();
+    virtual ~SrsVhostConfig();
+};
+
 // The config service provider.
 // For the config supports reload, so never keep the reference cross st-thread,
 // that is, never save the SrsConfDirective* get by any api of config,
@@ -281,6 +305,17 @@ private:
 protected:
     // The directive root.
     SrsConfDirective* root;
+private:
+    // The generation of config, increased when config is reloaded or updated.
+    uint64_t generation_;
+    // The generation of vhost index, rebuild the index when not equal to generation_.
+    uint64_t vhosts_generation_;
+    // The index of vhost directives, the key is vhost name.
+    std::map<std::string, SrsConfDirective*> vhosts_;
+    // The typed config of vhosts, the key is vhost name.
+    std::map<std::string, SrsVhostConfig*> vhost_configs_;
+    // The typed config when vhost not found, all fields are default value.
+    SrsVhostConfig* vhost_config_default_;
 // Reload  section
 private:
     // The reload subscribers, when reload, callback all handlers.
@@ -484,6 +519,39 @@ public:
     virtual int get_critical_pulse();
     virtual int get_dying_threshold();
     virtual int get_dying_pulse();
+    // Get the limits of other signals, the load is the max percent of signals to the limits, 0 to ignore it.
+    // The max event loop lag, in srs_utime_t.
+    virtual srs_utime_t get_lag_limit();
+    // The memory RSS in MB.
+    virtual int get_memory_limit();
+    // The max duration of consumer queue, in srs_utime_t.
+    virtual srs_utime_t get_queue_limit();
+    // The number of writes blocked by socket send buffer, per second.
+    virtual int get_sndbuf_limit();
+// Coroutine stack section.
+public:
+    // Get the max number of free stacks to reuse, -1 for no limit.
+    virtual int get_coroutine_stack_pool();
+    // Whether protect the stack by guard pages.
+    virtual bool get_coroutine_stack_guard();
+    // Whether stat the high water-level of stack usage.
+    virtual bool get_coroutine_stack_watermark();
+    // Get the stack sizes by the name of coroutine, NULL if not configured.
+    virtual SrsConfDirective* get_coroutine_stack_sizes();
+// Admission section.
+public:
+    // Whether enable the admission control for accept storm.
+    virtual bool get_admission_enabled();
+    // Get the global rate and burst of new clients.
+    virtual int get_admission_rate();
+    virtual int get_admission_burst();
+    // Get the rate and burst of new clients for each IP.
+    virtual int get_admission_ip_rate();
+    virtual int get_admission_ip_burst();
+    // Get the max number of deferred clients.
+    virtual int get_admission_max_deferred();
+    // Get the max time for client to wait in deferred queue.
+    virtual srs_utime_t get_admission_defer_timeout();
 // stream_caster section
 public:
     // Get all stream_caster in config file.
@@ -502,6 +570,8 @@ public:
     virtual int get_stream_caster_rtp_port_min(SrsConfDirective* conf);
     // Get the max udp port for rtp of stream caster rtsp.
     virtual int get_stream_caster_rtp_port_max(SrsConfDirective* conf);
+    // Get the timeout to expire the idle flow of stream caster mpegts_over_udp.
+    virtual srs_utime_t get_stream_caster_idle_timeout(SrsConfDirective* conf);
 
 // rtc section
 public:
@@ -544,6 +614,17 @@ public:
     virtual SrsConfDirective* get_vhost(std::string vhost, bool try_default_vhost = true);
     // Get all vhosts in config file.
     virtual void get_vhosts(std::vector<SrsConfDirective*>& vhosts);
+    // Get the typed config of vhost, fallback to the default vhost.
+    // @remark The object is freed when config changed, so user must check the generation before using it.
+    virtual SrsVhostConfig* get_vhost_config(std::string vhost);
+    // The generation of config, user can cache the config by it.
+    virtual uint64_t generation();
+private:
+    // Build the index and typed config of vhosts.
+    virtual void build_vhosts();
+    virtual void clear_vhosts();
+    virtual SrsVhostConfig* create_vhost_config(std::string vhost);
+public:
     // Whether vhost is enabled
     // @param vhost, the vhost name.
     // @return true when vhost is ok; otherwise, false.
@@ -557,6 +638,12 @@ public:
     // @return true when gop_cache is ok; otherwise, false.
     // @remark, default true.
     virtual bool get_gop_cache(std::string vhost);
+    // Get the max size of gop cache, in bytes.
+    // @remark, default 0, no limit.
+    virtual int64_t get_gop_cache_max_size(std::string vhost);
+    // Get the max duration of gop cache, in srs_utime_t.
+    // @remark, default 0, no limit.
+    virtual srs_utime_t get_gop_cache_max_duration(std::string vhost);
     // Whether debug_srs_upnode is enabled of vhost.
     // debug_srs_upnode is very important feature for tracable log,
     // but some server, for instance, flussonic donot support it.
@@ -645,6 +732,14 @@ public:
     virtual bool get_forward_enabled(std::string vhost);
     // Get the forward directive of vhost.
     virtual SrsConfDirective* get_forwards(std::string vhost);
+    // shm_fanout section
+public:
+    // Whether share stream to sibling processes by shared memory.
+    virtual bool get_shm_fanout_enabled(std::string vhost);
+    // Get the directory of the shared memory rings.
+    virtual std::string get_shm_fanout_dir(std::string vhost);
+    // Get the size of shared memory ring for each stream, in bytes.
+    virtual int get_shm_fanout_size(std::string vhost);
 
 public:
     // Whether the srt sevice enabled
@@ -751,6 +846,10 @@ public:
     // Get the transformed vhost for edge,
     // @see https://github.com/ossrs/srs/issues/372
     virtual std::string get_vhost_edge_transform_vhost(std::string vhost);
+    // Whether edge keeps a hot-standby connection to another origin, to switch instantly.
+    virtual bool get_vhost_edge_hot_standby(std::string vhost);
+    // Get the load balance algorithm to select origin for edge, round_robin or fastest.
+    virtual std::string get_vhost_edge_load_balance(std::string vhost);
     // Whether enable the origin cluster.
     // @see https://github.com/ossrs/srs/wiki/v3_EN_OriginCluster
     virtual bool get_vhost_origin_cluster(std::string vhost);
@@ -936,6 +1035,12 @@ public:
     virtual bool get_hls_keys(std::string vhost);
     // how many fragments can one key encrypted.
     virtual int get_hls_fragments_per_key(std::string vhost);
+    // Whether enable LL-HLS, which writes the segment in parts.
+    virtual bool get_hls_ll(std::string vhost);
+    // The duration in srs_utime_t of LL-HLS part.
+    virtual srs_utime_t get_hls_part_duration(std::string vhost);
+    // Whether HLS uses CMAF(fMP4) segments, which are shared with DASH.
+    virtual bool get_hls_fmp4(std::string vhost);
     // Get the HLS key file path template.
     virtual std::string get_hls_key_file(std::string vhost);
     // Get the HLS key file store path.
@@ -979,6 +1084,10 @@ public:
     virtual srs_utime_t get_dvr_duration(std::string vhost);
     // Whether wait keyframe to reap segment.
     virtual bool get_dvr_wait_keyframe(std::string vhost);
+    // Whether DVR to fragmented MP4, which writes moof and mdat in fragments.
+    virtual bool get_dvr_fmp4(std::string vhost);
+    // Get the duration in srs_utime_t of fragment, for fragmented MP4.
+    virtual srs_utime_t get_dvr_fmp4_fragment(std::string vhost);
     // Get the time_jitter algorithm for dvr.
     virtual int get_dvr_time_jitter(std::string vhost);
 // http api section
@@ -1000,6 +1109,15 @@ public:
     virtual bool get_raw_api_allow_query();
     // Whether allow rpc update.
     virtual bool get_raw_api_allow_update();
+private:
+    SrsConfDirective* get_http_api_metrics();
+public:
+    // Whether enable the Prometheus exporter at /metrics.
+    virtual bool get_http_api_metrics_enabled();
+    // Get the labels of stream metrics, any of vhost, app and stream.
+    virtual std::vector<std::string> get_http_api_metrics_labels();
+    // Get the max series of stream metrics, to bound the cardinality.
+    virtual int get_http_api_metrics_max_streams();
 // https api section
 private:
     SrsConfDirective* get_https_api();
@@ -1078,6 +1196,8 @@ public:
     // The device name configed in args of directive.
     // @return the disk device name to stat. NULL if not configed.
     virtual SrsConfDirective* get_stats_disk_device();
+    // Whether account the CPU of coroutines, to find the hottest connections.
+    virtual bool get_stats_cpu_accounting();
 };
 
 #endif
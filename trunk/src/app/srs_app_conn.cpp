@@ -42,6 +42,7 @@ SrsResourceManager::SrsResourceManager(const std::string& label, bool verbose)
     trd = NULL;
     p_disposing_ = NULL;
     removing_ = false;
+    nn_removed_ = 0;
 
     nn_level0_cache_ = 100000;
     conns_level0_cache_ = new SrsResourceFastIdItem[nn_level0_cache_];
@@ -60,6 +61,12 @@ SrsResourceManager::~SrsResourceManager()
     clear();
 
     srs_freepa(conns_level0_cache_);
+
+    for (map<ISrsResource*, SrsResourceIndex*>::iterator it = conns_index_.begin(); it != conns_index_.end(); ++it) {
+        SrsResourceIndex* index = it->second;
+        srs_freep(index);
+    }
+    conns_index_.clear();
 }
 
 srs_error_t SrsResourceManager::start()
@@ -86,6 +93,11 @@ size_t SrsResourceManager::size()
     return conns_.size();
 }
 
+size_t SrsResourceManager::alive()
+{
+    return conns_.size() - nn_removed_;
+}
+
 srs_error_t SrsResourceManager::cycle()
 {
     srs_error_t err = srs_success;
@@ -111,7 +123,10 @@ srs_error_t SrsResourceManager::cycle()
 
 void SrsResourceManager::add(ISrsResource* conn, bool* exists)
 {
-    if (std::find(conns_.begin(), conns_.end(), conn) == conns_.end()) {
+    if (conns_index_.find(conn) == conns_index_.end()) {
+        SrsResourceIndex* index = new SrsResourceIndex();
+        index->pos = (int)conns_.size();
+        conns_index_[conn] = index;
         conns_.push_back(conn);
     } else {
         if (exists) {
@@ -123,6 +138,11 @@ void SrsResourceManager::add(ISrsResource* conn, bool* exists)
 void SrsResourceManager::add_with_id(const std::string& id, ISrsResource* conn)
 {
     add(conn);
+
+    map<string, ISrsResource*>::iterator it = conns_id_.find(id);
+    if (it == conns_id_.end() || it->second != conn) {
+        conns_index_[conn]->ids.push_back(id);
+    }
     conns_id_[id] = conn;
 }
 
@@ -130,6 +150,11 @@ void SrsResourceManager::add_with_fast_id(uint64_t id, ISrsResource* conn)
 {
     bool exists = false;
     add(conn, &exists);
+
+    map<uint64_t, ISrsResource*>::iterator it = conns_fast_id_.find(id);
+    if (it == conns_fast_id_.end() || it->second != conn) {
+        conns_index_[conn]->fast_ids.push_back(id);
+    }
     conns_fast_id_[id] = conn;
 
     if (exists) {
@@ -162,6 +187,11 @@ void SrsResourceManager::add_with_fast_id(uint64_t id, ISrsResource* conn)
 void SrsResourceManager::add_with_name(const std::string& name, ISrsResource* conn)
 {
     add(conn);
+
+    map<string, ISrsResource*>::iterator it = conns_name_.find(name);
+    if (it == conns_name_.end() || it->second != conn) {
+        conns_index_[conn]->names.push_back(name);
+    }
     conns_name_[name] = conn;
 }
 
@@ -252,6 +282,12 @@ void SrsResourceManager::do_remove(ISrsResource* c)
     // Push to zombies, we will free it in another coroutine.
     zombies_.push_back(c);
 
+    map<ISrsResource*, SrsResourceIndex*>::iterator it = conns_index_.find(c);
+    if (it != conns_index_.end() && !it->second->removed) {
+        it->second->removed = true;
+        nn_removed_++;
+    }
+
     // We should copy all handlers, because it may change during callback.
     vector<ISrsDisposingHandler*> handlers = handlers_;
 
@@ -275,6 +311,12 @@ void SrsResourceManager::do_remove(ISrsResource* c)
 
 void SrsResourceManager::check_remove(ISrsResource* c, bool& in_zombie, bool& in_disposing)
 {
+    // Fast path, the resource is not removed.
+    map<ISrsResource*, SrsResourceIndex*>::iterator it_index = conns_index_.find(c);
+    if (it_index != conns_index_.end() && !it_index->second->removed) {
+        return;
+    }
+
     // Only notify when not removed(in zombies_).
     vector<ISrsResource*>::iterator it = std::find(zombies_.begin(), zombies_.end(), c);
     if (it != zombies_.end()) {
@@ -347,45 +389,17 @@ void SrsResourceManager::do_clear()
 
 void SrsResourceManager::dispose(ISrsResource* c)
 {
-    for (map<string, ISrsResource*>::iterator it = conns_name_.begin(); it != conns_name_.end();) {
-        if (c != it->second) {
-            ++it;
-        } else {
-            // Use C++98 style: https://stackoverflow.com/a/4636230
-            conns_name_.erase(it++);
-        }
-    }
-
-    for (map<string, ISrsResource*>::iterator it = conns_id_.begin(); it != conns_id_.end();) {
-        if (c != it->second) {
-            ++it;
-        } else {
-            // Use C++98 style: https://stackoverflow.com/a/4636230
-            conns_id_.erase(it++);
-        }
-    }
-
-    for (map<uint64_t, ISrsResource*>::iterator it = conns_fast_id_.begin(); it != conns_fast_id_.end();) {
-        if (c != it->second) {
-            ++it;
-        } else {
-            // Update the level-0 cache for fast-id.
-            uint64_t id = it->first;
-            SrsResourceFastIdItem* item = &conns_level0_cache_[(id | id>>32) % nn_level0_cache_];
-            item->nn_collisions--;
-            if (!item->nn_collisions) {
-                item->fast_id = 0;
-                item->available = false;
-            }
+    map<ISrsResource*, SrsResourceIndex*>::iterator it = conns_index_.find(c);
+    if (it != conns_index_.end()) {
+        SrsResourceIndex* index = it->second;
+        conns_index_.erase(it);
 
-            // Use C++98 style: https://stackoverflow.com/a/4636230
-            conns_fast_id_.erase(it++);
+        if (index->removed) {
+            nn_removed_--;
         }
-    }
 
-    vector<ISrsResource*>::iterator it = std::find(conns_.begin(), conns_.end(), c);
-    if (it != conns_.end()) {
-        conns_.erase(it);
+        do_dispose(c, index);
+        srs_freep(index);
     }
 
     // We should copy all handlers, because it may change during callback.
@@ -406,6 +420,51 @@ void SrsResourceManager::dispose(ISrsResource* c)
     }
 }
 
+void SrsResourceManager::do_dispose(ISrsResource* c, SrsResourceIndex* index)
+{
+    // Remove the keys by reverse index, ignore if the key is used by another resource.
+    for (int i = 0; i < (int)index->names.size(); i++) {
+        map<string, ISrsResource*>::iterator it = conns_name_.find(index->names.at(i));
+        if (it != conns_name_.end() && it->second == c) {
+            conns_name_.erase(it);
+        }
+    }
+
+    for (int i = 0; i < (int)index->ids.size(); i++) {
+        map<string, ISrsResource*>::iterator it = conns_id_.find(index->ids.at(i));
+        if (it != conns_id_.end() && it->second == c) {
+            conns_id_.erase(it);
+        }
+    }
+
+    for (int i = 0; i < (int)index->fast_ids.size(); i++) {
+        uint64_t id = index->fast_ids.at(i);
+        map<uint64_t, ISrsResource*>::iterator it = conns_fast_id_.find(id);
+        if (it == conns_fast_id_.end() || it->second != c) {
+            continue;
+        }
+
+        // Update the level-0 cache for fast-id.
+        SrsResourceFastIdItem* item = &conns_level0_cache_[(id | id>>32) % nn_level0_cache_];
+        item->nn_collisions--;
+        if (!item->nn_collisions) {
+            item->fast_id = 0;
+            item->available = false;
+        }
+
+        conns_fast_id_.erase(it);
+    }
+
+    // Move the last resource to the position, to remove it in O(1).
+    // @remark The order of resources is changed, see at(index).
+    ISrsResource* last = conns_.back();
+    if (last != c) {
+        conns_[index->pos] = last;
+        conns_index_[last]->pos = index->pos;
+    }
+    conns_.pop_back();
+}
+
 ISrsExpire::ISrsExpire()
 {
 }
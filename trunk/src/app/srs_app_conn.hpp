@@ -59,6 +59,25 @@ public:
     }
 };
 
+// The reverse index of resource, to remove resource from manager without iterating all resources.
+class SrsResourceIndex
+{
+public:
+    // The position of resource in manager.
+    int pos;
+    // The ids, fast ids and names of resource.
+    std::vector<std::string> ids;
+    std::vector<uint64_t> fast_ids;
+    std::vector<std::string> names;
+    // Whether resource is removed, in zombies or disposing.
+    bool removed;
+public:
+    SrsResourceIndex() {
+        pos = 0;
+        removed = false;
+    }
+};
+
 // The resource manager remove resource and delete it asynchronously.
 class SrsResourceManager : public ISrsCoroutineHandler, public ISrsResourceManager
 {
@@ -78,6 +97,8 @@ private:
     // The zombie connections, we will delete it asynchronously.
     std::vector<ISrsResource*> zombies_;
     std::vector<ISrsResource*>* p_disposing_;
+    // The number of removed resources, which are in zombies or disposing, but not disposed.
+    int nn_removed_;
 private:
     // The connections without any id.
     std::vector<ISrsResource*> conns_;
@@ -90,6 +111,8 @@ private:
     SrsResourceFastIdItem* conns_level0_cache_;
     // The connections with resource name.
     std::map<std::string, ISrsResource*> conns_name_;
+    // The reverse index of connections, to remove connection in O(logN).
+    std::map<ISrsResource*, SrsResourceIndex*> conns_index_;
 public:
     SrsResourceManager(const std::string& label, bool verbose = false);
     virtual ~SrsResourceManager();
@@ -97,6 +120,8 @@ public:
     srs_error_t start();
     bool empty();
     size_t size();
+    // The number of alive resources, excluding the removed ones which are not disposed.
+    size_t alive();
 // Interface ISrsCoroutineHandler
 public:
     virtual srs_error_t cycle();
@@ -121,6 +146,7 @@ private:
     void clear();
     void do_clear();
     void dispose(ISrsResource* c);
+    void do_dispose(ISrsResource* c, SrsResourceIndex* index);
 };
 
 // If a connection is able to be expired,
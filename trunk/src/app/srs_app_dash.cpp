@@ -18,7 +18,9 @@
 #include <srs_kernel_mp4.hpp>
 
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <sstream>
+#include <iomanip>
 using namespace std;
 
 SrsInitMp4::SrsInitMp4()
@@ -65,7 +67,7 @@ SrsFragmentedMp4::~SrsFragmentedMp4()
     srs_freep(fw);
 }
 
-srs_error_t SrsFragmentedMp4::initialize(SrsRequest* r, bool video, SrsMpdWriter* mpd, uint32_t tid)
+srs_error_t SrsFragmentedMp4::initialize(string home, bool video, SrsMpdWriter* mpd, uint32_t tid)
 {
     srs_error_t err = srs_success;
     
@@ -77,7 +79,6 @@ srs_error_t SrsFragmentedMp4::initialize(SrsRequest* r, bool video, SrsMpdWriter
         return srs_error_wrap(err, "get fragment");
     }
     
-    string home = _srs_config->get_dash_path(r->vhost);
     set_path(home + "/" + file_home + "/" + file_name);
     
     if ((err = create_dir()) != srs_success) {
@@ -255,6 +256,16 @@ srs_error_t SrsMpdWriter::write(SrsFormat* format)
     return err;
 }
 
+void SrsMpdWriter::set_fragment(srs_utime_t v)
+{
+    fragment = v;
+}
+
+string SrsMpdWriter::get_fragment_home()
+{
+    return fragment_home;
+}
+
 srs_error_t SrsMpdWriter::get_fragment(bool video, std::string& home, std::string& file_name, int64_t& sn, srs_utime_t& basetime)
 {
     srs_error_t err = srs_success;
@@ -280,22 +291,266 @@ srs_error_t SrsMpdWriter::get_fragment(bool video, std::string& home, std::strin
     return err;
 }
 
+string srs_fmp4_video_codecs(SrsVideoCodecConfig* vcodec)
+{
+    const vector<char>& v = vcodec->avc_extra_data;
+    const uint8_t* p = (const uint8_t*)(v.empty()? NULL : &v[0]);
+    char buf[16];
+
+    // The avc1.PPCCLL, by the profile, constraint flags and level in AVCDecoderConfigurationRecord.
+    // @see ISO_IEC_14496-15-AVC-format-2012.pdf, page 16.
+    if (vcodec->id == SrsVideoCodecIdAVC && v.size() >= 4) {
+        snprintf(buf, sizeof(buf), "avc1.%02x%02x%02x", p[1], p[2], p[3]);
+        return buf;
+    }
+
+    // The hvc1.[A-C]P.F.[LH]L.C.C, by the HEVCDecoderConfigurationRecord.
+    // @see E.3 The 'Codecs' parameter for HEVC, ISO_IEC_14496-15-2017.pdf, page 143.
+    if (vcodec->id == SrsVideoCodecIdHEVC && v.size() >= 13) {
+        stringstream ss;
+        ss << "hvc1.";
+
+        int profile_space = (p[1] >> 6) & 0x03;
+        if (profile_space) {
+            ss << (char)('A' + profile_space - 1);
+        }
+        ss << (int)(p[1] & 0x1f);
+
+        // The general_profile_compatibility_flags in reverse bit order.
+        uint32_t flags = ((uint32_t)p[2] << 24) | ((uint32_t)p[3] << 16) | ((uint32_t)p[4] << 8) | p[5];
+        uint32_t reversed = 0;
+        for (int i = 0; i < 32; i++) {
+            reversed = (reversed << 1) | ((flags >> i) & 0x01);
+        }
+        ss << "." << std::hex << reversed << std::dec;
+
+        ss << "." << (((p[1] >> 5) & 0x01)? "H" : "L") << (int)p[12];
+
+        // The general_constraint_indicator_flags, omit the trailing zero bytes.
+        int nn_constraints = 6;
+        while (nn_constraints > 0 && p[5 + nn_constraints] == 0) {
+            nn_constraints--;
+        }
+        for (int i = 0; i < nn_constraints; i++) {
+            snprintf(buf, sizeof(buf), ".%X", p[6 + i]);
+            ss << buf;
+        }
+
+        return ss.str();
+    }
+
+    return "";
+}
+
+string srs_fmp4_audio_codecs(SrsAudioCodecConfig* acodec)
+{
+    // The mp4a.40.N, by the audio object type of AAC.
+    if (acodec->id == SrsAudioCodecIdAAC && acodec->aac_object != SrsAacObjectTypeReserved) {
+        return "mp4a.40." + srs_int2str(acodec->aac_object);
+    }
+
+    return "";
+}
+
+SrsFmp4M3u8Writer::SrsFmp4M3u8Writer()
+{
+    req = NULL;
+    fragment = 0;
+    video_bandwidth = 0;
+    audio_bandwidth = 0;
+}
+
+SrsFmp4M3u8Writer::~SrsFmp4M3u8Writer()
+{
+}
+
+srs_error_t SrsFmp4M3u8Writer::initialize(SrsRequest* r)
+{
+    req = r;
+    return srs_success;
+}
+
+srs_error_t SrsFmp4M3u8Writer::on_publish(string h, string fh, srs_utime_t f)
+{
+    home = h;
+    fragment_home = fh;
+    fragment = f;
+    master = "";
+    video_bandwidth = 0;
+    audio_bandwidth = 0;
+
+    string m3u8_file = _srs_config->get_hls_m3u8_file(req->vhost);
+    m3u8_path = srs_path_build_stream(m3u8_file, req->vhost, req->app, req->stream);
+
+    srs_trace("HLS: Config fmp4 home=%s, m3u8=%s, fragment=%s, duration=%dms", home.c_str(), m3u8_path.c_str(),
+        fragment_home.c_str(), srsu2msi(fragment));
+
+    return srs_success;
+}
+
+void SrsFmp4M3u8Writer::on_unpublish()
+{
+}
+
+srs_error_t SrsFmp4M3u8Writer::write(bool video, SrsFormat* format, SrsFragmentWindow* fragments, int64_t sequence_no)
+{
+    srs_error_t err = srs_success;
+
+    // The peak bitrate of fragments in window, for the BANDWIDTH of multivariant playlist.
+    int bandwidth = 0;
+    for (int i = 0; i < fragments->size(); i++) {
+        SrsFragment* fragment = fragments->at(i);
+
+        struct stat st;
+        srs_utime_t duration = fragment->duration();
+        if (duration > 0 && ::stat(fragment->fullpath().c_str(), &st) == 0) {
+            bandwidth = srs_max(bandwidth, (int)(st.st_size * 8 * SRS_UTIME_SECONDS / duration));
+        }
+    }
+    if (video) {
+        video_bandwidth = bandwidth;
+    } else {
+        audio_bandwidth = bandwidth;
+    }
+
+    if ((err = write_master(format)) != srs_success) {
+        return srs_error_wrap(err, "write master");
+    }
+
+    srs_utime_t target = srs_max(fragment, fragments->max_duration());
+
+    stringstream ss;
+    ss << "#EXTM3U" << SRS_CONSTS_LF
+        << "#EXT-X-VERSION:7" << SRS_CONSTS_LF
+        << "#EXT-X-TARGETDURATION:" << (target + SRS_UTIME_SECONDS - 1) / SRS_UTIME_SECONDS << SRS_CONSTS_LF
+        << "#EXT-X-MEDIA-SEQUENCE:" << sequence_no << SRS_CONSTS_LF
+        << "#EXT-X-MAP:URI=\"" << (video? "video":"audio") << "-init.mp4\"" << SRS_CONSTS_LF;
+
+    for (int i = 0; i < fragments->size(); i++) {
+        SrsFragment* fragment = fragments->at(i);
+        ss << "#EXTINF:" << std::fixed << std::setprecision(3) << srsu2ms(fragment->duration()) / 1000.0 << "," << SRS_CONSTS_LF
+            << srs_path_basename(fragment->fullpath()) << SRS_CONSTS_LF;
+    }
+
+    string path = home + "/" + fragment_home + "/" + (video? "video.m3u8":"audio.m3u8");
+    if ((err = write_file(path, ss.str())) != srs_success) {
+        return srs_error_wrap(err, "write media playlist");
+    }
+
+    return err;
+}
+
+srs_error_t SrsFmp4M3u8Writer::write_master(SrsFormat* format)
+{
+    srs_error_t err = srs_success;
+
+    // The media playlists are under the fragment home, relative to the multivariant playlist.
+    string m3u8_dir = srs_path_dirname(m3u8_path);
+    string uri = "/" + fragment_home;
+    if (srs_string_starts_with(fragment_home, m3u8_dir + "/")) {
+        uri = fragment_home.substr(m3u8_dir.length() + 1);
+    }
+
+    stringstream ss;
+    ss << "#EXTM3U" << SRS_CONSTS_LF
+        << "#EXT-X-VERSION:7" << SRS_CONSTS_LF
+        << "#EXT-X-INDEPENDENT-SEGMENTS" << SRS_CONSTS_LF;
+
+    if (format->vcodec && format->acodec) {
+        ss << "#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"audio\",NAME=\"audio\",DEFAULT=YES,AUTOSELECT=YES,"
+            << "URI=\"" << uri << "/audio.m3u8\"" << SRS_CONSTS_LF;
+    }
+    // Never write the CODECS if any codec is unknown, for player trusts it to select decoder.
+    string vcodecs = format->vcodec? srs_fmp4_video_codecs(format->vcodec) : "";
+    string acodecs = format->acodec? srs_fmp4_audio_codecs(format->acodec) : "";
+    bool codecs_ok = (!format->vcodec || !vcodecs.empty()) && (!format->acodec || !acodecs.empty());
+
+    if (format->vcodec) {
+        ss << "#EXT-X-STREAM-INF:BANDWIDTH=" << video_bandwidth + (format->acodec? audio_bandwidth : 0);
+        if (codecs_ok) {
+            ss << ",CODECS=\"" << vcodecs << (format->acodec? "," + acodecs : "") << "\"";
+        }
+        if (format->vcodec->width && format->vcodec->height) {
+            ss << ",RESOLUTION=" << format->vcodec->width << "x" << format->vcodec->height;
+        }
+        if (format->acodec) {
+            ss << ",AUDIO=\"audio\"";
+        }
+        ss << SRS_CONSTS_LF << uri << "/video.m3u8" << SRS_CONSTS_LF;
+    } else if (format->acodec) {
+        ss << "#EXT-X-STREAM-INF:BANDWIDTH=" << audio_bandwidth;
+        if (codecs_ok) {
+            ss << ",CODECS=\"" << acodecs << "\"";
+        }
+        ss << SRS_CONSTS_LF << uri << "/audio.m3u8" << SRS_CONSTS_LF;
+    }
+
+    // Ignore if not changed, to avoid rewriting it for each fragment.
+    string content = ss.str();
+    if (content == master) {
+        return err;
+    }
+
+    string path = home + "/" + m3u8_path;
+    if ((err = write_file(path, content)) != srs_success) {
+        return srs_error_wrap(err, "write multivariant playlist");
+    }
+    master = content;
+
+    srs_trace("HLS: Refresh fmp4 m3u8 success, size=%dB, file=%s", content.length(), path.c_str());
+
+    return err;
+}
+
+srs_error_t SrsFmp4M3u8Writer::write_file(string path, string content)
+{
+    srs_error_t err = srs_success;
+
+    string full_home = srs_path_dirname(path);
+    if ((err = srs_create_dir_recursively(full_home)) != srs_success) {
+        return srs_error_wrap(err, "Create m3u8 home failed, home=%s", full_home.c_str());
+    }
+
+    SrsFileWriter* fw = new SrsFileWriter();
+    SrsAutoFree(SrsFileWriter, fw);
+
+    string path_tmp = path + ".tmp";
+    if ((err = fw->open(path_tmp)) != srs_success) {
+        return srs_error_wrap(err, "Open m3u8 file=%s failed", path_tmp.c_str());
+    }
+
+    if ((err = fw->write((void*)content.data(), content.length(), NULL)) != srs_success) {
+        return srs_error_wrap(err, "Write m3u8 file=%s failed", path.c_str());
+    }
+
+    if (::rename(path_tmp.c_str(), path.c_str()) < 0) {
+        return srs_error_new(ERROR_HLS_WRITE_FAILED, "Rename %s to %s failed", path_tmp.c_str(), path.c_str());
+    }
+
+    return err;
+}
+
 SrsDashController::SrsDashController()
 {
     req = NULL;
     video_tack_id = 0;
     audio_track_id = 1;
     mpd = new SrsMpdWriter();
+    m3u8 = new SrsFmp4M3u8Writer();
+    mpd_enabled = m3u8_enabled = false;
     vcurrent = acurrent = NULL;
     vfragments = new SrsFragmentWindow();
     afragments = new SrsFragmentWindow();
     audio_dts = video_dts = 0;
-    fragment = 0;
+    nn_vreaped = nn_areaped = 0;
+    fragment = window = 0;
+    cleanup = false;
 }
 
 SrsDashController::~SrsDashController()
 {
     srs_freep(mpd);
+    srs_freep(m3u8);
     srs_freep(vcurrent);
     srs_freep(acurrent);
     srs_freep(vfragments);
@@ -312,6 +567,10 @@ srs_error_t SrsDashController::initialize(SrsRequest* r)
         return srs_error_wrap(err, "mpd");
     }
     
+    if ((err = m3u8->initialize(r)) != srs_success) {
+        return srs_error_wrap(err, "m3u8");
+    }
+    
     return err;
 }
 
@@ -321,22 +580,45 @@ srs_error_t SrsDashController::on_publish()
 
     SrsRequest* r = req;
 
-    fragment = _srs_config->get_dash_fragment(r->vhost);
-    home = _srs_config->get_dash_path(r->vhost);
+    mpd_enabled = _srs_config->get_dash_enabled(r->vhost);
+    m3u8_enabled = _srs_config->get_hls_enabled(r->vhost) && _srs_config->get_hls_fmp4(r->vhost);
+
+    // The fragments are shared by DASH and HLS, so follow the config of DASH if enabled.
+    if (mpd_enabled) {
+        fragment = _srs_config->get_dash_fragment(r->vhost);
+        home = _srs_config->get_dash_path(r->vhost);
+        window = _srs_config->get_dash_timeshift(r->vhost);
+    } else {
+        fragment = _srs_config->get_hls_fragment(r->vhost);
+        home = _srs_config->get_hls_path(r->vhost);
+        window = 0;
+    }
+
+    // Keep the fragments in the larger window, and only HLS cleanup the expired files.
+    cleanup = false;
+    if (m3u8_enabled) {
+        window = srs_max(window, _srs_config->get_hls_window(r->vhost));
+        cleanup = _srs_config->get_hls_cleanup(r->vhost);
+    }
 
     if ((err = mpd->on_publish()) != srs_success) {
         return srs_error_wrap(err, "mpd");
     }
+    mpd->set_fragment(fragment);
+
+    if (m3u8_enabled && (err = m3u8->on_publish(home, mpd->get_fragment_home(), fragment)) != srs_success) {
+        return srs_error_wrap(err, "m3u8");
+    }
 
     srs_freep(vcurrent);
     vcurrent = new SrsFragmentedMp4();
-    if ((err = vcurrent->initialize(req, true, mpd, video_tack_id)) != srs_success) {
+    if ((err = vcurrent->initialize(home, true, mpd, video_tack_id)) != srs_success) {
         return srs_error_wrap(err, "video fragment");
     }
 
     srs_freep(acurrent);
     acurrent = new SrsFragmentedMp4();
-    if ((err = acurrent->initialize(req, false, mpd, audio_track_id)) != srs_success) {
+    if ((err = acurrent->initialize(home, false, mpd, audio_track_id)) != srs_success) {
         return srs_error_wrap(err, "audio fragment");
     }
 
@@ -346,6 +628,7 @@ srs_error_t SrsDashController::on_publish()
 void SrsDashController::on_unpublish()
 {
     mpd->on_unpublish();
+    m3u8->on_unpublish();
 
     srs_error_t err = srs_success;
 
@@ -378,7 +661,11 @@ srs_error_t SrsDashController::on_audio(SrsSharedPtrMessage* shared_audio, SrsFo
         afragments->append(acurrent);
         acurrent = new SrsFragmentedMp4();
         
-        if ((err = acurrent->initialize(req, false, mpd, audio_track_id)) != srs_success) {
+        if ((err = on_reaped(false, format)) != srs_success) {
+            return srs_error_wrap(err, "reaped");
+        }
+        
+        if ((err = acurrent->initialize(home, false, mpd, audio_track_id)) != srs_success) {
             return srs_error_wrap(err, "Initialize the audio fragment failed");
         }
     }
@@ -411,7 +698,11 @@ srs_error_t SrsDashController::on_video(SrsSharedPtrMessage* shared_video, SrsFo
         vfragments->append(vcurrent);
         vcurrent = new SrsFragmentedMp4();
         
-        if ((err = vcurrent->initialize(req, true, mpd, video_tack_id)) != srs_success) {
+        if ((err = on_reaped(true, format)) != srs_success) {
+            return srs_error_wrap(err, "reaped");
+        }
+        
+        if ((err = vcurrent->initialize(home, true, mpd, video_tack_id)) != srs_success) {
             return srs_error_wrap(err, "Initialize the video fragment failed");
         }
     }
@@ -427,10 +718,37 @@ srs_error_t SrsDashController::on_video(SrsSharedPtrMessage* shared_video, SrsFo
     return err;
 }
 
+srs_error_t SrsDashController::on_reaped(bool video, SrsFormat* format)
+{
+    srs_error_t err = srs_success;
+
+    SrsFragmentWindow* fragments = video? vfragments : afragments;
+    int64_t nn_reaped = video? ++nn_vreaped : ++nn_areaped;
+
+    fragments->shrink(window);
+    fragments->clear_expired(cleanup);
+
+    if (!m3u8_enabled) {
+        return err;
+    }
+
+    // The media sequence of the first fragment in window.
+    int64_t sequence_no = nn_reaped - fragments->size();
+    if ((err = m3u8->write(video, format, fragments, sequence_no)) != srs_success) {
+        return srs_error_wrap(err, "write m3u8");
+    }
+
+    return err;
+}
+
 srs_error_t SrsDashController::refresh_mpd(SrsFormat* format)
 {
     srs_error_t err = srs_success;
     
+    if (!mpd_enabled) {
+        return err;
+    }
+    
     // TODO: FIXME: Support pure audio streaming.
     if (!format->acodec || !format->vcodec) {
         return err;
@@ -521,7 +839,9 @@ srs_error_t SrsDash::on_publish()
         return err;
     }
     
-    if (!_srs_config->get_dash_enabled(req->vhost)) {
+    // The fragments are shared by DASH and HLS of FMP4.
+    bool hls_fmp4 = _srs_config->get_hls_enabled(req->vhost) && _srs_config->get_hls_fmp4(req->vhost);
+    if (!_srs_config->get_dash_enabled(req->vhost) && !hls_fmp4) {
         return err;
     }
     enabled = true;
@@ -22,6 +22,8 @@ class SrsFileWriter;
 class SrsMpdWriter;
 class SrsMp4M2tsInitEncoder;
 class SrsMp4M2tsSegmentEncoder;
+class SrsVideoCodecConfig;
+class SrsAudioCodecConfig;
 
 // The init mp4 for FMP4.
 class SrsInitMp4 : public SrsFragment
@@ -47,8 +49,8 @@ public:
     SrsFragmentedMp4();
     virtual ~SrsFragmentedMp4();
 public:
-    // Initialize the fragment, create the home dir, open the file.
-    virtual srs_error_t initialize(SrsRequest* r, bool video, SrsMpdWriter* mpd, uint32_t tid);
+    // Initialize the fragment under the home dir, create the dir, open the file.
+    virtual srs_error_t initialize(std::string home, bool video, SrsMpdWriter* mpd, uint32_t tid);
     // Write media message to fragment.
     virtual srs_error_t write(SrsSharedPtrMessage* shared_msg, SrsFormat* format);
     // Reap the fragment, close the fd and rename tmp to official file.
@@ -85,17 +87,69 @@ public:
     // Write MPD according to parsed format of stream.
     virtual srs_error_t write(SrsFormat* format);
 public:
+    // Set the fragment duration, which determines the sequence number of fragment.
+    // @remark For HLS without DASH, the fragments are reaped by hls_fragment.
+    virtual void set_fragment(srs_utime_t v);
+    // Get the home for fragment, relative to home.
+    virtual std::string get_fragment_home();
     // Get the fragment relative home and filename.
     // The basetime is the absolute time in srs_utime_t, while the sn(sequence number) is basetime/fragment.
     virtual srs_error_t get_fragment(bool video, std::string& home, std::string& filename, int64_t& sn, srs_utime_t& basetime);
 };
 
-// The controller for DASH, control the MPD and FMP4 generating system.
+// Build the codecs of track in RFC6381 for CODECS of m3u8, for example, avc1.64001f or mp4a.40.2,
+// return empty string if unknown.
+extern std::string srs_fmp4_video_codecs(SrsVideoCodecConfig* vcodec);
+extern std::string srs_fmp4_audio_codecs(SrsAudioCodecConfig* acodec);
+
+// The writer to write m3u8 for HLS, which refers to the FMP4 fragments shared with DASH.
+// There is a multivariant playlist, and a media playlist for each track, for example:
+//      live/livestream.m3u8, the multivariant playlist.
+//      live/livestream/video.m3u8, refers to video-init.mp4 and video-N.m4s
+//      live/livestream/audio.m3u8, refers to audio-init.mp4 and audio-N.m4s
+class SrsFmp4M3u8Writer
+{
+private:
+    SrsRequest* req;
+    // The base or home dir to write files, same to the fragments.
+    std::string home;
+    // The path of multivariant playlist, relative to home.
+    std::string m3u8_path;
+    // The home for fragment and media playlists, relative to home.
+    std::string fragment_home;
+    // The duration of fragment in srs_utime_t, the minimum target duration.
+    srs_utime_t fragment;
+    // The content of multivariant playlist, to rewrite it when codec or bandwidth changed.
+    std::string master;
+    // The peak bitrate of video and audio fragments, in bps.
+    int video_bandwidth;
+    int audio_bandwidth;
+public:
+    SrsFmp4M3u8Writer();
+    virtual ~SrsFmp4M3u8Writer();
+public:
+    virtual srs_error_t initialize(SrsRequest* r);
+    virtual srs_error_t on_publish(std::string h, std::string fh, srs_utime_t f);
+    virtual void on_unpublish();
+    // Write the media playlist of track, and the multivariant playlist if codec changed.
+    // @param sequence_no The media sequence number of the first fragment in window.
+    virtual srs_error_t write(bool video, SrsFormat* format, SrsFragmentWindow* fragments, int64_t sequence_no);
+private:
+    virtual srs_error_t write_master(SrsFormat* format);
+    virtual srs_error_t write_file(std::string path, std::string content);
+};
+
+// The controller for DASH and HLS of FMP4, control the MPD, m3u8 and FMP4 generating system.
+// @remark The stream is fragmented once, and the fragments are shared by MPD and m3u8.
 class SrsDashController
 {
 private:
     SrsRequest* req;
     SrsMpdWriter* mpd;
+    SrsFmp4M3u8Writer* m3u8;
+    // Whether write MPD for DASH, and m3u8 for HLS.
+    bool mpd_enabled;
+    bool m3u8_enabled;
 private:
     SrsFragmentedMp4* vcurrent;
     SrsFragmentWindow* vfragments;
@@ -103,9 +157,15 @@ private:
     SrsFragmentWindow* afragments;
     uint64_t audio_dts;
     uint64_t video_dts;
+    // The number of reaped fragments, for the media sequence of m3u8.
+    int64_t nn_vreaped;
+    int64_t nn_areaped;
 private:
     // The fragment duration in srs_utime_t to reap it.
     srs_utime_t fragment;
+    // The window in srs_utime_t to keep the fragments, and whether delete the expired files.
+    srs_utime_t window;
+    bool cleanup;
 private:
     std::string home;
     int video_tack_id;
@@ -120,11 +180,13 @@ public:
     virtual srs_error_t on_audio(SrsSharedPtrMessage* shared_audio, SrsFormat* format);
     virtual srs_error_t on_video(SrsSharedPtrMessage* shared_video, SrsFormat* format);
 private:
+    // Append the reaped fragment to window, shrink it and refresh the m3u8.
+    virtual srs_error_t on_reaped(bool video, SrsFormat* format);
     virtual srs_error_t refresh_mpd(SrsFormat* format);
     virtual srs_error_t refresh_init_mp4(SrsSharedPtrMessage* msg, SrsFormat* format);
 };
 
-// The MPEG-DASH encoder, transmux RTMP to DASH.
+// The MPEG-DASH encoder, transmux RTMP to DASH, and HLS of FMP4.
 class SrsDash
 {
 private:
@@ -421,11 +421,13 @@ srs_error_t SrsDvrFlvSegmenter::close_encoder()
 SrsDvrMp4Segmenter::SrsDvrMp4Segmenter()
 {
     enc = new SrsMp4Encoder();
+    fenc = NULL;
 }
 
 SrsDvrMp4Segmenter::~SrsDvrMp4Segmenter()
 {
     srs_freep(enc);
+    srs_freep(fenc);
 }
 
 srs_error_t SrsDvrMp4Segmenter::refresh_metadata()
@@ -438,8 +440,18 @@ srs_error_t SrsDvrMp4Segmenter::open_encoder()
     srs_error_t err = srs_success;
     
     srs_freep(enc);
-    enc = new SrsMp4Encoder();
+    srs_freep(fenc);
+    
+    // For fragmented MP4, only the samples of current fragment are cached.
+    if (_srs_config->get_dvr_fmp4(req->vhost)) {
+        fenc = new SrsMp4FragmentedEncoder();
+        if ((err = fenc->initialize(fs, _srs_config->get_dvr_fmp4_fragment(req->vhost))) != srs_success) {
+            return srs_error_wrap(err, "init fmp4 encoder");
+        }
+        return err;
+    }
     
+    enc = new SrsMp4Encoder();
     if ((err = enc->initialize(fs)) != srs_success) {
         return srs_error_wrap(err, "init encoder");
     }
@@ -462,18 +474,29 @@ srs_error_t SrsDvrMp4Segmenter::encode_audio(SrsSharedPtrMessage* audio, SrsForm
     SrsAudioChannels channels = format->acodec->sound_type;
     
     SrsAudioAacFrameTrait ct = format->audio->aac_packet_type;
-    if (ct == SrsAudioAacFrameTraitSequenceHeader) {
+    if (ct == SrsAudioAacFrameTraitSequenceHeader && enc) {
         enc->acodec = sound_format;
         enc->sample_rate = sound_rate;
         enc->sound_bits = sound_size;
         enc->channels = channels;
     }
+    if (ct == SrsAudioAacFrameTraitSequenceHeader && fenc) {
+        fenc->acodec = sound_format;
+        fenc->sample_rate = sound_rate;
+        fenc->sound_bits = sound_size;
+        fenc->channels = channels;
+    }
     
     uint8_t* sample = (uint8_t*)format->raw;
     uint32_t nb_sample = (uint32_t)format->nb_raw;
     
     uint32_t dts = (uint32_t)audio->timestamp;
-    if ((err = enc->write_sample(format, SrsMp4HandlerTypeSOUN, 0x00, ct, dts, dts, sample, nb_sample)) != srs_success) {
+    if (fenc) {
+        err = fenc->write_sample(format, SrsMp4HandlerTypeSOUN, 0x00, ct, dts, dts, sample, nb_sample);
+    } else {
+        err = enc->write_sample(format, SrsMp4HandlerTypeSOUN, 0x00, ct, dts, dts, sample, nb_sample);
+    }
+    if (err != srs_success) {
         return srs_error_wrap(err, "write sample");
     }
     
@@ -491,7 +514,11 @@ srs_error_t SrsDvrMp4Segmenter::encode_video(SrsSharedPtrMessage* video, SrsForm
     uint32_t cts = (uint32_t)format->video->cts;
     
     if (ct == SrsVideoAvcFrameTraitSequenceHeader) {
-        enc->vcodec = codec_id;
+        if (enc) {
+            enc->vcodec = codec_id;
+        } else {
+            fenc->vcodec = codec_id;
+        }
     }
     
     uint32_t dts = (uint32_t)video->timestamp;
@@ -499,7 +526,12 @@ srs_error_t SrsDvrMp4Segmenter::encode_video(SrsSharedPtrMessage* video, SrsForm
     
     uint8_t* sample = (uint8_t*)format->raw;
     uint32_t nb_sample = (uint32_t)format->nb_raw;
-    if ((err = enc->write_sample(format, SrsMp4HandlerTypeVIDE, frame_type, ct, dts, pts, sample, nb_sample)) != srs_success) {
+    if (fenc) {
+        err = fenc->write_sample(format, SrsMp4HandlerTypeVIDE, frame_type, ct, dts, pts, sample, nb_sample);
+    } else {
+        err = enc->write_sample(format, SrsMp4HandlerTypeVIDE, frame_type, ct, dts, pts, sample, nb_sample);
+    }
+    if (err != srs_success) {
         return srs_error_wrap(err, "write sample");
     }
     
@@ -510,7 +542,11 @@ srs_error_t SrsDvrMp4Segmenter::close_encoder()
 {
     srs_error_t err = srs_success;
     
-    if ((err = enc->flush()) != srs_success) {
+    if (fenc && (err = fenc->flush()) != srs_success) {
+        return srs_error_wrap(err, "flush fmp4 encoder");
+    }
+    
+    if (enc && (err = enc->flush()) != srs_success) {
         return srs_error_wrap(err, "flush encoder");
     }
     
@@ -865,7 +901,8 @@ srs_error_t SrsDvrSegmentPlan::update_duration(SrsSharedPtrMessage* msg)
         
         char* payload = msg->payload;
         int size = msg->size;
-        bool is_key_frame = SrsFlvVideo::h264(payload, size) && SrsFlvVideo::keyframe(payload, size) && !SrsFlvVideo::sh(payload, size);
+        bool is_video = SrsFlvVideo::h264(payload, size) || SrsFlvVideo::hevc(payload, size);
+        bool is_key_frame = is_video && SrsFlvVideo::keyframe(payload, size) && !SrsFlvVideo::sh(payload, size);
         if (!is_key_frame) {
             return err;
         }
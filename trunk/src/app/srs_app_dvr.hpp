@@ -25,6 +25,7 @@ class SrsJsonAny;
 class SrsJsonObject;
 class SrsThread;
 class SrsMp4Encoder;
+class SrsMp4FragmentedEncoder;
 class SrsFragment;
 class SrsFormat;
 
@@ -42,8 +43,9 @@ protected:
     bool wait_keyframe;
     // The FLV/MP4 fragment file.
     SrsFragment* fragment;
-private:
+protected:
     SrsRequest* req;
+private:
     SrsDvrPlan* plan;
 private:
     SrsRtmpJitter* jitter;
@@ -125,6 +127,8 @@ class SrsDvrMp4Segmenter : public SrsDvrSegmenter
 private:
     // The MP4 encoder, for MP4 target.
     SrsMp4Encoder* enc;
+    // The fragmented MP4 encoder, for MP4 target when dvr_fmp4 is on.
+    SrsMp4FragmentedEncoder* fenc;
 public:
     SrsDvrMp4Segmenter();
     virtual ~SrsDvrMp4Segmenter();
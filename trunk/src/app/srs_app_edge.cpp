@@ -7,6 +7,7 @@
 #include <srs_app_edge.hpp>
 
 #include <stdlib.h>
+#include <algorithm>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -29,6 +30,9 @@ using namespace std;
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_balance.hpp>
 #include <srs_app_rtmp_conn.hpp>
+#include <srs_app_shm.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_kernel_codec.hpp>
 
 // when edge timeout, retry next.
 #define SRS_EDGE_INGESTER_TIMEOUT (5 * SRS_UTIME_SECONDS)
@@ -36,6 +40,56 @@ using namespace std;
 // when edge error, wait for quit
 #define SRS_EDGE_FORWARDER_TIMEOUT (150 * SRS_UTIME_MILLISECONDS)
 
+// when no message in shared memory, sleep for a while and poll again.
+#define SRS_EDGE_SHM_POLL_INTERVAL (10 * SRS_UTIME_MILLISECONDS)
+
+// when error, edge ingester sleep for a while and retry.
+#define SRS_EDGE_INGESTER_CIMS (3 * SRS_UTIME_SECONDS)
+
+// the max messages cached by hot-standby feeder, drop to the next keyframe if exceed.
+#define SRS_EDGE_FEEDER_MAX_MSGS 4096
+// the interval for hot-standby ingester to check feeders.
+#define SRS_EDGE_FEEDER_CHECK (100 * SRS_UTIME_MILLISECONDS)
+// when timestamp of feeders differs less than it, the origins share the same timeline, in ms.
+#define SRS_EDGE_FEEDER_JITTER 3000
+// when origins have different timeline, the gap of timestamp when switching, in ms.
+#define SRS_EDGE_FEEDER_GAP 10
+
+// Sample the latency of origin, for the fastest load balance.
+void srs_edge_sample_latency(SrsLbRoundRobin* lb, string origin, srs_utime_t latency)
+{
+    SrsLbFastest* fastest = dynamic_cast<SrsLbFastest*>(lb);
+    if (!fastest || origin.empty()) {
+        return;
+    }
+
+    fastest->sample(origin, latency);
+    srs_trace("edge origin %s latency=%dms, smoothed=%dms", origin.c_str(), srsu2msi(latency), srsu2msi(fastest->latency(origin)));
+}
+
+void srs_edge_free_messages(vector<SrsCommonMessage*>& msgs)
+{
+    vector<SrsCommonMessage*>::iterator it;
+    for (it = msgs.begin(); it != msgs.end(); ++it) {
+        SrsCommonMessage* msg = *it;
+        srs_freep(msg);
+    }
+    msgs.clear();
+}
+
+// Copy the message, for the sequence headers.
+SrsCommonMessage* srs_edge_copy_message(SrsCommonMessage* msg)
+{
+    SrsCommonMessage* copy = new SrsCommonMessage();
+    copy->header = msg->header;
+    if (msg->size > 0) {
+        copy->create_payload(msg->size);
+        memcpy(copy->payload, msg->payload, msg->size);
+    }
+    copy->size = msg->size;
+    return copy;
+}
+
 SrsEdgeUpstream::SrsEdgeUpstream()
 {
 }
@@ -73,8 +127,13 @@ srs_error_t SrsEdgeRtmpUpstream::connect(SrsRequest* r, SrsLbRoundRobin* lb)
             return srs_error_new(ERROR_EDGE_VHOST_REMOVED, "vhost %s removed", req->vhost.c_str());
         }
         
-        // select the origin.
-        std::string server = lb->select(conf->args);
+        // select the origin, exclude the one used by hot-standby peer.
+        std::vector<std::string> origins = conf->args;
+        origins.erase(std::remove(origins.begin(), origins.end(), exclude), origins.end());
+        if (origins.empty()) {
+            origins = conf->args;
+        }
+        std::string server = selected_origin = lb->select(origins);
         int port = SRS_CONSTS_RTMP_DEFAULT_PORT;
         srs_parse_hostport(server, server, port);
         
@@ -136,6 +195,16 @@ void SrsEdgeRtmpUpstream::close()
     srs_freep(sdk);
 }
 
+void SrsEdgeRtmpUpstream::set_exclude(string origin)
+{
+    exclude = origin;
+}
+
+string SrsEdgeRtmpUpstream::origin()
+{
+    return selected_origin;
+}
+
 void SrsEdgeRtmpUpstream::selected(string& server, int& port)
 {
     server = selected_ip;
@@ -152,11 +221,343 @@ void SrsEdgeRtmpUpstream::kbps_sample(const char* label, int64_t age)
     sdk->kbps_sample(label, age);
 }
 
+SrsEdgeShmUpstream::SrsEdgeShmUpstream(string d)
+{
+    dir = d;
+    ring = new SrsShmRing();
+    timeout = SRS_EDGE_INGESTER_TIMEOUT;
+}
+
+SrsEdgeShmUpstream::~SrsEdgeShmUpstream()
+{
+    close();
+    srs_freep(ring);
+}
+
+srs_error_t SrsEdgeShmUpstream::connect(SrsRequest* r, SrsLbRoundRobin* /*lb*/)
+{
+    srs_error_t err = srs_success;
+    
+    string url = r->get_stream_url();
+    string path = srs_shm_ring_path(dir, url);
+    
+    if ((err = ring->attach(path, url)) != srs_success) {
+        return srs_error_wrap(err, "attach %s", path.c_str());
+    }
+    
+    if ((err = ring->read_slots(pending)) != srs_success) {
+        return srs_error_wrap(err, "read slots");
+    }
+    
+    srs_trace("edge pull %s from shm %s, sh=%d", url.c_str(), path.c_str(), (int)pending.size());
+    
+    return err;
+}
+
+srs_error_t SrsEdgeShmUpstream::recv_message(SrsCommonMessage** pmsg)
+{
+    srs_error_t err = srs_success;
+    
+    if (!pending.empty()) {
+        *pmsg = pending.front();
+        pending.erase(pending.begin());
+        return err;
+    }
+    
+    srs_utime_t starttime = srs_update_system_time();
+    while (true) {
+        SrsCommonMessage* msg = NULL;
+        if ((err = ring->read(&msg)) != srs_success) {
+            return srs_error_wrap(err, "read shm");
+        }
+        
+        if (msg) {
+            *pmsg = msg;
+            return err;
+        }
+        
+        if (!ring->alive()) {
+            return srs_error_new(ERROR_SHM_CLOSED, "shm closed");
+        }
+        
+        if (srs_update_system_time() - starttime > timeout) {
+            return srs_error_new(ERROR_SHM_TIMEOUT, "shm timeout %dms", srsu2msi(timeout));
+        }
+        
+        srs_usleep(SRS_EDGE_SHM_POLL_INTERVAL);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsEdgeShmUpstream::decode_message(SrsCommonMessage* msg, SrsPacket** ppacket)
+{
+    srs_error_t err = srs_success;
+    
+    // Only metadata is written to shared memory.
+    if (!msg->header.is_amf0_data()) {
+        return srs_error_new(ERROR_SHM_INVALID, "invalid message type=%d", msg->header.message_type);
+    }
+    
+    SrsBuffer stream(msg->payload, msg->size);
+    SrsOnMetaDataPacket* metadata = new SrsOnMetaDataPacket();
+    if ((err = metadata->decode(&stream)) != srs_success) {
+        srs_freep(metadata);
+        return srs_error_wrap(err, "decode metadata");
+    }
+    
+    *ppacket = metadata;
+    
+    return err;
+}
+
+void SrsEdgeShmUpstream::close()
+{
+    std::vector<SrsCommonMessage*>::iterator it;
+    for (it = pending.begin(); it != pending.end(); ++it) {
+        SrsCommonMessage* msg = *it;
+        srs_freep(msg);
+    }
+    pending.clear();
+    
+    ring->close();
+}
+
+void SrsEdgeShmUpstream::selected(string& server, int& port)
+{
+    server = dir;
+    port = 0;
+}
+
+void SrsEdgeShmUpstream::set_recv_timeout(srs_utime_t tm)
+{
+    timeout = tm;
+}
+
+void SrsEdgeShmUpstream::kbps_sample(const char* label, int64_t age)
+{
+    srs_trace("<- %s time=%" PRId64 ", shm overrun=%d", label, age, ring->nn_overrun());
+}
+
+SrsEdgeFeeder::SrsEdgeFeeder()
+{
+    req = NULL;
+    lb = NULL;
+    peer = NULL;
+    trd = new SrsDummyCoroutine();
+    upstream = NULL;
+    cond = srs_cond_new();
+    connected_ = false;
+    active_ = false;
+    has_keyframe = false;
+    meta = vsh = ash = NULL;
+}
+
+SrsEdgeFeeder::~SrsEdgeFeeder()
+{
+    stop();
+    
+    srs_freep(trd);
+    srs_cond_destroy(cond);
+}
+
+void SrsEdgeFeeder::initialize(SrsRequest* r, SrsLbRoundRobin* l, SrsEdgeFeeder* p)
+{
+    req = r;
+    lb = l;
+    peer = p;
+}
+
+srs_error_t SrsEdgeFeeder::start()
+{
+    srs_error_t err = srs_success;
+    
+    srs_freep(trd);
+    trd = new SrsSTCoroutine("edge-feeder", this);
+    
+    if ((err = trd->start()) != srs_success) {
+        return srs_error_wrap(err, "coroutine");
+    }
+    
+    return err;
+}
+
+void SrsEdgeFeeder::stop()
+{
+    trd->stop();
+    
+    reset();
+    srs_freep(upstream);
+    srs_freep(meta);
+    srs_freep(vsh);
+    srs_freep(ash);
+}
+
+bool SrsEdgeFeeder::connected()
+{
+    return connected_;
+}
+
+bool SrsEdgeFeeder::ready()
+{
+    return connected_ && has_keyframe;
+}
+
+void SrsEdgeFeeder::set_active(bool v)
+{
+    active_ = v;
+}
+
+string SrsEdgeFeeder::origin()
+{
+    return (connected_ && upstream)? upstream->origin() : "";
+}
+
+SrsEdgeUpstream* SrsEdgeFeeder::get_upstream()
+{
+    return upstream;
+}
+
+void SrsEdgeFeeder::dump_sh(vector<SrsCommonMessage*>& out)
+{
+    SrsCommonMessage* shs[] = {meta, vsh, ash};
+    for (int i = 0; i < 3; i++) {
+        if (shs[i]) {
+            out.push_back(srs_edge_copy_message(shs[i]));
+        }
+    }
+}
+
+void SrsEdgeFeeder::pop(vector<SrsCommonMessage*>& out, srs_utime_t timeout)
+{
+    if (msgs.empty() && connected_ && timeout > 0) {
+        srs_cond_timedwait(cond, timeout);
+    }
+    
+    out.insert(out.end(), msgs.begin(), msgs.end());
+    msgs.clear();
+}
+
+srs_error_t SrsEdgeFeeder::cycle()
+{
+    srs_error_t err = srs_success;
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "edge feeder");
+        }
+        
+        if ((err = do_cycle()) != srs_success) {
+            srs_warn("EdgeFeeder: Ignore error, %s", srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+        
+        // Notify the ingester to switch to the standby.
+        connected_ = false;
+        reset();
+        srs_cond_signal(cond);
+        
+        srs_usleep(SRS_EDGE_INGESTER_CIMS);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsEdgeFeeder::do_cycle()
+{
+    srs_error_t err = srs_success;
+    
+    srs_freep(upstream);
+    upstream = new SrsEdgeRtmpUpstream("");
+    upstream->set_exclude(peer->origin());
+    
+    srs_utime_t starttime = srs_update_system_time();
+    if ((err = upstream->connect(req, lb)) != srs_success) {
+        srs_edge_sample_latency(lb, upstream->origin(), SRS_EDGE_INGESTER_TIMEOUT);
+        return srs_error_wrap(err, "connect upstream");
+    }
+    
+    upstream->set_recv_timeout(SRS_EDGE_INGESTER_TIMEOUT);
+    connected_ = true;
+    
+    bool got_frame = false;
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            return srs_error_wrap(err, "thread quit");
+        }
+        
+        SrsCommonMessage* msg = NULL;
+        if ((err = upstream->recv_message(&msg)) != srs_success) {
+            return srs_error_wrap(err, "recv message");
+        }
+        
+        if (!got_frame && (msg->header.is_audio() || msg->header.is_video())) {
+            got_frame = true;
+            srs_edge_sample_latency(lb, upstream->origin(), srs_update_system_time() - starttime);
+        }
+        
+        on_message(msg);
+        srs_cond_signal(cond);
+    }
+    
+    return err;
+}
+
+void SrsEdgeFeeder::on_message(SrsCommonMessage* msg)
+{
+    bool is_vsh = msg->header.is_video() && SrsFlvVideo::sh(msg->payload, msg->size);
+    bool is_ash = msg->header.is_audio() && SrsFlvAudio::sh(msg->payload, msg->size);
+    bool keyframe = msg->header.is_video() && !is_vsh && SrsFlvVideo::keyframe(msg->payload, msg->size);
+    
+    // Copy the metadata and sequence headers, for ingester to switch to.
+    SrsCommonMessage** psh = NULL;
+    if (is_vsh) {
+        psh = &vsh;
+    } else if (is_ash) {
+        psh = &ash;
+    } else if (msg->header.is_amf0_data() || msg->header.is_amf3_data()) {
+        psh = &meta;
+    }
+    if (psh) {
+        srs_freep(*psh);
+        *psh = srs_edge_copy_message(msg);
+    }
+    
+    // For standby, only cache the messages from the last keyframe.
+    if (keyframe && !active_) {
+        reset();
+    }
+    
+    // Drop to the next keyframe, if the ingester is too slow.
+    if ((int)msgs.size() >= SRS_EDGE_FEEDER_MAX_MSGS) {
+        srs_warn("edge feeder drop %d msgs", (int)msgs.size());
+        reset();
+    }
+    
+    if (keyframe) {
+        has_keyframe = true;
+    }
+    
+    if (!has_keyframe) {
+        srs_freep(msg);
+        return;
+    }
+    
+    msgs.push_back(msg);
+}
+
+void SrsEdgeFeeder::reset()
+{
+    srs_edge_free_messages(msgs);
+    has_keyframe = false;
+}
+
 SrsEdgeIngester::SrsEdgeIngester()
 {
     source = NULL;
     edge = NULL;
     req = NULL;
+    pull_starttime = 0;
     
     upstream = new SrsEdgeRtmpUpstream("");
     lb = new SrsLbRoundRobin();
@@ -178,6 +579,11 @@ srs_error_t SrsEdgeIngester::initialize(SrsLiveSource* s, SrsPlayEdge* e, SrsReq
     edge = e;
     req = r;
     
+    if (_srs_config->get_vhost_edge_load_balance(req->vhost) == "fastest") {
+        srs_freep(lb);
+        lb = new SrsLbFastest();
+    }
+    
     return srs_success;
 }
 
@@ -189,6 +595,20 @@ srs_error_t SrsEdgeIngester::start()
         return srs_error_wrap(err, "notify source");
     }
     
+    // Start two feeders for hot-standby, which pull stream from different origins.
+    if (_srs_config->get_vhost_edge_hot_standby(req->vhost)) {
+        feeders.push_back(new SrsEdgeFeeder());
+        feeders.push_back(new SrsEdgeFeeder());
+        feeders[0]->initialize(req, lb, feeders[1]);
+        feeders[1]->initialize(req, lb, feeders[0]);
+        
+        for (int i = 0; i < (int)feeders.size(); i++) {
+            if ((err = feeders[i]->start()) != srs_success) {
+                return srs_error_wrap(err, "feeder");
+            }
+        }
+    }
+    
     srs_freep(trd);
     trd = new SrsSTCoroutine("edge-igs", this);
     
@@ -204,6 +624,13 @@ void SrsEdgeIngester::stop()
     trd->stop();
     upstream->close();
     
+    std::vector<SrsEdgeFeeder*>::iterator it;
+    for (it = feeders.begin(); it != feeders.end(); ++it) {
+        SrsEdgeFeeder* feeder = *it;
+        srs_freep(feeder);
+    }
+    feeders.clear();
+    
     // notice to unpublish.
     if (source) {
         source->on_unpublish();
@@ -215,9 +642,6 @@ string SrsEdgeIngester::get_curr_origin()
     return lb->selected();
 }
 
-// when error, edge ingester sleep for a while and retry.
-#define SRS_EDGE_INGESTER_CIMS (3 * SRS_UTIME_SECONDS)
-
 srs_error_t SrsEdgeIngester::cycle()
 {
     srs_error_t err = srs_success;
@@ -243,6 +667,13 @@ srs_error_t SrsEdgeIngester::cycle()
 srs_error_t SrsEdgeIngester::do_cycle()
 {
     srs_error_t err = srs_success;
+    
+    if (!feeders.empty()) {
+        if ((err = source->on_source_id_changed(_srs_context->get_id())) != srs_success) {
+            return srs_error_wrap(err, "on source id changed");
+        }
+        return ingest_hot_standby();
+    }
 
     std::string redirect;
     while (true) {
@@ -251,13 +682,24 @@ srs_error_t SrsEdgeIngester::do_cycle()
         }
         
         srs_freep(upstream);
-        upstream = new SrsEdgeRtmpUpstream(redirect);
+        
+        // Play from sibling process by shared memory if possible, the origin always use it,
+        // while the edge fallback to pull stream from origin.
+        bool is_edge = _srs_config->get_vhost_is_edge(req->vhost);
+        string dir = _srs_config->get_shm_fanout_dir(req->vhost);
+        if (_srs_config->get_shm_fanout_enabled(req->vhost) && (!is_edge || srs_shm_ring_alive(dir, req->get_stream_url()))) {
+            upstream = new SrsEdgeShmUpstream(dir);
+        } else {
+            upstream = new SrsEdgeRtmpUpstream(redirect);
+        }
         
         if ((err = source->on_source_id_changed(_srs_context->get_id())) != srs_success) {
             return srs_error_wrap(err, "on source id changed");
         }
         
+        pull_starttime = srs_update_system_time();
         if ((err = upstream->connect(req, lb)) != srs_success) {
+            srs_edge_sample_latency(lb, lb->selected(), SRS_EDGE_INGESTER_TIMEOUT);
             return srs_error_wrap(err, "connect upstream");
         }
         
@@ -325,7 +767,13 @@ srs_error_t SrsEdgeIngester::ingest(string& redirect)
         srs_assert(msg);
         SrsAutoFree(SrsCommonMessage, msg);
         
-        if ((err = process_publish_message(msg, redirect)) != srs_success) {
+        // Sample the latency of the first frame, for the fastest load balance.
+        if (pull_starttime && (msg->header.is_audio() || msg->header.is_video())) {
+            srs_edge_sample_latency(lb, lb->selected(), srs_update_system_time() - pull_starttime);
+            pull_starttime = 0;
+        }
+        
+        if ((err = process_publish_message(upstream, msg, redirect)) != srs_success) {
             return srs_error_wrap(err, "process message");
         }
     }
@@ -333,7 +781,153 @@ srs_error_t SrsEdgeIngester::ingest(string& redirect)
     return err;
 }
 
-srs_error_t SrsEdgeIngester::process_publish_message(SrsCommonMessage* msg, string& redirect)
+srs_error_t SrsEdgeIngester::ingest_hot_standby()
+{
+    srs_error_t err = srs_success;
+    
+    SrsPithyPrint* pprint = SrsPithyPrint::create_edge();
+    SrsAutoFree(SrsPithyPrint, pprint);
+    
+    SrsEdgeFeeder* active = NULL;
+    std::vector<SrsCommonMessage*> msgs;
+    
+    // The timestamp offset of active feeder, and the last timestamp of stream, in ms.
+    int64_t offset = 0;
+    int64_t last_ts = -1;
+    // Whether wait for the next keyframe of active feeder.
+    bool wait_keyframe = false;
+    srs_utime_t last_recv = srs_update_system_time();
+    
+    while (true) {
+        if ((err = trd->pull()) != srs_success) {
+            err = srs_error_wrap(err, "thread quit");
+            break;
+        }
+        
+        pprint->elapse();
+        if (pprint->can_print() && active) {
+            active->get_upstream()->kbps_sample(SRS_CONSTS_LOG_EDGE_PLAY, pprint->age());
+        }
+        
+        // Switch to the standby feeder, when the active one fails.
+        if (!active || !active->connected()) {
+            SrsEdgeFeeder* standby = select_standby(active);
+            if (!standby) {
+                if (srs_update_system_time() - last_recv > SRS_EDGE_INGESTER_TIMEOUT) {
+                    err = srs_error_new(ERROR_SOCKET_TIMEOUT, "no origin available");
+                    break;
+                }
+                srs_usleep(SRS_EDGE_FEEDER_CHECK);
+                continue;
+            }
+            
+            if (active) {
+                active->set_active(false);
+            }
+            standby->set_active(true);
+            
+            srs_edge_free_messages(msgs);
+            standby->dump_sh(msgs);
+            size_t nn_sh = msgs.size();
+            standby->pop(msgs, 0);
+            
+            // The standby starts from a keyframe, align the timestamp to the stream.
+            offset = 0;
+            wait_keyframe = false;
+            if (last_ts >= 0 && msgs.size() > nn_sh) {
+                int64_t kf_ts = msgs[nn_sh]->header.timestamp;
+                if (kf_ts - last_ts < SRS_EDGE_FEEDER_JITTER && last_ts - kf_ts < SRS_EDGE_FEEDER_JITTER) {
+                    wait_keyframe = true;
+                } else {
+                    offset = last_ts + SRS_EDGE_FEEDER_GAP - kf_ts;
+                }
+            }
+            
+            srs_trace("edge switch to origin %s, offset=%" PRId64 ", last=%" PRId64 ", wait=%d",
+                standby->origin().c_str(), offset, last_ts, wait_keyframe);
+            
+            active = standby;
+            if ((err = edge->on_ingest_play()) != srs_success) {
+                err = srs_error_wrap(err, "notify edge play");
+                break;
+            }
+        }
+        
+        if (msgs.empty()) {
+            active->pop(msgs, SRS_EDGE_FEEDER_CHECK);
+        }
+        if (!msgs.empty()) {
+            last_recv = srs_update_system_time();
+        }
+        
+        std::vector<SrsCommonMessage*>::iterator it;
+        for (it = msgs.begin(); it != msgs.end(); ++it) {
+            SrsCommonMessage* msg = *it;
+            SrsAutoFree(SrsCommonMessage, msg);
+            
+            // Drop the left messages when error.
+            if (err != srs_success) {
+                continue;
+            }
+            
+            bool av = msg->header.is_audio() || msg->header.is_video();
+            bool sh = (msg->header.is_video() && SrsFlvVideo::sh(msg->payload, msg->size))
+                || (msg->header.is_audio() && SrsFlvAudio::sh(msg->payload, msg->size));
+            
+            msg->header.timestamp += offset;
+            
+            // For the same timeline, switch on the next keyframe after the last timestamp.
+            if (wait_keyframe && av && !sh) {
+                if (!msg->header.is_video() || !SrsFlvVideo::keyframe(msg->payload, msg->size) || msg->header.timestamp <= last_ts) {
+                    continue;
+                }
+                wait_keyframe = false;
+            }
+            
+            if (av && !sh) {
+                last_ts = msg->header.timestamp;
+            }
+            
+            // For hot-standby, the RTMP 302 redirect is ignored, we only switch between the configured origins.
+            std::string redirect;
+            err = process_publish_message(active->get_upstream(), msg, redirect);
+            if (srs_error_code(err) == ERROR_CONTROL_REDIRECT) {
+                srs_warn("edge ignore redirect to %s for hot-standby", redirect.c_str());
+                srs_error_reset(err);
+            }
+        }
+        
+        msgs.clear();
+        
+        if (err != srs_success) {
+            err = srs_error_wrap(err, "process message");
+            break;
+        }
+    }
+    
+    srs_edge_free_messages(msgs);
+    
+    return err;
+}
+
+SrsEdgeFeeder* SrsEdgeIngester::select_standby(SrsEdgeFeeder* active)
+{
+    if (active && active->connected()) {
+        return NULL;
+    }
+    
+    std::vector<SrsEdgeFeeder*>::iterator it;
+    for (it = feeders.begin(); it != feeders.end(); ++it) {
+        SrsEdgeFeeder* feeder = *it;
+        if (feeder != active && feeder->ready()) {
+            return feeder;
+        }
+    }
+    
+    return NULL;
+}
+
+srs_error_t SrsEdgeIngester::process_publish_message(SrsEdgeUpstream* up, SrsCommonMessage* msg, string& redirect)
 {
     srs_error_t err = srs_success;
     
@@ -362,7 +956,7 @@ srs_error_t SrsEdgeIngester::process_publish_message(SrsCommonMessage* msg, stri
     // process onMetaData
     if (msg->header.is_amf0_data() || msg->header.is_amf3_data()) {
         SrsPacket* pkt = NULL;
-        if ((err = upstream->decode_message(msg, &pkt)) != srs_success) {
+        if ((err = up->decode_message(msg, &pkt)) != srs_success) {
             return srs_error_wrap(err, "decode message");
         }
         SrsAutoFree(SrsPacket, pkt);
@@ -381,7 +975,7 @@ srs_error_t SrsEdgeIngester::process_publish_message(SrsCommonMessage* msg, stri
     // call messages, for example, reject, redirect.
     if (msg->header.is_amf0_command() || msg->header.is_amf3_command()) {
         SrsPacket* pkt = NULL;
-        if ((err = upstream->decode_message(msg, &pkt)) != srs_success) {
+        if ((err = up->decode_message(msg, &pkt)) != srs_success) {
             return srs_error_wrap(err, "decode message");
         }
         SrsAutoFree(SrsPacket, pkt);
@@ -10,8 +10,10 @@
 #include <srs_core.hpp>
 
 #include <srs_app_st.hpp>
+#include <srs_service_st.hpp>
 
 #include <string>
+#include <vector>
 
 class SrsStSocket;
 class SrsRtmpServer;
@@ -28,6 +30,8 @@ class SrsLbRoundRobin;
 class SrsTcpClient;
 class SrsSimpleRtmpClient;
 class SrsPacket;
+class SrsShmRing;
+class SrsEdgeFeeder;
 
 // The state of edge, auto machine
 enum SrsEdgeState
@@ -81,10 +85,42 @@ private:
     // Current selected server, the ip:port.
     std::string selected_ip;
     int selected_port;
+    // Current selected origin in config, and the origin to exclude.
+    std::string selected_origin;
+    std::string exclude;
 public:
     // @param rediect, override the server. ignore if empty.
     SrsEdgeRtmpUpstream(std::string r);
     virtual ~SrsEdgeRtmpUpstream();
+public:
+    // Never select the origin, for example, which is used by the hot-standby peer.
+    virtual void set_exclude(std::string origin);
+    // Get the selected origin in config.
+    virtual std::string origin();
+public:
+    virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb);
+    virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
+    virtual srs_error_t decode_message(SrsCommonMessage* msg, SrsPacket** ppacket);
+    virtual void close();
+public:
+    virtual void selected(std::string& server, int& port);
+    virtual void set_recv_timeout(srs_utime_t tm);
+    virtual void kbps_sample(const char* label, int64_t age);
+};
+
+// The upstream of shared memory, to play stream from sibling process on the same host.
+class SrsEdgeShmUpstream : public SrsEdgeUpstream
+{
+private:
+    // The directory of ring files.
+    std::string dir;
+    SrsShmRing* ring;
+    srs_utime_t timeout;
+    // The sequence headers to deliver before messages in ring.
+    std::vector<SrsCommonMessage*> pending;
+public:
+    SrsEdgeShmUpstream(std::string d);
+    virtual ~SrsEdgeShmUpstream();
 public:
     virtual srs_error_t connect(SrsRequest* r, SrsLbRoundRobin* lb);
     virtual srs_error_t recv_message(SrsCommonMessage** pmsg);
@@ -96,6 +132,60 @@ public:
     virtual void kbps_sample(const char* label, int64_t age);
 };
 
+// The feeder of hot-standby edge, pulls stream from an origin in its own coroutine, and caches the
+// messages from the last keyframe, so the ingester is able to switch to it instantly when the
+// current origin fails, without connecting to another origin and waiting for the keyframe.
+class SrsEdgeFeeder : public ISrsCoroutineHandler
+{
+private:
+    SrsRequest* req;
+    SrsLbRoundRobin* lb;
+    // The peer feeder, never pull from the same origin as peer.
+    SrsEdgeFeeder* peer;
+    SrsCoroutine* trd;
+    SrsEdgeRtmpUpstream* upstream;
+    srs_cond_t cond;
+    // Whether pulling stream from origin.
+    bool connected_;
+    // Whether the ingester consumes the feeder, or it's standby.
+    bool active_;
+    // Whether got keyframe, standby feeder caches messages from keyframe.
+    bool has_keyframe;
+    std::vector<SrsCommonMessage*> msgs;
+    // The copy of metadata and sequence headers, for ingester to switch to.
+    SrsCommonMessage* meta;
+    SrsCommonMessage* vsh;
+    SrsCommonMessage* ash;
+public:
+    SrsEdgeFeeder();
+    virtual ~SrsEdgeFeeder();
+public:
+    // @param l The load balance shared by feeders.
+    // @param p The peer feeder.
+    virtual void initialize(SrsRequest* r, SrsLbRoundRobin* l, SrsEdgeFeeder* p);
+    virtual srs_error_t start();
+    virtual void stop();
+public:
+    virtual bool connected();
+    // Whether connected and cached a keyframe, so ingester is able to switch to it.
+    virtual bool ready();
+    virtual void set_active(bool v);
+    // The origin in config, empty if not connected.
+    virtual std::string origin();
+    virtual SrsEdgeUpstream* get_upstream();
+    // Dump the metadata and sequence headers.
+    virtual void dump_sh(std::vector<SrsCommonMessage*>& out);
+    // Take the cached messages, wait for timeout if empty.
+    virtual void pop(std::vector<SrsCommonMessage*>& out, srs_utime_t timeout);
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+    virtual void on_message(SrsCommonMessage* msg);
+    virtual void reset();
+};
+
 // The edge used to ingest stream from origin.
 class SrsEdgeIngester : public ISrsCoroutineHandler
 {
@@ -106,6 +196,10 @@ private:
     SrsCoroutine* trd;
     SrsLbRoundRobin* lb;
     SrsEdgeUpstream* upstream;
+    // The feeders for hot-standby, empty if disabled.
+    std::vector<SrsEdgeFeeder*> feeders;
+    // The time to start pulling stream, to sample the latency of origin.
+    srs_utime_t pull_starttime;
 public:
     SrsEdgeIngester();
     virtual ~SrsEdgeIngester();
@@ -121,7 +215,10 @@ private:
     virtual srs_error_t do_cycle();
 private:
     virtual srs_error_t ingest(std::string& redirect);
-    virtual srs_error_t process_publish_message(SrsCommonMessage* msg, std::string& redirect);
+    virtual srs_error_t ingest_hot_standby();
+    // Select the ready standby feeder, NULL if the active is still connected or no standby.
+    virtual SrsEdgeFeeder* select_standby(SrsEdgeFeeder* active);
+    virtual srs_error_t process_publish_message(SrsEdgeUpstream* up, SrsCommonMessage* msg, std::string& redirect);
 };
 
 // The edge used to forward stream to origin.
@@ -13,6 +13,7 @@
 #include <string.h>
 #include <math.h>
 #include <unistd.h>
+#include <limits.h>
 #include <algorithm>
 #include <sstream>
 using namespace std;
@@ -45,6 +46,17 @@ using namespace std;
 // reset the piece id when deviation overflow this.
 #define SRS_JUMP_WHEN_PIECE_DEVIATION 20
 
+SrsHlsPart::SrsHlsPart()
+{
+    index = 0;
+    duration = 0;
+    independent = false;
+}
+
+SrsHlsPart::~SrsHlsPart()
+{
+}
+
 SrsHlsSegment::SrsHlsSegment(SrsTsContext* c, SrsAudioCodecId ac, SrsVideoCodecId vc, SrsFileWriter* w)
 {
     sequence_no = 0;
@@ -55,6 +67,12 @@ SrsHlsSegment::SrsHlsSegment(SrsTsContext* c, SrsAudioCodecId ac, SrsVideoCodecI
 SrsHlsSegment::~SrsHlsSegment()
 {
     srs_freep(tscw);
+
+    for (int i = 0; i < (int)parts.size(); i++) {
+        SrsHlsPart* part = parts.at(i);
+        srs_freep(part);
+    }
+    parts.clear();
 }
 
 void SrsHlsSegment::config_cipher(unsigned char* key,unsigned char* iv)
@@ -65,6 +83,250 @@ void SrsHlsSegment::config_cipher(unsigned char* key,unsigned char* iv)
     fw->config_cipher(key, iv);
 }
 
+string SrsHlsSegment::part_of(string v, int index)
+{
+    std::stringstream ss;
+    ss << ".part" << index;
+
+    if (srs_string_ends_with(v, ".ts")) {
+        return v.substr(0, v.length() - 3) + ss.str() + ".ts";
+    }
+    return v + ss.str();
+}
+
+bool SrsHlsSegment::is_part(string v)
+{
+    if (srs_string_ends_with(v, ".ts")) {
+        v = v.substr(0, v.length() - 3);
+    }
+
+    size_t pos = v.rfind(".part");
+    if (pos == string::npos || pos + 5 == v.length()) {
+        return false;
+    }
+
+    return v.find_first_not_of("0123456789", pos + 5) == string::npos;
+}
+
+srs_error_t SrsHlsSegment::unlink_file()
+{
+    for (int i = 0; i < (int)parts.size(); i++) {
+        SrsHlsPart* part = parts.at(i);
+        if (::unlink(part->fullpath.c_str()) < 0) {
+            srs_warn("ignore unlink part %s failed", part->fullpath.c_str());
+        }
+    }
+
+    return SrsFragment::unlink_file();
+}
+
+SrsHlsPartWriter::SrsHlsPartWriter()
+{
+    part = new SrsFileWriter();
+}
+
+SrsHlsPartWriter::~SrsHlsPartWriter()
+{
+    srs_freep(part);
+}
+
+srs_error_t SrsHlsPartWriter::open_part(string p)
+{
+    srs_error_t err = srs_success;
+
+    part->close();
+
+    if ((err = part->open(p)) != srs_success) {
+        return srs_error_wrap(err, "open part %s", p.c_str());
+    }
+
+    return err;
+}
+
+void SrsHlsPartWriter::close_part()
+{
+    part->close();
+}
+
+srs_error_t SrsHlsPartWriter::write(void* buf, size_t count, ssize_t* pnwrite)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = SrsFileWriter::write(buf, count, pnwrite)) != srs_success) {
+        return srs_error_wrap(err, "write segment");
+    }
+
+    if (part->is_open() && (err = part->write(buf, count, NULL)) != srs_success) {
+        return srs_error_wrap(err, "write part");
+    }
+
+    return err;
+}
+
+SrsHlsPartState::SrsHlsPartState()
+{
+    msn = 0;
+    part = -1;
+    target = 0;
+    alive = true;
+    nn_waiters = 0;
+    cond = srs_cond_new();
+}
+
+SrsHlsPartState::~SrsHlsPartState()
+{
+    srs_cond_destroy(cond);
+}
+
+SrsHlsPartNotifier* _srs_hls_parts = NULL;
+
+SrsHlsPartNotifier::SrsHlsPartNotifier()
+{
+}
+
+SrsHlsPartNotifier::~SrsHlsPartNotifier()
+{
+    std::map<std::string, SrsHlsPartState*>::iterator it;
+    for (it = states.begin(); it != states.end(); ++it) {
+        SrsHlsPartState* state = it->second;
+        srs_freep(state);
+    }
+    states.clear();
+}
+
+void SrsHlsPartNotifier::update(string m3u8, int msn, int part, string hint, srs_utime_t target)
+{
+    SrsHlsPartState* state = NULL;
+
+    std::map<std::string, SrsHlsPartState*>::iterator it = states.find(m3u8);
+    if (it != states.end()) {
+        state = it->second;
+    } else {
+        state = new SrsHlsPartState();
+        states[m3u8] = state;
+    }
+
+    state->msn = msn;
+    state->part = part;
+    state->hint = hint;
+    state->target = target;
+
+    srs_cond_broadcast(state->cond);
+}
+
+void SrsHlsPartNotifier::unpublish(string m3u8)
+{
+    std::map<std::string, SrsHlsPartState*>::iterator it = states.find(m3u8);
+    if (it == states.end()) {
+        return;
+    }
+
+    SrsHlsPartState* state = it->second;
+    states.erase(it);
+
+    // Wakeup the waiting requests, the last one frees the state.
+    state->alive = false;
+    srs_cond_broadcast(state->cond);
+    release(state);
+}
+
+void SrsHlsPartNotifier::wait_part(string m3u8, int msn, int part, int* pcode)
+{
+    *pcode = SRS_CONSTS_HTTP_OK;
+
+    // Not a LL-HLS playlist, or not publishing, serve the file directly.
+    std::map<std::string, SrsHlsPartState*>::iterator it = states.find(m3u8);
+    if (it == states.end()) {
+        return;
+    }
+
+    SrsHlsPartState* state = it->second;
+
+    // The request is too far in the future, see 6.2.5.2 of rfc8216bis.
+    if (msn > state->msn + 2) {
+        *pcode = SRS_CONSTS_HTTP_BadRequest;
+        return;
+    }
+
+    srs_utime_t deadline = srs_update_system_time() + 3 * state->target;
+
+    state->nn_waiters++;
+    while (state->alive) {
+        // Whole segment msn is ready when writing the next segment, or the part msn.part is ready.
+        if (state->msn > msn || (part >= 0 && state->msn == msn && state->part >= part)) {
+            break;
+        }
+
+        srs_utime_t now = srs_update_system_time();
+        if (now >= deadline) {
+            *pcode = SRS_CONSTS_HTTP_ServiceUnavailable;
+            break;
+        }
+
+        wait(state, deadline - now);
+    }
+    state->nn_waiters--;
+
+    release(state);
+}
+
+void SrsHlsPartNotifier::wait_hint(string fullpath)
+{
+    SrsHlsPartState* state = NULL;
+
+    std::map<std::string, SrsHlsPartState*>::iterator it;
+    for (it = states.begin(); it != states.end(); ++it) {
+        if (it->second->hint == fullpath) {
+            state = it->second;
+            break;
+        }
+    }
+
+    if (!state) {
+        return;
+    }
+
+    srs_utime_t deadline = srs_update_system_time() + 3 * state->target;
+
+    // Wait util the hinted part is ready, the muxer renames the part and hints the next part.
+    state->nn_waiters++;
+    while (state->alive && state->hint == fullpath && !srs_path_exists(fullpath)) {
+        srs_utime_t now = srs_update_system_time();
+        if (now >= deadline) {
+            break;
+        }
+
+        wait(state, deadline - now);
+    }
+    state->nn_waiters--;
+
+    release(state);
+}
+
+string SrsHlsPartNotifier::realpath(string path)
+{
+    char buf[PATH_MAX];
+
+    string dir = srs_path_dirname(path);
+    if (!::realpath(dir.c_str(), buf)) {
+        return path;
+    }
+
+    return string(buf) + "/" + srs_path_basename(path);
+}
+
+void SrsHlsPartNotifier::wait(SrsHlsPartState* state, srs_utime_t timeout)
+{
+    srs_cond_timedwait(state->cond, timeout);
+}
+
+void SrsHlsPartNotifier::release(SrsHlsPartState* state)
+{
+    if (!state->alive && state->nn_waiters == 0) {
+        srs_freep(state);
+    }
+}
+
 SrsDvrAsyncCallOnHls::SrsDvrAsyncCallOnHls(SrsContextId c, SrsRequest* r, string p, string t, string m, string mu, int s, srs_utime_t d)
 {
     req = r->copy();
@@ -174,6 +436,7 @@ string SrsDvrAsyncCallOnHlsNotify::to_string()
 SrsHlsMuxer::SrsHlsMuxer()
 {
     req = NULL;
+    latest_vcodec = SrsVideoCodecIdForbidden;
     hls_fragment = hls_window = 0;
     hls_aof_ratio = 1.0;
     deviation_ts = 0;
@@ -188,6 +451,12 @@ SrsHlsMuxer::SrsHlsMuxer()
     current = NULL;
     hls_keys = false;
     hls_fragments_per_key = 0;
+    hls_ll = false;
+    hls_part_duration = 0;
+    part_writer = NULL;
+    part = NULL;
+    part_dts = 0;
+    last_dts = -1;
     async = new SrsAsyncCallWorker();
     context = new SrsTsContext();
     segments = new SrsFragmentWindow();
@@ -199,6 +468,7 @@ SrsHlsMuxer::SrsHlsMuxer()
 SrsHlsMuxer::~SrsHlsMuxer()
 {
     srs_freep(segments);
+    srs_freep(part);
     srs_freep(current);
     srs_freep(req);
     srs_freep(async);
@@ -211,8 +481,21 @@ void SrsHlsMuxer::dispose()
     srs_error_t err = srs_success;
     
     segments->dispose();
+
+    if (part) {
+        part_writer->close_part();
+        string tmp_file = part->fullpath + ".tmp";
+        if (::unlink(tmp_file.c_str()) < 0) {
+            srs_warn("dispose unlink part failed. file=%s", tmp_file.c_str());
+        }
+        srs_freep(part);
+    }
     
     if (current) {
+        for (int i = 0; i < (int)current->parts.size(); i++) {
+            ::unlink(current->parts.at(i)->fullpath.c_str());
+        }
+
         if ((err = current->unlink_tmpfile()) != srs_success) {
             srs_warn("Unlink tmp ts failed %s", srs_error_desc(err).c_str());
             srs_freep(err);
@@ -271,13 +554,20 @@ srs_error_t SrsHlsMuxer::on_publish(SrsRequest* req)
 srs_error_t SrsHlsMuxer::on_unpublish()
 {
     async->stop();
+
+    // Wakeup the blocking requests of LL-HLS.
+    if (hls_ll) {
+        _srs_hls_parts->unpublish(m3u8_key);
+    }
+
     return srs_success;
 }
 
 srs_error_t SrsHlsMuxer::update_config(SrsRequest* r, string entry_prefix,
     string path, string m3u8_file, string ts_file, srs_utime_t fragment, srs_utime_t window,
     bool ts_floor, double aof_ratio, bool cleanup, bool wait_keyframe, bool keys,
-    int fragments_per_key, string key_file ,string key_file_path, string key_url)
+    int fragments_per_key, string key_file ,string key_file_path, string key_url,
+    bool ll, srs_utime_t part_duration)
 {
     srs_error_t err = srs_success;
     
@@ -302,6 +592,9 @@ srs_error_t SrsHlsMuxer::update_config(SrsRequest* r, string entry_prefix,
     hls_key_file = key_file;
     hls_key_file_path = key_file_path;
     hls_key_url = key_url;
+
+    hls_ll = ll;
+    hls_part_duration = part_duration;
    
     // generate the m3u8 dir and path.
     m3u8_url = srs_path_build_stream(m3u8_file, req->vhost, req->app, req->stream);
@@ -316,6 +609,9 @@ srs_error_t SrsHlsMuxer::update_config(SrsRequest* r, string entry_prefix,
         return srs_error_wrap(err, "create dir");
     }
 
+    // The key of LL-HLS state, which is also used by HTTP server to find the playlist.
+    m3u8_key = SrsHlsPartNotifier::realpath(m3u8);
+
     if (hls_keys && (hls_path != hls_key_file_path)) {
         string key_file = srs_path_build_stream(hls_key_file, req->vhost, req->app, req->stream);
         string key_url = hls_key_file_path + "/" + key_file;
@@ -327,6 +623,9 @@ srs_error_t SrsHlsMuxer::update_config(SrsRequest* r, string entry_prefix,
 
     if(hls_keys) {
         writer = new SrsEncFileWriter();
+    } else if (hls_ll) {
+        part_writer = new SrsHlsPartWriter();
+        writer = part_writer;
     } else {
         writer = new SrsFileWriter();
     }
@@ -367,6 +666,8 @@ srs_error_t SrsHlsMuxer::segment_open()
         std::string default_vcodec_str = _srs_config->get_hls_vcodec(req->vhost);
         if (default_vcodec_str == "h264") {
             default_vcodec = SrsVideoCodecIdAVC;
+        } else if (default_vcodec_str == "h265") {
+            default_vcodec = SrsVideoCodecIdHEVC;
         } else if (default_vcodec_str == "vn") {
             default_vcodec = SrsVideoCodecIdDisabled;
         } else {
@@ -374,6 +675,11 @@ srs_error_t SrsHlsMuxer::segment_open()
         }
     }
     
+    // Use the codec of stream, for example, the h.265 stream, unless video is disabled.
+    if (latest_vcodec != SrsVideoCodecIdForbidden && default_vcodec != SrsVideoCodecIdDisabled) {
+        default_vcodec = latest_vcodec;
+    }
+    
     // new segment.
     current = new SrsHlsSegment(context, default_acodec, default_vcodec, writer);
     current->sequence_no = _sequence_no++;
@@ -461,6 +767,15 @@ srs_error_t SrsHlsMuxer::segment_open()
 
     // reset the context for a new ts start.
     context->reset();
+
+    // For LL-HLS, refresh the m3u8 to hint the first part of new segment.
+    last_dts = -1;
+    if (hls_ll) {
+        if ((err = refresh_m3u8()) != srs_success) {
+            return srs_error_wrap(err, "hls: refresh m3u8");
+        }
+        notify_parts();
+    }
     
     return err;
 }
@@ -512,6 +827,32 @@ bool SrsHlsMuxer::is_segment_absolutely_overflow()
     return current->duration() >= hls_aof_ratio * hls_fragment + deviation;
 }
 
+bool SrsHlsMuxer::is_part_overflow(int64_t dts)
+{
+    if (!hls_ll || !part) {
+        return false;
+    }
+
+    return dts - part_dts > srsu2ms(hls_part_duration);
+}
+
+srs_error_t SrsHlsMuxer::part_close()
+{
+    srs_error_t err = srs_success;
+
+    if ((err = do_part_close()) != srs_success) {
+        return srs_error_wrap(err, "part close");
+    }
+
+    if ((err = refresh_m3u8()) != srs_success) {
+        return srs_error_wrap(err, "hls: refresh m3u8");
+    }
+
+    notify_parts();
+
+    return err;
+}
+
 bool SrsHlsMuxer::pure_audio()
 {
     return current && current->tscw && current->tscw->video_codec() == SrsVideoCodecIdDisabled;
@@ -531,8 +872,13 @@ srs_error_t SrsHlsMuxer::flush_audio(SrsTsMessageCache* cache)
         return err;
     }
     
+    if ((err = part_open(cache->audio->pts / 90, false)) != srs_success) {
+        return srs_error_wrap(err, "hls: open part");
+    }
+
     // update the duration of segment.
     current->append(cache->audio->pts / 90);
+    last_dts = cache->audio->pts / 90;
     
     if ((err = current->tscw->write_audio(cache->audio)) != srs_success) {
         return srs_error_wrap(err, "hls: write audio");
@@ -559,9 +905,14 @@ srs_error_t SrsHlsMuxer::flush_video(SrsTsMessageCache* cache)
     }
     
     srs_assert(current);
+
+    if ((err = part_open(cache->video->dts / 90, cache->video->write_pcr)) != srs_success) {
+        return srs_error_wrap(err, "hls: open part");
+    }
     
     // update the duration of segment.
     current->append(cache->video->dts / 90);
+    last_dts = cache->video->dts / 90;
     
     if ((err = current->tscw->write_video(cache->video)) != srs_success) {
         return srs_error_wrap(err, "hls: write video");
@@ -573,6 +924,16 @@ srs_error_t SrsHlsMuxer::flush_video(SrsTsMessageCache* cache)
     return err;
 }
 
+void SrsHlsMuxer::set_latest_vcodec(SrsVideoCodecId v)
+{
+    latest_vcodec = v;
+    
+    // The PMT is rewritten by TS context when codec changed.
+    if (current && current->tscw && current->tscw->video_codec() != SrsVideoCodecIdDisabled) {
+        current->tscw->set_video_codec(v);
+    }
+}
+
 srs_error_t SrsHlsMuxer::segment_close()
 {
     srs_error_t err = do_segment_close();
@@ -595,6 +956,11 @@ srs_error_t SrsHlsMuxer::do_segment_close()
     // when close current segment, the current segment must not be NULL.
     srs_assert(current);
 
+    // Finish the last part of segment, for LL-HLS.
+    if ((err = do_part_close()) != srs_success) {
+        return srs_error_wrap(err, "part close");
+    }
+
     // We should always close the underlayer writer.
     if (current && current->writer) {
         current->writer->close();
@@ -635,6 +1001,11 @@ srs_error_t SrsHlsMuxer::do_segment_close()
         srs_trace("Drop ts segment, sequence_no=%d, uri=%s, duration=%dms",
             current->sequence_no, current->uri.c_str(), srsu2msi(current->duration()));
         
+        // remove the parts of dropped segment.
+        for (int i = 0; i < (int)current->parts.size(); i++) {
+            ::unlink(current->parts.at(i)->fullpath.c_str());
+        }
+
         // rename from tmp to real path
         if ((err = current->unlink_tmpfile()) != srs_success) {
             return srs_error_wrap(err, "rename");
@@ -658,6 +1029,71 @@ srs_error_t SrsHlsMuxer::do_segment_close()
     return err;
 }
 
+srs_error_t SrsHlsMuxer::part_open(int64_t dts, bool keyframe)
+{
+    srs_error_t err = srs_success;
+
+    if (!hls_ll || part) {
+        return err;
+    }
+
+    part = new SrsHlsPart();
+    part->index = (int)current->parts.size();
+    part->independent = keyframe || pure_audio();
+    part->uri = SrsHlsSegment::part_of(current->uri, part->index);
+    part->fullpath = SrsHlsSegment::part_of(current->fullpath(), part->index);
+
+    // The part starts from the last frame of previous part, so the sum of parts is the segment.
+    part_dts = (last_dts >= 0)? last_dts : dts;
+
+    if ((err = part_writer->open_part(part->fullpath + ".tmp")) != srs_success) {
+        srs_freep(part);
+        return srs_error_wrap(err, "open part");
+    }
+
+    // Each part starts with PAT/PMT, because client may start to play from any part.
+    context->reset();
+
+    return err;
+}
+
+srs_error_t SrsHlsMuxer::do_part_close()
+{
+    srs_error_t err = srs_success;
+
+    if (!part) {
+        return err;
+    }
+
+    part_writer->close_part();
+    part->duration = srs_max(0, last_dts - part_dts) * SRS_UTIME_MILLISECONDS;
+
+    // Rename from tmp to real path, then the part is ready for client.
+    string tmp_file = part->fullpath + ".tmp";
+    if (::rename(tmp_file.c_str(), part->fullpath.c_str()) < 0) {
+        ::unlink(tmp_file.c_str());
+        err = srs_error_new(ERROR_HLS_WRITE_FAILED, "rename %s to %s", tmp_file.c_str(), part->fullpath.c_str());
+        srs_freep(part);
+        return err;
+    }
+
+    current->parts.push_back(part);
+    part = NULL;
+
+    return err;
+}
+
+void SrsHlsMuxer::notify_parts()
+{
+    if (!hls_ll || !current) {
+        return;
+    }
+
+    int index = (int)current->parts.size();
+    string hint = SrsHlsPartNotifier::realpath(SrsHlsSegment::part_of(current->fullpath(), index));
+    _srs_hls_parts->update(m3u8_key, current->sequence_no, index - 1, hint, max_td);
+}
+
 srs_error_t SrsHlsMuxer::write_hls_key()
 {
     srs_error_t err = srs_success;
@@ -699,7 +1135,7 @@ srs_error_t SrsHlsMuxer::refresh_m3u8()
     srs_error_t err = srs_success;
     
     // no segments, also no m3u8, return.
-    if (segments->empty()) {
+    if (segments->empty() && (!hls_ll || !current || current->parts.empty())) {
         return err;
     }
     
@@ -725,7 +1161,7 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
     srs_error_t err = srs_success;
     
     // no segments, return.
-    if (segments->empty()) {
+    if (segments->empty() && (!hls_ll || !current || current->parts.empty())) {
         return err;
     }
     
@@ -738,10 +1174,12 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
     // #EXT-X-VERSION:3\n
     std::stringstream ss;
     ss << "#EXTM3U" << SRS_CONSTS_LF;
-    ss << "#EXT-X-VERSION:3" << SRS_CONSTS_LF;
+    // The EXT-X-PART requires version 6, for LL-HLS.
+    ss << "#EXT-X-VERSION:" << (hls_ll? 6 : 3) << SRS_CONSTS_LF;
     
     // #EXT-X-MEDIA-SEQUENCE:4294967295\n
-    SrsHlsSegment* first = dynamic_cast<SrsHlsSegment*>(segments->first());
+    // For LL-HLS, there might be only parts of current segment.
+    SrsHlsSegment* first = segments->empty()? current : dynamic_cast<SrsHlsSegment*>(segments->first());
     if (first == NULL) {
         return srs_error_new(ERROR_HLS_WRITE_FAILED, "segments cast");
     }
@@ -762,6 +1200,28 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
     int target_duration = (int)ceil(srsu2msi(srs_max(max_duration, max_td)) / 1000.0);
     
     ss << "#EXT-X-TARGETDURATION:" << target_duration << SRS_CONSTS_LF;
+
+    // For LL-HLS, the client should hold back at least 3 parts from the end of playlist.
+    ss.precision(3);
+    ss.setf(std::ios::fixed, std::ios::floatfield);
+    if (hls_ll) {
+        double part_target = srsu2msi(hls_part_duration) / 1000.0;
+        ss << "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=" << 3 * part_target << SRS_CONSTS_LF;
+        ss << "#EXT-X-PART-INF:PART-TARGET=" << part_target << SRS_CONSTS_LF;
+    }
+
+    // The parts are only listed for the segments in the last 3 target durations.
+    int parts_from = segments->size();
+    if (hls_ll) {
+        srs_utime_t tail = 0;
+        for (int i = segments->size() - 1; i >= 0; i--) {
+            tail += segments->at(i)->duration();
+            if (tail > 3 * target_duration * SRS_UTIME_SECONDS) {
+                break;
+            }
+            parts_from = i;
+        }
+    }
     
     // write all segments
     for (int i = 0; i < segments->size(); i++) {
@@ -771,6 +1231,10 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
             // #EXT-X-DISCONTINUITY\n
             ss << "#EXT-X-DISCONTINUITY" << SRS_CONSTS_LF;
         }
+
+        if (i >= parts_from) {
+            write_parts(ss, segment);
+        }
         
         if(hls_keys && ((segment->sequence_no % hls_fragments_per_key) == 0)) {
             char hexiv[33];
@@ -804,6 +1268,18 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
         //ss << segment->uri << SRS_CONSTS_LF;
         ss << seg_uri << SRS_CONSTS_LF;
     }
+
+    // For LL-HLS, write the parts of current segment, and hint the next part.
+    if (hls_ll && current) {
+        if (!current->parts.empty() && current->is_sequence_header()) {
+            ss << "#EXT-X-DISCONTINUITY" << SRS_CONSTS_LF;
+        }
+
+        write_parts(ss, current);
+
+        string hint = SrsHlsSegment::part_of(current->uri, (int)current->parts.size());
+        ss << "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" << hint << "\"" << SRS_CONSTS_LF;
+    }
     
     // write m3u8 to writer.
     std::string m3u8 = ss.str();
@@ -814,6 +1290,20 @@ srs_error_t SrsHlsMuxer::_refresh_m3u8(string m3u8_file)
     return err;
 }
 
+void SrsHlsMuxer::write_parts(std::stringstream& ss, SrsHlsSegment* segment)
+{
+    for (int i = 0; i < (int)segment->parts.size(); i++) {
+        SrsHlsPart* part = segment->parts.at(i);
+
+        // #EXT-X-PART:DURATION=0.500,URI="livestream-5.part0.ts",INDEPENDENT=YES\n
+        ss << "#EXT-X-PART:DURATION=" << srsu2msi(part->duration) / 1000.0 << ",URI=\"" << part->uri << "\"";
+        if (part->independent) {
+            ss << ",INDEPENDENT=YES";
+        }
+        ss << SRS_CONSTS_LF;
+    }
+}
+
 SrsHlsController::SrsHlsController()
 {
     tsmc = new SrsTsMessageCache();
@@ -891,6 +1381,14 @@ srs_error_t SrsHlsController::on_publish(SrsRequest* req)
     string hls_key_file =  _srs_config->get_hls_key_file(vhost);
     string hls_key_file_path = _srs_config->get_hls_key_file_path(vhost);
     string hls_key_url = _srs_config->get_hls_key_url(vhost);
+
+    // For LL-HLS, the part is a piece of segment, which is not supported by encryption.
+    bool hls_ll = _srs_config->get_hls_ll(vhost);
+    srs_utime_t hls_part_duration = _srs_config->get_hls_part_duration(vhost);
+    if (hls_ll && hls_keys) {
+        srs_warn("hls: disable LL-HLS for hls_keys");
+        hls_ll = false;
+    }
     
     // TODO: FIXME: support load exists m3u8, to continue publish stream.
     // for the HLS donot requires the EXT-X-MEDIA-SEQUENCE be monotonically increase.
@@ -901,7 +1399,7 @@ srs_error_t SrsHlsController::on_publish(SrsRequest* req)
     
     if ((err = muxer->update_config(req, entry_prefix, path, m3u8_file, ts_file, hls_fragment,
         hls_window, ts_floor, hls_aof_ratio, cleanup, wait_keyframe,hls_keys,hls_fragments_per_key,
-        hls_key_file, hls_key_file_path, hls_key_url)) != srs_success ) {
+        hls_key_file, hls_key_file_path, hls_key_url, hls_ll, hls_part_duration)) != srs_success ) {
         return srs_error_wrap(err, "hls: update config");
     }
     
@@ -912,9 +1410,9 @@ srs_error_t SrsHlsController::on_publish(SrsRequest* req)
     // This config item is used in SrsHls, we just log its value here.
     bool hls_dts_directly = _srs_config->get_vhost_hls_dts_directly(req->vhost);
 
-    srs_trace("hls: win=%dms, frag=%dms, prefix=%s, path=%s, m3u8=%s, ts=%s, aof=%.2f, floor=%d, clean=%d, waitk=%d, dispose=%dms, dts_directly=%d",
+    srs_trace("hls: win=%dms, frag=%dms, prefix=%s, path=%s, m3u8=%s, ts=%s, aof=%.2f, floor=%d, clean=%d, waitk=%d, dispose=%dms, dts_directly=%d, ll=%d, part=%dms",
         srsu2msi(hls_window), srsu2msi(hls_fragment), entry_prefix.c_str(), path.c_str(), m3u8_file.c_str(), ts_file.c_str(),
-        hls_aof_ratio, ts_floor, cleanup, wait_keyframe, srsu2msi(hls_dispose), hls_dts_directly);
+        hls_aof_ratio, ts_floor, cleanup, wait_keyframe, srsu2msi(hls_dispose), hls_dts_directly, hls_ll, srsu2msi(hls_part_duration));
     
     return err;
 }
@@ -980,6 +1478,13 @@ srs_error_t SrsHlsController::write_audio(SrsAudioFrame* frame, int64_t pts)
         }
     }
     
+    // For LL-HLS, close the part when the audio makes it overflow.
+    if (tsmc->audio && muxer->is_part_overflow(tsmc->audio->pts / 90)) {
+        if ((err = muxer->part_close()) != srs_success) {
+            return srs_error_wrap(err, "hls: part close");
+        }
+    }
+    
     // directly write the audio frame by frame to ts,
     // it's ok for the hls overload, or maybe cause the audio corrupt,
     // which introduced by aggregate the audios to a big one.
@@ -995,6 +1500,12 @@ srs_error_t SrsHlsController::write_video(SrsVideoFrame* frame, int64_t dts)
 {
     srs_error_t err = srs_success;
     
+    // Follow the codec of stream, h.264 or h.265.
+    SrsVideoCodecConfig* c = frame->vcodec();
+    if (c) {
+        muxer->set_latest_vcodec(c->id);
+    }
+    
     // write video to cache.
     if ((err = tsmc->cache_video(frame, dts)) != srs_success) {
         return srs_error_wrap(err, "hls: cache video");
@@ -1013,6 +1524,13 @@ srs_error_t SrsHlsController::write_video(SrsVideoFrame* frame, int64_t dts)
         }
     }
     
+    // For LL-HLS, close the part when the video makes it overflow.
+    if (tsmc->video && muxer->is_part_overflow(tsmc->video->dts / 90)) {
+        if ((err = muxer->part_close()) != srs_success) {
+            return srs_error_wrap(err, "hls: part close");
+        }
+    }
+    
     // flush video when got one
     if ((err = muxer->flush_video(tsmc)) != srs_success) {
         return srs_error_wrap(err, "hls: flush video");
@@ -1164,6 +1682,11 @@ srs_error_t SrsHls::on_publish()
         return err;
     }
     
+    // The HLS of FMP4 is generated by DASH, which shares the fragments.
+    if (_srs_config->get_hls_fmp4(req->vhost)) {
+        return err;
+    }
+    
     if ((err = controller->on_publish(req)) != srs_success) {
         return srs_error_wrap(err, "hls: on publish");
     }
@@ -1308,7 +1831,7 @@ srs_error_t SrsHls::on_video(SrsSharedPtrMessage* shared_video, SrsFormat* forma
     }
     
     srs_assert(format->vcodec);
-    if (format->vcodec->id != SrsVideoCodecIdAVC) {
+    if (format->vcodec->id != SrsVideoCodecIdAVC && format->vcodec->id != SrsVideoCodecIdHEVC) {
         return err;
     }
     
@@ -11,11 +11,14 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <sstream>
 
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_file.hpp>
 #include <srs_app_async_call.hpp>
 #include <srs_app_fragment.hpp>
+#include <srs_app_st.hpp>
 
 class SrsFormat;
 class SrsSharedPtrMessage;
@@ -33,6 +36,26 @@ class SrsTsMessageCache;
 class SrsHlsSegment;
 class SrsTsContext;
 
+// The partial segment of LL-HLS, a piece of segment in sub-second, see EXT-X-PART of
+// https://datatracker.ietf.org/doc/html/draft-pantos-hls-rfc8216bis#section-4.4.4.9
+class SrsHlsPart
+{
+public:
+    // The index of part in segment, start from 0.
+    int index;
+    // The part uri in m3u8.
+    std::string uri;
+    // The full file path of part.
+    std::string fullpath;
+    // The duration of part.
+    srs_utime_t duration;
+    // Whether the part starts with a keyframe.
+    bool independent;
+public:
+    SrsHlsPart();
+    virtual ~SrsHlsPart();
+};
+
 // The wrapper of m3u8 segment from specification:
 //
 // 3.3.2.  EXTINF
@@ -52,13 +75,93 @@ public:
     unsigned char iv[16];
     // The full key path.
     std::string keypath;
+    // The finished parts of segment, for LL-HLS.
+    std::vector<SrsHlsPart*> parts;
 public:
     SrsHlsSegment(SrsTsContext* c, SrsAudioCodecId ac, SrsVideoCodecId vc, SrsFileWriter* w);
     virtual ~SrsHlsSegment();
 public:
     void config_cipher(unsigned char* key,unsigned char* iv);
+    // Build the uri or path of part by index, for example, livestream-5.ts to livestream-5.part0.ts
+    static std::string part_of(std::string v, int index);
+    // Whether the uri or path is a part, which is built by part_of.
+    static bool is_part(std::string v);
+// Interface SrsFragment
+public:
+    // Unlink the segment and all its parts.
+    virtual srs_error_t unlink_file();
+};
+
+// The file writer for LL-HLS, which writes the segment file, and copies the bytes to the
+// part file if open, so the part is a continuous piece of segment.
+class SrsHlsPartWriter : public SrsFileWriter
+{
+private:
+    SrsFileWriter* part;
+public:
+    SrsHlsPartWriter();
+    virtual ~SrsHlsPartWriter();
+public:
+    virtual srs_error_t open_part(std::string p);
+    virtual void close_part();
+// Interface ISrsWriteSeeker
+public:
+    virtual srs_error_t write(void* buf, size_t count, ssize_t* pnwrite);
 };
 
+// The state of a LL-HLS playlist, for HTTP server to block the playlist reload.
+class SrsHlsPartState
+{
+public:
+    // The media sequence number of the segment in writing.
+    int msn;
+    // The index of the last finished part of segment msn, -1 if no part.
+    int part;
+    // The full path of part file, which is hinted by EXT-X-PRELOAD-HINT.
+    std::string hint;
+    // The target duration of segment, to timeout the blocking request.
+    srs_utime_t target;
+    // Whether the stream is publishing, the last waiter frees the state when unpublished.
+    bool alive;
+    int nn_waiters;
+    srs_cond_t cond;
+public:
+    SrsHlsPartState();
+    virtual ~SrsHlsPartState();
+};
+
+// The manager of LL-HLS playlists, the muxer updates the state when part is ready, while the
+// HTTP server parks the requests of blocking playlist reload, or preload hint part, on the cond,
+// until the part is ready or timeout.
+class SrsHlsPartNotifier
+{
+private:
+    // The state of playlist, key is the real path of m3u8 file.
+    std::map<std::string, SrsHlsPartState*> states;
+public:
+    SrsHlsPartNotifier();
+    virtual ~SrsHlsPartNotifier();
+public:
+    // When muxer finish a part, or start a segment, notify the waiting requests.
+    virtual void update(std::string m3u8, int msn, int part, std::string hint, srs_utime_t target);
+    // When muxer unpublish, wakeup all waiting requests.
+    virtual void unpublish(std::string m3u8);
+    // Wait for the part of playlist m3u8, for request with _HLS_msn and _HLS_part.
+    // @param part The index of part, -1 to wait for the whole segment msn.
+    // @param pcode Set to the HTTP status code to response, 200 if ok to serve the playlist.
+    virtual void wait_part(std::string m3u8, int msn, int part, int* pcode);
+    // Wait for the part file, which is hinted by EXT-X-PRELOAD-HINT, util it's ready or timeout.
+    virtual void wait_hint(std::string fullpath);
+public:
+    // Get the real path of file, which is used as key, return the path itself if failed.
+    static std::string realpath(std::string path);
+private:
+    virtual void wait(SrsHlsPartState* state, srs_utime_t timeout);
+    virtual void release(SrsHlsPartState* state);
+};
+
+extern SrsHlsPartNotifier* _srs_hls_parts;
+
 // The hls async call: on_hls
 class SrsDvrAsyncCallOnHls : public ISrsAsyncCallTask
 {
@@ -142,6 +245,20 @@ private:
     unsigned char iv[16];
     // The underlayer file writer.
     SrsFileWriter* writer;
+private:
+    // Whether enable LL-HLS, which writes the segment in parts.
+    bool hls_ll;
+    srs_utime_t hls_part_duration;
+    // The writer to copy segment to part files, same object to writer if LL-HLS.
+    SrsHlsPartWriter* part_writer;
+    // The current writing part of current segment.
+    SrsHlsPart* part;
+    // The start dts in ms of current part, which is the last dts of previous part.
+    int64_t part_dts;
+    // The dts in ms of last frame written to current segment, -1 if no frame.
+    int64_t last_dts;
+    // The real path of m3u8, the key of LL-HLS state.
+    std::string m3u8_key;
 private:
     int _sequence_no;
     srs_utime_t max_td;
@@ -155,6 +272,8 @@ private:
     // The ts context, to keep cc continous between ts.
     // @see https://github.com/ossrs/srs/issues/375
     SrsTsContext* context;
+    // The latest video codec of stream, to write PMT for h.264 or h.265.
+    SrsVideoCodecId latest_vcodec;
 public:
     SrsHlsMuxer();
     virtual ~SrsHlsMuxer();
@@ -176,7 +295,8 @@ public:
         std::string path, std::string m3u8_file, std::string ts_file,
         srs_utime_t fragment, srs_utime_t window, bool ts_floor, double aof_ratio,
         bool cleanup, bool wait_keyframe, bool keys, int fragments_per_key,
-        std::string key_file, std::string key_file_path, std::string key_url);
+        std::string key_file, std::string key_file_path, std::string key_url,
+        bool ll, srs_utime_t part_duration);
     // Open a new segment(a new ts file)
     virtual srs_error_t segment_open();
     virtual srs_error_t on_sequence_header();
@@ -189,18 +309,34 @@ public:
     // that is whether the current segment duration>=2*(the segment in config)
     // @see https://github.com/ossrs/srs/issues/151#issuecomment-71155184
     virtual bool is_segment_absolutely_overflow();
+    // Whether the part overflow if write frame at dts, that is the part duration>(the part in config),
+    // so we should close the part before write the frame.
+    // @param dts The dts of frame in ms.
+    virtual bool is_part_overflow(int64_t dts);
+    // Close the current part, and refresh the m3u8 for LL-HLS.
+    virtual srs_error_t part_close();
 public:
     // Whether current hls muxer is pure audio mode.
     virtual bool pure_audio();
     virtual srs_error_t flush_audio(SrsTsMessageCache* cache);
     virtual srs_error_t flush_video(SrsTsMessageCache* cache);
+    // Update the video codec of stream, the PMT of current segment follows it unless disabled.
+    virtual void set_latest_vcodec(SrsVideoCodecId v);
     // Close segment(ts).
     virtual srs_error_t segment_close();
 private:
     virtual srs_error_t do_segment_close();
+    // Open a new part when write the first frame to part.
+    virtual srs_error_t part_open(int64_t dts, bool keyframe);
+    // Close the part file, and append to current segment.
+    virtual srs_error_t do_part_close();
+    // Update the LL-HLS state, to wakeup the blocking requests.
+    virtual void notify_parts();
     virtual srs_error_t write_hls_key();
     virtual srs_error_t refresh_m3u8();
     virtual srs_error_t _refresh_m3u8(std::string m3u8_file);
+    // Write the EXT-X-PART of segment to m3u8.
+    virtual void write_parts(std::stringstream& ss, SrsHlsSegment* segment);
 };
 
 // The hls stream cache,
@@ -19,6 +19,9 @@ SrsPps* _srs_pps_timer = NULL;
 SrsPps* _srs_pps_conn = NULL;
 SrsPps* _srs_pps_pub = NULL;
 
+// The lag of event loop, that is the delay of timer, which is blocked by other coroutines.
+SrsHistogram* _srs_latency_loop = NULL;
+
 extern SrsPps* _srs_pps_clock_15ms;
 extern SrsPps* _srs_pps_clock_20ms;
 extern SrsPps* _srs_pps_clock_25ms;
@@ -197,12 +200,20 @@ srs_error_t SrsFastTimer::cycle()
 
 SrsClockWallMonitor::SrsClockWallMonitor()
 {
+    max_lag_ = 0;
 }
 
 SrsClockWallMonitor::~SrsClockWallMonitor()
 {
 }
 
+srs_utime_t SrsClockWallMonitor::consume_lag()
+{
+    srs_utime_t lag = max_lag_;
+    max_lag_ = 0;
+    return lag;
+}
+
 srs_error_t SrsClockWallMonitor::on_timer(srs_utime_t interval)
 {
     srs_error_t err = srs_success;
@@ -218,6 +229,11 @@ srs_error_t SrsClockWallMonitor::on_timer(srs_utime_t interval)
     srs_utime_t elapsed = now - clock;
     clock = now;
 
+    if (elapsed - interval > max_lag_) {
+        max_lag_ = elapsed - interval;
+    }
+    _srs_latency_loop->record(srs_max(0, elapsed - interval));
+
     if (elapsed <= 15 * SRS_UTIME_MILLISECONDS) {
         ++_srs_pps_clock_15ms->sugar;
     } else if (elapsed <= 21 * SRS_UTIME_MILLISECONDS) {
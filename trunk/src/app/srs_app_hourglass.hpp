@@ -126,9 +126,15 @@ private:
 // To monitor the system wall clock timer deviation.
 class SrsClockWallMonitor : public ISrsFastTimer
 {
+private:
+    // The max lag of timer, which is the deviation from the interval, as event loop lag.
+    srs_utime_t max_lag_;
 public:
     SrsClockWallMonitor();
     virtual ~SrsClockWallMonitor();
+public:
+    // Get the max lag of event loop, and reset it for next duration.
+    srs_utime_t consume_lag();
 // interface ISrsFastTimer
 private:
     srs_error_t on_timer(srs_utime_t interval);
@@ -7,6 +7,7 @@
 #include <srs_app_http_api.hpp>
 
 #include <sstream>
+#include <algorithm>
 #include <stdlib.h>
 #include <signal.h>
 #include <unistd.h>
@@ -30,6 +31,9 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_app_coworkers.hpp>
+#include <srs_kernel_kbps.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_app_admission.hpp>
 
 srs_error_t srs_api_response_jsonp(ISrsHttpResponseWriter* w, string callback, string data)
 {
@@ -261,6 +265,8 @@ srs_error_t SrsGoApiV1::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r
     urls->set("raw", SrsJsonAny::str("raw api for srs, support CUID srs for instance the config"));
     urls->set("clusters", SrsJsonAny::str("origin cluster server API"));
     urls->set("perf", SrsJsonAny::str("System performance stat"));
+    urls->set("cpu", SrsJsonAny::str("the hottest connections and streams by CPU, default query top 10"));
+    urls->set("latency", SrsJsonAny::str("the latency histograms in us of stages, for the last 5s"));
     urls->set("tcmalloc", SrsJsonAny::str("tcmalloc api with params ?page=summary|api"));
 
     SrsJsonObject* tests = SrsJsonAny::object();
@@ -845,6 +851,274 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
     return srs_api_response(w, r, obj->dumps());
 }
 
+SrsGoApiCpu::SrsGoApiCpu()
+{
+}
+
+SrsGoApiCpu::~SrsGoApiCpu()
+{
+}
+
+// The CPU of stream, which is the CPU of its publisher and players.
+struct SrsCpuStream
+{
+    SrsStatisticStream* stream;
+    uint64_t ticks;
+    int nn_clients;
+};
+
+static bool srs_cpu_stream_hotter(const SrsCpuStream& a, const SrsCpuStream& b)
+{
+    return a.ticks > b.ticks;
+}
+
+srs_error_t SrsGoApiCpu::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+
+    // Query the top 10 by default.
+    std::string rcount = r->query_get("count");
+    int count = rcount.empty() ? 10 : srs_max(1, atoi(rcount.c_str()));
+
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
+
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+
+    data->set("duration", SrsJsonAny::integer(srsu2ms(_srs_cpu->duration())));
+    data->set("others", SrsJsonAny::number(_srs_cpu->others()));
+
+    std::vector<SrsCpuSlot*> slots;
+    _srs_cpu->top(-1, slots);
+
+    SrsJsonArray* conns = SrsJsonAny::array();
+    data->set("connections", conns);
+
+    std::map<std::string, SrsCpuStream> streams;
+    for (int i = 0; i < (int)slots.size(); i++) {
+        SrsCpuSlot* slot = slots.at(i);
+        SrsStatisticClient* client = stat->find_client(slot->cid.c_str());
+
+        // Sum the CPU of clients to its stream.
+        if (client && client->stream) {
+            SrsCpuStream& s = streams[client->stream->id];
+            s.stream = client->stream;
+            s.ticks += slot->delta;
+            s.nn_clients++;
+        }
+
+        if (i >= count) {
+            continue;
+        }
+
+        SrsJsonObject* conn = SrsJsonAny::object();
+        conns->append(conn);
+
+        conn->set("id", SrsJsonAny::str(slot->cid.c_str()));
+        conn->set("name", SrsJsonAny::str(slot->name.c_str()));
+        conn->set("coroutines", SrsJsonAny::integer(slot->refs));
+        conn->set("cpu", SrsJsonAny::number(_srs_cpu->percent(slot->delta)));
+        if (client) {
+            conn->set("ip", SrsJsonAny::str(client->req->ip.c_str()));
+            conn->set("type", SrsJsonAny::str(srs_client_type_string(client->type).c_str()));
+            conn->set("url", SrsJsonAny::str(client->req->get_stream_url().c_str()));
+        }
+    }
+
+    std::vector<SrsCpuStream> hottest;
+    for (std::map<std::string, SrsCpuStream>::iterator it = streams.begin(); it != streams.end(); ++it) {
+        hottest.push_back(it->second);
+    }
+    std::sort(hottest.begin(), hottest.end(), srs_cpu_stream_hotter);
+
+    SrsJsonArray* arr = SrsJsonAny::array();
+    data->set("streams", arr);
+
+    for (int i = 0; i < (int)hottest.size() && i < count; i++) {
+        SrsCpuStream& s = hottest.at(i);
+
+        SrsJsonObject* stream = SrsJsonAny::object();
+        arr->append(stream);
+
+        stream->set("id", SrsJsonAny::str(s.stream->id.c_str()));
+        stream->set("url", SrsJsonAny::str(s.stream->url.c_str()));
+        stream->set("clients", SrsJsonAny::integer(s.nn_clients));
+        stream->set("cpu", SrsJsonAny::number(_srs_cpu->percent(s.ticks)));
+    }
+
+    return srs_api_response(w, r, obj->dumps());
+}
+
+extern SrsHistogram* _srs_latency_publish;
+extern SrsHistogram* _srs_latency_queue;
+extern SrsHistogram* _srs_latency_send;
+extern SrsHistogram* _srs_latency_loop;
+#ifdef SRS_RTC
+extern SrsHistogram* _srs_latency_rtc;
+#endif
+
+SrsGoApiLatency::SrsGoApiLatency()
+{
+}
+
+SrsGoApiLatency::~SrsGoApiLatency()
+{
+}
+
+// Dumps the latency in us of histogram, for the last duration.
+static SrsJsonObject* srs_latency_dumps(SrsHistogram* h)
+{
+    SrsJsonObject* obj = SrsJsonAny::object();
+
+    obj->set("count", SrsJsonAny::integer(h->count()));
+    obj->set("min", SrsJsonAny::integer(h->min()));
+    obj->set("avg", SrsJsonAny::integer(h->average()));
+    obj->set("p50", SrsJsonAny::integer(h->percentile(50)));
+    obj->set("p90", SrsJsonAny::integer(h->percentile(90)));
+    obj->set("p99", SrsJsonAny::integer(h->percentile(99)));
+    obj->set("p999", SrsJsonAny::integer(h->percentile(99.9)));
+    obj->set("max", SrsJsonAny::integer(h->max()));
+
+    return obj;
+}
+
+srs_error_t SrsGoApiLatency::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    SrsStatistic* stat = SrsStatistic::instance();
+
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+
+    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
+
+    SrsJsonObject* data = SrsJsonAny::object();
+    obj->set("data", data);
+
+    data->set("publish", srs_latency_dumps(_srs_latency_publish));
+    data->set("queue", srs_latency_dumps(_srs_latency_queue));
+    data->set("send", srs_latency_dumps(_srs_latency_send));
+#ifdef SRS_RTC
+    data->set("rtc", srs_latency_dumps(_srs_latency_rtc));
+#endif
+    data->set("loop", srs_latency_dumps(_srs_latency_loop));
+
+    return srs_api_response(w, r, obj->dumps());
+}
+
+extern SrsPps* _srs_pps_rpkts;
+extern SrsPps* _srs_pps_spkts;
+extern SrsPps* _srs_pps_dispose;
+#ifdef SRS_RTC
+extern SrsPps* _srs_pps_rrtps;
+extern SrsPps* _srs_pps_srtps;
+extern SrsPps* _srs_pps_rnack;
+extern SrsPps* _srs_pps_snack;
+extern SrsPps* _srs_pps_pli;
+#endif
+
+SrsGoApiMetrics::SrsGoApiMetrics()
+{
+    enabled_ = _srs_config->get_http_api_metrics_enabled();
+    labels_ = srs_metrics_labels_parse(_srs_config->get_http_api_metrics_labels());
+    max_streams_ = _srs_config->get_http_api_metrics_max_streams();
+}
+
+SrsGoApiMetrics::~SrsGoApiMetrics()
+{
+}
+
+// Append the counter of pps.
+static void srs_metrics_pps(string& out, const char* family, const char* help, SrsPps* pps)
+{
+    string name = string(family) + "_total";
+    srs_metrics_family(out, family, "counter", help);
+    srs_metrics_sample(out, name.c_str(), "", pps->sugar);
+}
+
+// Append the quantiles of latency histogram.
+static void srs_metrics_latency(string& out, const char* stage, SrsHistogram* h)
+{
+    string labels;
+    srs_metrics_label(labels, "stage", stage);
+
+    srs_metrics_sample(out, "srs_latency_microseconds", labels + ",quantile=\"0.5\"", h->percentile(50));
+    srs_metrics_sample(out, "srs_latency_microseconds", labels + ",quantile=\"0.99\"", h->percentile(99));
+    srs_metrics_sample(out, "srs_latency_microseconds", labels + ",quantile=\"1\"", h->max());
+}
+
+srs_error_t SrsGoApiMetrics::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+
+    if (!enabled_) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_NotFound);
+    }
+
+    SrsStatistic* stat = SrsStatistic::instance();
+    string& out = buf_;
+    out.clear();
+
+    if (true) {
+        string labels;
+        srs_metrics_label(labels, "version", RTMP_SIG_SRS_VERSION);
+        srs_metrics_label(labels, "server", stat->server_id());
+        srs_metrics_family(out, "srs_build", "info", "The version and id of server.");
+        srs_metrics_sample(out, "srs_build_info", labels, 1);
+    }
+
+    srs_metrics_family(out, "srs_uptime_seconds", "gauge", "The seconds since server started.");
+    srs_metrics_sample(out, "srs_uptime_seconds", "", (srs_get_system_time() - srs_get_system_startup_time()) / SRS_UTIME_SECONDS);
+
+    SrsProcSelfStat* u = srs_get_self_proc_stat();
+    srs_metrics_family(out, "srs_cpu_percent", "gauge", "The CPU percent of server.");
+    srs_metrics_number(out, "srs_cpu_percent", "", u->percent * 100);
+    srs_metrics_family(out, "srs_memory_rss_bytes", "gauge", "The resident memory of server.");
+    srs_metrics_sample(out, "srs_memory_rss_bytes", "", (int64_t)u->rss * 4096);
+
+    // The clients, vhosts and streams.
+    stat->dumps_metrics(out, labels_, max_streams_);
+
+    _srs_circuit_breaker->dumps_metrics(out);
+    _srs_admission->dumps_metrics(out);
+
+    srs_metrics_family(out, "srs_latency_microseconds", "summary", "The latency of stages in last 5s.");
+    srs_metrics_latency(out, "publish", _srs_latency_publish);
+    srs_metrics_latency(out, "queue", _srs_latency_queue);
+    srs_metrics_latency(out, "send", _srs_latency_send);
+#ifdef SRS_RTC
+    srs_metrics_latency(out, "rtc", _srs_latency_rtc);
+#endif
+    srs_metrics_latency(out, "loop", _srs_latency_loop);
+
+    srs_metrics_pps(out, "srs_udp_recv_packets", "The UDP packets received.", _srs_pps_rpkts);
+    srs_metrics_pps(out, "srs_udp_send_packets", "The UDP packets sent.", _srs_pps_spkts);
+    srs_metrics_pps(out, "srs_disposed_connections", "The connections disposed.", _srs_pps_dispose);
+#ifdef SRS_RTC
+    srs_metrics_pps(out, "srs_rtc_recv_rtp", "The RTP packets received of RTC.", _srs_pps_rrtps);
+    srs_metrics_pps(out, "srs_rtc_send_srtp", "The SRTP packets sent of RTC.", _srs_pps_srtps);
+    srs_metrics_pps(out, "srs_rtc_recv_nack", "The NACK packets received of RTC.", _srs_pps_rnack);
+    srs_metrics_pps(out, "srs_rtc_send_nack", "The NACK packets sent of RTC.", _srs_pps_snack);
+    srs_metrics_pps(out, "srs_rtc_send_pli", "The PLI packets sent of RTC.", _srs_pps_pli);
+#endif
+
+    out.append("# EOF\n");
+
+    SrsHttpHeader* h = w->header();
+    h->set_content_length(out.length());
+    h->set_content_type("application/openmetrics-text; version=1.0.0; charset=utf-8");
+
+    if ((err = w->write((char*)out.data(), (int)out.length())) != srs_success) {
+        return srs_error_wrap(err, "write metrics");
+    }
+
+    return err;
+}
+
 SrsGoApiRaw::SrsGoApiRaw(SrsServer* svr)
 {
     server = svr;
@@ -168,6 +168,42 @@ public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 };
 
+// The hottest connections and streams, by the CPU of coroutines in last duration.
+class SrsGoApiCpu : public ISrsHttpHandler
+{
+public:
+    SrsGoApiCpu();
+    virtual ~SrsGoApiCpu();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+class SrsGoApiLatency : public ISrsHttpHandler
+{
+public:
+    SrsGoApiLatency();
+    virtual ~SrsGoApiLatency();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
+// The Prometheus exporter, to expose the metrics in OpenMetrics text, which writes the counters to
+// text directly without JSON objects, because it's scraped frequently by lots of nodes.
+class SrsGoApiMetrics : public ISrsHttpHandler
+{
+private:
+    bool enabled_;
+    int labels_;
+    int max_streams_;
+    // The buffer to write metrics, reused for each scrape.
+    std::string buf_;
+public:
+    SrsGoApiMetrics();
+    virtual ~SrsGoApiMetrics();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+};
+
 class SrsGoApiRaw : public ISrsHttpHandler, public ISrsReloadHandler
 {
 private:
@@ -7,6 +7,7 @@
 #include <srs_app_http_hooks.hpp>
 
 #include <sstream>
+#include <vector>
 using namespace std;
 
 #include <srs_kernel_error.hpp>
@@ -452,6 +453,89 @@ srs_error_t SrsHttpHooks::discover_co_workers(string url, string& host, int& por
     return err;
 }
 
+// The http hooks will cause context switch, so we must copy all hooks for the config may be
+// freed by reload.
+// @see https://github.com/ossrs/srs/issues/475
+vector<string> srs_http_hooks_copy(SrsRequest* req, SrsConfDirective* conf)
+{
+    vector<string> hooks;
+
+    if (conf && _srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
+        hooks = conf->args;
+    }
+
+    return hooks;
+}
+
+srs_error_t SrsHttpHooks::on_connect(SrsRequest* req)
+{
+    srs_error_t err = srs_success;
+
+    vector<string> hooks = srs_http_hooks_copy(req, _srs_config->get_vhost_on_connect(req->vhost));
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        if ((err = on_connect(url, req)) != srs_success) {
+            return srs_error_wrap(err, "on_connect %s", url.c_str());
+        }
+    }
+
+    return err;
+}
+
+void SrsHttpHooks::on_close(SrsRequest* req, int64_t send_bytes, int64_t recv_bytes)
+{
+    vector<string> hooks = srs_http_hooks_copy(req, _srs_config->get_vhost_on_close(req->vhost));
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        on_close(hooks.at(i), req, send_bytes, recv_bytes);
+    }
+}
+
+srs_error_t SrsHttpHooks::on_publish(SrsRequest* req)
+{
+    srs_error_t err = srs_success;
+
+    vector<string> hooks = srs_http_hooks_copy(req, _srs_config->get_vhost_on_publish(req->vhost));
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        if ((err = on_publish(url, req)) != srs_success) {
+            return srs_error_wrap(err, "on_publish %s", url.c_str());
+        }
+    }
+
+    return err;
+}
+
+void SrsHttpHooks::on_unpublish(SrsRequest* req)
+{
+    vector<string> hooks = srs_http_hooks_copy(req, _srs_config->get_vhost_on_unpublish(req->vhost));
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        on_unpublish(hooks.at(i), req);
+    }
+}
+
+srs_error_t SrsHttpHooks::on_play(SrsRequest* req)
+{
+    srs_error_t err = srs_success;
+
+    vector<string> hooks = srs_http_hooks_copy(req, _srs_config->get_vhost_on_play(req->vhost));
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        std::string url = hooks.at(i);
+        if ((err = on_play(url, req)) != srs_success) {
+            return srs_error_wrap(err, "on_play %s", url.c_str());
+        }
+    }
+
+    return err;
+}
+
+void SrsHttpHooks::on_stop(SrsRequest* req)
+{
+    vector<string> hooks = srs_http_hooks_copy(req, _srs_config->get_vhost_on_stop(req->vhost));
+    for (int i = 0; i < (int)hooks.size(); i++) {
+        on_stop(hooks.at(i), req);
+    }
+}
+
 srs_error_t SrsHttpHooks::do_post(SrsHttpClient* hc, std::string url, std::string req, int& code, string& res)
 {
     srs_error_t err = srs_success;
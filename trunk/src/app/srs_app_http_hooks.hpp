@@ -79,6 +79,14 @@ public:
     static srs_error_t on_hls_notify(SrsContextId cid, std::string url, SrsRequest* req, std::string ts_url, int nb_notify);
     // Discover co-workers for origin cluster.
     static srs_error_t discover_co_workers(std::string url, std::string& host, int& port);
+public:
+    // Call all hooks of the event, which is configured in vhost of req, ignore if http hooks disabled.
+    static srs_error_t on_connect(SrsRequest* req);
+    static void on_close(SrsRequest* req, int64_t send_bytes, int64_t recv_bytes);
+    static srs_error_t on_publish(SrsRequest* req);
+    static void on_unpublish(SrsRequest* req);
+    static srs_error_t on_play(SrsRequest* req);
+    static void on_stop(SrsRequest* req);
 private:
     static srs_error_t do_post(SrsHttpClient* hc, std::string url, std::string req, int& code, std::string& res);
 };
@@ -33,6 +33,7 @@ using namespace std;
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_source.hpp>
 #include <srs_app_server.hpp>
+#include <srs_app_hls.hpp>
 
 SrsVodStream::SrsVodStream(string root_dir) : SrsHttpFileServer(root_dir)
 {
@@ -42,6 +43,37 @@ SrsVodStream::~SrsVodStream()
 {
 }
 
+srs_error_t SrsVodStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_assert(entry);
+
+    string fullpath = srs_http_fs_fullpath(dir, entry->pattern, r->path());
+
+    // For LL-HLS, the hinted part is not ready, wait for it. Other files are served without waiting.
+    if (!_srs_path_exists(fullpath)) {
+        if (SrsHlsSegment::is_part(fullpath)) {
+            _srs_hls_parts->wait_hint(SrsHlsPartNotifier::realpath(fullpath));
+        }
+        return SrsHttpFileServer::serve_http(w, r);
+    }
+
+    // For LL-HLS, the blocking playlist reload, see 6.2.5.2 of rfc8216bis.
+    string msn = r->query_get("_HLS_msn");
+    if (!msn.empty() && srs_string_ends_with(fullpath, ".m3u8")) {
+        string part = r->query_get("_HLS_part");
+
+        int code = SRS_CONSTS_HTTP_OK;
+        _srs_hls_parts->wait_part(SrsHlsPartNotifier::realpath(fullpath), ::atoi(msn.c_str()),
+            part.empty()? -1 : ::atoi(part.c_str()), &code);
+
+        if (code != SRS_CONSTS_HTTP_OK) {
+            return srs_go_http_error(w, code);
+        }
+    }
+
+    return SrsHttpFileServer::serve_http(w, r);
+}
+
 srs_error_t SrsVodStream::serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, int offset)
 {
     srs_error_t err = srs_success;
@@ -20,6 +20,11 @@ class SrsVodStream : public SrsHttpFileServer
 public:
     SrsVodStream(std::string root_dir);
     virtual ~SrsVodStream();
+// Interface ISrsHttpHandler
+public:
+    // For LL-HLS, block the playlist reload by _HLS_msn and _HLS_part, and block the request
+    // of hinted part util it's ready.
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 protected:
     virtual srs_error_t serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int offset);
     virtual srs_error_t serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int start, int end);
@@ -39,6 +39,10 @@ using namespace std;
 #include <srs_app_statistic.hpp>
 #include <srs_app_recv_thread.hpp>
 #include <srs_app_http_hooks.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_kernel_kbps.hpp>
+
+extern SrsHistogram* _srs_latency_send;
 
 SrsBufferCache::SrsBufferCache(SrsLiveSource* s, SrsRequest* r)
 {
@@ -524,6 +528,11 @@ srs_error_t SrsLiveStream::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage
 {
     srs_error_t err = srs_success;
     
+    // Pause the player when overload.
+    if ((err = _srs_circuit_breaker->on_play()) != srs_success) {
+        return srs_error_wrap(err, "circuit breaker");
+    }
+    
     if ((err = http_hooks_on_play(r)) != srs_success) {
         return srs_error_wrap(err, "http hook");
     }
@@ -657,6 +666,8 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
         if ((err = consumer->dump_packets(&msgs, count)) != srs_success) {
             return srs_error_wrap(err, "consumer dump packets");
         }
+        // The time when dumped, updated by consumer if got messages.
+        srs_utime_t dumptime = srs_get_system_time();
 
         // TODO: FIXME: Support merged-write wait.
         if (count <= 0) {
@@ -677,6 +688,7 @@ srs_error_t SrsLiveStream::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
         } else {
             err = streaming_send_messages(enc, msgs.msgs, count);
         }
+        _srs_latency_send->record(srs_update_system_time() - dumptime);
 
         // TODO: FIXME: Update the stat.
 
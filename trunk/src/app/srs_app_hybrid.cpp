@@ -11,6 +11,7 @@
 #include <srs_kernel_error.hpp>
 #include <srs_service_st.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_kernel_flv.hpp>
 
 using namespace std;
 
@@ -112,6 +113,17 @@ extern SrsPps* _srs_pps_objs_rbuf;
 extern SrsPps* _srs_pps_objs_msgs;
 extern SrsPps* _srs_pps_objs_rothers;
 
+SrsPps* _srs_pps_objs_pool_hit = NULL;
+SrsPps* _srs_pps_objs_pool_miss = NULL;
+
+extern SrsHistogram* _srs_latency_publish;
+extern SrsHistogram* _srs_latency_queue;
+extern SrsHistogram* _srs_latency_send;
+extern SrsHistogram* _srs_latency_loop;
+#ifdef SRS_RTC
+extern SrsHistogram* _srs_latency_rtc;
+#endif
+
 ISrsHybridServer::ISrsHybridServer()
 {
 }
@@ -226,6 +238,11 @@ srs_error_t SrsHybridServer::initialize()
 {
     srs_error_t err = srs_success;
 
+    // Account the CPU of coroutines, before the coroutines start.
+    if (_srs_config->get_stats_cpu_accounting() && (err = _srs_cpu->initialize()) != srs_success) {
+        return srs_error_wrap(err, "cpu accounting");
+    }
+
     // Start the timer first.
     if ((err = timer20ms_->start()) != srs_success) {
         return srs_error_wrap(err, "start timer");
@@ -318,10 +335,18 @@ SrsFastTimer* SrsHybridServer::timer5s()
     return timer5s_;
 }
 
+SrsClockWallMonitor* SrsHybridServer::clock_monitor()
+{
+    return clock_monitor_;
+}
+
 srs_error_t SrsHybridServer::on_timer(srs_utime_t interval)
 {
     srs_error_t err = srs_success;
 
+    // Sample the CPU of coroutines for the last duration.
+    _srs_cpu->sample();
+
     // Show statistics for RTC server.
     SrsProcSelfStat* u = srs_get_self_proc_stat();
     // Resident Set Size: number of pages the process has in real memory.
@@ -436,12 +461,36 @@ srs_error_t SrsHybridServer::on_timer(srs_utime_t interval)
     }
 #endif
 
-    srs_trace("Hybrid cpu=%.2f%%,%dMB%s%s%s%s%s%s%s%s%s%s%s",
+    string pool_desc;
+    _srs_pps_objs_pool_hit->update(_srs_payload_pool->nn_hit); _srs_pps_objs_pool_miss->update(_srs_payload_pool->nn_miss);
+    if (_srs_pps_objs_pool_hit->r10s() || _srs_pps_objs_pool_miss->r10s()) {
+        snprintf(buf, sizeof(buf), ", pool=(hit:%d,miss:%d,kb:%d)", _srs_pps_objs_pool_hit->r10s(),
+            _srs_pps_objs_pool_miss->r10s(), (int)(_srs_payload_pool->cached_bytes() / 1024));
+        pool_desc = buf;
+    }
+
+    // The p99 latency in us of stages.
+    string latency_desc;
+    _srs_latency_publish->update(); _srs_latency_queue->update(); _srs_latency_send->update(); _srs_latency_loop->update();
+    int rtc_p99 = 0;
+#ifdef SRS_RTC
+    _srs_latency_rtc->update();
+    rtc_p99 = (int)_srs_latency_rtc->percentile(99);
+#endif
+    if (_srs_latency_publish->count() || _srs_latency_queue->count() || _srs_latency_send->count() || rtc_p99) {
+        snprintf(buf, sizeof(buf), ", p99=(pub:%d,queue:%d,send:%d,rtc:%d,loop:%d)",
+            (int)_srs_latency_publish->percentile(99), (int)_srs_latency_queue->percentile(99),
+            (int)_srs_latency_send->percentile(99), rtc_p99, (int)_srs_latency_loop->percentile(99));
+        latency_desc = buf;
+    }
+
+    srs_trace("Hybrid cpu=%.2f%%,%dMB%s%s%s%s%s%s%s%s%s%s%s%s%s",
         u->percent * 100, memory,
         cid_desc.c_str(), timer_desc.c_str(),
         recvfrom_desc.c_str(), io_desc.c_str(), msg_desc.c_str(),
         epoll_desc.c_str(), sched_desc.c_str(), clock_desc.c_str(),
-        thread_desc.c_str(), free_desc.c_str(), objs_desc.c_str()
+        thread_desc.c_str(), free_desc.c_str(), objs_desc.c_str(),
+        pool_desc.c_str(), latency_desc.c_str()
     );
 
     return err;
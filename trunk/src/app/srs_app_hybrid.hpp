@@ -71,6 +71,7 @@ public:
     SrsFastTimer* timer100ms();
     SrsFastTimer* timer1s();
     SrsFastTimer* timer5s();
+    SrsClockWallMonitor* clock_monitor();
 // interface ISrsFastTimer
 private:
     srs_error_t on_timer(srs_utime_t interval);
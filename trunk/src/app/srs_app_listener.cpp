@@ -41,6 +41,9 @@ SrsPps* _srs_pps_spkts = NULL;
 // sleep in srs_utime_t for udp recv packet.
 #define SrsUdpPacketRecvCycleInterval 0
 
+// The max number of tcp clients to accept in a batch.
+#define SRS_TCP_ACCEPT_BATCH 16
+
 ISrsUdpHandler::ISrsUdpHandler()
 {
 }
@@ -79,15 +82,37 @@ ISrsTcpHandler::~ISrsTcpHandler()
 {
 }
 
-SrsUdpListener::SrsUdpListener(ISrsUdpHandler* h, string i, int p)
+SrsUdpListener::SrsUdpListener(ISrsUdpHandler* h, string i, int p, int batch)
 {
     handler = h;
     ip = i;
     port = p;
     lfd = NULL;
     
+    // There is no recvmmsg for OSX, so we receive one packet a time.
+#ifdef __linux__
+    nn_batch = srs_max(1, batch);
+#else
+    nn_batch = 1;
+#endif
+    
     nb_buf = SRS_UDP_MAX_PACKET_SIZE;
-    buf = new char[nb_buf];
+    buf = new char[nb_buf * nn_batch];
+    
+#ifdef __linux__
+    // Each message uses a slice of buf, and receives the address of peer to froms.
+    msgs = new mmsghdr[nn_batch];
+    iovs = new iovec[nn_batch];
+    froms = new sockaddr_storage[nn_batch];
+    memset(msgs, 0, sizeof(mmsghdr) * nn_batch);
+    for (int i = 0; i < nn_batch; i++) {
+        iovs[i].iov_base = buf + i * nb_buf;
+        iovs[i].iov_len = nb_buf;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &froms[i];
+    }
+#endif
     
     trd = new SrsDummyCoroutine();
 }
@@ -97,6 +122,11 @@ SrsUdpListener::~SrsUdpListener()
     srs_freep(trd);
     srs_close_stfd(lfd);
     srs_freepa(buf);
+#ifdef __linux__
+    srs_freepa(msgs);
+    srs_freepa(iovs);
+    srs_freepa(froms);
+#endif
 }
 
 int SrsUdpListener::fd()
@@ -184,23 +214,17 @@ srs_error_t SrsUdpListener::cycle()
             return srs_error_wrap(err, "udp listener");
         }
 
-        int nread = 0;
-        sockaddr_storage from;
-        int nb_from = sizeof(from);
-        if ((nread = srs_recvfrom(lfd, buf, nb_buf, (sockaddr*)&from, &nb_from, SRS_UTIME_NO_TIMEOUT)) <= 0) {
-            return srs_error_new(ERROR_SOCKET_READ, "udp read, nread=%d", nread);
+#ifdef __linux__
+        if (nn_batch > 1) {
+            err = do_cycle_batch();
+        } else {
+            err = do_cycle();
         }
-
-        // Drop UDP health check packet of Aliyun SLB.
-        //      Healthcheck udp check
-        // @see https://help.aliyun.com/document_detail/27595.html
-        if (nread == 21 && buf[0] == 0x48 && buf[1] == 0x65 && buf[2] == 0x61 && buf[3] == 0x6c
-            && buf[19] == 0x63 && buf[20] == 0x6b) {
-            continue;
-        }
-
-        if ((err = handler->on_udp_packet((const sockaddr*)&from, nb_from, buf, nread)) != srs_success) {
-            return srs_error_wrap(err, "handle packet %d bytes", nread);
+#else
+        err = do_cycle();
+#endif
+        if (err != srs_success) {
+            return srs_error_wrap(err, "udp listener");
         }
         
         if (SrsUdpPacketRecvCycleInterval > 0) {
@@ -211,6 +235,71 @@ srs_error_t SrsUdpListener::cycle()
     return err;
 }
 
+// Drop UDP health check packet of Aliyun SLB.
+//      Healthcheck udp check
+// @see https://help.aliyun.com/document_detail/27595.html
+bool srs_is_udp_health_check(char* buf, int nread)
+{
+    return nread == 21 && buf[0] == 0x48 && buf[1] == 0x65 && buf[2] == 0x61 && buf[3] == 0x6c
+        && buf[19] == 0x63 && buf[20] == 0x6b;
+}
+
+srs_error_t SrsUdpListener::do_cycle()
+{
+    srs_error_t err = srs_success;
+
+    int nread = 0;
+    sockaddr_storage from;
+    int nb_from = sizeof(from);
+    if ((nread = srs_recvfrom(lfd, buf, nb_buf, (sockaddr*)&from, &nb_from, SRS_UTIME_NO_TIMEOUT)) <= 0) {
+        return srs_error_new(ERROR_SOCKET_READ, "udp read, nread=%d", nread);
+    }
+
+    if (srs_is_udp_health_check(buf, nread)) {
+        return err;
+    }
+
+    if ((err = handler->on_udp_packet((const sockaddr*)&from, nb_from, buf, nread)) != srs_success) {
+        return srs_error_wrap(err, "handle packet %d bytes", nread);
+    }
+
+    return err;
+}
+
+#ifdef __linux__
+srs_error_t SrsUdpListener::do_cycle_batch()
+{
+    srs_error_t err = srs_success;
+
+    // Reset the length of address, which is updated by recvmmsg.
+    for (int i = 0; i < nn_batch; i++) {
+        msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+    }
+
+    // Wait for the first packet, then receive all packets in kernel buffer, at most nn_batch.
+    int nn_msgs = 0;
+    if ((nn_msgs = srs_recvmmsg(lfd, msgs, nn_batch, 0, SRS_UTIME_NO_TIMEOUT)) <= 0) {
+        return srs_error_new(ERROR_SOCKET_READ, "udp read, nn_msgs=%d", nn_msgs);
+    }
+
+    for (int i = 0; i < nn_msgs; i++) {
+        char* p = (char*)iovs[i].iov_base;
+        int nread = (int)msgs[i].msg_len;
+
+        if (srs_is_udp_health_check(p, nread)) {
+            continue;
+        }
+
+        const sockaddr* from = (const sockaddr*)msgs[i].msg_hdr.msg_name;
+        if ((err = handler->on_udp_packet(from, (int)msgs[i].msg_hdr.msg_namelen, p, nread)) != srs_success) {
+            return srs_error_wrap(err, "handle packet %d bytes", nread);
+        }
+    }
+
+    return err;
+}
+#endif
+
 SrsTcpListener::SrsTcpListener(ISrsTcpHandler* h, string i, int p)
 {
     handler = h;
@@ -259,17 +348,21 @@ srs_error_t SrsTcpListener::cycle()
             return srs_error_wrap(err, "tcp listener");
         }
         
-        srs_netfd_t fd = srs_accept(lfd, NULL, NULL, SRS_UTIME_NO_TIMEOUT);
-        if(fd == NULL){
+        // Accept a batch of clients, for accept storm, the fds are already close-on-exec.
+        srs_netfd_t fds[SRS_TCP_ACCEPT_BATCH];
+        int nn = srs_accept_batch(lfd, fds, SRS_TCP_ACCEPT_BATCH, SRS_UTIME_NO_TIMEOUT);
+        if (nn <= 0) {
             return srs_error_new(ERROR_SOCKET_ACCEPT, "accept at fd=%d", srs_netfd_fileno(lfd));
         }
         
-        if ((err = srs_fd_closeexec(srs_netfd_fileno(fd))) != srs_success) {
-            return srs_error_wrap(err, "set closeexec");
-        }
-        
-        if ((err = handler->on_tcp_client(fd)) != srs_success) {
-            return srs_error_wrap(err, "handle fd=%d", srs_netfd_fileno(fd));
+        for (int i = 0; i < nn; i++) {
+            if ((err = handler->on_tcp_client(fds[i])) != srs_success) {
+                // Close the left fds, which are not handled.
+                for (int j = i + 1; j < nn; j++) {
+                    srs_close_stfd(fds[j]);
+                }
+                return srs_error_wrap(err, "handle fd=%d", srs_netfd_fileno(fds[i]));
+            }
         }
     }
     
@@ -76,12 +76,21 @@ protected:
 protected:
     char* buf;
     int nb_buf;
+    // The max number of packets to receive in a batch, by recvmmsg.
+    int nn_batch;
+#ifdef __linux__
+    struct mmsghdr* msgs;
+    struct iovec* iovs;
+    sockaddr_storage* froms;
+#endif
 protected:
     ISrsUdpHandler* handler;
     std::string ip;
     int port;
 public:
-    SrsUdpListener(ISrsUdpHandler* h, std::string i, int p);
+    // @param batch The max number of packets to receive in a batch, each packet uses a buffer
+    //      of 64KB. Use 1 to receive one packet a time.
+    SrsUdpListener(ISrsUdpHandler* h, std::string i, int p, int batch = 1);
     virtual ~SrsUdpListener();
 public:
     virtual int fd();
@@ -93,6 +102,11 @@ public:
 // Interface ISrsReusableThreadHandler.
 public:
     virtual srs_error_t cycle();
+private:
+    virtual srs_error_t do_cycle();
+#ifdef __linux__
+    virtual srs_error_t do_cycle_batch();
+#endif
 };
 
 // Bind and listen tcp port, use handler to process the client.
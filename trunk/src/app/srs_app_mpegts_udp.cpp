@@ -31,8 +31,8 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_raw_avc.hpp>
 #include <srs_app_pithy_print.hpp>
-#include <srs_app_rtmp_conn.hpp>
-#include <srs_protocol_utility.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_app_hybrid.hpp>
 
 SrsMpegtsQueue::SrsMpegtsQueue()
 {
@@ -41,48 +41,48 @@ SrsMpegtsQueue::SrsMpegtsQueue()
 
 SrsMpegtsQueue::~SrsMpegtsQueue()
 {
-    std::map<int64_t, SrsSharedPtrMessage*>::iterator it;
+    std::map<int64_t, SrsCommonMessage*>::iterator it;
     for (it = msgs.begin(); it != msgs.end(); ++it) {
-        SrsSharedPtrMessage* msg = it->second;
+        SrsCommonMessage* msg = it->second;
         srs_freep(msg);
     }
     msgs.clear();
 }
 
-srs_error_t SrsMpegtsQueue::push(SrsSharedPtrMessage* msg)
+srs_error_t SrsMpegtsQueue::push(SrsCommonMessage* msg)
 {
     srs_error_t err = srs_success;
     
     // TODO: FIXME: use right way.
     for (int i = 0; i < 10; i++) {
-        if (msgs.find(msg->timestamp) == msgs.end()) {
+        if (msgs.find(msg->header.timestamp) == msgs.end()) {
             break;
         }
         
         // adjust the ts, add 1ms.
-        msg->timestamp += 1;
+        msg->header.timestamp += 1;
         
         if (i >= 5) {
-            srs_warn("mpegts: free the msg for dts exists, dts=%" PRId64, msg->timestamp);
+            srs_warn("mpegts: free the msg for dts exists, dts=%" PRId64, msg->header.timestamp);
             srs_freep(msg);
             return err;
         }
     }
     
-    if (msg->is_audio()) {
+    if (msg->header.is_audio()) {
         nb_audios++;
     }
     
-    if (msg->is_video()) {
+    if (msg->header.is_video()) {
         nb_videos++;
     }
     
-    msgs[msg->timestamp] = msg;
+    msgs[msg->header.timestamp] = msg;
     
     return err;
 }
 
-SrsSharedPtrMessage* SrsMpegtsQueue::dequeue()
+SrsCommonMessage* SrsMpegtsQueue::dequeue()
 {
     // got 2+ videos and audios, ok to dequeue.
     bool av_ok = nb_videos >= 2 && nb_audios >= 2;
@@ -90,15 +90,15 @@ SrsSharedPtrMessage* SrsMpegtsQueue::dequeue()
     bool av_overflow = nb_videos > 100 || nb_audios > 300;
     
     if (av_ok || av_overflow) {
-        std::map<int64_t, SrsSharedPtrMessage*>::iterator it = msgs.begin();
-        SrsSharedPtrMessage* msg = it->second;
+        std::map<int64_t, SrsCommonMessage*>::iterator it = msgs.begin();
+        SrsCommonMessage* msg = it->second;
         msgs.erase(it);
         
-        if (msg->is_audio()) {
+        if (msg->header.is_audio()) {
             nb_audios--;
         }
         
-        if (msg->is_video()) {
+        if (msg->header.is_video()) {
             nb_videos--;
         }
         
@@ -108,91 +108,64 @@ SrsSharedPtrMessage* SrsMpegtsQueue::dequeue()
     return NULL;
 }
 
-SrsMpegtsOverUdp::SrsMpegtsOverUdp(SrsConfDirective* c)
+string srs_mpegts_udp_flow_key(string output, string ip, int port)
 {
-    context = new SrsTsContext();
-    buffer = new SrsSimpleStream();
-    output = _srs_config->get_stream_caster_output(c);
+    string key;
     
-    sdk = NULL;
+    if (srs_string_contains(output, "[ip]")) {
+        key = ip;
+    }
     
-    avc = new SrsRawH264Stream();
-    aac = new SrsRawAacStream();
-    h264_sps_changed = false;
-    h264_pps_changed = false;
-    h264_sps_pps_sent = false;
-    queue = new SrsMpegtsQueue();
-    pprint = SrsPithyPrint::create_caster();
+    if (srs_string_contains(output, "[port]")) {
+        key += ":" + srs_int2str(port);
+    }
+    
+    return key;
 }
 
-SrsMpegtsOverUdp::~SrsMpegtsOverUdp()
+string srs_mpegts_udp_build_url(string output, string ip, int port, int program)
 {
-    close();
+    string url = output;
     
-    srs_freep(buffer);
-    srs_freep(context);
-    srs_freep(avc);
-    srs_freep(aac);
-    srs_freep(queue);
-    srs_freep(pprint);
+    url = srs_string_replace(url, "[ip]", ip);
+    url = srs_string_replace(url, "[port]", srs_int2str(port));
+    url = srs_string_replace(url, "[program]", srs_int2str(program));
+    
+    return url;
 }
 
-srs_error_t SrsMpegtsOverUdp::on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf)
+SrsMpegtsUdpFlow::SrsMpegtsUdpFlow(string o, string i, int p)
 {
-    char address_string[64];
-    char port_string[16];
-    if(getnameinfo(from, fromlen, 
-                   (char*)&address_string, sizeof(address_string),
-                   (char*)&port_string, sizeof(port_string),
-                   NI_NUMERICHOST|NI_NUMERICSERV)) {
-        return srs_error_new(ERROR_SYSTEM_IP_INVALID, "bad address");
+    context = new SrsTsContext();
+    buffer = new SrsSimpleStream();
+    output = o;
+    ip = i;
+    port = p;
+    demux_program = srs_string_contains(output, "[program]");
+    last_packet = srs_get_system_time();
+}
+
+SrsMpegtsUdpFlow::~SrsMpegtsUdpFlow()
+{
+    std::map<int, SrsMpegtsUdpStream*>::iterator it;
+    for (it = streams.begin(); it != streams.end(); ++it) {
+        SrsMpegtsUdpStream* stream = it->second;
+        srs_freep(stream);
     }
-    std::string peer_ip = std::string(address_string);
-    int peer_port = atoi(port_string);
+    streams.clear();
     
-    // append to buffer.
-    buffer->append(buf, nb_buf);
-    
-    srs_error_t err = on_udp_bytes(peer_ip, peer_port, buf, nb_buf);
-    if (err != srs_success) {
-        return srs_error_wrap(err, "process udp");
-    }
-    return err;
+    srs_freep(buffer);
+    srs_freep(context);
 }
 
-srs_error_t SrsMpegtsOverUdp::on_udp_bytes(string host, int port, char* buf, int nb_buf)
+srs_error_t SrsMpegtsUdpFlow::on_udp_bytes(char* buf, int nb_buf)
 {
     srs_error_t err = srs_success;
     
-    // collect nMB data to parse in a time.
-    // TODO: FIXME: comment the following for release.
-    //if (buffer->length() < 3 * 1024 * 1024) return ret;
-    // TODO: FIXME: remove the debug to file.
-#if 0
-    SrsFileWriter fw;
-    if ((err = fw.open("latest.ts")) != srs_success) {
-        return srs_error_wrap(err, "open file");
-    }
-    if ((err = fw.write(buffer->bytes(), buffer->length(), NULL)) != srs_success) {
-        return srs_error_wrap(err, "write data");
-    }
-    fw.close();
-#endif
-#if 0
-    SrsFileReader fr;
-    if ((err = fr.open("latest.ts")) != srs_success) {
-        return srs_error_wrap(err, "open file");
-    }
-    buffer->erase(buffer->length());
-    int nb_fbuf = fr.filesize();
-    char* fbuf = new char[nb_fbuf];
-    SrsAutoFreeA(char, fbuf);
-    if ((err = fr.read(fbuf, nb_fbuf, NULL)) != srs_success) {
-        return srs_error_wrap(err, "read data");
-    }
-    fr.close();
-    buffer->append(fbuf, nb_fbuf);
-#endif
+    last_packet = srs_get_system_time();
+    
+    // append to buffer.
+    buffer->append(buf, nb_buf);
     
     // find the sync byte of mpegts.
     char* p = buffer->bytes();
@@ -209,7 +182,7 @@ srs_error_t SrsMpegtsOverUdp::on_udp_bytes(string host, int port, char* buf, int
     
     // drop ts packet when size not modulus by 188
     if (buffer->length() < SRS_TS_PACKET_SIZE) {
-        srs_warn("udp: wait %s:%d packet %d/%d bytes", host.c_str(), port, nb_buf, buffer->length());
+        srs_warn("udp: wait %s:%d packet %d/%d bytes", ip.c_str(), port, nb_buf, buffer->length());
         return err;
     }
     
@@ -218,11 +191,11 @@ srs_error_t SrsMpegtsOverUdp::on_udp_bytes(string host, int port, char* buf, int
     for (int i = 0; i < nb_packet; i++) {
         char* p = buffer->bytes() + (i * SRS_TS_PACKET_SIZE);
         
-        SrsBuffer* stream = new SrsBuffer(p, SRS_TS_PACKET_SIZE);
-        SrsAutoFree(SrsBuffer, stream);
+        // parse the ts packet in place.
+        SrsBuffer stream(p, SRS_TS_PACKET_SIZE);
         
         // process each ts packet
-        if ((err = context->decode(stream, this)) != srs_success) {
+        if ((err = context->decode(&stream, this)) != srs_success) {
             srs_warn("parse ts packet err=%s", srs_error_desc(err).c_str());
             srs_error_reset(err);
             continue;
@@ -237,10 +210,186 @@ srs_error_t SrsMpegtsOverUdp::on_udp_bytes(string host, int port, char* buf, int
     return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::on_ts_message(SrsTsMessage* msg)
+bool SrsMpegtsUdpFlow::is_idle(srs_utime_t timeout)
+{
+    return srs_get_system_time() - last_packet > timeout;
+}
+
+void SrsMpegtsUdpFlow::expire(srs_utime_t timeout)
+{
+    // Remove the idle streams from map before free them, because unpublish might switch
+    // coroutine, when the new messages of program should create a new stream.
+    std::vector<int> programs;
+    std::vector<SrsMpegtsUdpStream*> expired;
+    std::map<int, SrsMpegtsUdpStream*>::iterator it;
+    for (it = streams.begin(); it != streams.end();) {
+        SrsMpegtsUdpStream* stream = it->second;
+        if (!stream->is_idle(timeout)) {
+            ++it;
+            continue;
+        }
+        
+        programs.push_back(it->first);
+        expired.push_back(stream);
+        streams.erase(it++);
+    }
+    
+    for (int i = 0; i < (int)expired.size(); i++) {
+        SrsMpegtsUdpStream* stream = expired.at(i);
+        srs_trace("mpegts: expire idle stream from %s:%d, program=%d, timeout=%dms, streams=%d",
+            ip.c_str(), port, programs.at(i), srsu2msi(timeout), (int)streams.size());
+        srs_freep(stream);
+    }
+}
+
+string SrsMpegtsUdpFlow::desc()
+{
+    return ip + ":" + srs_int2str(port) + ", streams=" + srs_int2str((int)streams.size());
+}
+
+srs_error_t SrsMpegtsUdpFlow::on_ts_message(SrsTsMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    // All programs are published as one stream, if not demux by program.
+    int program = demux_program? msg->channel->program : 0;
+    
+    SrsMpegtsUdpStream* stream = NULL;
+    std::map<int, SrsMpegtsUdpStream*>::iterator it = streams.find(program);
+    if (it != streams.end()) {
+        stream = it->second;
+    } else {
+        string url = srs_mpegts_udp_build_url(output, ip, port, program);
+        stream = streams[program] = new SrsMpegtsUdpStream(url, ip);
+        srs_trace("mpegts: new stream from %s:%d, program=%d, url=%s", ip.c_str(), port, program, url.c_str());
+    }
+    
+    if ((err = stream->on_ts_message(msg)) != srs_success) {
+        return srs_error_wrap(err, "program=%d", program);
+    }
+    
+    return err;
+}
+
+SrsMpegtsOverUdp::SrsMpegtsOverUdp(SrsConfDirective* c)
+{
+    output = _srs_config->get_stream_caster_output(c);
+    idle_timeout = _srs_config->get_stream_caster_idle_timeout(c);
+    
+    _srs_hybrid->timer5s()->subscribe(this);
+}
+
+SrsMpegtsOverUdp::~SrsMpegtsOverUdp()
+{
+    _srs_hybrid->timer5s()->unsubscribe(this);
+    
+    std::map<std::string, SrsMpegtsUdpFlow*>::iterator it;
+    for (it = flows.begin(); it != flows.end(); ++it) {
+        SrsMpegtsUdpFlow* flow = it->second;
+        srs_freep(flow);
+    }
+    flows.clear();
+}
+
+srs_error_t SrsMpegtsOverUdp::on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf)
+{
+    char address_string[64];
+    char port_string[16];
+    if(getnameinfo(from, fromlen, 
+                   (char*)&address_string, sizeof(address_string),
+                   (char*)&port_string, sizeof(port_string),
+                   NI_NUMERICHOST|NI_NUMERICSERV)) {
+        return srs_error_new(ERROR_SYSTEM_IP_INVALID, "bad address");
+    }
+    std::string peer_ip = std::string(address_string);
+    int peer_port = atoi(port_string);
+    
+    // Demux the packet to flow by the address of sender.
+    string key = srs_mpegts_udp_flow_key(output, peer_ip, peer_port);
+    
+    SrsMpegtsUdpFlow* flow = NULL;
+    std::map<std::string, SrsMpegtsUdpFlow*>::iterator it = flows.find(key);
+    if (it != flows.end()) {
+        flow = it->second;
+    } else {
+        flow = flows[key] = new SrsMpegtsUdpFlow(output, peer_ip, peer_port);
+        srs_trace("mpegts: new flow from %s:%d, key=%s, flows=%d", peer_ip.c_str(), peer_port, key.c_str(), (int)flows.size());
+    }
+    
+    srs_error_t err = flow->on_udp_bytes(buf, nb_buf);
+    if (err != srs_success) {
+        return srs_error_wrap(err, "process udp");
+    }
+    return err;
+}
+
+srs_error_t SrsMpegtsOverUdp::on_timer(srs_utime_t interval)
 {
     srs_error_t err = srs_success;
     
+    // Remove the idle flows from map before free them, because unpublish might switch
+    // coroutine, when the new packets should create a new flow.
+    std::vector<SrsMpegtsUdpFlow*> expired;
+    std::map<std::string, SrsMpegtsUdpFlow*>::iterator it;
+    for (it = flows.begin(); it != flows.end();) {
+        SrsMpegtsUdpFlow* flow = it->second;
+        if (!flow->is_idle(idle_timeout)) {
+            ++it;
+            continue;
+        }
+        
+        expired.push_back(flow);
+        flows.erase(it++);
+    }
+    
+    for (int i = 0; i < (int)expired.size(); i++) {
+        SrsMpegtsUdpFlow* flow = expired.at(i);
+        srs_trace("mpegts: expire idle flow %s, timeout=%dms, flows=%d", flow->desc().c_str(), srsu2msi(idle_timeout), (int)flows.size());
+        srs_freep(flow);
+    }
+    
+    // For the alive flows, expire the idle programs, for example, the sender stops a program.
+    for (it = flows.begin(); it != flows.end(); ++it) {
+        SrsMpegtsUdpFlow* flow = it->second;
+        flow->expire(idle_timeout);
+    }
+    
+    return err;
+}
+
+SrsMpegtsUdpStream::SrsMpegtsUdpStream(string u, string i)
+{
+    url = u;
+    ip = i;
+    
+    publisher = new SrsLivePublisher();
+    
+    avc = new SrsRawH264Stream();
+    aac = new SrsRawAacStream();
+    h264_sps_changed = false;
+    h264_pps_changed = false;
+    h264_sps_pps_sent = false;
+    queue = new SrsMpegtsQueue();
+    pprint = SrsPithyPrint::create_caster();
+    last_message = srs_get_system_time();
+}
+
+SrsMpegtsUdpStream::~SrsMpegtsUdpStream()
+{
+    close();
+    
+    srs_freep(publisher);
+    srs_freep(avc);
+    srs_freep(aac);
+    srs_freep(queue);
+    srs_freep(pprint);
+}
+
+srs_error_t SrsMpegtsUdpStream::on_ts_message(SrsTsMessage* msg)
+{
+    srs_error_t err = srs_success;
+    
+    last_message = srs_get_system_time();
     pprint->elapse();
     
     // about the bytes of msg, specified by elementary stream which indicates by PES_packet_data_byte and stream_id
@@ -323,7 +472,12 @@ srs_error_t SrsMpegtsOverUdp::on_ts_message(SrsTsMessage* msg)
     return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::on_ts_video(SrsTsMessage* msg, SrsBuffer* avs)
+bool SrsMpegtsUdpStream::is_idle(srs_utime_t timeout)
+{
+    return srs_get_system_time() - last_message > timeout;
+}
+
+srs_error_t SrsMpegtsUdpStream::on_ts_video(SrsTsMessage* msg, SrsBuffer* avs)
 {
     srs_error_t err = srs_success;
     
@@ -403,7 +557,7 @@ srs_error_t SrsMpegtsOverUdp::on_ts_video(SrsTsMessage* msg, SrsBuffer* avs)
     return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::write_h264_sps_pps(uint32_t dts, uint32_t pts)
+srs_error_t SrsMpegtsUdpStream::write_h264_sps_pps(uint32_t dts, uint32_t pts)
 {
     srs_error_t err = srs_success;
     
@@ -444,7 +598,7 @@ srs_error_t SrsMpegtsOverUdp::write_h264_sps_pps(uint32_t dts, uint32_t pts)
     return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::write_h264_ipb_frame(char* frame, int frame_size, uint32_t dts, uint32_t pts)
+srs_error_t SrsMpegtsUdpStream::write_h264_ipb_frame(char* frame, int frame_size, uint32_t dts, uint32_t pts)
 {
     srs_error_t err = srs_success;
     
@@ -482,7 +636,7 @@ srs_error_t SrsMpegtsOverUdp::write_h264_ipb_frame(char* frame, int frame_size,
     return rtmp_write_packet(SrsFrameTypeVideo, timestamp, flv, nb_flv);
 }
 
-srs_error_t SrsMpegtsOverUdp::on_ts_audio(SrsTsMessage* msg, SrsBuffer* avs)
+srs_error_t SrsMpegtsUdpStream::on_ts_audio(SrsTsMessage* msg, SrsBuffer* avs)
 {
     srs_error_t err = srs_success;
     
@@ -535,7 +689,7 @@ srs_error_t SrsMpegtsOverUdp::on_ts_audio(SrsTsMessage* msg, SrsBuffer* avs)
     return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, uint32_t dts)
+srs_error_t SrsMpegtsUdpStream::write_audio_raw_frame(char* frame, int frame_size, SrsRawAacStreamCodec* codec, uint32_t dts)
 {
     srs_error_t err = srs_success;
     
@@ -548,7 +702,7 @@ srs_error_t SrsMpegtsOverUdp::write_audio_raw_frame(char* frame, int frame_size,
     return rtmp_write_packet(SrsFrameTypeAudio, dts, data, size);
 }
 
-srs_error_t SrsMpegtsOverUdp::rtmp_write_packet(char type, uint32_t timestamp, char* data, int size)
+srs_error_t SrsMpegtsUdpStream::rtmp_write_packet(char type, uint32_t timestamp, char* data, int size)
 {
     srs_error_t err = srs_success;
     
@@ -556,9 +710,9 @@ srs_error_t SrsMpegtsOverUdp::rtmp_write_packet(char type, uint32_t timestamp, c
         return srs_error_wrap(err, "connect");
     }
     
-    SrsSharedPtrMessage* msg = NULL;
+    SrsCommonMessage* msg = NULL;
     
-    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, sdk->sid(), &msg)) != srs_success) {
+    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, 1, &msg)) != srs_success) {
         return srs_error_wrap(err, "create message");
     }
     srs_assert(msg);
@@ -576,11 +730,13 @@ srs_error_t SrsMpegtsOverUdp::rtmp_write_packet(char type, uint32_t timestamp, c
         
         if (pprint->can_print()) {
             srs_trace("mpegts: send msg %s age=%d, dts=%" PRId64 ", size=%d",
-                      msg->is_audio()? "A":msg->is_video()? "V":"N", pprint->age(), msg->timestamp, msg->size);
+                      msg->header.is_audio()? "A":msg->header.is_video()? "V":"N", pprint->age(), msg->header.timestamp, msg->size);
         }
         
-        // send out encoded msg.
-        if ((err = sdk->send_and_free_message(msg)) != srs_success) {
+        // deliver to source, the payload is transferred without copy.
+        err = publisher->on_message(msg);
+        srs_freep(msg);
+        if (err != srs_success) {
             close();
             return srs_error_wrap(err, "send messages");
         }
@@ -589,34 +745,24 @@ srs_error_t SrsMpegtsOverUdp::rtmp_write_packet(char type, uint32_t timestamp, c
     return err;
 }
 
-srs_error_t SrsMpegtsOverUdp::connect()
+srs_error_t SrsMpegtsUdpStream::connect()
 {
     srs_error_t err = srs_success;
     
-    // Ignore when connected.
-    if (sdk) {
+    // Ignore when publishing.
+    if (publisher->publishing()) {
         return err;
     }
     
-    srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
-    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk = new SrsSimpleRtmpClient(output, cto, sto);
-    
-    if ((err = sdk->connect()) != srs_success) {
-        close();
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", output.c_str(), srsu2msi(cto), srsu2msi(sto));
-    }
-    
-    if ((err = sdk->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
-        close();
-        return srs_error_wrap(err, "publish");
+    if ((err = publisher->publish(url, ip)) != srs_success) {
+        return srs_error_wrap(err, "publish %s", url.c_str());
     }
     
     return err;
 }
 
-void SrsMpegtsOverUdp::close()
+void SrsMpegtsUdpStream::close()
 {
-    srs_freep(sdk);
+    publisher->unpublish();
 }
 
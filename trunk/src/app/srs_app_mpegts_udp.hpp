@@ -21,15 +21,16 @@ class SrsRtmpClient;
 class SrsStSocket;
 class SrsRequest;
 class SrsRawH264Stream;
-class SrsSharedPtrMessage;
+class SrsCommonMessage;
 class SrsRawAacStream;
 struct SrsRawAacStreamCodec;
 class SrsPithyPrint;
-class SrsSimpleRtmpClient;
+class SrsLivePublisher;
 
 #include <srs_app_st.hpp>
 #include <srs_kernel_ts.hpp>
 #include <srs_app_listener.hpp>
+#include <srs_app_hourglass.hpp>
 
 // The queue for mpegts over udp to send packets.
 // For the aac in mpegts contains many flv packets in a pes packet,
@@ -38,26 +39,33 @@ class SrsMpegtsQueue
 {
 private:
     // The key: dts, value: msg.
-    std::map<int64_t, SrsSharedPtrMessage*> msgs;
+    std::map<int64_t, SrsCommonMessage*> msgs;
     int nb_audios;
     int nb_videos;
 public:
     SrsMpegtsQueue();
     virtual ~SrsMpegtsQueue();
 public:
-    virtual srs_error_t push(SrsSharedPtrMessage* msg);
-    virtual SrsSharedPtrMessage* dequeue();
+    virtual srs_error_t push(SrsCommonMessage* msg);
+    virtual SrsCommonMessage* dequeue();
 };
 
-// The mpegts over udp stream caster.
-class SrsMpegtsOverUdp : public ISrsTsHandler, public ISrsUdpHandler
+// Build the key of flow for the output url, the packets in the same flow are demuxed by
+// one ts context. Return empty string if the output has no variable of sender.
+extern std::string srs_mpegts_udp_flow_key(std::string output, std::string ip, int port);
+// Build the url of stream, for the output url with variables [ip], [port] and [program].
+extern std::string srs_mpegts_udp_build_url(std::string output, std::string ip, int port, int program);
+
+// The stream of mpegts over udp, to convert the ts messages of a program to RTMP messages
+// and publish to a live source.
+class SrsMpegtsUdpStream
 {
 private:
-    SrsTsContext* context;
-    SrsSimpleStream* buffer;
-    std::string output;
+    std::string url;
+    // The ip of the client.
+    std::string ip;
 private:
-    SrsSimpleRtmpClient* sdk;
+    SrsLivePublisher* publisher;
 private:
     SrsRawH264Stream* avc;
     std::string h264_sps;
@@ -71,17 +79,15 @@ private:
 private:
     SrsMpegtsQueue* queue;
     SrsPithyPrint* pprint;
+    // The time of the latest message, to expire the stream of program.
+    srs_utime_t last_message;
 public:
-    SrsMpegtsOverUdp(SrsConfDirective* c);
-    virtual ~SrsMpegtsOverUdp();
-// Interface ISrsUdpHandler
-public:
-    virtual srs_error_t on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf);
-private:
-    virtual srs_error_t on_udp_bytes(std::string host, int port, char* buf, int nb_buf);
-// Interface ISrsTsHandler
+    SrsMpegtsUdpStream(std::string u, std::string i);
+    virtual ~SrsMpegtsUdpStream();
 public:
     virtual srs_error_t on_ts_message(SrsTsMessage* msg);
+    // Whether the stream is idle, no messages in timeout.
+    virtual bool is_idle(srs_utime_t timeout);
 private:
     virtual srs_error_t on_ts_video(SrsTsMessage* msg, SrsBuffer* avs);
     virtual srs_error_t write_h264_sps_pps(uint32_t dts, uint32_t pts);
@@ -91,11 +97,63 @@ private:
 private:
     virtual srs_error_t rtmp_write_packet(char type, uint32_t timestamp, char* data, int size);
 private:
-    // Connect to RTMP server.
+    // Publish to the live source.
     virtual srs_error_t connect();
-    // Close the connection to RTMP server.
+    // Unpublish the live source.
     virtual void close();
 };
 
+// The flow of mpegts over udp, the packets from a sender, which is demuxed by a ts context,
+// and each program is published as a stream, if the output url contains [program].
+class SrsMpegtsUdpFlow : public ISrsTsHandler
+{
+private:
+    SrsTsContext* context;
+    SrsSimpleStream* buffer;
+    std::string output;
+    // The ip and port of the sender.
+    std::string ip;
+    int port;
+    // Whether demux the programs to streams.
+    bool demux_program;
+    // The time of the latest packet, to expire the flow.
+    srs_utime_t last_packet;
+    // The key: program_number, value: stream.
+    std::map<int, SrsMpegtsUdpStream*> streams;
+public:
+    SrsMpegtsUdpFlow(std::string o, std::string i, int p);
+    virtual ~SrsMpegtsUdpFlow();
+public:
+    virtual srs_error_t on_udp_bytes(char* buf, int nb_buf);
+    // Whether the flow is idle, no packets in timeout.
+    virtual bool is_idle(srs_utime_t timeout);
+    // Expire the idle streams of programs, while other programs of flow are alive.
+    virtual void expire(srs_utime_t timeout);
+    virtual std::string desc();
+// Interface ISrsTsHandler
+public:
+    virtual srs_error_t on_ts_message(SrsTsMessage* msg);
+};
+
+// The mpegts over udp stream caster, which accepts many senders on one port, and demuxes
+// the packets to flows by the address of sender.
+class SrsMpegtsOverUdp : public ISrsUdpHandler, public ISrsFastTimer
+{
+private:
+    std::string output;
+    srs_utime_t idle_timeout;
+    // The key: flow key, see srs_mpegts_udp_flow_key, value: flow.
+    std::map<std::string, SrsMpegtsUdpFlow*> flows;
+public:
+    SrsMpegtsOverUdp(SrsConfDirective* c);
+    virtual ~SrsMpegtsOverUdp();
+// Interface ISrsUdpHandler
+public:
+    virtual srs_error_t on_udp_packet(const sockaddr* from, const int fromlen, char* buf, int nb_buf);
+// Interface ISrsFastTimer
+private:
+    virtual srs_error_t on_timer(srs_utime_t interval);
+};
+
 #endif
 
@@ -0,0 +1,329 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_app_publisher.hpp>
+
+#include <string>
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_buffer.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_security.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_http_hooks.hpp>
+#include <srs_app_hybrid.hpp>
+#include <srs_app_server.hpp>
+#ifdef SRS_RTC
+#include <srs_app_rtc_source.hpp>
+#endif
+
+SrsLivePublisher::SrsLivePublisher()
+{
+    req_ = NULL;
+    source_ = NULL;
+    security_ = new SrsSecurity();
+    edge_ = false;
+    connected_ = false;
+    publishing_ = false;
+    expired_ = false;
+    nn_recv_bytes_ = 0;
+}
+
+SrsLivePublisher::~SrsLivePublisher()
+{
+    unpublish();
+    srs_freep(security_);
+}
+
+srs_error_t SrsLivePublisher::publish(string url, string ip)
+{
+    srs_error_t err = srs_success;
+
+    if (publishing_) {
+        return err;
+    }
+
+    // Cleanup the previous session, for example, failed to publish.
+    unpublish();
+
+    ip_ = ip;
+    id_ = _srs_context->generate_id().c_str();
+    expired_ = false;
+    nn_recv_bytes_ = 0;
+
+    if ((err = do_publish(url)) != srs_success) {
+        unpublish();
+        return srs_error_wrap(err, "publish %s", url.c_str());
+    }
+
+    return err;
+}
+
+void SrsLivePublisher::unpublish()
+{
+    if (publishing_) {
+        release_publish();
+        SrsHttpHooks::on_unpublish(req_);
+    }
+    publishing_ = false;
+
+    if (connected_) {
+        SrsHttpHooks::on_close(req_, 0, nn_recv_bytes_);
+    }
+    connected_ = false;
+
+    if (req_) {
+        SrsStatistic::instance()->on_disconnect(id_);
+    }
+
+    // The source is managed by _srs_sources, never free it.
+    source_ = NULL;
+    srs_freep(req_);
+}
+
+bool SrsLivePublisher::publishing()
+{
+    return publishing_;
+}
+
+SrsRequest* SrsLivePublisher::request()
+{
+    return req_;
+}
+
+srs_error_t SrsLivePublisher::on_message(SrsCommonMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    if (expired_) {
+        return srs_error_new(ERROR_THREAD_INTERRUPED, "publisher %s expired", id_.c_str());
+    }
+
+    if (!publishing_) {
+        return srs_error_new(ERROR_RTMP_STREAM_NOT_FOUND, "publisher %s not publishing", id_.c_str());
+    }
+
+    nn_recv_bytes_ += msg->size;
+
+    // for edge, directly proxy message to origin.
+    if (edge_) {
+        if ((err = source_->on_edge_proxy_publish(msg)) != srs_success) {
+            return srs_error_wrap(err, "proxy publish");
+        }
+        return err;
+    }
+
+    if (msg->header.is_audio()) {
+        if ((err = source_->on_audio(msg)) != srs_success) {
+            return srs_error_wrap(err, "consume audio");
+        }
+        return err;
+    }
+
+    if (msg->header.is_video()) {
+        if ((err = source_->on_video(msg)) != srs_success) {
+            return srs_error_wrap(err, "consume video");
+        }
+        return err;
+    }
+
+    if (msg->header.is_aggregate()) {
+        if ((err = source_->on_aggregate(msg)) != srs_success) {
+            return srs_error_wrap(err, "consume aggregate");
+        }
+        return err;
+    }
+
+    if (msg->header.is_amf0_data()) {
+        if ((err = on_meta_data(msg)) != srs_success) {
+            return srs_error_wrap(err, "consume metadata");
+        }
+        return err;
+    }
+
+    return err;
+}
+
+srs_error_t SrsLivePublisher::on_flv_tag(char type, uint32_t timestamp, char* data, int size)
+{
+    srs_error_t err = srs_success;
+
+    SrsCommonMessage* msg = NULL;
+    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, 1, &msg)) != srs_success) {
+        return srs_error_wrap(err, "create message");
+    }
+    SrsAutoFree(SrsCommonMessage, msg);
+
+    return on_message(msg);
+}
+
+void SrsLivePublisher::expire()
+{
+    expired_ = true;
+}
+
+srs_error_t SrsLivePublisher::do_publish(string url)
+{
+    srs_error_t err = srs_success;
+
+    req_ = new SrsRequest();
+    req_->ip = ip_;
+    srs_parse_rtmp_url(url, req_->tcUrl, req_->stream);
+    srs_discovery_tc_url(req_->tcUrl, req_->schema, req_->host, req_->vhost, req_->app, req_->stream, req_->port, req_->param);
+    req_->strip();
+
+    if (req_->schema.empty() || req_->vhost.empty() || req_->port == 0 || req_->app.empty()) {
+        return srs_error_new(ERROR_RTMP_REQ_TCURL, "discovery tcUrl failed, tcUrl=%s, schema=%s, vhost=%s, port=%d, app=%s",
+            req_->tcUrl.c_str(), req_->schema.c_str(), req_->vhost.c_str(), req_->port, req_->app.c_str());
+    }
+
+    // Never allow the empty stream name, for HLS may write to a file with empty name.
+    if (req_->stream.empty()) {
+        return srs_error_new(ERROR_RTMP_STREAM_NAME_EMPTY, "empty stream");
+    }
+
+    // check vhost, allow default vhost.
+    SrsConfDirective* vhost = _srs_config->get_vhost(req_->vhost, true);
+    if (vhost == NULL) {
+        return srs_error_new(ERROR_RTMP_VHOST_NOT_FOUND, "no vhost %s", req_->vhost.c_str());
+    }
+    req_->vhost = vhost->arg0();
+
+    if (!_srs_config->get_vhost_config(req_->vhost)->enabled) {
+        return srs_error_new(ERROR_RTMP_VHOST_NOT_FOUND, "vhost %s disabled", req_->vhost.c_str());
+    }
+
+    if ((err = SrsHttpHooks::on_connect(req_)) != srs_success) {
+        return srs_error_wrap(err, "callback on connect");
+    }
+    connected_ = true;
+
+    edge_ = _srs_config->get_vhost_config(req_->vhost)->edge;
+
+    if ((err = security_->check(SrsRtmpConnFMLEPublish, ip_, req_)) != srs_success) {
+        return srs_error_wrap(err, "security check");
+    }
+
+    if ((err = _srs_sources->fetch_or_create(req_, source_handler(), &source_)) != srs_success) {
+        return srs_error_wrap(err, "fetch source");
+    }
+    srs_assert(source_ != NULL);
+
+    SrsStatistic* stat = SrsStatistic::instance();
+    if ((err = stat->on_client(id_, req_, this, SrsRtmpConnFMLEPublish)) != srs_success) {
+        return srs_error_wrap(err, "stat client");
+    }
+
+    bool enabled_cache = source_->vhost_conf()->gop_cache;
+    source_->set_cache(enabled_cache);
+
+    srs_trace("publisher url=%s, ip=%s, cache=%d, is_edge=%d, source_id=%s/%s", req_->get_stream_url().c_str(),
+        ip_.c_str(), enabled_cache, edge_, source_->source_id().c_str(), source_->pre_source_id().c_str());
+
+    if ((err = SrsHttpHooks::on_publish(req_)) != srs_success) {
+        return srs_error_wrap(err, "callback on publish");
+    }
+
+    if ((err = acquire_publish()) != srs_success) {
+        SrsHttpHooks::on_unpublish(req_);
+        return srs_error_wrap(err, "acquire publish");
+    }
+    publishing_ = true;
+
+    return err;
+}
+
+srs_error_t SrsLivePublisher::acquire_publish()
+{
+    srs_error_t err = srs_success;
+
+    // Check whether RTMP stream is busy.
+    if (!source_->can_publish(edge_)) {
+        return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "stream %s is busy", req_->get_stream_url().c_str());
+    }
+
+    // Check whether RTC stream is busy.
+#ifdef SRS_RTC
+    SrsRtcSource *rtc = NULL;
+    bool rtc_server_enabled = _srs_config->get_rtc_server_enabled();
+    bool rtc_enabled = _srs_config->get_rtc_enabled(req_->vhost);
+    if (rtc_server_enabled && rtc_enabled && !edge_) {
+        if ((err = _srs_rtc_sources->fetch_or_create(req_, &rtc)) != srs_success) {
+            return srs_error_wrap(err, "create source");
+        }
+
+        if (!rtc->can_publish()) {
+            return srs_error_new(ERROR_SYSTEM_STREAM_BUSY, "rtc stream %s busy", req_->get_stream_url().c_str());
+        }
+    }
+#endif
+
+    // Bridge to RTC streaming.
+#if defined(SRS_RTC) && defined(SRS_FFMPEG_FIT)
+    if (rtc) {
+        SrsRtcFromRtmpBridger *bridger = new SrsRtcFromRtmpBridger(rtc);
+        if ((err = bridger->initialize(req_)) != srs_success) {
+            srs_freep(bridger);
+            return srs_error_wrap(err, "bridger init");
+        }
+
+        source_->set_bridger(bridger);
+    }
+#endif
+
+    // Start publisher now.
+    if (edge_) {
+        return source_->on_edge_start_publish();
+    } else {
+        return source_->on_publish();
+    }
+}
+
+void SrsLivePublisher::release_publish()
+{
+    // when edge, notice edge to change state.
+    // when origin, notice all service to unpublish.
+    if (edge_) {
+        source_->on_edge_proxy_unpublish();
+    } else {
+        source_->on_unpublish();
+    }
+}
+
+srs_error_t SrsLivePublisher::on_meta_data(SrsCommonMessage* msg)
+{
+    srs_error_t err = srs_success;
+
+    SrsBuffer stream(msg->payload, msg->size);
+
+    // Only the onMetaData is delivered, ignore other data messages.
+    SrsOnMetaDataPacket* metadata = new SrsOnMetaDataPacket();
+    SrsAutoFree(SrsOnMetaDataPacket, metadata);
+    if ((err = metadata->decode(&stream)) != srs_success) {
+        return srs_error_wrap(err, "decode metadata");
+    }
+
+    if (metadata->name != SRS_CONSTS_RTMP_ON_METADATA) {
+        return err;
+    }
+
+    if ((err = source_->on_meta_data(msg, metadata)) != srs_success) {
+        return srs_error_wrap(err, "source metadata");
+    }
+
+    return err;
+}
+
+ISrsLiveSourceHandler* SrsLivePublisher::source_handler()
+{
+    return _srs_hybrid->srs()->instance();
+}
@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SRS_APP_PUBLISHER_HPP
+#define SRS_APP_PUBLISHER_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+
+#include <srs_app_conn.hpp>
+
+class SrsRequest;
+class SrsLiveSource;
+class ISrsLiveSourceHandler;
+class SrsSecurity;
+class SrsCommonMessage;
+
+// The in-process publisher, for stream casters and SRT to publish stream to the live source
+// directly, without a RTMP client to publish to this server over loopback TCP. Like a RTMP
+// publisher, it checks the vhost and security, calls the http hooks, and updates statistic.
+class SrsLivePublisher : public ISrsExpire
+{
+private:
+    // The id of publisher, for statistic.
+    std::string id_;
+    // The ip of client, for security and http hooks.
+    std::string ip_;
+    SrsRequest* req_;
+    SrsLiveSource* source_;
+    SrsSecurity* security_;
+    bool edge_;
+    bool connected_;
+    bool publishing_;
+    bool expired_;
+    int64_t nn_recv_bytes_;
+public:
+    SrsLivePublisher();
+    virtual ~SrsLivePublisher();
+public:
+    // Start publishing stream to the url, ignore if publishing.
+    // @param url The url of stream, for example, rtmp://127.0.0.1/live/livestream?vhost=xxx
+    // @param ip The ip of client.
+    virtual srs_error_t publish(std::string url, std::string ip);
+    // Stop publishing, ignore if not publishing.
+    virtual void unpublish();
+    virtual bool publishing();
+    // The request of publisher, NULL if not publishing.
+    virtual SrsRequest* request();
+public:
+    // Deliver the message to source, the payload is transferred to source without copy.
+    // @remark User should free the msg.
+    virtual srs_error_t on_message(SrsCommonMessage* msg);
+    // Deliver the FLV tag to source, the data is always freed by this function.
+    virtual srs_error_t on_flv_tag(char type, uint32_t timestamp, char* data, int size);
+// Interface ISrsExpire.
+public:
+    virtual void expire();
+private:
+    virtual srs_error_t do_publish(std::string url);
+    virtual srs_error_t acquire_publish();
+    virtual void release_publish();
+    virtual srs_error_t on_meta_data(SrsCommonMessage* msg);
+    // The handler of source, to mount the stream when publishing.
+    virtual ISrsLiveSourceHandler* source_handler();
+};
+
+#endif
+
@@ -17,10 +17,14 @@
 #include <srs_app_http_conn.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_app_statistic.hpp>
+#include <srs_kernel_kbps.hpp>
 
 #include <sys/socket.h>
 using namespace std;
 
+// The latency from publisher message received, to source handled.
+SrsHistogram* _srs_latency_publish = NULL;
+
 // the max small bytes to group
 #define SRS_MR_SMALL_BYTES 4096
 
@@ -373,7 +377,12 @@ srs_error_t SrsPublishRecvThread::consume(SrsCommonMessage* msg)
                 srs_update_system_time(), msg->header.timestamp, msg->size);
     
     // the rtmp connection will handle this message
+    bool is_av = msg->header.is_audio() || msg->header.is_video();
+    srs_utime_t starttime = srs_update_system_time();
     err = _conn->handle_publish_message(_source, msg);
+    if (is_av) {
+        _srs_latency_publish->record(srs_update_system_time() - starttime);
+    }
     
     // must always free it,
     // the source will copy it if need to use.
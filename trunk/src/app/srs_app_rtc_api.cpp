@@ -14,6 +14,7 @@
 #include <srs_protocol_utility.hpp>
 #include <srs_app_config.hpp>
 #include <srs_app_statistic.hpp>
+#include <srs_app_threads.hpp>
 
 #include <unistd.h>
 #include <deque>
@@ -61,6 +62,11 @@ srs_error_t SrsGoApiRtcPlay::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMe
     SrsHttpHeader* hdr = w->header();
     hdr->set("Connection", "Close");
 
+    // Pause the player when overload.
+    if ((err = _srs_circuit_breaker->on_play()) != srs_success) {
+        return srs_error_wrap(err, "circuit breaker");
+    }
+
     // Parse req, the request json object, from body.
     SrsJsonObject* req = NULL;
     SrsAutoFree(SrsJsonObject, req);
@@ -279,6 +285,11 @@ srs_error_t SrsGoApiRtcPublish::do_serve_http(ISrsHttpResponseWriter* w, ISrsHtt
     SrsHttpHeader* hdr = w->header();
     hdr->set("Connection", "Close");
 
+    // Refuse the publisher when overload.
+    if ((err = _srs_circuit_breaker->on_publish()) != srs_success) {
+        return srs_error_wrap(err, "circuit breaker");
+    }
+
     // Parse req, the request json object, from body.
     SrsJsonObject* req = NULL;
     SrsAutoFree(SrsJsonObject, req);
@@ -66,6 +66,9 @@ extern SrsPps* _srs_pps_rnack2;
 extern SrsPps* _srs_pps_pub;
 extern SrsPps* _srs_pps_conn;
 
+// The latency of RTC packets, from RTP received, to SRTP sent.
+SrsHistogram* _srs_latency_rtc = NULL;
+
 ISrsRtcTransport::ISrsRtcTransport()
 {
 }
@@ -436,8 +439,9 @@ srs_error_t SrsRtcPlayStream::initialize(SrsRequest* req, std::map<uint32_t, Srs
     }
 
     // TODO: FIXME: Support reload.
-    nack_enabled_ = _srs_config->get_rtc_nack_enabled(req->vhost);
-    nack_no_copy_ = _srs_config->get_rtc_nack_no_copy(req->vhost);
+    SrsVhostConfig* vconf = _srs_config->get_vhost_config(req->vhost);
+    nack_enabled_ = vconf->rtc_nack_enabled;
+    nack_no_copy_ = vconf->rtc_nack_no_copy;
     srs_trace("RTC player nack=%d, nnc=%d", nack_enabled_, nack_no_copy_);
 
     // Setup tracks.
@@ -488,8 +492,9 @@ srs_error_t SrsRtcPlayStream::on_reload_vhost_play(string vhost)
         return srs_success;
     }
 
-    realtime = _srs_config->get_realtime_enabled(req_->vhost, true);
-    mw_msgs = _srs_config->get_mw_msgs(req_->vhost, realtime, true);
+    SrsVhostConfig* vconf = _srs_config->get_vhost_config(req_->vhost);
+    realtime = vconf->rtc_realtime;
+    mw_msgs = vconf->rtc_mw_msgs;
 
     srs_trace("Reload play realtime=%d, mw_msgs=%d", realtime, mw_msgs);
 
@@ -572,8 +577,9 @@ srs_error_t SrsRtcPlayStream::cycle()
         return srs_error_wrap(err, "dumps consumer, url=%s", req_->get_stream_url().c_str());
     }
 
-    realtime = _srs_config->get_realtime_enabled(req_->vhost, true);
-    mw_msgs = _srs_config->get_mw_msgs(req_->vhost, realtime, true);
+    SrsVhostConfig* vconf = _srs_config->get_vhost_config(req_->vhost);
+    realtime = vconf->rtc_realtime;
+    mw_msgs = vconf->rtc_mw_msgs;
 
     // TODO: FIXME: Add cost in ms.
     SrsContextId cid = source->source_id();
@@ -674,6 +680,11 @@ srs_error_t SrsRtcPlayStream::send_packet(SrsRtpPacket*& pkt)
         return srs_error_wrap(err, "audio track, SSRC=%u, SEQ=%u", ssrc, pkt->header.get_sequence());
     }
 
+    // Stat the latency from RTP received, to SRTP sent.
+    if (pkt->recv_time > 0) {
+        _srs_latency_rtc->record(srs_update_system_time() - pkt->recv_time);
+    }
+
     // For NACK to handle packet.
     // @remark Note that the pkt might be set to NULL.
     if (nack_enabled_) {
@@ -1299,6 +1310,7 @@ srs_error_t SrsRtcPublishStream::on_rtp_plaintext(char* plaintext, int nb_plaint
 
     // Allocate packet form cache.
     SrsRtpPacket* pkt = new SrsRtpPacket();
+    pkt->recv_time = srs_update_system_time();
 
     // Copy the packet body.
     char* p = pkt->wrap(plaintext, nb_plaintext);
@@ -2296,6 +2308,11 @@ void SrsRtcConnection::alive()
     last_stun_time = srs_get_system_time();
 }
 
+srs_utime_t SrsRtcConnection::deadline()
+{
+    return last_stun_time + session_timeout;
+}
+
 void SrsRtcConnection::update_sendonly_socket(SrsUdpMuxSocket* skt)
 {
     // TODO: FIXME: Refine performance.
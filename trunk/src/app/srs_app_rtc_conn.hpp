@@ -521,6 +521,8 @@ public:
     srs_error_t start_publish(std::string stream_uri);
     bool is_alive();
     void alive();
+    // The time to expire the session, if no STUN packets.
+    srs_utime_t deadline();
     void update_sendonly_socket(SrsUdpMuxSocket* skt);
 public:
     // send rtcp
@@ -558,6 +558,7 @@ srs_error_t SrsRtcServer::do_create_session(SrsRtcUserConfig* ruc, SrsSdp& local
 
     // We allows username is optional, but it never empty here.
     _srs_rtc_manager->add_with_name(username, session);
+    deadlines_.push(std::make_pair(session->deadline(), username));
 
     return err;
 }
@@ -572,33 +573,36 @@ srs_error_t SrsRtcServer::on_timer(srs_utime_t interval)
 {
     srs_error_t err = srs_success;
 
-    // Alive RTC sessions, for stat.
-    int nn_rtc_conns = 0;
+    // Check the sessions in deadline heap, and dispose the dead sessions.
+    srs_utime_t now = srs_get_system_time();
+    while (!deadlines_.empty() && deadlines_.top().first <= now) {
+        string username = deadlines_.top().second;
+        deadlines_.pop();
 
-    // Check all sessions and dispose the dead sessions.
-    for (int i = 0; i < (int)_srs_rtc_manager->size(); i++) {
-        SrsRtcConnection* session = dynamic_cast<SrsRtcConnection*>(_srs_rtc_manager->at(i));
         // Ignore not session, or already disposing.
+        SrsRtcConnection* session = find_session_by_username(username);
         if (!session || session->disposing_) {
             continue;
         }
 
-        // Update stat if session is alive.
+        // Session is alive, update the deadline.
         if (session->is_alive()) {
-            nn_rtc_conns++;
+            deadlines_.push(std::make_pair(session->deadline(), username));
             continue;
         }
 
         SrsContextRestore(_srs_context->get_id());
         session->switch_to_context();
 
-        string username = session->username();
         srs_trace("RTC: session destroy by timeout, username=%s", username.c_str());
 
         // Use manager to free session and notify other objects.
         _srs_rtc_manager->remove(session);
     }
 
+    // RTC sessions, for stat, ignore the sessions which are disposing.
+    int nn_rtc_conns = (int)_srs_rtc_manager->alive();
+
     // Ignore stats if no RTC connections.
     if (!nn_rtc_conns) {
         return err;
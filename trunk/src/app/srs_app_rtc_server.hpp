@@ -17,6 +17,8 @@
 #include <srs_app_rtc_sdp.hpp>
 
 #include <string>
+#include <queue>
+#include <functional>
 
 class SrsRtcServer;
 class SrsHourGlass;
@@ -94,6 +96,12 @@ private:
     std::vector<SrsUdpMuxListener*> listeners;
     ISrsRtcServerHandler* handler;
     ISrsRtcServerHijacker* hijacker;
+private:
+    // The deadline heap of sessions, the value is the username of session. We check the earliest
+    // deadline only, so the cost of timer is proportional to the number of expiring sessions.
+    // @remark The deadline is lazy updated, so we check the session again when it's expired.
+    std::priority_queue< std::pair<srs_utime_t, std::string>, std::vector< std::pair<srs_utime_t, std::string> >,
+        std::greater< std::pair<srs_utime_t, std::string> > > deadlines_;
 public:
     SrsRtcServer();
     virtual ~SrsRtcServer();
@@ -916,6 +916,11 @@ srs_error_t SrsRtcFromRtmpBridger::on_video(SrsSharedPtrMessage* msg)
         return err;
     }
 
+    // WebRTC only support H.264 now, ignore other codecs such as H.265.
+    if (format->vcodec->id != SrsVideoCodecIdAVC) {
+        return err;
+    }
+
     bool has_idr = false;
     vector<SrsSample*> samples;
     if ((err = filter(msg, format, has_idr, samples)) != srs_success) {
@@ -39,6 +39,11 @@ using namespace std;
 #include <srs_protocol_utility.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_app_rtc_source.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_kernel_kbps.hpp>
+
+// The latency of play messages, from dumped from consumer, to sent out.
+SrsHistogram* _srs_latency_send = NULL;
 
 // the timeout in srs_utime_t to wait encoder to republish
 // if timeout, close the connection.
@@ -484,7 +489,7 @@ srs_error_t SrsRtmpConn::stream_service_cycle()
     // do token traverse before serve it.
     // @see https://github.com/ossrs/srs/pull/239
     if (true) {
-        info->edge = _srs_config->get_vhost_is_edge(req->vhost);
+        info->edge = _srs_config->get_vhost_config(req->vhost)->edge;
         bool edge_traverse = _srs_config->get_vhost_edge_token_traverse(req->vhost);
         if (info->edge && edge_traverse) {
             if ((err = check_edge_token_traverse_auth()) != srs_success) {
@@ -504,6 +509,14 @@ srs_error_t SrsRtmpConn::stream_service_cycle()
         return srs_error_new(ERROR_RTMP_STREAM_NAME_EMPTY, "rtmp: empty stream");
     }
 
+    // Pause the player or refuse the publisher when overload.
+    if (info->type == SrsRtmpConnPlay && (err = _srs_circuit_breaker->on_play()) != srs_success) {
+        return srs_error_wrap(err, "rtmp: circuit breaker");
+    }
+    if (srs_client_type_is_publish(info->type) && (err = _srs_circuit_breaker->on_publish()) != srs_success) {
+        return srs_error_wrap(err, "rtmp: circuit breaker");
+    }
+
     // client is identified, set the timeout to service timeout.
     rtmp->set_recv_timeout(SRS_CONSTS_RTMP_TIMEOUT);
     rtmp->set_send_timeout(SRS_CONSTS_RTMP_TIMEOUT);
@@ -521,7 +534,7 @@ srs_error_t SrsRtmpConn::stream_service_cycle()
         return srs_error_wrap(err, "rtmp: stat client");
     }
     
-    bool enabled_cache = _srs_config->get_gop_cache(req->vhost);
+    bool enabled_cache = source->vhost_conf()->gop_cache;
     srs_trace("source url=%s, ip=%s, cache=%d, is_edge=%d, source_id=%s/%s",
         req->get_stream_url().c_str(), ip.c_str(), enabled_cache, info->edge, source->source_id().c_str(), source->pre_source_id().c_str());
     source->set_cache(enabled_cache);
@@ -582,7 +595,7 @@ srs_error_t SrsRtmpConn::check_vhost(bool try_default_vhost)
         return srs_error_new(ERROR_RTMP_VHOST_NOT_FOUND, "rtmp: no vhost %s", req->vhost.c_str());
     }
     
-    if (!_srs_config->get_vhost_enabled(req->vhost)) {
+    if (!_srs_config->get_vhost_config(req->vhost)->enabled) {
         return srs_error_new(ERROR_RTMP_VHOST_NOT_FOUND, "rtmp: vhost %s disabled", req->vhost.c_str());
     }
     
@@ -759,6 +772,8 @@ srs_error_t SrsRtmpConn::do_playing(SrsLiveSource* source, SrsLiveConsumer* cons
         if ((err = consumer->dump_packets(&msgs, count)) != srs_success) {
             return srs_error_wrap(err, "rtmp: consumer dump packets");
         }
+        // The time when dumped, updated by consumer if got messages.
+        srs_utime_t dumptime = srs_get_system_time();
 
         // reportable
         if (pprint->can_print()) {
@@ -797,6 +812,7 @@ srs_error_t SrsRtmpConn::do_playing(SrsLiveSource* source, SrsLiveConsumer* cons
         if (count > 0 && (err = rtmp->send_and_free_messages(msgs.msgs, count, info->res->stream_id)) != srs_success) {
             return srs_error_wrap(err, "rtmp: send %d messages", count);
         }
+        _srs_latency_send->record(srs_update_system_time() - dumptime);
         
         // if duration specified, and exceed it, stop play live.
         // @see: https://github.com/ossrs/srs/issues/45
@@ -885,6 +901,10 @@ srs_error_t SrsRtmpConn::do_publishing(SrsLiveSource* source, SrsPublishRecvThre
             mr, srsu2msi(mr_sleep), srsu2msi(publish_1stpkt_timeout), srsu2msi(publish_normal_timeout), tcp_nodelay);
     }
     
+    // The handle of publisher in stat, to update the frames without lookup.
+    SrsStatistic* stat = SrsStatistic::instance();
+    int64_t handle = stat->find_handle(_srs_context->get_id().c_str());
+    
     int64_t nb_msgs = 0;
     uint64_t nb_frames = 0;
     while (true) {
@@ -917,8 +937,7 @@ srs_error_t SrsRtmpConn::do_publishing(SrsLiveSource* source, SrsPublishRecvThre
         
         // Update the stat for video fps.
         // @remark https://github.com/ossrs/srs/issues/851
-        SrsStatistic* stat = SrsStatistic::instance();
-        if ((err = stat->on_video_frames(req, (int)(rtrd->nb_video_frames() - nb_frames))) != srs_success) {
+        if ((err = stat->on_video_frames(handle, (int)(rtrd->nb_video_frames() - nb_frames))) != srs_success) {
             return srs_error_wrap(err, "rtmp: stat video frames");
         }
         nb_frames = rtrd->nb_video_frames();
@@ -1245,196 +1264,32 @@ srs_error_t SrsRtmpConn::on_disconnect()
 
 srs_error_t SrsRtmpConn::http_hooks_on_connect()
 {
-    srs_error_t err = srs_success;
-    
-    SrsRequest* req = info->req;
-    
-    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
-        return err;
-    }
-    
-    // the http hooks will cause context switch,
-    // so we must copy all hooks for the on_connect may freed.
-    // @see https://github.com/ossrs/srs/issues/475
-    vector<string> hooks;
-    
-    if (true) {
-        SrsConfDirective* conf = _srs_config->get_vhost_on_connect(req->vhost);
-        
-        if (!conf) {
-            return err;
-        }
-        
-        hooks = conf->args;
-    }
-    
-    for (int i = 0; i < (int)hooks.size(); i++) {
-        std::string url = hooks.at(i);
-        if ((err = SrsHttpHooks::on_connect(url, req)) != srs_success) {
-            return srs_error_wrap(err, "rtmp on_connect %s", url.c_str());
-        }
-    }
-    
-    return err;
+    return SrsHttpHooks::on_connect(info->req);
 }
 
 void SrsRtmpConn::http_hooks_on_close()
 {
-    SrsRequest* req = info->req;
-    
-    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
-        return;
-    }
-    
-    // the http hooks will cause context switch,
-    // so we must copy all hooks for the on_connect may freed.
-    // @see https://github.com/ossrs/srs/issues/475
-    vector<string> hooks;
-    
-    if (true) {
-        SrsConfDirective* conf = _srs_config->get_vhost_on_close(req->vhost);
-        
-        if (!conf) {
-            return;
-        }
-        
-        hooks = conf->args;
-    }
-    
-    for (int i = 0; i < (int)hooks.size(); i++) {
-        std::string url = hooks.at(i);
-        SrsHttpHooks::on_close(url, req, kbps->get_send_bytes(), kbps->get_recv_bytes());
-    }
+    SrsHttpHooks::on_close(info->req, kbps->get_send_bytes(), kbps->get_recv_bytes());
 }
 
 srs_error_t SrsRtmpConn::http_hooks_on_publish()
 {
-    srs_error_t err = srs_success;
-    
-    SrsRequest* req = info->req;
-    
-    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
-        return err;
-    }
-    
-    // the http hooks will cause context switch,
-    // so we must copy all hooks for the on_connect may freed.
-    // @see https://github.com/ossrs/srs/issues/475
-    vector<string> hooks;
-    
-    if (true) {
-        SrsConfDirective* conf = _srs_config->get_vhost_on_publish(req->vhost);
-        
-        if (!conf) {
-            return err;
-        }
-        
-        hooks = conf->args;
-    }
-    
-    for (int i = 0; i < (int)hooks.size(); i++) {
-        std::string url = hooks.at(i);
-        if ((err = SrsHttpHooks::on_publish(url, req)) != srs_success) {
-            return srs_error_wrap(err, "rtmp on_publish %s", url.c_str());
-        }
-    }
-    
-    return err;
+    return SrsHttpHooks::on_publish(info->req);
 }
 
 void SrsRtmpConn::http_hooks_on_unpublish()
 {
-    SrsRequest* req = info->req;
-    
-    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
-        return;
-    }
-    
-    // the http hooks will cause context switch,
-    // so we must copy all hooks for the on_connect may freed.
-    // @see https://github.com/ossrs/srs/issues/475
-    vector<string> hooks;
-    
-    if (true) {
-        SrsConfDirective* conf = _srs_config->get_vhost_on_unpublish(req->vhost);
-        
-        if (!conf) {
-            return;
-        }
-        
-        hooks = conf->args;
-    }
-    
-    for (int i = 0; i < (int)hooks.size(); i++) {
-        std::string url = hooks.at(i);
-        SrsHttpHooks::on_unpublish(url, req);
-    }
+    SrsHttpHooks::on_unpublish(info->req);
 }
 
 srs_error_t SrsRtmpConn::http_hooks_on_play()
 {
-    srs_error_t err = srs_success;
-    
-    SrsRequest* req = info->req;
-    
-    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
-        return err;
-    }
-    
-    // the http hooks will cause context switch,
-    // so we must copy all hooks for the on_connect may freed.
-    // @see https://github.com/ossrs/srs/issues/475
-    vector<string> hooks;
-    
-    if (true) {
-        SrsConfDirective* conf = _srs_config->get_vhost_on_play(req->vhost);
-        
-        if (!conf) {
-            return err;
-        }
-        
-        hooks = conf->args;
-    }
-    
-    for (int i = 0; i < (int)hooks.size(); i++) {
-        std::string url = hooks.at(i);
-        if ((err = SrsHttpHooks::on_play(url, req)) != srs_success) {
-            return srs_error_wrap(err, "rtmp on_play %s", url.c_str());
-        }
-    }
-    
-    return err;
+    return SrsHttpHooks::on_play(info->req);
 }
 
 void SrsRtmpConn::http_hooks_on_stop()
 {
-    SrsRequest* req = info->req;
-    
-    if (!_srs_config->get_vhost_http_hooks_enabled(req->vhost)) {
-        return;
-    }
-    
-    // the http hooks will cause context switch,
-    // so we must copy all hooks for the on_connect may freed.
-    // @see https://github.com/ossrs/srs/issues/475
-    vector<string> hooks;
-    
-    if (true) {
-        SrsConfDirective* conf = _srs_config->get_vhost_on_stop(req->vhost);
-        
-        if (!conf) {
-            return;
-        }
-        
-        hooks = conf->args;
-    }
-    
-    for (int i = 0; i < (int)hooks.size(); i++) {
-        std::string url = hooks.at(i);
-        SrsHttpHooks::on_stop(url, req);
-    }
-    
-    return;
+    SrsHttpHooks::on_stop(info->req);
 }
 
 srs_error_t SrsRtmpConn::start()
@@ -25,7 +25,7 @@ using namespace std;
 #include <srs_raw_avc.hpp>
 #include <srs_kernel_codec.hpp>
 #include <srs_app_pithy_print.hpp>
-#include <srs_app_rtmp_conn.hpp>
+#include <srs_app_publisher.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_protocol_format.hpp>
 
@@ -183,7 +183,7 @@ SrsRtspConn::SrsRtspConn(SrsRtspCaster* c, srs_netfd_t fd, std::string o)
     audio_channel = 0;
     
     req = NULL;
-    sdk = NULL;
+    publisher = new SrsLivePublisher();
     vjitter = new SrsRtspJitter();
     ajitter = new SrsRtspJitter();
     
@@ -206,7 +206,7 @@ SrsRtspConn::~SrsRtspConn()
     srs_freep(skt);
     srs_freep(rtsp);
     
-    srs_freep(sdk);
+    srs_freep(publisher);
     srs_freep(req);
     
     srs_freep(vjitter);
@@ -635,15 +635,8 @@ srs_error_t SrsRtspConn::rtmp_write_packet(char type, uint32_t timestamp, char*
         return srs_error_wrap(err, "connect");
     }
     
-    SrsSharedPtrMessage* msg = NULL;
-    
-    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, sdk->sid(), &msg)) != srs_success) {
-        return srs_error_wrap(err, "create message");
-    }
-    srs_assert(msg);
-    
-    // send out encoded msg.
-    if ((err = sdk->send_and_free_message(msg)) != srs_success) {
+    // deliver to source, the data is transferred without copy.
+    if ((err = publisher->on_flv_tag(type, timestamp, data, size)) != srs_success) {
         close();
         return srs_error_wrap(err, "write message");
     }
@@ -655,8 +648,8 @@ srs_error_t SrsRtspConn::connect()
 {
     srs_error_t err = srs_success;
     
-    // Ignore when connected.
-    if (sdk) {
+    // Ignore when publishing.
+    if (publisher->publishing()) {
         return err;
     }
     
@@ -674,19 +667,9 @@ srs_error_t SrsRtspConn::connect()
         url = output;
     }
     
-    // connect host.
-    srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
-    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
-    sdk = new SrsSimpleRtmpClient(url, cto, sto);
-    
-    if ((err = sdk->connect()) != srs_success) {
-        close();
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", url.c_str(), srsu2msi(cto), srsu2msi(sto));
-    }
-    
-    // publish.
-    if ((err = sdk->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
-        close();
+    // publish to source.
+    std::string ip = srs_get_peer_ip(srs_netfd_fileno(stfd));
+    if ((err = publisher->publish(url, ip)) != srs_success) {
         return srs_error_wrap(err, "publish %s failed", url.c_str());
     }
     
@@ -695,7 +678,7 @@ srs_error_t SrsRtspConn::connect()
 
 void SrsRtspConn::close()
 {
-    srs_freep(sdk);
+    publisher->unpublish();
 }
 
 SrsRtspCaster::SrsRtspCaster(SrsConfDirective* c)
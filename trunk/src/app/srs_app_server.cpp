@@ -16,6 +16,8 @@
 #ifndef SRS_OSX
 #include <sys/inotify.h>
 #endif
+
+#include <st.h>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
@@ -37,6 +39,11 @@ using namespace std;
 #include <srs_app_coworkers.hpp>
 #include <srs_service_log.hpp>
 #include <srs_app_latest_version.hpp>
+#include <srs_app_shm.hpp>
+
+// The max number of packets to receive in a batch for UDP stream caster, for there might be many
+// senders to one port, each packet uses a 64KB buffer.
+#define SRS_UDP_CASTER_RECV_BATCH 16
 
 std::string srs_listener_type2string(SrsListenerType type)
 {
@@ -255,7 +262,7 @@ srs_error_t SrsUdpStreamListener::listen(string i, int p)
     port = p;
     
     srs_freep(listener);
-    listener = new SrsUdpListener(caster, ip, port);
+    listener = new SrsUdpListener(caster, ip, port, SRS_UDP_CASTER_RECV_BATCH);
     
     if ((err = listener->listen()) != srs_success) {
         return srs_error_wrap(err, "listen %s:%d", ip.c_str(), port);
@@ -706,6 +713,10 @@ srs_error_t SrsServer::initialize(ISrsServerCycle* ch)
     if ((err = http_server->initialize()) != srs_success) {
         return srs_error_wrap(err, "http server initialize");
     }
+
+    if ((err = _srs_admission->initialize(this)) != srs_success) {
+        return srs_error_wrap(err, "admission initialize");
+    }
     
     return err;
 }
@@ -722,6 +733,32 @@ srs_error_t SrsServer::initialize_st()
     
     srs_trace("server main cid=%s, pid=%d, ppid=%d, asprocess=%d",
         _srs_context->get_id().c_str(), ::getpid(), ppid, asprocess);
+
+    // Setup the stacks of coroutines, for the coroutines to create.
+    int stack_pool = _srs_config->get_coroutine_stack_pool();
+    bool stack_guard = _srs_config->get_coroutine_stack_guard();
+    bool stack_watermark = _srs_config->get_coroutine_stack_watermark();
+    st_set_stack_pool(stack_pool);
+    st_set_stack_guard(stack_guard);
+    st_set_stack_watermark(stack_watermark);
+
+    SrsConfDirective* stack_sizes = _srs_config->get_coroutine_stack_sizes();
+    for (int i = 0; stack_sizes && i < (int)stack_sizes->directives.size(); i++) {
+        SrsConfDirective* conf = stack_sizes->at(i);
+        _srs_stacks->set_stack_size(conf->name, ::atoi(conf->arg0().c_str()));
+    }
+    srs_trace("coroutine stack pool=%d, guard=%d, watermark=%d, sizes=%d", stack_pool, stack_guard,
+        stack_watermark, (stack_sizes ? (int)stack_sizes->directives.size() : 0));
+    
+    // Remove the stale shared memory rings, left by the crashed processes.
+    std::vector<SrsConfDirective*> vhosts;
+    _srs_config->get_vhosts(vhosts);
+    for (int i = 0; i < (int)vhosts.size(); i++) {
+        std::string vhost = vhosts[i]->arg0();
+        if (_srs_config->get_shm_fanout_enabled(vhost)) {
+            srs_shm_reclaim(_srs_config->get_shm_fanout_dir(vhost));
+        }
+    }
     
     return err;
 }
@@ -897,6 +934,15 @@ srs_error_t SrsServer::http_handle()
     if ((err = http_api_mux->handle("/api/v1/clients/", new SrsGoApiClients())) != srs_success) {
         return srs_error_wrap(err, "handle clients");
     }
+    if ((err = http_api_mux->handle("/api/v1/cpu", new SrsGoApiCpu())) != srs_success) {
+        return srs_error_wrap(err, "handle cpu");
+    }
+    if ((err = http_api_mux->handle("/api/v1/latency", new SrsGoApiLatency())) != srs_success) {
+        return srs_error_wrap(err, "handle latency");
+    }
+    if ((err = http_api_mux->handle("/metrics", new SrsGoApiMetrics())) != srs_success) {
+        return srs_error_wrap(err, "handle metrics");
+    }
     if ((err = http_api_mux->handle("/api/v1/raw", new SrsGoApiRaw(this))) != srs_success) {
         return srs_error_wrap(err, "handle raw");
     }
@@ -1393,25 +1439,42 @@ void SrsServer::resample_kbps()
 {
     SrsStatistic* stat = SrsStatistic::instance();
     
-    // collect delta from all clients.
-    for (int i = 0; i < (int)conn_manager->size(); i++) {
-        ISrsResource* c = conn_manager->at(i);
-        ISrsKbpsDelta* conn = dynamic_cast<ISrsKbpsDelta*>(conn_manager->at(i));
-        
-        // add delta of connection to server kbps.,
-        // for next sample() of server kbps can get the stat.
-        stat->kbps_add_delta(c->get_id().c_str(), conn);
-    }
-    
+    // collect delta from all clients, and sample the kbps, get the stat.
     // TODO: FXME: support all other connections.
-    
-    // sample the kbps, get the stat.
     SrsKbps* kbps = stat->kbps_sample();
     
     srs_update_rtmp_server((int)conn_manager->size(), kbps);
 }
 
 srs_error_t SrsServer::accept_client(SrsListenerType type, srs_netfd_t stfd)
+{
+    // Admission control for accept storm, except the HTTP API for operators.
+    if (type == SrsListenerRtmpStream || type == SrsListenerHttpStream || type == SrsListenerHttpsStream) {
+        // Never get the peer ip if admission is disabled, which is a syscall for each client.
+        string ip = _srs_admission->enabled() ? srs_get_peer_ip(srs_netfd_fileno(stfd)) : "";
+        SrsAdmissionResult r = _srs_admission->admit(ip, type, stfd);
+
+        // The client is deferred, util it's admitted, see on_admit_client.
+        if (r == SrsAdmissionDefer) {
+            return srs_success;
+        }
+
+        // Close the rejected client silently, which is counted in stat of admission.
+        if (r == SrsAdmissionReject) {
+            srs_close_stfd(stfd);
+            return srs_success;
+        }
+    }
+
+    return do_accept_client(type, stfd);
+}
+
+srs_error_t SrsServer::on_admit_client(int type, srs_netfd_t stfd)
+{
+    return do_accept_client((SrsListenerType)type, stfd);
+}
+
+srs_error_t SrsServer::do_accept_client(SrsListenerType type, srs_netfd_t stfd)
 {
     srs_error_t err = srs_success;
     
@@ -1504,10 +1567,8 @@ srs_error_t SrsServer::fd_to_resource(SrsListenerType type, srs_netfd_t stfd, IS
 
 void SrsServer::remove(ISrsResource* c)
 {
-    ISrsStartableConneciton* conn = dynamic_cast<ISrsStartableConneciton*>(c);
-
+    // Collect the last delta of kbps, before the connection is freed.
     SrsStatistic* stat = SrsStatistic::instance();
-    stat->kbps_add_delta(c->get_id().c_str(), conn);
     stat->on_disconnect(c->get_id().c_str());
 
     // use manager to free it async.
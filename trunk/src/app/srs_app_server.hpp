@@ -20,6 +20,7 @@
 #include <srs_app_conn.hpp>
 #include <srs_service_st.hpp>
 #include <srs_app_hourglass.hpp>
+#include <srs_app_admission.hpp>
 
 class SrsServer;
 class SrsHttpServeMux;
@@ -212,7 +213,7 @@ public:
 // SRS RTMP server, initialize and listen, start connection service thread, destroy client.
 class SrsServer : public ISrsReloadHandler, public ISrsLiveSourceHandler
     , public ISrsResourceManager, public ISrsCoroutineHandler
-    , public ISrsHourGlass
+    , public ISrsHourGlass, public ISrsAdmissionHandler
 {
 private:
     // TODO: FIXME: Extract an HttpApiServer.
@@ -323,7 +324,11 @@ public:
     // TODO: FIXME: Fetch from hybrid server manager.
     virtual SrsHttpServeMux* api_server();
 private:
+    virtual srs_error_t do_accept_client(SrsListenerType type, srs_netfd_t stfd);
     virtual srs_error_t fd_to_resource(SrsListenerType type, srs_netfd_t stfd, ISrsStartableConneciton** pr);
+// Interface ISrsAdmissionHandler
+public:
+    virtual srs_error_t on_admit_client(int type, srs_netfd_t stfd);
 // Interface ISrsResourceManager
 public:
     // A callback for connection to remove itself.
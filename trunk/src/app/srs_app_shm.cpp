@@ -0,0 +1,713 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#include <srs_app_shm.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+using namespace std;
+
+#include <srs_kernel_error.hpp>
+#include <srs_kernel_log.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_protocol_utility.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_app_config.hpp>
+
+// The magic of ring file, the "SRSR" in ASCII.
+#define SRS_SHM_MAGIC 0x53525352
+#define SRS_SHM_VERSION 1
+
+// The ring file is named as prefix + crc32(url) + suffix.
+#define SRS_SHM_PREFIX "srs-shm-"
+#define SRS_SHM_SUFFIX ".ring"
+
+// The bytes of ring header, page aligned.
+#define SRS_SHM_HEADER_SIZE 4096
+// The bytes of each sequence header slot.
+#define SRS_SHM_SLOT_SIZE (64 * 1024)
+// The min bytes of ring data.
+#define SRS_SHM_MIN_CAPACITY (256 * 1024)
+
+// The max retry to read a slot when writer is updating it.
+#define SRS_SHM_SLOT_RETRY 1024
+
+// The interval for writer to try to own the ring, when sibling owns it.
+#define SRS_SHM_OWN_INTERVAL (3 * SRS_UTIME_SECONDS)
+
+// The message type of padding record, to skip the tail of ring.
+#define SRS_SHM_PADDING 0
+
+// The record of message in ring, followed by the payload.
+struct SrsShmRecord
+{
+    int32_t size;
+    int16_t type;
+    int16_t keyframe;
+    int64_t timestamp;
+};
+
+// All records are aligned to 8 bytes.
+#define srs_shm_align(x) (((x) + 7) & ~7)
+
+// The max bytes of a record, to never overwrite the record which reader is copying.
+#define srs_shm_max_record(capacity) ((capacity) / 4)
+// The max distance of reader behind writer. The writer skips the tail of ring and writes a record,
+// which takes up to half of ring, so the record of reader must be out of it.
+#define srs_shm_safe_window(capacity) ((capacity) / 2 - srs_shm_max_record(capacity))
+
+// Whether the process is alive, never be ourself.
+bool srs_shm_pid_alive(int pid)
+{
+    if (pid <= 0 || pid == ::getpid()) {
+        return false;
+    }
+
+    return ::kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// Read the header of ring file, without mapping it.
+srs_error_t srs_shm_read_header(string path, SrsShmRingHeader* h)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return srs_error_new(ERROR_SHM_OPEN, "open %s", path.c_str());
+    }
+
+    ssize_t nn = ::pread(fd, h, sizeof(SrsShmRingHeader), 0);
+    ::close(fd);
+
+    if (nn != (ssize_t)sizeof(SrsShmRingHeader) || h->magic != SRS_SHM_MAGIC || h->version != SRS_SHM_VERSION) {
+        return srs_error_new(ERROR_SHM_INVALID, "invalid ring %s, nn=%d", path.c_str(), (int)nn);
+    }
+
+    return srs_success;
+}
+
+SrsCommonMessage* srs_shm_create_message(int type, int64_t timestamp, char* payload, int size)
+{
+    SrsCommonMessage* msg = new SrsCommonMessage();
+
+    if (type == RTMP_MSG_AudioMessage) {
+        msg->header.initialize_audio(size, 0, 1);
+    } else if (type == RTMP_MSG_VideoMessage) {
+        msg->header.initialize_video(size, 0, 1);
+    } else {
+        msg->header.initialize_amf0_script(size, 1);
+        msg->header.message_type = type;
+    }
+    msg->header.timestamp = timestamp;
+    msg->header.timestamp_delta = (int32_t)timestamp;
+
+    if (size > 0) {
+        msg->create_payload(size);
+        memcpy(msg->payload, payload, size);
+    }
+    msg->size = size;
+
+    return msg;
+}
+
+SrsShmRing::SrsShmRing()
+{
+    fd_ = -1;
+    owner_ = false;
+    data_ = NULL;
+    nn_data_ = 0;
+    header_ = NULL;
+    slots_ = NULL;
+    ring_ = NULL;
+    read_pos_ = 0;
+    nn_overrun_ = 0;
+}
+
+SrsShmRing::~SrsShmRing()
+{
+    close();
+}
+
+srs_error_t SrsShmRing::create(string path, string url, int size)
+{
+    srs_error_t err = srs_success;
+
+    srs_assert(fd_ < 0);
+    srs_assert(sizeof(SrsShmRingHeader) <= SRS_SHM_HEADER_SIZE);
+
+    path_ = path;
+    url_ = url;
+
+    // Create the file exclusively, remove it if the owner is dead.
+    for (int i = 0; i < 2 && fd_ < 0; i++) {
+        if ((fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644)) >= 0) {
+            break;
+        }
+
+        if (errno != EEXIST) {
+            return srs_error_new(ERROR_SHM_OPEN, "create %s", path.c_str());
+        }
+
+        SrsShmRingHeader h;
+        if ((err = srs_shm_read_header(path, &h)) != srs_success) {
+            srs_freep(err);
+        } else if (!h.closed && srs_shm_pid_alive(h.pid)) {
+            return srs_error_new(ERROR_SHM_OPEN, "%s owned by pid=%d", path.c_str(), h.pid);
+        }
+
+        srs_warn("shm: remove stale ring %s", path.c_str());
+        ::unlink(path.c_str());
+    }
+
+    if (fd_ < 0) {
+        return srs_error_new(ERROR_SHM_OPEN, "create %s", path.c_str());
+    }
+    owner_ = true;
+
+    int64_t capacity = srs_shm_align(srs_max(size, SRS_SHM_MIN_CAPACITY));
+    nn_data_ = SRS_SHM_HEADER_SIZE + SRS_SHM_SLOT_SIZE * SrsShmSlotMax + capacity;
+    if (::ftruncate(fd_, nn_data_) != 0) {
+        return srs_error_new(ERROR_SHM_OPEN, "truncate %s to %" PRId64, path.c_str(), nn_data_);
+    }
+
+    if ((err = map(PROT_READ | PROT_WRITE)) != srs_success) {
+        return srs_error_wrap(err, "map");
+    }
+
+    // The file is zero filled, set the magic at last, so reader never see a partial header.
+    header_->version = SRS_SHM_VERSION;
+    header_->pid = ::getpid();
+    header_->capacity = capacity;
+    header_->heartbeat = srs_get_system_time();
+    snprintf(header_->url, sizeof(header_->url), "%s", url.c_str());
+    __sync_synchronize();
+    header_->magic = SRS_SHM_MAGIC;
+
+    return err;
+}
+
+srs_error_t SrsShmRing::attach(string path, string url)
+{
+    srs_error_t err = srs_success;
+
+    srs_assert(fd_ < 0);
+
+    path_ = path;
+    url_ = url;
+
+    if ((fd_ = ::open(path.c_str(), O_RDONLY)) < 0) {
+        return srs_error_new(ERROR_SHM_OPEN, "open %s", path.c_str());
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || st.st_size < SRS_SHM_HEADER_SIZE + SRS_SHM_SLOT_SIZE * SrsShmSlotMax) {
+        return srs_error_new(ERROR_SHM_INVALID, "invalid size of %s", path.c_str());
+    }
+    nn_data_ = st.st_size;
+
+    if ((err = map(PROT_READ)) != srs_success) {
+        return srs_error_wrap(err, "map");
+    }
+
+    if (header_->magic != SRS_SHM_MAGIC || header_->version != SRS_SHM_VERSION) {
+        return srs_error_new(ERROR_SHM_INVALID, "invalid magic=%#x, version=%d", header_->magic, header_->version);
+    }
+
+    if (SRS_SHM_HEADER_SIZE + SRS_SHM_SLOT_SIZE * SrsShmSlotMax + header_->capacity != nn_data_) {
+        return srs_error_new(ERROR_SHM_INVALID, "invalid capacity=%" PRId64 ", size=%" PRId64, header_->capacity, nn_data_);
+    }
+
+    if (strncmp(header_->url, url.c_str(), sizeof(header_->url)) != 0) {
+        return srs_error_new(ERROR_SHM_INVALID, "url %s not match %s", header_->url, url.c_str());
+    }
+
+    // Never attach to the ring of ourself, or the dead or closed owner, which is never updated.
+    if (header_->closed || !srs_shm_pid_alive(header_->pid)) {
+        return srs_error_new(ERROR_SHM_INVALID, "ring %s not alive, pid=%d, closed=%d", path.c_str(), header_->pid, header_->closed);
+    }
+
+    // Start from the last keyframe, if it's still in ring.
+    uint64_t kf = header_->keyframe_pos;
+    __sync_synchronize();
+    uint64_t wp = header_->write_pos;
+    read_pos_ = (wp - kf <= (uint64_t)srs_shm_safe_window(header_->capacity)) ? kf : wp;
+
+    return err;
+}
+
+void SrsShmRing::close()
+{
+    // Remove the file only if it's still ours, it might be replaced if we were treated as dead.
+    if (owner_ && header_) {
+        header_->closed = 1;
+        __sync_synchronize();
+
+        struct stat st0, st1;
+        if (::fstat(fd_, &st0) == 0 && ::stat(path_.c_str(), &st1) == 0 && st0.st_ino == st1.st_ino) {
+            ::unlink(path_.c_str());
+        }
+    }
+
+    if (data_) {
+        ::munmap(data_, nn_data_);
+    }
+
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+
+    fd_ = -1;
+    owner_ = false;
+    data_ = NULL;
+    header_ = NULL;
+    slots_ = NULL;
+    ring_ = NULL;
+}
+
+bool SrsShmRing::alive()
+{
+    if (!header_ || header_->closed) {
+        return false;
+    }
+
+    return owner_ || srs_shm_pid_alive(header_->pid);
+}
+
+bool SrsShmRing::owner()
+{
+    return owner_;
+}
+
+int SrsShmRing::nn_overrun()
+{
+    return nn_overrun_;
+}
+
+srs_error_t SrsShmRing::write(int type, int64_t timestamp, char* payload, int size, bool keyframe)
+{
+    if (!owner_ || !header_) {
+        return srs_error_new(ERROR_SHM_INVALID, "not owner");
+    }
+
+    // The message must be small enough, to never overwrite the record which reader is copying.
+    int64_t capacity = header_->capacity;
+    int nn = srs_shm_align((int)sizeof(SrsShmRecord) + size);
+    if (nn > srs_shm_max_record(capacity)) {
+        return srs_error_new(ERROR_SHM_INVALID, "message %dB too large, capacity=%" PRId64, size, capacity);
+    }
+
+    uint64_t wp = header_->write_pos;
+    int64_t pos = wp % capacity;
+
+    // No space at the tail, skip to the head of ring.
+    if (pos + nn > capacity) {
+        if (capacity - pos >= (int64_t)sizeof(SrsShmRecord)) {
+            SrsShmRecord* padding = (SrsShmRecord*)(ring_ + pos);
+            padding->size = 0;
+            padding->type = SRS_SHM_PADDING;
+        }
+        wp += capacity - pos;
+        pos = 0;
+    }
+
+    SrsShmRecord* rec = (SrsShmRecord*)(ring_ + pos);
+    rec->size = size;
+    rec->type = (int16_t)type;
+    rec->keyframe = keyframe;
+    rec->timestamp = timestamp;
+    memcpy(ring_ + pos + sizeof(SrsShmRecord), payload, size);
+
+    // Publish the record to readers.
+    __sync_synchronize();
+    if (keyframe) {
+        header_->keyframe_pos = wp;
+    }
+    header_->write_pos = wp + nn;
+    header_->heartbeat = srs_get_system_time();
+
+    return srs_success;
+}
+
+srs_error_t SrsShmRing::write_slot(SrsShmSlot slot, int type, int64_t timestamp, char* payload, int size)
+{
+    if (!owner_ || !header_) {
+        return srs_error_new(ERROR_SHM_INVALID, "not owner");
+    }
+
+    if (size > SRS_SHM_SLOT_SIZE) {
+        return srs_error_new(ERROR_SHM_INVALID, "slot %d overflow %dB", slot, size);
+    }
+
+    SrsShmRingSlot* s = &header_->slots[slot];
+
+    s->generation++;
+    __sync_synchronize();
+
+    memcpy(slots_ + slot * SRS_SHM_SLOT_SIZE, payload, size);
+    s->size = size;
+    s->type = type;
+    s->timestamp = timestamp;
+
+    __sync_synchronize();
+    s->generation++;
+
+    return srs_success;
+}
+
+srs_error_t SrsShmRing::read_slots(vector<SrsCommonMessage*>& msgs)
+{
+    srs_error_t err = srs_success;
+
+    for (int i = 0; i < SrsShmSlotMax; i++) {
+        SrsCommonMessage* msg = NULL;
+        if ((err = read_slot((SrsShmSlot)i, &msg)) != srs_success) {
+            return srs_error_wrap(err, "slot %d", i);
+        }
+
+        if (msg) {
+            msgs.push_back(msg);
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsShmRing::read(SrsCommonMessage** pmsg)
+{
+    *pmsg = NULL;
+
+    if (!header_) {
+        return srs_error_new(ERROR_SHM_INVALID, "not attached");
+    }
+
+    uint64_t capacity = (uint64_t)header_->capacity;
+    // Reader must be behind writer in the window, which writer never overwrites.
+    uint64_t safe = (uint64_t)srs_shm_safe_window(header_->capacity);
+
+    while (true) {
+        uint64_t kf = header_->keyframe_pos;
+        __sync_synchronize();
+        uint64_t wp = header_->write_pos;
+        __sync_synchronize();
+
+        if (read_pos_ == wp) {
+            return srs_success;
+        }
+
+        // Overrun by writer, skip to the last keyframe.
+        if (wp - read_pos_ > safe) {
+            nn_overrun_++;
+            read_pos_ = (wp - kf <= safe) ? kf : wp;
+            continue;
+        }
+
+        uint64_t pos = read_pos_ % capacity;
+        if (capacity - pos < sizeof(SrsShmRecord)) {
+            read_pos_ += capacity - pos;
+            continue;
+        }
+
+        // Like seqlock, check the writer before and after copying, discard it if overwritten.
+        SrsShmRecord rec;
+        memcpy(&rec, ring_ + pos, sizeof(SrsShmRecord));
+
+        __sync_synchronize();
+        if (header_->write_pos - read_pos_ > safe) {
+            continue;
+        }
+
+        if (rec.type == SRS_SHM_PADDING) {
+            read_pos_ += capacity - pos;
+            continue;
+        }
+
+        if (rec.size < 0 || pos + sizeof(SrsShmRecord) + rec.size > capacity) {
+            return srs_error_new(ERROR_SHM_INVALID, "invalid record size=%d at %" PRId64, rec.size, (int64_t)pos);
+        }
+
+        SrsCommonMessage* msg = srs_shm_create_message(rec.type, rec.timestamp, ring_ + pos + sizeof(SrsShmRecord), rec.size);
+
+        __sync_synchronize();
+        if (header_->write_pos - read_pos_ > safe) {
+            srs_freep(msg);
+            continue;
+        }
+
+        read_pos_ += srs_shm_align(sizeof(SrsShmRecord) + rec.size);
+        *pmsg = msg;
+        return srs_success;
+    }
+}
+
+srs_error_t SrsShmRing::map(int flags)
+{
+    void* p = ::mmap(NULL, nn_data_, flags, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        return srs_error_new(ERROR_SHM_MMAP, "mmap %s size=%" PRId64, path_.c_str(), nn_data_);
+    }
+
+    data_ = (char*)p;
+    header_ = (SrsShmRingHeader*)data_;
+    slots_ = data_ + SRS_SHM_HEADER_SIZE;
+    ring_ = slots_ + SRS_SHM_SLOT_SIZE * SrsShmSlotMax;
+
+    return srs_success;
+}
+
+srs_error_t SrsShmRing::read_slot(SrsShmSlot slot, SrsCommonMessage** pmsg)
+{
+    SrsShmRingSlot* s = &header_->slots[slot];
+
+    for (int i = 0; i < SRS_SHM_SLOT_RETRY; i++) {
+        uint32_t generation = s->generation;
+        __sync_synchronize();
+
+        // Writer is updating the slot.
+        if ((generation & 0x01) != 0) {
+            continue;
+        }
+
+        int size = s->size;
+        if (size <= 0 || size > SRS_SHM_SLOT_SIZE) {
+            return srs_success;
+        }
+
+        SrsCommonMessage* msg = srs_shm_create_message(s->type, s->timestamp, slots_ + slot * SRS_SHM_SLOT_SIZE, size);
+
+        __sync_synchronize();
+        if (generation == s->generation) {
+            *pmsg = msg;
+            return srs_success;
+        }
+
+        srs_freep(msg);
+    }
+
+    return srs_error_new(ERROR_SHM_TIMEOUT, "slot %d busy", slot);
+}
+
+string srs_shm_ring_path(string dir, string url)
+{
+    uint32_t crc = srs_crc32_ieee(url.data(), (int)url.length());
+
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%08x", crc);
+
+    return dir + "/" + SRS_SHM_PREFIX + buf + SRS_SHM_SUFFIX;
+}
+
+bool srs_shm_ring_alive(string dir, string url)
+{
+    srs_error_t err = srs_success;
+
+    SrsShmRingHeader h;
+    if ((err = srs_shm_read_header(srs_shm_ring_path(dir, url), &h)) != srs_success) {
+        srs_freep(err);
+        return false;
+    }
+
+    if (strncmp(h.url, url.c_str(), sizeof(h.url)) != 0) {
+        return false;
+    }
+
+    return !h.closed && srs_shm_pid_alive(h.pid);
+}
+
+void srs_shm_reclaim(string dir)
+{
+    DIR* d = ::opendir(dir.c_str());
+    if (!d) {
+        return;
+    }
+
+    struct dirent* ent = NULL;
+    while ((ent = ::readdir(d)) != NULL) {
+        string name = ent->d_name;
+        if (!srs_string_starts_with(name, SRS_SHM_PREFIX) || !srs_string_ends_with(name, SRS_SHM_SUFFIX)) {
+            continue;
+        }
+
+        string path = dir + "/" + name;
+
+        SrsShmRingHeader h;
+        srs_error_t err = srs_shm_read_header(path, &h);
+        if (err != srs_success) {
+            srs_freep(err);
+            continue;
+        }
+
+        if (h.closed || !srs_shm_pid_alive(h.pid)) {
+            srs_trace("shm: reclaim ring %s of pid=%d, url=%.*s", path.c_str(), h.pid, (int)sizeof(h.url), h.url);
+            ::unlink(path.c_str());
+        }
+    }
+
+    ::closedir(d);
+}
+
+SrsShmWriter::SrsShmWriter()
+{
+    req = NULL;
+    ring = NULL;
+    enabled = false;
+    last_try = 0;
+    meta = vsh = ash = NULL;
+}
+
+SrsShmWriter::~SrsShmWriter()
+{
+    on_unpublish();
+}
+
+srs_error_t SrsShmWriter::initialize(SrsRequest* r)
+{
+    req = r;
+    return srs_success;
+}
+
+srs_error_t SrsShmWriter::on_publish()
+{
+    enabled = _srs_config->get_shm_fanout_enabled(req->vhost);
+    last_try = 0;
+
+    if (enabled) {
+        try_own();
+    }
+
+    return srs_success;
+}
+
+void SrsShmWriter::on_unpublish()
+{
+    if (ring) {
+        srs_trace("shm: stop fanout %s, overrun=%d", req->get_stream_url().c_str(), ring->nn_overrun());
+    }
+
+    srs_freep(ring);
+    srs_freep(meta);
+    srs_freep(vsh);
+    srs_freep(ash);
+    enabled = false;
+}
+
+srs_error_t SrsShmWriter::on_meta_data(SrsSharedPtrMessage* shared_metadata)
+{
+    if (!enabled) {
+        return srs_success;
+    }
+
+    srs_freep(meta);
+    meta = shared_metadata->copy();
+
+    return write(SrsShmSlotMetadata, RTMP_MSG_AMF0DataMessage, shared_metadata, false);
+}
+
+srs_error_t SrsShmWriter::on_audio(SrsSharedPtrMessage* shared_audio)
+{
+    if (!enabled) {
+        return srs_success;
+    }
+
+    if (SrsFlvAudio::sh(shared_audio->payload, shared_audio->size)) {
+        srs_freep(ash);
+        ash = shared_audio->copy();
+        return write(SrsShmSlotAudioSh, RTMP_MSG_AudioMessage, shared_audio, false);
+    }
+
+    return write(SrsShmSlotMax, RTMP_MSG_AudioMessage, shared_audio, false);
+}
+
+srs_error_t SrsShmWriter::on_video(SrsSharedPtrMessage* shared_video, bool is_sequence_header)
+{
+    if (!enabled) {
+        return srs_success;
+    }
+
+    if (is_sequence_header) {
+        srs_freep(vsh);
+        vsh = shared_video->copy();
+        return write(SrsShmSlotVideoSh, RTMP_MSG_VideoMessage, shared_video, false);
+    }
+
+    bool keyframe = SrsFlvVideo::keyframe(shared_video->payload, shared_video->size);
+    return write(SrsShmSlotMax, RTMP_MSG_VideoMessage, shared_video, keyframe);
+}
+
+srs_error_t SrsShmWriter::write(SrsShmSlot slot, int type, SrsSharedPtrMessage* msg, bool keyframe)
+{
+    srs_error_t err = srs_success;
+
+    if (!try_own()) {
+        return err;
+    }
+
+    if (slot != SrsShmSlotMax) {
+        err = ring->write_slot(slot, type, msg->timestamp, msg->payload, msg->size);
+    }
+
+    if (err == srs_success) {
+        err = ring->write(type, msg->timestamp, msg->payload, msg->size, keyframe);
+    }
+
+    // Never fail the stream for fanout, the message is dropped for sibling processes.
+    if (err != srs_success) {
+        srs_warn("shm: ignore message, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+
+    return srs_success;
+}
+
+bool SrsShmWriter::try_own()
+{
+    srs_error_t err = srs_success;
+
+    if (ring) {
+        return true;
+    }
+
+    srs_utime_t now = srs_get_system_time();
+    if (last_try && now - last_try < SRS_SHM_OWN_INTERVAL) {
+        return false;
+    }
+    last_try = now;
+
+    string dir = _srs_config->get_shm_fanout_dir(req->vhost);
+    string url = req->get_stream_url();
+    int size = _srs_config->get_shm_fanout_size(req->vhost);
+
+    ring = new SrsShmRing();
+    if ((err = ring->create(srs_shm_ring_path(dir, url), url, size)) != srs_success) {
+        srs_info("shm: ignore own %s, %s", url.c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+        srs_freep(ring);
+        return false;
+    }
+
+    // Restore the sequence headers, when we own the ring in the middle of stream.
+    SrsSharedPtrMessage* shs[] = {meta, vsh, ash};
+    int types[] = {RTMP_MSG_AMF0DataMessage, RTMP_MSG_VideoMessage, RTMP_MSG_AudioMessage};
+    for (int i = 0; i < SrsShmSlotMax; i++) {
+        SrsSharedPtrMessage* msg = shs[i];
+        if (msg && (err = ring->write_slot((SrsShmSlot)i, types[i], msg->timestamp, msg->payload, msg->size)) != srs_success) {
+            srs_warn("shm: ignore slot %d, %s", i, srs_error_desc(err).c_str());
+            srs_freep(err);
+        }
+    }
+
+    srs_trace("shm: fanout %s to %s, size=%dKB", url.c_str(), srs_shm_ring_path(dir, url).c_str(), size / 1024);
+
+    return true;
+}
+
@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2013-2021 Winlin
+//
+// SPDX-License-Identifier: MIT
+//
+
+#ifndef SRS_APP_SHM_HPP
+#define SRS_APP_SHM_HPP
+
+#include <srs_core.hpp>
+
+#include <string>
+#include <vector>
+
+class SrsRequest;
+class SrsCommonMessage;
+class SrsSharedPtrMessage;
+
+// The index of sequence header slots in ring.
+enum SrsShmSlot
+{
+    SrsShmSlotMetadata = 0,
+    SrsShmSlotVideoSh = 1,
+    SrsShmSlotAudioSh = 2,
+    SrsShmSlotMax = 3,
+};
+
+// The sequence header slot, updated by seqlock, for reader to start from.
+struct SrsShmRingSlot
+{
+    // Odd when writer is updating the slot, even when it's stable.
+    volatile uint32_t generation;
+    volatile int32_t size;
+    volatile int64_t timestamp;
+    volatile int32_t type;
+    int32_t reserved;
+};
+
+// The header of ring file, at the beginning of the mapped memory.
+struct SrsShmRingHeader
+{
+    volatile uint32_t magic;
+    uint32_t version;
+    // The pid of owner process, which is the only writer.
+    volatile int32_t pid;
+    // Set to 1 when owner stop publishing.
+    volatile int32_t closed;
+    // The bytes of ring data.
+    int64_t capacity;
+    // The monotonically increasing position of writer and the last keyframe.
+    volatile uint64_t write_pos;
+    volatile uint64_t keyframe_pos;
+    // The last time the owner write to ring, in srs_utime_t.
+    volatile int64_t heartbeat;
+    // The stream url, to verify the ring for reader.
+    char url[256];
+    SrsShmRingSlot slots[SrsShmSlotMax];
+};
+
+// The shared memory ring of a live stream, to fan out the stream to sibling processes on the
+// same host, for example, the processes listen at the same port by SO_REUSEPORT.
+// The owner process writes messages to ring, while other processes attach the ring and read
+// messages from it, so only one process pulls the stream from origin or publisher.
+// @remark The ring is single writer and multiple readers, and lock free. Reader never blocks
+//      the writer, if reader is too slow and overrun, it skips to the last keyframe.
+class SrsShmRing
+{
+private:
+    std::string path_;
+    std::string url_;
+    int fd_;
+    bool owner_;
+    // The whole mapped memory, and the size of it.
+    char* data_;
+    int64_t nn_data_;
+    SrsShmRingHeader* header_;
+    // The data of sequence header slots.
+    char* slots_;
+    // The data of ring.
+    char* ring_;
+    // For reader, the position to read from.
+    uint64_t read_pos_;
+    // For reader, the number of overrun.
+    int nn_overrun_;
+public:
+    SrsShmRing();
+    virtual ~SrsShmRing();
+public:
+    // Create the ring as owner, fail if the ring is owned by other alive process.
+    // @param size The bytes of ring data.
+    virtual srs_error_t create(std::string path, std::string url, int size);
+    // Attach to the ring as reader, start from the last keyframe.
+    virtual srs_error_t attach(std::string path, std::string url);
+    // Detach or destroy the ring, the owner marks it closed and removes the file.
+    virtual void close();
+    // Whether the owner is alive and not closed.
+    virtual bool alive();
+    virtual bool owner();
+    virtual int nn_overrun();
+// For writer.
+public:
+    // Write a message to ring.
+    // @param keyframe Whether the message is a video keyframe, reader starts from it.
+    virtual srs_error_t write(int type, int64_t timestamp, char* payload, int size, bool keyframe);
+    // Update the sequence header slot, the metadata, video or audio sequence header.
+    virtual srs_error_t write_slot(SrsShmSlot slot, int type, int64_t timestamp, char* payload, int size);
+// For reader.
+public:
+    // Read the sequence header slots, ignore the empty slots.
+    virtual srs_error_t read_slots(std::vector<SrsCommonMessage*>& msgs);
+    // Read a message from ring, set to NULL if no message.
+    virtual srs_error_t read(SrsCommonMessage** pmsg);
+private:
+    virtual srs_error_t map(int flags);
+    virtual srs_error_t read_slot(SrsShmSlot slot, SrsCommonMessage** pmsg);
+};
+
+// Get the path of ring file of stream url, in directory dir.
+extern std::string srs_shm_ring_path(std::string dir, std::string url);
+// Whether the ring of stream is owned by another alive process.
+extern bool srs_shm_ring_alive(std::string dir, std::string url);
+// Remove the stale ring files whose owner process is dead, for example, killed by SIGKILL.
+extern void srs_shm_reclaim(std::string dir);
+
+// The writer to fan out the stream of source to shared memory.
+class SrsShmWriter
+{
+private:
+    SrsRequest* req;
+    SrsShmRing* ring;
+    bool enabled;
+    // The sequence headers, to restore the slots when own the ring in the middle of stream.
+    SrsSharedPtrMessage* meta;
+    SrsSharedPtrMessage* vsh;
+    SrsSharedPtrMessage* ash;
+    // The last time to try to own the ring.
+    srs_utime_t last_try;
+public:
+    SrsShmWriter();
+    virtual ~SrsShmWriter();
+public:
+    virtual srs_error_t initialize(SrsRequest* r);
+    virtual srs_error_t on_publish();
+    virtual void on_unpublish();
+    virtual srs_error_t on_meta_data(SrsSharedPtrMessage* shared_metadata);
+    virtual srs_error_t on_audio(SrsSharedPtrMessage* shared_audio);
+    virtual srs_error_t on_video(SrsSharedPtrMessage* shared_video, bool is_sequence_header);
+private:
+    // Write message to ring, and update the slot if not SrsShmSlotMax.
+    virtual srs_error_t write(SrsShmSlot slot, int type, SrsSharedPtrMessage* msg, bool keyframe);
+    // Try to own the ring, when sibling owner quit.
+    virtual bool try_own();
+};
+
+#endif
+
@@ -34,6 +34,12 @@ using namespace std;
 #include <srs_app_dash.hpp>
 #include <srs_protocol_format.hpp>
 #include <srs_app_rtc_source.hpp>
+#include <srs_app_shm.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_kernel_kbps.hpp>
+
+// The latency of messages in consumer queue, from enqueue to dump.
+SrsHistogram* _srs_latency_queue = NULL;
 
 #define CONST_MAX_JITTER_MS         250
 #define CONST_MAX_JITTER_MS_NEG         -250
@@ -447,7 +453,13 @@ srs_error_t SrsLiveConsumer::enqueue(SrsSharedPtrMessage* shared_msg, bool atc,
 {
     srs_error_t err = srs_success;
     
+    // Drop the disposable frames when overload.
+    if (_srs_circuit_breaker->on_consume(queue->duration(), shared_msg->payload, shared_msg->size, shared_msg->is_video(), source->avc_nalu_length())) {
+        return err;
+    }
+    
     SrsSharedPtrMessage* msg = shared_msg->copy();
+    msg->enqueue_time = srs_get_system_time();
 
     if (!atc) {
         if ((err = jitter->correct(msg, ag)) != srs_success) {
@@ -515,6 +527,17 @@ srs_error_t SrsLiveConsumer::dump_packets(SrsMessageArray* msgs, int& count)
     if ((err = queue->dump_packets(max, msgs->msgs, count)) != srs_success) {
         return srs_error_wrap(err, "dump packets");
     }
+
+    // Stat the latency of messages in queue.
+    if (count > 0) {
+        srs_utime_t now = srs_update_system_time();
+        for (int i = 0; i < count; i++) {
+            SrsSharedPtrMessage* msg = msgs->msgs[i];
+            if (msg->enqueue_time > 0) {
+                _srs_latency_queue->record(now - msg->enqueue_time);
+            }
+        }
+    }
     
     return err;
 }
@@ -566,11 +589,22 @@ void SrsLiveConsumer::wakeup()
 #endif
 }
 
+static SrsGopCacheStat _srs_gop_cache_stat = {0, 0, 0};
+
+SrsGopCacheStat* srs_get_gop_cache_stat()
+{
+    return &_srs_gop_cache_stat;
+}
+
 SrsGopCache::SrsGopCache()
 {
     cached_video_count = 0;
     enable_gop_cache = true;
     audio_after_last_video_count = 0;
+    cached_bytes_ = 0;
+    max_bytes_ = 0;
+    max_duration_ = 0;
+    overflow_ = false;
 }
 
 SrsGopCache::~SrsGopCache()
@@ -598,6 +632,17 @@ bool SrsGopCache::enabled()
     return enable_gop_cache;
 }
 
+void SrsGopCache::set_limit(int64_t max_bytes, srs_utime_t max_duration)
+{
+    max_bytes_ = max_bytes;
+    max_duration_ = max_duration;
+}
+
+int64_t SrsGopCache::bytes()
+{
+    return cached_bytes_;
+}
+
 srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
 {
     srs_error_t err = srs_success;
@@ -611,8 +656,8 @@ srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
     
     // got video, update the video count if acceptable
     if (msg->is_video()) {
-        // drop video when not h.264
-        if (!SrsFlvVideo::h264(msg->payload, msg->size)) {
+        // drop video when not h.264 or h.265
+        if (!SrsFlvVideo::h264(msg->payload, msg->size) && !SrsFlvVideo::hevc(msg->payload, msg->size)) {
             return err;
         }
         
@@ -644,9 +689,29 @@ srs_error_t SrsGopCache::cache(SrsSharedPtrMessage* shared_msg)
         // curent msg is video frame, so we set to 1.
         cached_video_count = 1;
     }
+
+    // The gop is overflow, ignore all frames util next keyframe.
+    if (overflow_) {
+        return err;
+    }
+
+    // Drop the whole gop when exceed the limit, player should wait for the next keyframe.
+    if (is_overflow(msg)) {
+        srs_warn("clear gop cache for overflow, msgs=%d, bytes=%" PRId64 ", max=%" PRId64 ", duration=%dms, max=%dms",
+            (int)gop_cache.size(), cached_bytes_, max_bytes_, int(msg->timestamp - gop_cache[0]->timestamp), srsu2msi(max_duration_));
+
+        clear();
+        overflow_ = true;
+        _srs_gop_cache_stat.overflows++;
+        return err;
+    }
     
     // cache the frame.
     gop_cache.push_back(msg->copy());
+
+    cached_bytes_ += msg->size;
+    _srs_gop_cache_stat.bytes += msg->size;
+    _srs_gop_cache_stat.msgs++;
     
     return err;
 }
@@ -658,10 +723,15 @@ void SrsGopCache::clear()
         SrsSharedPtrMessage* msg = *it;
         srs_freep(msg);
     }
+
+    _srs_gop_cache_stat.bytes -= cached_bytes_;
+    _srs_gop_cache_stat.msgs -= (int64_t)gop_cache.size();
     gop_cache.clear();
     
     cached_video_count = 0;
     audio_after_last_video_count = 0;
+    cached_bytes_ = 0;
+    overflow_ = false;
 }
 
 srs_error_t SrsGopCache::dump(SrsLiveConsumer* consumer, bool atc, SrsRtmpJitterAlgorithm jitter_algorithm)
@@ -702,6 +772,26 @@ bool SrsGopCache::pure_audio()
     return cached_video_count == 0;
 }
 
+bool SrsGopCache::is_overflow(SrsSharedPtrMessage* msg)
+{
+    if (gop_cache.empty()) {
+        return false;
+    }
+
+    if (max_bytes_ > 0 && cached_bytes_ + msg->size > max_bytes_) {
+        return true;
+    }
+
+    if (max_duration_ > 0) {
+        int64_t duration = msg->timestamp - gop_cache[0]->timestamp;
+        if (duration * SRS_UTIME_MILLISECONDS > max_duration_) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 ISrsLiveSourceHandler::ISrsLiveSourceHandler()
 {
 }
@@ -816,6 +906,7 @@ SrsOriginHub::SrsOriginHub()
 #endif
     ng_exec = new SrsNgExec();
     format = new SrsRtmpFormat();
+    shm = new SrsShmWriter();
     
     _srs_config->subscribe(this);
 }
@@ -833,6 +924,7 @@ SrsOriginHub::~SrsOriginHub()
         forwarders.clear();
     }
     srs_freep(ng_exec);
+    srs_freep(shm);
     
     srs_freep(format);
     srs_freep(hls);
@@ -867,6 +959,10 @@ srs_error_t SrsOriginHub::initialize(SrsLiveSource* s, SrsRequest* r)
         return srs_error_wrap(err, "dvr initialize");
     }
     
+    if ((err = shm->initialize(req)) != srs_success) {
+        return srs_error_wrap(err, "shm initialize");
+    }
+    
     return err;
 }
 
@@ -903,6 +999,10 @@ srs_error_t SrsOriginHub::on_meta_data(SrsSharedPtrMessage* shared_metadata, Srs
         return srs_error_wrap(err, "Format parse metadata");
     }
     
+    if ((err = shm->on_meta_data(shared_metadata)) != srs_success) {
+        return srs_error_wrap(err, "shm consume metadata");
+    }
+    
     // copy to all forwarders
     if (true) {
         std::vector<SrsForwarder*>::iterator it;
@@ -927,6 +1027,10 @@ srs_error_t SrsOriginHub::on_audio(SrsSharedPtrMessage* shared_audio)
     
     SrsSharedPtrMessage* msg = shared_audio;
 
+    if ((err = shm->on_audio(msg)) != srs_success) {
+        return srs_error_wrap(err, "shm consume audio");
+    }
+
     // TODO: FIXME: Support parsing OPUS for RTC.
     if ((err = format->on_audio(msg)) != srs_success) {
         return srs_error_wrap(err, "format consume audio");
@@ -1013,10 +1117,14 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
     
     SrsSharedPtrMessage* msg = shared_video;
     
+    if ((err = shm->on_video(msg, is_sequence_header)) != srs_success) {
+        return srs_error_wrap(err, "shm consume video");
+    }
+    
     // user can disable the sps parse to workaround when parse sps failed.
     // @see https://github.com/ossrs/srs/issues/474
     if (is_sequence_header) {
-        format->avc_parse_sps = _srs_config->get_parse_sps(req->vhost);
+        format->avc_parse_sps = source->vhost_conf()->parse_sps;
     }
     
     if ((err = format->on_video(msg)) != srs_success) {
@@ -1037,13 +1145,14 @@ srs_error_t SrsOriginHub::on_video(SrsSharedPtrMessage* shared_video, bool is_se
         
         // when got video stream info.
         SrsStatistic* stat = SrsStatistic::instance();
-        if ((err = stat->on_video_info(req, SrsVideoCodecIdAVC, c->avc_profile, c->avc_level, c->width, c->height)) != srs_success) {
+        if ((err = stat->on_video_info(req, c->id, c->avc_profile, c->avc_level, c->width, c->height)) != srs_success) {
             return srs_error_wrap(err, "stat video");
         }
         
+        bool hevc = c->id == SrsVideoCodecIdHEVC;
         srs_trace("%dB video sh,  codec(%d, profile=%s, level=%s, %dx%d, %dkbps, %.1ffps, %.1fs)",
-                  msg->size, c->id, srs_avc_profile2str(c->avc_profile).c_str(),
-                  srs_avc_level2str(c->avc_level).c_str(), c->width, c->height,
+                  msg->size, c->id, hevc? srs_hevc_profile2str(c->hevc_profile).c_str() : srs_avc_profile2str(c->avc_profile).c_str(),
+                  hevc? srs_hevc_level2str(c->hevc_level).c_str() : srs_avc_level2str(c->avc_level).c_str(), c->width, c->height,
                   c->video_data_rate / 1000, c->frame_rate, c->duration);
     }
 
@@ -1145,6 +1254,10 @@ srs_error_t SrsOriginHub::on_publish()
         return srs_error_wrap(err, "exec publish");
     }
     
+    if ((err = shm->on_publish()) != srs_success) {
+        return srs_error_wrap(err, "shm publish");
+    }
+    
     is_active = true;
     
     return err;
@@ -1167,6 +1280,7 @@ void SrsOriginHub::on_unpublish()
 #endif
     
     ng_exec->on_unpublish();
+    shm->on_unpublish();
 }
 
 srs_error_t SrsOriginHub::on_forwarder_start(SrsForwarder* forwarder)
@@ -1475,7 +1589,7 @@ srs_error_t SrsOriginHub::create_forwarders()
             return srs_error_wrap(err, "init forwarder");
         }
 
-        srs_utime_t queue_size = _srs_config->get_queue_length(req->vhost);
+        srs_utime_t queue_size = source->vhost_conf()->queue_length;
         forwarder->set_queue_size(queue_size);
         
         if ((err = forwarder->on_publish()) != srs_success) {
@@ -1855,6 +1969,9 @@ SrsLiveSource::SrsLiveSource()
     is_monotonically_increase = false;
     last_packet_time = 0;
     
+    vhost_conf_ = NULL;
+    vhost_conf_generation_ = 0;
+    
     _srs_config->subscribe(this);
     atc = false;
 }
@@ -1921,6 +2038,24 @@ bool SrsLiveSource::expired()
     return false;
 }
 
+SrsVhostConfig* SrsLiveSource::vhost_conf()
+{
+    if (!vhost_conf_ || vhost_conf_generation_ != _srs_config->generation()) {
+        vhost_conf_ = _srs_config->get_vhost_config(req->vhost);
+        vhost_conf_generation_ = _srs_config->generation();
+    }
+    return vhost_conf_;
+}
+
+int8_t SrsLiveSource::avc_nalu_length()
+{
+    SrsFormat* format = meta->vsh_format();
+    if (!format || !format->vcodec || format->vcodec->id != SrsVideoCodecIdAVC || !format->vcodec->is_avc_codec_ok()) {
+        return -1;
+    }
+    return format->vcodec->NAL_unit_length;
+}
+
 srs_error_t SrsLiveSource::initialize(SrsRequest* r, ISrsLiveSourceHandler* h)
 {
     srs_error_t err = srs_success;
@@ -1930,7 +2065,7 @@ srs_error_t SrsLiveSource::initialize(SrsRequest* r, ISrsLiveSourceHandler* h)
     
     handler = h;
     req = r->copy();
-    atc = _srs_config->get_atc(req->vhost);
+    atc = vhost_conf()->atc;
     
     if ((err = hub->initialize(this, req)) != srs_success) {
         return srs_error_wrap(err, "hub");
@@ -1943,11 +2078,13 @@ srs_error_t SrsLiveSource::initialize(SrsRequest* r, ISrsLiveSourceHandler* h)
         return srs_error_wrap(err, "edge(publish)");
     }
     
-    srs_utime_t queue_size = _srs_config->get_queue_length(req->vhost);
+    srs_utime_t queue_size = vhost_conf()->queue_length;
     publish_edge->set_queue_size(queue_size);
     
-    jitter_algorithm = (SrsRtmpJitterAlgorithm)_srs_config->get_time_jitter(req->vhost);
-    mix_correct = _srs_config->get_mix_correct(req->vhost);
+    jitter_algorithm = (SrsRtmpJitterAlgorithm)vhost_conf()->time_jitter;
+    mix_correct = vhost_conf()->mix_correct;
+
+    gop_cache->set_limit(_srs_config->get_gop_cache_max_size(req->vhost), _srs_config->get_gop_cache_max_duration(req->vhost));
     
     return err;
 }
@@ -1967,11 +2104,11 @@ srs_error_t SrsLiveSource::on_reload_vhost_play(string vhost)
     }
     
     // time_jitter
-    jitter_algorithm = (SrsRtmpJitterAlgorithm)_srs_config->get_time_jitter(req->vhost);
+    jitter_algorithm = (SrsRtmpJitterAlgorithm)vhost_conf()->time_jitter;
     
     // mix_correct
     if (true) {
-        bool v = _srs_config->get_mix_correct(req->vhost);
+        bool v = vhost_conf()->mix_correct;
         
         // when changed, clear the mix queue.
         if (v != mix_correct) {
@@ -1982,7 +2119,7 @@ srs_error_t SrsLiveSource::on_reload_vhost_play(string vhost)
     
     // atc changed.
     if (true) {
-        bool v = _srs_config->get_atc(vhost);
+        bool v = vhost_conf()->atc;
         
         if (v != atc) {
             srs_warn("vhost %s atc changed to %d, connected client may corrupt.", vhost.c_str(), v);
@@ -1993,18 +2130,20 @@ srs_error_t SrsLiveSource::on_reload_vhost_play(string vhost)
     
     // gop cache changed.
     if (true) {
-        bool v = _srs_config->get_gop_cache(vhost);
+        bool v = vhost_conf()->gop_cache;
         
         if (v != gop_cache->enabled()) {
             string url = req->get_stream_url();
             srs_trace("vhost %s gop_cache changed to %d, source url=%s", vhost.c_str(), v, url.c_str());
             gop_cache->set(v);
         }
+
+        gop_cache->set_limit(_srs_config->get_gop_cache_max_size(vhost), _srs_config->get_gop_cache_max_duration(vhost));
     }
     
     // queue length
     if (true) {
-        srs_utime_t v = _srs_config->get_queue_length(req->vhost);
+        srs_utime_t v = vhost_conf()->queue_length;
         
         if (true) {
             std::vector<SrsLiveConsumer*>::iterator it;
@@ -2092,6 +2231,13 @@ bool SrsLiveSource::can_publish(bool is_edge)
         return publish_edge->can_publish();
     }
     
+    // For origin playing stream from sibling process by shared memory, the stream can be published
+    // to this process if sibling quit, and the play is stopped in on_publish.
+    if (!_can_publish && _srs_config->get_shm_fanout_enabled(req->vhost)) {
+        string dir = _srs_config->get_shm_fanout_dir(req->vhost);
+        return !srs_shm_ring_alive(dir, req->get_stream_url());
+    }
+    
     return _can_publish;
 }
 
@@ -2101,8 +2247,8 @@ srs_error_t SrsLiveSource::on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPack
     
     // if allow atc_auto and bravo-atc detected, open atc for vhost.
     SrsAmf0Any* prop = NULL;
-    atc = _srs_config->get_atc(req->vhost);
-    if (_srs_config->get_atc_auto(req->vhost)) {
+    atc = vhost_conf()->atc;
+    if (vhost_conf()->atc_auto) {
         if ((prop = metadata->metadata->get_property("bravo_atc")) != NULL) {
             if (prop->is_string() && prop->to_str() == "true") {
                 atc = true;
@@ -2121,7 +2267,7 @@ srs_error_t SrsLiveSource::on_meta_data(SrsCommonMessage* msg, SrsOnMetaDataPack
     
     // when already got metadata, drop when reduce sequence header.
     bool drop_for_reduce = false;
-    if (meta->data() && _srs_config->get_reduce_sequence_header(req->vhost)) {
+    if (meta->data() && vhost_conf()->reduce_sequence_header) {
         drop_for_reduce = true;
         srs_warn("drop for reduce sh metadata, size=%d", msg->size);
     }
@@ -2195,7 +2341,7 @@ srs_error_t SrsLiveSource::on_audio_imp(SrsSharedPtrMessage* msg)
     
     // whether consumer should drop for the duplicated sequence header.
     bool drop_for_reduce = false;
-    if (is_sequence_header && meta->previous_ash() && _srs_config->get_reduce_sequence_header(req->vhost)) {
+    if (is_sequence_header && meta->previous_ash() && vhost_conf()->reduce_sequence_header) {
         if (meta->previous_ash()->size == msg->size) {
             drop_for_reduce = srs_bytes_equals(meta->previous_ash()->payload, msg->payload, msg->size);
             srs_warn("drop for reduce sh audio, size=%d", msg->size);
@@ -2319,7 +2465,7 @@ srs_error_t SrsLiveSource::on_video_imp(SrsSharedPtrMessage* msg)
     
     // whether consumer should drop for the duplicated sequence header.
     bool drop_for_reduce = false;
-    if (is_sequence_header && meta->previous_vsh() && _srs_config->get_reduce_sequence_header(req->vhost)) {
+    if (is_sequence_header && meta->previous_vsh() && vhost_conf()->reduce_sequence_header) {
         if (meta->previous_vsh()->size == msg->size) {
             drop_for_reduce = srs_bytes_equals(meta->previous_vsh()->payload, msg->payload, msg->size);
             srs_warn("drop for reduce sh video, size=%d", msg->size);
@@ -2472,6 +2618,11 @@ srs_error_t SrsLiveSource::on_publish()
     // update the request object.
     srs_assert(req);
     
+    // Stop playing stream from sibling process by shared memory, which unpublish the source.
+    if (!_can_publish && _srs_config->get_shm_fanout_enabled(req->vhost)) {
+        play_edge->on_all_client_stop();
+    }
+    
     _can_publish = false;
     
     // whatever, the publish thread is the source or edge source,
@@ -2566,11 +2717,17 @@ srs_error_t SrsLiveSource::create_consumer(SrsLiveConsumer*& consumer)
     consumers.push_back(consumer);
     
     // for edge, when play edge stream, check the state
-    if (_srs_config->get_vhost_is_edge(req->vhost)) {
+    if (vhost_conf()->edge) {
         // notice edge to start for the first client.
         if ((err = play_edge->on_client_play()) != srs_success) {
             return srs_error_wrap(err, "play edge");
         }
+    } else if (_can_publish && _srs_config->get_shm_fanout_enabled(req->vhost)) {
+        // For origin, if stream is published to sibling process, play it from shared memory.
+        string dir = _srs_config->get_shm_fanout_dir(req->vhost);
+        if (srs_shm_ring_alive(dir, req->get_stream_url()) && (err = play_edge->on_client_play()) != srs_success) {
+            return srs_error_wrap(err, "play shm");
+        }
     }
     
     return err;
@@ -2580,7 +2737,7 @@ srs_error_t SrsLiveSource::consumer_dumps(SrsLiveConsumer* consumer, bool ds, bo
 {
     srs_error_t err = srs_success;
 
-    srs_utime_t queue_size = _srs_config->get_queue_length(req->vhost);
+    srs_utime_t queue_size = vhost_conf()->queue_length;
     consumer->set_queue_size(queue_size);
 
     // if atc, update the sequence header to gop cache time.
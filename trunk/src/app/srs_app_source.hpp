@@ -30,6 +30,7 @@ class SrsOnMetaDataPacket;
 class SrsSharedPtrMessage;
 class SrsForwarder;
 class SrsRequest;
+class SrsVhostConfig;
 class SrsStSocket;
 class SrsRtmpServer;
 class SrsEdgeProxyContext;
@@ -42,6 +43,7 @@ class SrsDvr;
 class SrsDash;
 class SrsEncoder;
 class SrsBuffer;
+class SrsShmWriter;
 #ifdef SRS_HDS
 class SrsHds;
 #endif
@@ -245,6 +247,15 @@ private:
     int audio_after_last_video_count;
     // cached gop.
     std::vector<SrsSharedPtrMessage*> gop_cache;
+    // The bytes of payload in the cached gop.
+    int64_t cached_bytes_;
+    // The max bytes and duration of a cached gop, 0 for no limit.
+    // @remark When overflow, we clear the gop cache and skip the frames util next keyframe,
+    //      so a huge gop never eat up the memory of server.
+    int64_t max_bytes_;
+    srs_utime_t max_duration_;
+    // Whether the current gop is overflow, skip the frames util next keyframe.
+    bool overflow_;
 public:
     SrsGopCache();
     virtual ~SrsGopCache();
@@ -254,6 +265,10 @@ public:
     // To enable or disable the gop cache.
     virtual void set(bool v);
     virtual bool enabled();
+    // Set the limit of gop cache, in bytes and srs_utime_t, 0 for no limit.
+    virtual void set_limit(int64_t max_bytes, srs_utime_t max_duration);
+    // Get the bytes of payload in gop cache.
+    virtual int64_t bytes();
     // only for h264 codec
     // 1. cache the gop when got h264 video packet.
     // 2. clear gop when got keyframe.
@@ -272,8 +287,25 @@ public:
     // whether current stream is pure audio,
     // when no video in gop cache, the stream is pure audio right now.
     virtual bool pure_audio();
+private:
+    // Whether gop cache exceed the limit, when append the msg.
+    virtual bool is_overflow(SrsSharedPtrMessage* msg);
 };
 
+// The global stat for all gop cache in process.
+struct SrsGopCacheStat
+{
+    // The bytes of payload in all gop cache.
+    int64_t bytes;
+    // The number of messages in all gop cache.
+    int64_t msgs;
+    // The number of gops dropped for exceed the limit.
+    int64_t overflows;
+};
+
+// Get the stat of all gop cache.
+extern SrsGopCacheStat* srs_get_gop_cache_stat();
+
 // The handler to handle the event of srs source.
 // For example, the http flv streaming module handle the event and
 // mount http when rtmp start publishing.
@@ -333,6 +365,8 @@ private:
     SrsNgExec* ng_exec;
     // To forward stream to other servers
     std::vector<SrsForwarder*> forwarders;
+    // To fan out stream to sibling processes by shared memory.
+    SrsShmWriter* shm;
 public:
     SrsOriginHub();
     virtual ~SrsOriginHub();
@@ -527,6 +561,9 @@ private:
     SrsOriginHub* hub;
     // The metadata cache.
     SrsMetaCache* meta;
+    // The cached typed config of vhost, update it when config generation changed.
+    SrsVhostConfig* vhost_conf_;
+    uint64_t vhost_conf_generation_;
 private:
     // Whether source is avaiable for publishing.
     bool _can_publish;
@@ -544,6 +581,11 @@ public:
 public:
     // Initialize the hls with handlers.
     virtual srs_error_t initialize(SrsRequest* r, ISrsLiveSourceHandler* h);
+    // Get the typed config of vhost, for hot path.
+    // @remark Never keep it cross st-thread switch, it's freed when config changed.
+    SrsVhostConfig* vhost_conf();
+    // Get the lengthSizeMinusOne of H.264 NALU from sequence header, -1 if unknown.
+    int8_t avc_nalu_length();
     // Bridge to other source, forward packets to it.
     void set_bridger(ISrsLiveSourceBridger* v);
 // Interface ISrsReloadHandler
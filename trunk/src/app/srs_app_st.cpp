@@ -7,11 +7,14 @@
 #include <srs_app_st.hpp>
 
 #include <st.h>
+#include <time.h>
 #include <string>
+#include <algorithm>
 using namespace std;
 
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_app_log.hpp>
 
@@ -175,6 +178,11 @@ srs_error_t SrsFastCoroutine::start()
         return err;
     }
 
+    // Use the stack size of role if configured, for example, rtc_sender.
+    if (_srs_stacks && _srs_stacks->stack_size(name) > 0) {
+        stack_size = _srs_stacks->stack_size(name);
+    }
+
     if ((trd = (srs_thread_t)_pfn_st_thread_create(pfn, this, 1, stack_size)) == NULL) {
         err = srs_error_new(ERROR_ST_CREATE_CYCLE_THREAD, "create failed");
         
@@ -249,6 +257,11 @@ srs_error_t SrsFastCoroutine::cycle()
         }
         _srs_context->set_id(cid_);
     }
+
+    // Account the CPU of coroutine to the slot of cid.
+    if (_srs_cpu) {
+        _srs_cpu->on_start(cid_, name);
+    }
     
     srs_error_t err = handler->cycle();
     if (err != srs_success) {
@@ -267,6 +280,10 @@ void* SrsFastCoroutine::pfn(void* arg)
 
     srs_error_t err = p->cycle();
 
+    if (_srs_cpu) {
+        _srs_cpu->on_stop();
+    }
+
     // Set the err for function pull to fetch it.
     // @see https://github.com/ossrs/srs/pull/1304#issuecomment-480484151
     if (err != srs_success) {
@@ -275,6 +292,272 @@ void* SrsFastCoroutine::pfn(void* arg)
         p->trd_err = err;
     }
 
+    // Stat the stack usage, before the stack is freed.
+    if (_srs_stacks) {
+        _srs_stacks->on_stack_usage(p->name, p->stack_size, st_thread_stack_usage(st_thread_self()));
+    }
+
     return (void*)err;
 }
 
+SrsCoroutineStacks* _srs_stacks = NULL;
+
+SrsCoroutineStacks::SrsCoroutineStacks()
+{
+}
+
+SrsCoroutineStacks::~SrsCoroutineStacks()
+{
+}
+
+void SrsCoroutineStacks::set_stack_size(string name, int size)
+{
+    sizes_[name] = size;
+}
+
+int SrsCoroutineStacks::stack_size(string name)
+{
+    map<string, int>::iterator it = sizes_.find(name);
+    return (it == sizes_.end()) ? 0 : it->second;
+}
+
+void SrsCoroutineStacks::on_stack_usage(string name, int size, int usage)
+{
+    if (usage < 0) {
+        return;
+    }
+
+    map<string, int>::iterator it = watermarks_.find(name);
+    if (it != watermarks_.end() && it->second >= usage) {
+        return;
+    }
+    watermarks_[name] = usage;
+
+    // Only trace when the high water-level is raised, to tune the stack size.
+    size = size ? size : 64 * 1024;
+    srs_trace("Stack: %s watermark %d/%d bytes, %.1f%%", name.c_str(), usage, size, usage * 100.0 / size);
+}
+
+int SrsCoroutineStacks::watermark(string name)
+{
+    map<string, int>::iterator it = watermarks_.find(name);
+    return (it == watermarks_.end()) ? -1 : it->second;
+}
+
+SrsCpuSlot::SrsCpuSlot()
+{
+    refs = 0;
+    ticks = delta = sampled = 0;
+}
+
+SrsCpuSlot::~SrsCpuSlot()
+{
+}
+
+// Get the current tick, which is cheap for each switch of coroutines.
+static inline uint64_t srs_cpu_tick()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static void srs_cpu_switch_in()
+{
+    _srs_cpu->on_switch_in();
+}
+
+static void srs_cpu_switch_out()
+{
+    _srs_cpu->on_switch_out();
+}
+
+SrsCoroutineCpu* _srs_cpu = NULL;
+
+SrsCoroutineCpu::SrsCoroutineCpu()
+{
+    enabled_ = false;
+    key_ = -1;
+    last_tick_ = 0;
+    others_ = others_delta_ = others_sampled_ = 0;
+    sample_tick_ = 0;
+    sample_time_ = 0;
+    duration_ticks_ = 0;
+    duration_ = 0;
+}
+
+SrsCoroutineCpu::~SrsCoroutineCpu()
+{
+    std::map<std::string, SrsCpuSlot*>::iterator it;
+    for (it = slots_.begin(); it != slots_.end(); ++it) {
+        SrsCpuSlot* slot = it->second;
+        srs_freep(slot);
+    }
+    slots_.clear();
+}
+
+srs_error_t SrsCoroutineCpu::initialize()
+{
+    srs_error_t err = srs_success;
+
+    if (st_key_create(&key_, NULL) != 0) {
+        return srs_error_new(ERROR_ST_INITIALIZE, "create key");
+    }
+
+    enabled_ = true;
+    last_tick_ = sample_tick_ = srs_cpu_tick();
+    sample_time_ = srs_get_system_time();
+
+    // The callbacks are global, only for the global object.
+    if (this == _srs_cpu) {
+        st_set_switch_in_cb(srs_cpu_switch_in);
+        st_set_switch_out_cb(srs_cpu_switch_out);
+    }
+
+    return err;
+}
+
+void SrsCoroutineCpu::on_start(const SrsContextId& cid, std::string name)
+{
+    if (!enabled_) {
+        return;
+    }
+
+    // The coroutine starts without switch in, so ignore the time of scheduler.
+    last_tick_ = srs_cpu_tick();
+
+    SrsCpuSlot* slot = NULL;
+    std::map<std::string, SrsCpuSlot*>::iterator it = slots_.find(cid.c_str());
+    if (it != slots_.end()) {
+        slot = it->second;
+    } else {
+        slot = slots_[cid.c_str()] = new SrsCpuSlot();
+        slot->cid = cid;
+        slot->name = name;
+    }
+
+    slot->refs++;
+    st_thread_setspecific(key_, slot);
+}
+
+void SrsCoroutineCpu::on_stop()
+{
+    if (!enabled_) {
+        return;
+    }
+
+    // ST never switch out the dead coroutine, so we account it here.
+    account(srs_cpu_tick());
+
+    SrsCpuSlot* slot = (SrsCpuSlot*)st_thread_getspecific(key_);
+    if (slot) {
+        slot->refs--;
+        st_thread_setspecific(key_, NULL);
+    }
+}
+
+void SrsCoroutineCpu::on_switch_in()
+{
+    if (!enabled_) {
+        return;
+    }
+
+    // Ignore the time of scheduler and idle coroutine.
+    last_tick_ = srs_cpu_tick();
+}
+
+void SrsCoroutineCpu::on_switch_out()
+{
+    if (!enabled_) {
+        return;
+    }
+
+    account(srs_cpu_tick());
+}
+
+void SrsCoroutineCpu::account(uint64_t now)
+{
+    uint64_t ticks = now - last_tick_;
+    last_tick_ = now;
+
+    SrsCpuSlot* slot = (SrsCpuSlot*)st_thread_getspecific(key_);
+    if (slot) {
+        slot->ticks += ticks;
+    } else {
+        others_ += ticks;
+    }
+}
+
+void SrsCoroutineCpu::sample()
+{
+    if (!enabled_) {
+        return;
+    }
+
+    uint64_t now = srs_cpu_tick();
+    srs_utime_t now_time = srs_get_system_time();
+    duration_ticks_ = now - sample_tick_;
+    duration_ = now_time - sample_time_;
+    sample_tick_ = now;
+    sample_time_ = now_time;
+
+    others_delta_ = others_ - others_sampled_;
+    others_sampled_ = others_;
+
+    std::map<std::string, SrsCpuSlot*>::iterator it;
+    for (it = slots_.begin(); it != slots_.end();) {
+        SrsCpuSlot* slot = it->second;
+        slot->delta = slot->ticks - slot->sampled;
+        slot->sampled = slot->ticks;
+
+        // Free the stopped slot, after its ticks of last duration is sampled.
+        if (slot->refs <= 0 && slot->delta == 0) {
+            slots_.erase(it++);
+            srs_freep(slot);
+        } else {
+            ++it;
+        }
+    }
+}
+
+static bool srs_cpu_slot_hotter(SrsCpuSlot* a, SrsCpuSlot* b)
+{
+    return a->delta > b->delta;
+}
+
+void SrsCoroutineCpu::top(int count, std::vector<SrsCpuSlot*>& slots)
+{
+    std::map<std::string, SrsCpuSlot*>::iterator it;
+    for (it = slots_.begin(); it != slots_.end(); ++it) {
+        slots.push_back(it->second);
+    }
+
+    std::sort(slots.begin(), slots.end(), srs_cpu_slot_hotter);
+    if (count >= 0 && (int)slots.size() > count) {
+        slots.resize(count);
+    }
+}
+
+float SrsCoroutineCpu::percent(uint64_t ticks)
+{
+    if (!duration_ticks_) {
+        return 0;
+    }
+    return ticks * 100.0 / duration_ticks_;
+}
+
+float SrsCoroutineCpu::others()
+{
+    return percent(others_delta_);
+}
+
+srs_utime_t SrsCoroutineCpu::duration()
+{
+    return duration_;
+}
@@ -10,6 +10,8 @@
 #include <srs_core.hpp>
 
 #include <string>
+#include <map>
+#include <vector>
 
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
@@ -185,5 +187,106 @@ private:
     static void* pfn(void* arg);
 };
 
+// The stacks of coroutines by the name(role) of coroutine, such as rtc_sender or recv, to set the
+// stack size of each role, and stat the high water-level of stack usage to tune the stack size.
+class SrsCoroutineStacks
+{
+private:
+    // The stack size by the name of coroutine.
+    std::map<std::string, int> sizes_;
+    // The high water-level of stack usage by the name of coroutine.
+    std::map<std::string, int> watermarks_;
+public:
+    SrsCoroutineStacks();
+    virtual ~SrsCoroutineStacks();
+public:
+    // Set the stack size of coroutines by the name, 0 to use the default.
+    void set_stack_size(std::string name, int size);
+    // Get the stack size of coroutines by the name, 0 if not set.
+    int stack_size(std::string name);
+    // When coroutine is done, update the high water-level by the stack usage of coroutine.
+    // @param size The size of stack, 0 for the default 64KB.
+    // @param usage The usage of stack, ignore if -1, which means watermark disabled.
+    void on_stack_usage(std::string name, int size, int usage);
+    // Get the high water-level of stack usage by the name, -1 if unknown.
+    int watermark(std::string name);
+};
+
+extern SrsCoroutineStacks* _srs_stacks;
+
+// The CPU of coroutines with the same context id, for example, the RTMP connection and its recv
+// coroutine, so it's the CPU of resource, such as connection, or timer.
+class SrsCpuSlot
+{
+public:
+    SrsContextId cid;
+    // The name of the first coroutine, such as rtmp or hybrid.
+    std::string name;
+    // The number of running coroutines, the slot is freed when zero.
+    int refs;
+    // The total ticks, and the ticks of last duration.
+    uint64_t ticks;
+    uint64_t delta;
+    // The total ticks when sample.
+    uint64_t sampled;
+public:
+    SrsCpuSlot();
+    virtual ~SrsCpuSlot();
+};
+
+// The CPU accounting of coroutines, by the switch callbacks of ST, to find out the hottest connections,
+// for example, a stream with huge GOP or malformed bitstream burns the CPU.
+// @remark The tick is rdtsc for x86, or monotonic clock in ns for others.
+// @remark The RTC sessions are served by the coroutine of UDP listener, so they share a slot.
+class SrsCoroutineCpu
+{
+private:
+    bool enabled_;
+    // The key of ST thread specific data, which is the slot of coroutine.
+    int key_;
+    // The tick of last switch.
+    uint64_t last_tick_;
+    // The ticks of coroutines without slot, such as the primordial thread.
+    uint64_t others_;
+    uint64_t others_delta_;
+    uint64_t others_sampled_;
+    // The key is the context id.
+    std::map<std::string, SrsCpuSlot*> slots_;
+    // The tick and time of last sample, to convert ticks to time.
+    uint64_t sample_tick_;
+    srs_utime_t sample_time_;
+    uint64_t duration_ticks_;
+    srs_utime_t duration_;
+public:
+    SrsCoroutineCpu();
+    virtual ~SrsCoroutineCpu();
+public:
+    // Create the thread specific key, and hook the switch of coroutines.
+    srs_error_t initialize();
+public:
+    // When coroutine starts, attach it to the slot of cid.
+    void on_start(const SrsContextId& cid, std::string name);
+    // When coroutine is done, detach it from the slot.
+    void on_stop();
+    // When ST switch in or out the coroutine.
+    void on_switch_in();
+    void on_switch_out();
+public:
+    // Sample the ticks of slots in last duration, and free the stopped slots.
+    void sample();
+    // Get the hottest slots in last duration, all slots if count is -1.
+    void top(int count, std::vector<SrsCpuSlot*>& slots);
+    // Get the percent of a CPU core in last duration.
+    float percent(uint64_t ticks);
+    // Get the percent of coroutines without slot in last duration.
+    float others();
+    // Get the last duration.
+    srs_utime_t duration();
+private:
+    void account(uint64_t now);
+};
+
+extern SrsCoroutineCpu* _srs_cpu;
+
 #endif
 
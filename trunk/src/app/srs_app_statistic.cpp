@@ -7,6 +7,7 @@
 #include <srs_app_statistic.hpp>
 
 #include <unistd.h>
+#include <string.h>
 #include <sstream>
 using namespace std;
 
@@ -19,6 +20,113 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_protocol_utility.hpp>
 
+// The stat of streams with the same labels, for metrics.
+struct SrsMetricsSample
+{
+    int nn_active;
+    int nb_clients;
+    uint64_t nb_frames;
+    int64_t send_bytes;
+    int64_t recv_bytes;
+    int send_kbps;
+    int recv_kbps;
+};
+
+// The counters of stream in a series, only the delta since joined is counted by series.
+struct SrsMetricsStream
+{
+    std::string key;
+    // The counters when joined the series.
+    uint64_t start_frames;
+    int64_t start_send_bytes;
+    int64_t start_recv_bytes;
+    // The counters of last scrape.
+    uint64_t nb_frames;
+    int64_t send_bytes;
+    int64_t recv_bytes;
+};
+
+// The series of streams with the same labels.
+struct SrsMetricsSeries
+{
+    int nn_streams;
+    // The counters of streams which left the series.
+    uint64_t nb_frames;
+    int64_t send_bytes;
+    int64_t recv_bytes;
+};
+
+int srs_metrics_labels_parse(const vector<string>& labels)
+{
+    int v = 0;
+
+    for (int i = 0; i < (int)labels.size(); i++) {
+        const string& label = labels.at(i);
+        if (label == "vhost") {
+            v |= SrsMetricsLabelVhost;
+        } else if (label == "app") {
+            v |= SrsMetricsLabelApp;
+        } else if (label == "stream") {
+            v |= SrsMetricsLabelStream;
+        }
+    }
+
+    return v;
+}
+
+void srs_metrics_family(string& out, const char* name, const char* type, const char* help)
+{
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+}
+
+void srs_metrics_sample(string& out, const char* name, const string& labels, int64_t value)
+{
+    char buf[32];
+    int nn = snprintf(buf, sizeof(buf), " %" PRId64 "\n", value);
+
+    out.append(name);
+    if (!labels.empty()) {
+        out.append("{").append(labels).append("}");
+    }
+    out.append(buf, nn);
+}
+
+void srs_metrics_number(string& out, const char* name, const string& labels, double value)
+{
+    char buf[32];
+    int nn = snprintf(buf, sizeof(buf), " %.2f\n", value);
+
+    out.append(name);
+    if (!labels.empty()) {
+        out.append("{").append(labels).append("}");
+    }
+    out.append(buf, nn);
+}
+
+void srs_metrics_label(string& out, const char* name, const string& value)
+{
+    if (!out.empty()) {
+        out.append(",");
+    }
+    out.append(name).append("=\"");
+
+    // The backslash, double-quote and line feed must be escaped.
+    for (int i = 0; i < (int)value.length(); i++) {
+        char ch = value.at(i);
+        if (ch == '\\' || ch == '"') {
+            out.push_back('\\');
+            out.push_back(ch);
+        } else if (ch == '\n') {
+            out.append("\\n");
+        } else {
+            out.push_back(ch);
+        }
+    }
+
+    out.append("\"");
+}
+
 string srs_generate_stat_vid()
 {
     return "vid-" + srs_random_str(7);
@@ -100,6 +208,9 @@ SrsStatisticStream::SrsStatisticStream()
     
     nb_clients = 0;
     nb_frames = 0;
+    metrics_frames = 0;
+    metrics_send_bytes = 0;
+    metrics_recv_bytes = 0;
 }
 
 SrsStatisticStream::~SrsStatisticStream()
@@ -186,6 +297,10 @@ SrsStatisticClient::SrsStatisticClient()
     req = NULL;
     type = SrsRtmpConnUnknown;
     create = srs_get_system_time();
+
+    handle = -1;
+    delta = NULL;
+    index = -1;
 }
 
 SrsStatisticClient::~SrsStatisticClient()
@@ -221,6 +336,8 @@ SrsStatistic::SrsStatistic()
     clk = new SrsWallClock();
     kbps = new SrsKbps(clk);
     kbps->set_io(NULL, NULL);
+
+    metrics_labels_ = 0;
 }
 
 SrsStatistic::~SrsStatistic()
@@ -250,6 +367,21 @@ SrsStatistic::~SrsStatistic()
         }
     }
     
+    if (true) {
+        std::map<std::string, SrsMetricsSeries*>::iterator it;
+        for (it = metrics_series_.begin(); it != metrics_series_.end(); it++) {
+            SrsMetricsSeries* series = it->second;
+            srs_freep(series);
+        }
+    }
+    if (true) {
+        std::map<std::string, SrsMetricsStream*>::iterator it;
+        for (it = metrics_streams_.begin(); it != metrics_streams_.end(); it++) {
+            SrsMetricsStream* stream = it->second;
+            srs_freep(stream);
+        }
+    }
+    
     vhosts.clear();
     rvhosts.clear();
     streams.clear();
@@ -304,6 +436,31 @@ SrsStatisticClient* SrsStatistic::find_client(string client_id)
     return NULL;
 }
 
+int64_t SrsStatistic::find_handle(string client_id)
+{
+    SrsStatisticClient* client = find_client(client_id);
+    return client? client->handle : -1;
+}
+
+SrsStatisticClient* SrsStatistic::find_client(int64_t handle)
+{
+    if (handle < 0) {
+        return NULL;
+    }
+
+    int slot = (int)(handle & 0xffffffff);
+    if (slot >= (int)slots_.size()) {
+        return NULL;
+    }
+
+    SrsStatisticClient* client = slots_[slot];
+    if (!client || client->handle != handle) {
+        return NULL;
+    }
+
+    return client;
+}
+
 srs_error_t SrsStatistic::on_video_info(SrsRequest* req, SrsVideoCodecId vcodec, SrsAvcProfile avc_profile, SrsAvcLevel avc_level, int width, int height)
 {
     srs_error_t err = srs_success;
@@ -338,14 +495,14 @@ srs_error_t SrsStatistic::on_audio_info(SrsRequest* req, SrsAudioCodecId acodec,
     return err;
 }
 
-srs_error_t SrsStatistic::on_video_frames(SrsRequest* req, int nb_frames)
+srs_error_t SrsStatistic::on_video_frames(int64_t handle, int nb_frames)
 {
     srs_error_t err = srs_success;
     
-    SrsStatisticVhost* vhost = create_vhost(req);
-    SrsStatisticStream* stream = create_stream(vhost, req);
-    
-    stream->nb_frames += nb_frames;
+    SrsStatisticClient* client = find_client(handle);
+    if (client) {
+        client->stream->nb_frames += nb_frames;
+    }
     
     return err;
 }
@@ -395,12 +552,14 @@ srs_error_t SrsStatistic::on_client(std::string id, SrsRequest* req, ISrsExpire*
         client->id = id;
         client->stream = stream;
         clients[id] = client;
+        attach_client(client);
     } else {
         client = clients[id];
     }
     
     // got client.
     client->conn = conn;
+    client->delta = dynamic_cast<ISrsKbpsDelta*>(conn);
     client->type = type;
     stream->nb_clients++;
     vhost->nb_clients++;
@@ -424,6 +583,16 @@ void SrsStatistic::on_disconnect(std::string id)
     SrsStatisticStream* stream = client->stream;
     SrsStatisticVhost* vhost = stream->vhost;
     
+    // Collect the last delta, before the connection is freed.
+    if (client->delta) {
+        int64_t in, out;
+        client->delta->remark(&in, &out);
+        kbps->add_delta(in, out);
+        stream->kbps->add_delta(in, out);
+        vhost->kbps->add_delta(in, out);
+    }
+    
+    detach_client(client);
     srs_freep(client);
     clients.erase(it);
     
@@ -431,27 +600,26 @@ void SrsStatistic::on_disconnect(std::string id)
     vhost->nb_clients--;
 }
 
-void SrsStatistic::kbps_add_delta(std::string id, ISrsKbpsDelta* delta)
+SrsKbps* SrsStatistic::kbps_sample()
 {
-    if (clients.find(id) == clients.end()) {
-        return;
+    // Collect the delta of clients, without lookup by id.
+    for (int i = 0; i < (int)dense_.size(); i++) {
+        SrsStatisticClient* client = dense_[i];
+        if (!client->delta) {
+            continue;
+        }
+
+        // resample the kbps to collect the delta.
+        int64_t in, out;
+        client->delta->remark(&in, &out);
+
+        // add delta of connection to kbps.
+        // for next sample() of server kbps can get the stat.
+        kbps->add_delta(in, out);
+        client->stream->kbps->add_delta(in, out);
+        client->stream->vhost->kbps->add_delta(in, out);
     }
-    
-    SrsStatisticClient* client = clients[id];
-    
-    // resample the kbps to collect the delta.
-    int64_t in, out;
-    delta->remark(&in, &out);
-    
-    // add delta of connection to kbps.
-    // for next sample() of server kbps can get the stat.
-    kbps->add_delta(in, out);
-    client->stream->kbps->add_delta(in, out);
-    client->stream->vhost->kbps->add_delta(in, out);
-}
 
-SrsKbps* SrsStatistic::kbps_sample()
-{
     kbps->sample();
     if (true) {
         std::map<std::string, SrsStatisticVhost*>::iterator it;
@@ -518,13 +686,8 @@ srs_error_t SrsStatistic::dumps_clients(SrsJsonArray* arr, int start, int count)
 {
     srs_error_t err = srs_success;
     
-    std::map<std::string, SrsStatisticClient*>::iterator it = clients.begin();
-    for (int i = 0; i < start + count && it != clients.end(); it++, i++) {
-        if (i < start) {
-            continue;
-        }
-        
-        SrsStatisticClient* client = it->second;
+    for (int i = srs_max(0, start); i < start + count && i < (int)dense_.size(); i++) {
+        SrsStatisticClient* client = dense_[i];
         
         SrsJsonObject* obj = SrsJsonAny::object();
         arr->append(obj);
@@ -537,6 +700,259 @@ srs_error_t SrsStatistic::dumps_clients(SrsJsonArray* arr, int start, int count)
     return err;
 }
 
+void SrsStatistic::dumps_metrics(string& out, int labels, int max_streams)
+{
+    srs_metrics_family(out, "srs_clients", "gauge", "The number of clients.");
+    srs_metrics_sample(out, "srs_clients", "", (int64_t)clients.size());
+
+    srs_metrics_family(out, "srs_send_bytes", "counter", "The bytes sent by server.");
+    srs_metrics_sample(out, "srs_send_bytes_total", "", kbps->get_send_bytes());
+    srs_metrics_family(out, "srs_recv_bytes", "counter", "The bytes received by server.");
+    srs_metrics_sample(out, "srs_recv_bytes_total", "", kbps->get_recv_bytes());
+
+    // The vhosts are limited by config, so always labeled.
+    std::vector<string> vlabels;
+    std::map<std::string, SrsStatisticVhost*>::iterator itv;
+    for (itv = vhosts.begin(); itv != vhosts.end(); ++itv) {
+        string v;
+        srs_metrics_label(v, "vhost", itv->second->vhost);
+        vlabels.push_back(v);
+    }
+
+    srs_metrics_family(out, "srs_vhost_clients", "gauge", "The number of clients of vhost.");
+    int i = 0;
+    for (itv = vhosts.begin(); itv != vhosts.end(); ++itv, ++i) {
+        srs_metrics_sample(out, "srs_vhost_clients", vlabels.at(i), itv->second->nb_clients);
+    }
+    srs_metrics_family(out, "srs_vhost_streams", "gauge", "The number of active streams of vhost.");
+    for (i = 0, itv = vhosts.begin(); itv != vhosts.end(); ++itv, ++i) {
+        srs_metrics_sample(out, "srs_vhost_streams", vlabels.at(i), itv->second->nb_streams);
+    }
+    srs_metrics_family(out, "srs_vhost_send_bytes", "counter", "The bytes sent of vhost.");
+    for (i = 0, itv = vhosts.begin(); itv != vhosts.end(); ++itv, ++i) {
+        srs_metrics_sample(out, "srs_vhost_send_bytes_total", vlabels.at(i), itv->second->kbps->get_send_bytes());
+    }
+    srs_metrics_family(out, "srs_vhost_recv_bytes", "counter", "The bytes received of vhost.");
+    for (i = 0, itv = vhosts.begin(); itv != vhosts.end(); ++itv, ++i) {
+        srs_metrics_sample(out, "srs_vhost_recv_bytes_total", vlabels.at(i), itv->second->kbps->get_recv_bytes());
+    }
+
+    // Aggregate the streams by labels, to bound the cardinality.
+    update_metrics(labels, max_streams);
+
+    std::map<std::string, SrsMetricsSample> series;
+    std::map<std::string, SrsMetricsSeries*>::iterator itm;
+    for (itm = metrics_series_.begin(); itm != metrics_series_.end(); ++itm) {
+        SrsMetricsSeries* ms = itm->second;
+
+        SrsMetricsSample s;
+        memset(&s, 0, sizeof(SrsMetricsSample));
+        s.nb_frames = ms->nb_frames;
+        s.send_bytes = ms->send_bytes;
+        s.recv_bytes = ms->recv_bytes;
+        series[itm->first] = s;
+    }
+
+    std::map<std::string, SrsMetricsStream*>::iterator it;
+    for (it = metrics_streams_.begin(); it != metrics_streams_.end(); ++it) {
+        SrsMetricsStream* ms = it->second;
+        SrsStatisticStream* stream = streams[it->first];
+
+        SrsMetricsSample& s = series[ms->key];
+        s.nn_active += stream->active? 1 : 0;
+        s.nb_clients += stream->nb_clients;
+        s.nb_frames += ms->nb_frames - ms->start_frames;
+        s.send_bytes += ms->send_bytes - ms->start_send_bytes;
+        s.recv_bytes += ms->recv_bytes - ms->start_recv_bytes;
+        s.send_kbps += stream->kbps->get_send_kbps_30s();
+        s.recv_kbps += stream->kbps->get_recv_kbps_30s();
+    }
+
+    std::map<std::string, SrsMetricsSample>::iterator its;
+    srs_metrics_family(out, "srs_stream_active", "gauge", "The number of active streams.");
+    for (its = series.begin(); its != series.end(); ++its) {
+        srs_metrics_sample(out, "srs_stream_active", its->first, its->second.nn_active);
+    }
+    srs_metrics_family(out, "srs_stream_clients", "gauge", "The number of clients of stream.");
+    for (its = series.begin(); its != series.end(); ++its) {
+        srs_metrics_sample(out, "srs_stream_clients", its->first, its->second.nb_clients);
+    }
+    srs_metrics_family(out, "srs_stream_frames", "counter", "The video frames of stream.");
+    for (its = series.begin(); its != series.end(); ++its) {
+        srs_metrics_sample(out, "srs_stream_frames_total", its->first, (int64_t)its->second.nb_frames);
+    }
+    srs_metrics_family(out, "srs_stream_send_bytes", "counter", "The bytes sent of stream.");
+    for (its = series.begin(); its != series.end(); ++its) {
+        srs_metrics_sample(out, "srs_stream_send_bytes_total", its->first, its->second.send_bytes);
+    }
+    srs_metrics_family(out, "srs_stream_recv_bytes", "counter", "The bytes received of stream.");
+    for (its = series.begin(); its != series.end(); ++its) {
+        srs_metrics_sample(out, "srs_stream_recv_bytes_total", its->first, its->second.recv_bytes);
+    }
+    srs_metrics_family(out, "srs_stream_send_kbps", "gauge", "The send kbps of stream, in 30s.");
+    for (its = series.begin(); its != series.end(); ++its) {
+        srs_metrics_sample(out, "srs_stream_send_kbps", its->first, its->second.send_kbps);
+    }
+    srs_metrics_family(out, "srs_stream_recv_kbps", "gauge", "The recv kbps of stream, in 30s.");
+    for (its = series.begin(); its != series.end(); ++its) {
+        srs_metrics_sample(out, "srs_stream_recv_kbps", its->first, its->second.recv_kbps);
+    }
+}
+
+void SrsStatistic::update_metrics(int labels, int max_streams)
+{
+    // Reset all series when labels changed.
+    if (labels != metrics_labels_) {
+        while (!metrics_streams_.empty()) {
+            leave_metrics(metrics_streams_.begin()->first);
+        }
+        metrics_labels_ = labels;
+    }
+
+    // The stream leaves the series when closed or idle.
+    std::vector<std::string> leaves;
+    std::map<std::string, SrsMetricsStream*>::iterator itm;
+    for (itm = metrics_streams_.begin(); itm != metrics_streams_.end(); ++itm) {
+        std::map<std::string, SrsStatisticStream*>::iterator it = streams.find(itm->first);
+        SrsStatisticStream* stream = (it != streams.end())? it->second : NULL;
+
+        // Never update the counters of the closed stream, which is not in the map.
+        SrsMetricsStream* ms = itm->second;
+        if (stream) {
+            ms->nb_frames = stream->nb_frames;
+            ms->send_bytes = stream->kbps->get_send_bytes();
+            ms->recv_bytes = stream->kbps->get_recv_bytes();
+        }
+
+        if (!stream || (!stream->active && !stream->nb_clients)) {
+            leaves.push_back(itm->first);
+        }
+    }
+    for (int i = 0; i < (int)leaves.size(); i++) {
+        leave_metrics(leaves.at(i));
+    }
+
+    if (!labels) {
+        return;
+    }
+
+    // The series of overflow uses a distinct label, never collides with any stream, for example,
+    // the stream named "others".
+    string overflow;
+    srs_metrics_label(overflow, "overflow", "true");
+
+    // The stream joins the series when first seen, to the series of overflow if full.
+    std::map<std::string, SrsStatisticStream*>::iterator it;
+    for (it = streams.begin(); it != streams.end(); ++it) {
+        SrsStatisticStream* stream = it->second;
+        if ((!stream->active && !stream->nb_clients) || metrics_streams_.find(it->first) != metrics_streams_.end()) {
+            continue;
+        }
+
+        string key;
+        if ((labels & SrsMetricsLabelVhost) != 0) {
+            srs_metrics_label(key, "vhost", stream->vhost->vhost);
+        }
+        if ((labels & SrsMetricsLabelApp) != 0) {
+            srs_metrics_label(key, "app", stream->app);
+        }
+        if ((labels & SrsMetricsLabelStream) != 0) {
+            srs_metrics_label(key, "stream", stream->stream);
+        }
+
+        int nn_series = (int)metrics_series_.size() - (metrics_series_.find(overflow) != metrics_series_.end()? 1 : 0);
+        if (nn_series >= max_streams && metrics_series_.find(key) == metrics_series_.end()) {
+            key = overflow;
+        }
+
+        SrsMetricsSeries* series = metrics_series_[key];
+        if (!series) {
+            series = metrics_series_[key] = new SrsMetricsSeries();
+            memset(series, 0, sizeof(SrsMetricsSeries));
+        }
+        series->nn_streams++;
+
+        // Start from the counters which are not counted, all for the new stream.
+        SrsMetricsStream* ms = new SrsMetricsStream();
+        ms->key = key;
+        ms->start_frames = stream->metrics_frames;
+        ms->start_send_bytes = stream->metrics_send_bytes;
+        ms->start_recv_bytes = stream->metrics_recv_bytes;
+        ms->nb_frames = stream->nb_frames;
+        ms->send_bytes = stream->kbps->get_send_bytes();
+        ms->recv_bytes = stream->kbps->get_recv_bytes();
+        metrics_streams_[it->first] = ms;
+    }
+}
+
+void SrsStatistic::leave_metrics(string id)
+{
+    std::map<std::string, SrsMetricsStream*>::iterator it = metrics_streams_.find(id);
+    if (it == metrics_streams_.end()) {
+        return;
+    }
+
+    SrsMetricsStream* ms = it->second;
+    metrics_streams_.erase(it);
+
+    std::map<std::string, SrsMetricsSeries*>::iterator its = metrics_series_.find(ms->key);
+    srs_assert(its != metrics_series_.end());
+    SrsMetricsSeries* series = its->second;
+
+    // Keep the counters of the stream in series, to be monotonic. Remove the series when all streams left.
+    series->nb_frames += ms->nb_frames - ms->start_frames;
+    series->send_bytes += ms->send_bytes - ms->start_send_bytes;
+    series->recv_bytes += ms->recv_bytes - ms->start_recv_bytes;
+    if (--series->nn_streams <= 0) {
+        metrics_series_.erase(its);
+        srs_freep(series);
+    }
+
+    // For the idle stream, never count the counters again when it joins the series.
+    std::map<std::string, SrsStatisticStream*>::iterator itv = streams.find(id);
+    if (itv != streams.end()) {
+        SrsStatisticStream* stream = itv->second;
+        stream->metrics_frames = ms->nb_frames;
+        stream->metrics_send_bytes = ms->send_bytes;
+        stream->metrics_recv_bytes = ms->recv_bytes;
+    }
+
+    srs_freep(ms);
+}
+
+void SrsStatistic::attach_client(SrsStatisticClient* client)
+{
+    int slot = 0;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    } else {
+        slot = (int)slots_.size();
+        slots_.push_back(NULL);
+        generations_.push_back(0);
+    }
+
+    slots_[slot] = client;
+    client->handle = ((int64_t)generations_[slot] << 32) | slot;
+
+    client->index = (int)dense_.size();
+    dense_.push_back(client);
+}
+
+void SrsStatistic::detach_client(SrsStatisticClient* client)
+{
+    int slot = (int)(client->handle & 0xffffffff);
+    slots_[slot] = NULL;
+    generations_[slot]++;
+    free_slots_.push_back(slot);
+
+    // Move the last client to the hole, to keep the array dense.
+    SrsStatisticClient* last = dense_.back();
+    dense_[client->index] = last;
+    last->index = client->index;
+    dense_.pop_back();
+}
+
 SrsStatisticVhost* SrsStatistic::create_vhost(SrsRequest* req)
 {
     SrsStatisticVhost* vhost = NULL;
@@ -23,6 +23,8 @@ class ISrsExpire;
 class SrsJsonObject;
 class SrsJsonArray;
 class ISrsKbpsDelta;
+struct SrsMetricsStream;
+struct SrsMetricsSeries;
 
 struct SrsStatisticVhost
 {
@@ -55,6 +57,10 @@ public:
     std::string publisher_id;
     int nb_clients;
     uint64_t nb_frames;
+    // The counters which are counted by metrics, when the stream is idle and leaves the series.
+    uint64_t metrics_frames;
+    int64_t metrics_send_bytes;
+    int64_t metrics_recv_bytes;
 public:
     // The stream total kbps.
     SrsKbps* kbps;
@@ -100,6 +106,13 @@ public:
     SrsRtmpConnType type;
     std::string id;
     srs_utime_t create;
+public:
+    // The stable handle of client, to update the stat without lookup by id.
+    int64_t handle;
+    // The delta of connection to collect kbps, NULL if not supported.
+    ISrsKbpsDelta* delta;
+    // The index in the dense array of clients.
+    int index;
 public:
     SrsStatisticClient();
     virtual ~SrsStatisticClient();
@@ -107,6 +120,27 @@ public:
     virtual srs_error_t dumps(SrsJsonObject* obj);
 };
 
+// The labels of stream metrics.
+enum SrsMetricsLabel
+{
+    SrsMetricsLabelVhost = 0x01,
+    SrsMetricsLabelApp = 0x02,
+    SrsMetricsLabelStream = 0x04,
+};
+
+// Parse the labels of stream metrics, ignore the unknown labels.
+extern int srs_metrics_labels_parse(const std::vector<std::string>& labels);
+// Append the family of metric in OpenMetrics text, the type is counter, gauge or info, for example:
+//      # TYPE srs_clients gauge
+//      # HELP srs_clients The number of clients.
+extern void srs_metrics_family(std::string& out, const char* name, const char* type, const char* help);
+// Append the sample of metric, the labels is optional, for example:
+//      srs_clients{vhost="__defaultVhost__"} 10
+extern void srs_metrics_sample(std::string& out, const char* name, const std::string& labels, int64_t value);
+extern void srs_metrics_number(std::string& out, const char* name, const std::string& labels, double value);
+// Escape the value of label, then append it to out, for example, vhost="__defaultVhost__".
+extern void srs_metrics_label(std::string& out, const char* name, const std::string& value);
+
 class SrsStatistic
 {
 private:
@@ -128,9 +162,25 @@ private:
 private:
     // The key: client id, value: stream object.
     std::map<std::string, SrsStatisticClient*> clients;
+    // The slots of clients, indexed by the low 32bits of handle, NULL if free.
+    std::vector<SrsStatisticClient*> slots_;
+    // The generation of slots, which is the high 32bits of handle, to detect the stale handle
+    // after the slot is reused by another client.
+    std::vector<uint32_t> generations_;
+    std::vector<int> free_slots_;
+    // The dense array of clients, to aggregate the stat and page the clients.
+    std::vector<SrsStatisticClient*> dense_;
     // The server total kbps.
     SrsKbps* kbps;
     SrsWallClock* clk;
+private:
+    // The labels of metrics, all series are reset when it changes.
+    int metrics_labels_;
+    // The key: labels of series, value: the series of streams.
+    std::map<std::string, SrsMetricsSeries*> metrics_series_;
+    // The key: stream id, value: the stream in series, which is kept until the stream leaves, so
+    // the series of stream is stable across scrapes.
+    std::map<std::string, SrsMetricsStream*> metrics_streams_;
 private:
     SrsStatistic();
     virtual ~SrsStatistic();
@@ -141,6 +191,11 @@ public:
     virtual SrsStatisticVhost* find_vhost_by_name(std::string name);
     virtual SrsStatisticStream* find_stream(std::string sid);
     virtual SrsStatisticClient* find_client(std::string client_id);
+    // Get the handle of client, -1 if not found. The handle is stable until client disconnect, so
+    // user should get it once after on_client, then update the stat by handle.
+    virtual int64_t find_handle(std::string client_id);
+    // Get the client by handle, NULL if not found or disconnected.
+    virtual SrsStatisticClient* find_client(int64_t handle);
 public:
     // When got video info for stream.
     virtual srs_error_t on_video_info(SrsRequest* req, SrsVideoCodecId vcodec, SrsAvcProfile avc_profile,
@@ -148,9 +203,9 @@ public:
     // When got audio info for stream.
     virtual srs_error_t on_audio_info(SrsRequest* req, SrsAudioCodecId acodec, SrsAudioSampleRate asample_rate,
         SrsAudioChannels asound_type, SrsAacObjectType aac_object);
-    // When got videos, update the frames.
+    // When got videos, update the frames of stream, by the handle of publisher.
     // We only stat the total number of video frames.
-    virtual srs_error_t on_video_frames(SrsRequest* req, int nb_frames);
+    virtual srs_error_t on_video_frames(int64_t handle, int nb_frames);
     // When publish stream.
     // @param req the request object of publish connection.
     // @param publisher_id The id of publish connection.
@@ -164,15 +219,12 @@ public:
     // @param conn, the physical absract connection object.
     // @param type, the type of connection.
     virtual srs_error_t on_client(std::string id, SrsRequest* req, ISrsExpire* conn, SrsRtmpConnType type);
-    // Client disconnect
+    // Client disconnect, collect the last delta of kbps.
     // @remark the on_disconnect always call, while the on_client is call when
     //      only got the request object, so the client specified by id maybe not
     //      exists in stat.
     virtual void on_disconnect(std::string id);
-    // Sample the kbps, add delta bytes of conn.
-    // Use kbps_sample() to get all result of kbps stat.
-    virtual void kbps_add_delta(std::string id, ISrsKbpsDelta* delta);
-    // Calc the result for all kbps.
+    // Collect the delta of clients by the dense array, then calc the result for all kbps.
     // @return the server kbps.
     virtual SrsKbps* kbps_sample();
 public:
@@ -183,13 +235,26 @@ public:
     virtual srs_error_t dumps_vhosts(SrsJsonArray* arr);
     // Dumps the streams to amf0 array.
     virtual srs_error_t dumps_streams(SrsJsonArray* arr);
-    // Dumps the clients to amf0 array
+    // Dumps the clients to amf0 array, which only visits the clients of page.
     // @param start the start index, from 0.
     // @param count the max count of clients to dump.
     virtual srs_error_t dumps_clients(SrsJsonArray* arr, int start, int count);
+    // Dumps the metrics of clients, vhosts and streams in OpenMetrics text, append to out.
+    // @param labels The labels of stream metrics, the streams with the same labels are aggregated.
+    // @param max_streams The max series of streams, the others are aggregated to the series of "others".
+    virtual void dumps_metrics(std::string& out, int labels, int max_streams);
+private:
+    // Update the series of streams, the stream joins a series when first seen, and leaves it when
+    // closed or idle, then the counters of stream are added to the series, to keep it monotonic.
+    virtual void update_metrics(int labels, int max_streams);
+    virtual void leave_metrics(std::string id);
 private:
     virtual SrsStatisticVhost* create_vhost(SrsRequest* req);
     virtual SrsStatisticStream* create_stream(SrsStatisticVhost* vhost, SrsRequest* req);
+    // Alloc the slot and handle for client, and append to the dense array.
+    virtual void attach_client(SrsStatisticClient* client);
+    // Free the slot of client, and remove from the dense array.
+    virtual void detach_client(SrsStatisticClient* client);
 };
 
 #endif
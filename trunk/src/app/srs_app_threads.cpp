@@ -10,11 +10,19 @@
 #include <srs_app_hybrid.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_kernel_utility.hpp>
+#include <srs_kernel_flv.hpp>
 #include <srs_app_rtc_source.hpp>
 #include <srs_app_source.hpp>
 #include <srs_app_pithy_print.hpp>
 #include <srs_app_rtc_server.hpp>
 #include <srs_app_log.hpp>
+#include <srs_app_hls.hpp>
+#include <srs_app_st.hpp>
+#include <srs_app_admission.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_error.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_app_statistic.hpp>
 
 #ifdef SRS_RTC
 #include <srs_app_rtc_dtls.hpp>
@@ -141,7 +149,17 @@ extern SrsPps* _srs_pps_aloss2;
 extern SrsPps* _srs_pps_cids_get;
 extern SrsPps* _srs_pps_cids_set;
 
+extern SrsHistogram* _srs_latency_publish;
+extern SrsHistogram* _srs_latency_queue;
+extern SrsHistogram* _srs_latency_send;
+extern SrsHistogram* _srs_latency_loop;
+#ifdef SRS_RTC
+extern SrsHistogram* _srs_latency_rtc;
+#endif
+
 extern SrsPps* _srs_pps_objs_msgs;
+extern SrsPps* _srs_pps_objs_pool_hit;
+extern SrsPps* _srs_pps_objs_pool_miss;
 
 extern SrsPps* _srs_pps_objs_rtps;
 extern SrsPps* _srs_pps_objs_rraw;
@@ -149,19 +167,43 @@ extern SrsPps* _srs_pps_objs_rfua;
 extern SrsPps* _srs_pps_objs_rbuf;
 extern SrsPps* _srs_pps_objs_rothers;
 
+// The max duration to pause the new player when critical.
+#define SRS_CIRCUIT_BREAKER_PAUSE (3 * SRS_UTIME_SECONDS)
+// The interval to check the water-level when pause the player.
+#define SRS_CIRCUIT_BREAKER_PAUSE_STEP (100 * SRS_UTIME_MILLISECONDS)
+
+// The number of writes blocked by full socket send buffer, in ST.
+extern unsigned long long _st_stat_writev_blocked;
+
 SrsCircuitBreaker::SrsCircuitBreaker()
 {
     enabled_ = false;
-    high_threshold_ = 0;
-    high_pulse_ = 0;
-    critical_threshold_ = 0;
-    critical_pulse_ = 0;
-    dying_threshold_ = 0;
-    dying_pulse_ = 0;
+    high_threshold_ = 90;
+    high_pulse_ = 2;
+    critical_threshold_ = 95;
+    critical_pulse_ = 1;
+    dying_threshold_ = 99;
+    dying_pulse_ = 5;
+    lag_limit_ = 0;
+    memory_limit_ = 0;
+    queue_limit_ = 0;
+    sndbuf_limit_ = 0;
 
     hybrid_high_water_level_ = 0;
     hybrid_critical_water_level_ = 0;
     hybrid_dying_water_level_ = 0;
+
+    cpu_ = 0;
+    lag_ = 0;
+    memory_ = 0;
+    queue_ = 0;
+    sndbuf_ = 0;
+    max_queue_ = 0;
+    nn_blocked_ = 0;
+    load_ = 0;
+    signal_ = "cpu";
+
+    nn_paused_players_ = nn_rejected_players_ = nn_rejected_publishers_ = nn_dropped_frames_ = 0;
 }
 
 SrsCircuitBreaker::~SrsCircuitBreaker()
@@ -172,25 +214,36 @@ srs_error_t SrsCircuitBreaker::initialize()
 {
     srs_error_t err = srs_success;
 
-    enabled_ = _srs_config->get_circuit_breaker();
     high_threshold_ = _srs_config->get_high_threshold();
     high_pulse_ = _srs_config->get_high_pulse();
     critical_threshold_ = _srs_config->get_critical_threshold();
     critical_pulse_ = _srs_config->get_critical_pulse();
     dying_threshold_ = _srs_config->get_dying_threshold();
     dying_pulse_ = _srs_config->get_dying_pulse();
+    setup(_srs_config->get_lag_limit(), _srs_config->get_memory_limit(), _srs_config->get_queue_limit(),
+        _srs_config->get_sndbuf_limit());
+    enabled_ = _srs_config->get_circuit_breaker();
 
     // Update the water level for circuit breaker.
     // @see SrsCircuitBreaker::on_timer()
     _srs_hybrid->timer1s()->subscribe(this);
 
-    srs_trace("CircuitBreaker: enabled=%d, high=%dx%d, critical=%dx%d, dying=%dx%d", enabled_,
+    srs_trace("CircuitBreaker: enabled=%d, high=%dx%d, critical=%dx%d, dying=%dx%d, limits=%dms,%dMB,%dms,%d", enabled_,
         high_pulse_, high_threshold_, critical_pulse_, critical_threshold_,
-        dying_pulse_, dying_threshold_);
+        dying_pulse_, dying_threshold_, srsu2msi(lag_limit_), memory_limit_, srsu2msi(queue_limit_), sndbuf_limit_);
 
     return err;
 }
 
+void SrsCircuitBreaker::setup(srs_utime_t lag, int memory, srs_utime_t queue, int sndbuf)
+{
+    enabled_ = true;
+    lag_limit_ = lag;
+    memory_limit_ = memory;
+    queue_limit_ = queue;
+    sndbuf_limit_ = sndbuf;
+}
+
 bool SrsCircuitBreaker::hybrid_high_water_level()
 {
     return enabled_ && (hybrid_critical_water_level() || hybrid_high_water_level_);
@@ -206,42 +259,188 @@ bool SrsCircuitBreaker::hybrid_dying_water_level()
     return enabled_ && dying_pulse_ && hybrid_dying_water_level_ >= dying_pulse_;
 }
 
-srs_error_t SrsCircuitBreaker::on_timer(srs_utime_t interval)
+srs_error_t SrsCircuitBreaker::on_play()
 {
     srs_error_t err = srs_success;
 
-    // Update the CPU usage.
-    srs_update_proc_stat();
-    SrsProcSelfStat* stat = srs_get_self_proc_stat();
+    if (!hybrid_critical_water_level()) {
+        return err;
+    }
+
+    // Pause the new player, util the water-level is down, because the player might retry at once.
+    nn_paused_players_++;
+    for (srs_utime_t elapsed = 0; elapsed < SRS_CIRCUIT_BREAKER_PAUSE; elapsed += SRS_CIRCUIT_BREAKER_PAUSE_STEP) {
+        srs_usleep(SRS_CIRCUIT_BREAKER_PAUSE_STEP);
 
-    // Reset the high water-level when CPU is low for N times.
-    if (stat->percent * 100 > high_threshold_) {
+        if (!hybrid_critical_water_level()) {
+            return err;
+        }
+    }
+
+    nn_rejected_players_++;
+    return srs_error_new(ERROR_SYSTEM_OVERLOAD, "reject player, load=%.2f%%, signal=%s", load_, signal_);
+}
+
+srs_error_t SrsCircuitBreaker::on_publish()
+{
+    srs_error_t err = srs_success;
+
+    if (hybrid_dying_water_level()) {
+        nn_rejected_publishers_++;
+        return srs_error_new(ERROR_SYSTEM_OVERLOAD, "reject publisher, load=%.2f%%, signal=%s", load_, signal_);
+    }
+
+    return err;
+}
+
+bool SrsCircuitBreaker::on_consume(srs_utime_t duration, char* payload, int size, bool is_video, int8_t nalu_length)
+{
+    if (max_queue_ < duration) {
+        max_queue_ = duration;
+    }
+
+    // Drop the disposable frames, which are never referenced, to save bandwidth for players.
+    if (!is_video || !hybrid_critical_water_level()) {
+        return false;
+    }
+
+    if (!SrsFlvVideo::disposable(payload, size, nalu_length)) {
+        return false;
+    }
+
+    nn_dropped_frames_++;
+    return true;
+}
+
+void SrsCircuitBreaker::on_signals(float cpu, srs_utime_t lag, int memory, srs_utime_t queue, int sndbuf)
+{
+    cpu_ = cpu;
+    lag_ = lag;
+    memory_ = memory;
+    queue_ = queue;
+    sndbuf_ = sndbuf;
+
+    // The load is the max percent of signals to their limits.
+    load_ = cpu;
+    signal_ = "cpu";
+    if (lag_limit_ > 0 && lag * 100.0 / lag_limit_ > load_) {
+        load_ = lag * 100.0 / lag_limit_;
+        signal_ = "lag";
+    }
+    if (memory_limit_ > 0 && memory * 100.0 / memory_limit_ > load_) {
+        load_ = memory * 100.0 / memory_limit_;
+        signal_ = "memory";
+    }
+    if (queue_limit_ > 0 && queue * 100.0 / queue_limit_ > load_) {
+        load_ = queue * 100.0 / queue_limit_;
+        signal_ = "queue";
+    }
+    if (sndbuf_limit_ > 0 && sndbuf * 100.0 / sndbuf_limit_ > load_) {
+        load_ = sndbuf * 100.0 / sndbuf_limit_;
+        signal_ = "sndbuf";
+    }
+
+    // Reset the high water-level when load is low for N times.
+    if (load_ > high_threshold_) {
         hybrid_high_water_level_ = high_pulse_;
     } else if (hybrid_high_water_level_ > 0) {
         hybrid_high_water_level_--;
     }
 
-    // Reset the critical water-level when CPU is low for N times.
-    if (stat->percent * 100 > critical_threshold_) {
+    // Reset the critical water-level when load is low for N times.
+    if (load_ > critical_threshold_) {
         hybrid_critical_water_level_ = critical_pulse_;
     } else if (hybrid_critical_water_level_ > 0) {
         hybrid_critical_water_level_--;
     }
 
-    // Reset the dying water-level when CPU is low for N times.
-    if (stat->percent * 100 > dying_threshold_) {
+    // Reset the dying water-level when load is low for N times.
+    if (load_ > dying_threshold_) {
         hybrid_dying_water_level_ = srs_min(dying_pulse_ + 1, hybrid_dying_water_level_ + 1);
     } else if (hybrid_dying_water_level_ > 0) {
         hybrid_dying_water_level_ = 0;
     }
+}
+
+void SrsCircuitBreaker::dumps(SrsJsonObject* obj)
+{
+    bool high = hybrid_high_water_level();
+    bool critical = hybrid_critical_water_level();
+    bool dying = hybrid_dying_water_level();
+
+    obj->set("enabled", SrsJsonAny::boolean(enabled_));
+    obj->set("level", SrsJsonAny::str(dying ? "dying" : (critical ? "critical" : (high ? "high" : "normal"))));
+    obj->set("load", SrsJsonAny::number(load_));
+    obj->set("signal", SrsJsonAny::str(signal_));
+
+    SrsJsonObject* signals = SrsJsonAny::object();
+    obj->set("signals", signals);
+
+    signals->set("cpu", SrsJsonAny::number(cpu_));
+    signals->set("lag", SrsJsonAny::integer(srsu2ms(lag_)));
+    signals->set("memory", SrsJsonAny::integer(memory_));
+    signals->set("queue", SrsJsonAny::integer(srsu2ms(queue_)));
+    signals->set("sndbuf", SrsJsonAny::integer(sndbuf_));
+
+    SrsJsonObject* actions = SrsJsonAny::object();
+    obj->set("actions", actions);
+
+    actions->set("disable_nack", SrsJsonAny::boolean(high));
+    actions->set("disable_twcc", SrsJsonAny::boolean(critical));
+    actions->set("pause_players", SrsJsonAny::boolean(critical));
+    actions->set("drop_frames", SrsJsonAny::boolean(critical));
+    actions->set("refuse_publishers", SrsJsonAny::boolean(dying));
+
+    SrsJsonObject* stat = SrsJsonAny::object();
+    obj->set("stat", stat);
+
+    stat->set("paused_players", SrsJsonAny::integer(nn_paused_players_));
+    stat->set("rejected_players", SrsJsonAny::integer(nn_rejected_players_));
+    stat->set("rejected_publishers", SrsJsonAny::integer(nn_rejected_publishers_));
+    stat->set("dropped_frames", SrsJsonAny::integer(nn_dropped_frames_));
+}
+
+void SrsCircuitBreaker::dumps_metrics(string& out)
+{
+    int level = hybrid_dying_water_level() ? 3 : (hybrid_critical_water_level() ? 2 : (hybrid_high_water_level() ? 1 : 0));
+
+    srs_metrics_family(out, "srs_circuit_breaker_level", "gauge", "The water-level, 0 normal, 1 high, 2 critical, 3 dying.");
+    srs_metrics_sample(out, "srs_circuit_breaker_level", "", level);
+    srs_metrics_family(out, "srs_circuit_breaker_load", "gauge", "The load percent of the max signal.");
+    srs_metrics_number(out, "srs_circuit_breaker_load", "", load_);
+
+    srs_metrics_family(out, "srs_circuit_breaker_paused_players", "counter", "The players paused when overload.");
+    srs_metrics_sample(out, "srs_circuit_breaker_paused_players_total", "", nn_paused_players_);
+    srs_metrics_family(out, "srs_circuit_breaker_rejected_players", "counter", "The players rejected when overload.");
+    srs_metrics_sample(out, "srs_circuit_breaker_rejected_players_total", "", nn_rejected_players_);
+    srs_metrics_family(out, "srs_circuit_breaker_rejected_publishers", "counter", "The publishers rejected when overload.");
+    srs_metrics_sample(out, "srs_circuit_breaker_rejected_publishers_total", "", nn_rejected_publishers_);
+    srs_metrics_family(out, "srs_circuit_breaker_dropped_frames", "counter", "The frames dropped when overload.");
+    srs_metrics_sample(out, "srs_circuit_breaker_dropped_frames_total", "", nn_dropped_frames_);
+}
+
+srs_error_t SrsCircuitBreaker::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    // Update the CPU usage.
+    srs_update_proc_stat();
+    SrsProcSelfStat* stat = srs_get_self_proc_stat();
 
-    // Show statistics for RTC server.
-    SrsProcSelfStat* u = srs_get_self_proc_stat();
     // Resident Set Size: number of pages the process has in real memory.
-    int memory = (int)(u->rss * 4 / 1024);
+    int memory = (int)(stat->rss * 4 / 1024);
+
+    // The max event loop lag and consumer queue in this duration.
+    srs_utime_t lag = _srs_hybrid->clock_monitor()->consume_lag();
+    srs_utime_t queue = max_queue_;
+    max_queue_ = 0;
+
+    // The writes blocked by full send buffer in this duration.
+    int sndbuf = (int)(_st_stat_writev_blocked - nn_blocked_);
+    nn_blocked_ = _st_stat_writev_blocked;
 
-    // The hybrid thread cpu and memory.
-    float thread_percent = stat->percent * 100;
+    // Update the water-level by signals.
+    on_signals(stat->percent * 100, lag, memory, queue, sndbuf);
 
     static char buf[128];
 
@@ -256,10 +455,11 @@ srs_error_t SrsCircuitBreaker::on_timer(srs_utime_t interval)
 #endif
 
     if (enabled_ && (hybrid_high_water_level() || hybrid_critical_water_level())) {
-        srs_trace("CircuitBreaker: cpu=%.2f%%,%dMB, break=%d,%d,%d, cond=%.2f%%%s",
-            u->percent * 100, memory,
+        srs_trace("CircuitBreaker: cpu=%.2f%%,%dMB, break=%d,%d,%d, cond=%.2f%%,%s, lag=%dms, queue=%dms, sndbuf=%d, drop=%" PRId64 "%s",
+            cpu_, memory,
             hybrid_high_water_level(), hybrid_critical_water_level(), hybrid_dying_water_level(), // Whether Circuit-Break is enable.
-            thread_percent, // The conditions to enable Circuit-Breaker.
+            load_, signal_, // The conditions to enable Circuit-Breaker.
+            srsu2msi(lag), srsu2msi(queue), sndbuf, nn_dropped_frames_,
             snk_desc.c_str()
         );
     }
@@ -295,6 +495,10 @@ srs_error_t srs_thread_initialize()
     _srs_sources = new SrsLiveSourceManager();
     _srs_stages = new SrsStageManager();
     _srs_circuit_breaker = new SrsCircuitBreaker();
+    _srs_stacks = new SrsCoroutineStacks();
+    _srs_cpu = new SrsCoroutineCpu();
+    _srs_admission = new SrsAdmission();
+    _srs_hls_parts = new SrsHlsPartNotifier();
 
 #ifdef SRS_RTC
     _srs_rtc_sources = new SrsRtcSourceManager();
@@ -385,6 +589,20 @@ srs_error_t srs_thread_initialize()
 
     _srs_pps_spkts = new SrsPps();
     _srs_pps_objs_msgs = new SrsPps();
+    _srs_pps_objs_pool_hit = new SrsPps();
+    _srs_pps_objs_pool_miss = new SrsPps();
+
+    // The pool to reuse payload of RTMP messages.
+    _srs_payload_pool = new SrsPayloadPool(SRS_PERF_PAYLOAD_POOL_SIZE, SRS_PERF_PAYLOAD_POOL_MAX_PAYLOAD);
+
+    // The latency histograms of stages.
+    _srs_latency_publish = new SrsHistogram();
+    _srs_latency_queue = new SrsHistogram();
+    _srs_latency_send = new SrsHistogram();
+    _srs_latency_loop = new SrsHistogram();
+#ifdef SRS_RTC
+    _srs_latency_rtc = new SrsHistogram();
+#endif
 
 #ifdef SRS_RTC
     _srs_pps_sstuns = new SrsPps();
@@ -9,9 +9,23 @@
 
 #include <srs_core.hpp>
 
+#include <string>
+
 #include <srs_app_hourglass.hpp>
 
-// Protect server in high load.
+class SrsJsonObject;
+
+// Protect server in high load, by the water-level of load, which is the max percent of signals to
+// their limits:
+//      cpu: The CPU percent of hybrid server.
+//      lag: The event loop lag, the deviation of the 20ms timer.
+//      memory: The memory RSS in MB.
+//      queue: The max duration of consumer queues, slow players make it grow.
+//      sndbuf: The number of writes blocked by full socket send buffer, per second.
+// The graded actions by the water-level:
+//      high: Disable NACK for RTC, defer new clients by admission.
+//      critical: Disable TWCC for RTC, pause new players, drop disposable frames for players.
+//      dying: Drop RTC packets for players, refuse new publishers.
 class SrsCircuitBreaker : public ISrsFastTimer
 {
 private:
@@ -23,22 +37,63 @@ private:
     int critical_pulse_;
     int dying_threshold_;
     int dying_pulse_;
+    // The limits of signals, 0 to ignore it.
+    srs_utime_t lag_limit_;
+    int memory_limit_;
+    srs_utime_t queue_limit_;
+    int sndbuf_limit_;
 private:
     // Reset the water-level when CPU is low for N times.
     // @note To avoid the CPU change rapidly.
     int hybrid_high_water_level_;
     int hybrid_critical_water_level_;
     int hybrid_dying_water_level_;
+private:
+    // The last samples of signals.
+    float cpu_;
+    srs_utime_t lag_;
+    int memory_;
+    srs_utime_t queue_;
+    int sndbuf_;
+    // The max duration of consumer queues in this duration.
+    srs_utime_t max_queue_;
+    // The last number of blocked writes.
+    uint64_t nn_blocked_;
+    // The load percent, and the signal of the max load.
+    float load_;
+    const char* signal_;
+private:
+    // The stat of actions.
+    int64_t nn_paused_players_;
+    int64_t nn_rejected_players_;
+    int64_t nn_rejected_publishers_;
+    int64_t nn_dropped_frames_;
 public:
     SrsCircuitBreaker();
     virtual ~SrsCircuitBreaker();
 public:
     srs_error_t initialize();
+    // Setup the limits of signals, and enable the circuit breaker.
+    void setup(srs_utime_t lag, int memory, srs_utime_t queue, int sndbuf);
 public:
     // Whether hybrid server water-level is high.
     bool hybrid_high_water_level();
     bool hybrid_critical_water_level();
     bool hybrid_dying_water_level();
+public:
+    // When player starts, wait for a while if critical, return error if still critical.
+    srs_error_t on_play();
+    // When publisher starts, return error if dying.
+    srs_error_t on_publish();
+    // When consumer enqueue the msg, update the queue duration, return true to drop the msg.
+    // @param nalu_length the lengthSizeMinusOne of H.264, -1 if unknown.
+    bool on_consume(srs_utime_t duration, char* payload, int size, bool is_video, int8_t nalu_length);
+    // Update the water-level by the samples of signals.
+    void on_signals(float cpu, srs_utime_t lag, int memory, srs_utime_t queue, int sndbuf);
+    // Dumps the signals and actions to json.
+    void dumps(SrsJsonObject* obj);
+    // Dumps the level and actions in OpenMetrics text, append to out.
+    void dumps_metrics(std::string& out);
 // interface ISrsFastTimer
 private:
     srs_error_t on_timer(srs_utime_t interval);
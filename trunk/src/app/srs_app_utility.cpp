@@ -27,6 +27,9 @@ using namespace std;
 #include <srs_app_config.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_error.hpp>
+#include <srs_app_source.hpp>
+#include <srs_app_admission.hpp>
+#include <srs_app_threads.hpp>
 #include <srs_protocol_kbps.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_kernel_buffer.hpp>
@@ -1256,6 +1259,7 @@ void srs_api_dump_summaries(SrsJsonObject* obj)
     SrsNetworkDevices* n = srs_get_network_devices();
     SrsNetworkRtmpServer* nrs = srs_get_network_rtmp_server();
     SrsDiskStat* d = srs_get_disk_stat();
+    SrsGopCacheStat* g = srs_get_gop_cache_stat();
     
     float self_mem_percent = 0;
     if (m->MemTotal > 0) {
@@ -1317,6 +1321,23 @@ void srs_api_dump_summaries(SrsJsonObject* obj)
     self->set("mem_percent", SrsJsonAny::number(self_mem_percent));
     self->set("cpu_percent", SrsJsonAny::number(u->percent));
     self->set("srs_uptime", SrsJsonAny::integer(srs_uptime));
+    // gop cache memory of all streams.
+    self->set("gop_cache_kbyte", SrsJsonAny::integer(g->bytes / 1024));
+    self->set("gop_cache_msgs", SrsJsonAny::integer(g->msgs));
+    self->set("gop_cache_overflows", SrsJsonAny::integer(g->overflows));
+    // admission control of new clients.
+    if (_srs_admission) {
+        SrsJsonObject* admission = SrsJsonAny::object();
+        self->set("admission", admission);
+        _srs_admission->dumps(admission);
+    }
+
+    // circuit breaker for overload.
+    if (_srs_circuit_breaker) {
+        SrsJsonObject* circuit_breaker = SrsJsonAny::object();
+        self->set("circuit_breaker", circuit_breaker);
+        _srs_circuit_breaker->dumps(circuit_breaker);
+    }
     
     // system
     SrsJsonObject* sys = SrsJsonAny::object();
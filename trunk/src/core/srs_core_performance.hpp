@@ -136,6 +136,16 @@
  */
 #define SRS_PERF_CHUNK_STREAM_CACHE 16
 
+/**
+ * the pool to reuse the payload of RTMP messages, size-classed from 512B to 1MB,
+ * to avoid malloc and free for each message when there are lots of publishers.
+ * @remark 0 to disable the payload pool.
+ */
+// in bytes, the max bytes of free payloads to keep in pool.
+#define SRS_PERF_PAYLOAD_POOL_SIZE (32 * 1024 * 1024)
+// in bytes, the max payload to use the pool, larger payload always use malloc.
+#define SRS_PERF_PAYLOAD_POOL_MAX_PAYLOAD (1024 * 1024)
+
 /**
  * the gop cache and play cache queue.
  */
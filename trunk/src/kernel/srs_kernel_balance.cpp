@@ -38,3 +38,59 @@ string SrsLbRoundRobin::select(const vector<string>& servers)
     return elem;
 }
 
+
+SrsLbFastest::SrsLbFastest()
+{
+}
+
+SrsLbFastest::~SrsLbFastest()
+{
+}
+
+string SrsLbFastest::select(const vector<string>& servers)
+{
+    srs_assert(!servers.empty());
+    
+    // start from the next server, to round-robin the servers never sampled.
+    int start = (int)(count++ % servers.size());
+    
+    index = -1;
+    srs_utime_t min = 0;
+    for (int i = 0; i < (int)servers.size(); i++) {
+        int j = (start + i) % (int)servers.size();
+        srs_utime_t v = latency(servers.at(j));
+        
+        if (v < 0) {
+            index = j;
+            break;
+        }
+        
+        if (index < 0 || v < min) {
+            index = j;
+            min = v;
+        }
+    }
+    
+    elem = servers.at(index);
+    
+    return elem;
+}
+
+void SrsLbFastest::sample(string server, srs_utime_t latency)
+{
+    map<string, srs_utime_t>::iterator it = latencies.find(server);
+    if (it == latencies.end()) {
+        latencies[server] = latency;
+    } else {
+        it->second = (it->second * 3 + latency) / 4;
+    }
+}
+
+srs_utime_t SrsLbFastest::latency(string server)
+{
+    map<string, srs_utime_t>::iterator it = latencies.find(server);
+    if (it == latencies.end()) {
+        return -1;
+    }
+    return it->second;
+}
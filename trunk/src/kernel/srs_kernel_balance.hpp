@@ -11,6 +11,7 @@
 
 #include <vector>
 #include <string>
+#include <map>
 
 /**
  * the round-robin load balance algorithm,
@@ -18,7 +19,7 @@
  */
 class SrsLbRoundRobin
 {
-private:
+protected:
     // current selected index.
     int index;
     // total scheduled count.
@@ -34,5 +35,26 @@ public:
     virtual std::string select(const std::vector<std::string>& servers);
 };
 
+/**
+ * the fastest load balance algorithm, select the server with the min latency,
+ * the latency is sampled by user, for example, the connect and first frame latency of edge.
+ * @remark the server never sampled is preferred, so all servers are measured.
+ */
+class SrsLbFastest : public SrsLbRoundRobin
+{
+private:
+    // the smoothed latency of servers.
+    std::map<std::string, srs_utime_t> latencies;
+public:
+    SrsLbFastest();
+    virtual ~SrsLbFastest();
+public:
+    virtual std::string select(const std::vector<std::string>& servers);
+    // sample the latency of server, smoothed by EWMA.
+    virtual void sample(std::string server, srs_utime_t latency);
+    // get the smoothed latency of server, -1 if never sampled.
+    virtual srs_utime_t latency(std::string server);
+};
+
 #endif
 
@@ -107,8 +107,8 @@ bool SrsFlvVideo::keyframe(char* data, int size)
 
 bool SrsFlvVideo::sh(char* data, int size)
 {
-    // sequence header only for h264
-    if (!h264(data, size)) {
+    // sequence header only for h264 or h265
+    if (!h264(data, size) && !hevc(data, size)) {
         return false;
     }
     
@@ -139,6 +139,74 @@ bool SrsFlvVideo::h264(char* data, int size)
     return codec_id == SrsVideoCodecIdAVC;
 }
 
+bool SrsFlvVideo::hevc(char* data, int size)
+{
+    // 1bytes required.
+    if (size < 1) {
+        return false;
+    }
+    
+    char codec_id = data[0];
+    codec_id = codec_id & 0x0F;
+    
+    return codec_id == SrsVideoCodecIdHEVC;
+}
+
+bool SrsFlvVideo::disposable(char* data, int size, int8_t nalu_length)
+{
+    // 1bytes required.
+    if (size < 1) {
+        return false;
+    }
+    
+    char frame_type = data[0];
+    frame_type = (frame_type >> 4) & 0x0F;
+    
+    if (frame_type == SrsVideoAvcFrameTypeDisposableInterFrame) {
+        return true;
+    }
+    
+    // Only the H.264 inter frame of NALUs, which is 5bytes header.
+    if (!h264(data, size) || frame_type != SrsVideoAvcFrameTypeInterFrame || size < 5) {
+        return false;
+    }
+    // The NALU length size is 1, 2 or 4 bytes, we can't parse the NALUs without it.
+    if (nalu_length != 0 && nalu_length != 1 && nalu_length != 3) {
+        return false;
+    }
+    if (data[1] != SrsVideoAvcFrameTraitNALU) {
+        return false;
+    }
+    
+    // Find the first slice, which is disposable if nal_ref_idc is 0.
+    uint8_t* p = (uint8_t*)data + 5;
+    uint8_t* end = (uint8_t*)data + size;
+    int nb_length = nalu_length + 1;
+    while (end - p > nb_length) {
+        int nb_nalu = 0;
+        for (int i = 0; i < nb_length; i++) {
+            nb_nalu = (nb_nalu << 8) | p[i];
+        }
+        p += nb_length;
+        
+        if (nb_nalu <= 0 || nb_nalu > end - p) {
+            return false;
+        }
+        
+        SrsAvcNaluType nalu_type = (SrsAvcNaluType)(p[0] & 0x1f);
+        if (nalu_type == SrsAvcNaluTypeNonIDR || nalu_type == SrsAvcNaluTypeDataPartitionA) {
+            return (p[0] & 0x60) == 0;
+        }
+        if (nalu_type == SrsAvcNaluTypeIDR) {
+            return false;
+        }
+        
+        p += nb_nalu;
+    }
+    
+    return false;
+}
+
 bool SrsFlvVideo::acceptable(char* data, int size)
 {
     // 1bytes required.
@@ -154,7 +222,7 @@ bool SrsFlvVideo::acceptable(char* data, int size)
         return false;
     }
     
-    if (codec_id < 2 || codec_id > 7) {
+    if ((codec_id < 2 || codec_id > 7) && codec_id != SrsVideoCodecIdHEVC) {
         return false;
     }
     
@@ -344,6 +412,37 @@ string srs_avc_level2str(SrsAvcLevel level)
     }
 }
 
+string srs_hevc_profile2str(SrsHevcProfile profile)
+{
+    switch (profile) {
+        case SrsHevcProfileMain: return "Main";
+        case SrsHevcProfileMain10: return "Main10";
+        case SrsHevcProfileMainStillPicture: return "MainStillPicture";
+        case SrsHevcProfileRext: return "Rext";
+        default: return "Other";
+    }
+}
+
+string srs_hevc_level2str(SrsHevcLevel level)
+{
+    switch (level) {
+        case SrsHevcLevel_1: return "1";
+        case SrsHevcLevel_2: return "2";
+        case SrsHevcLevel_21: return "2.1";
+        case SrsHevcLevel_3: return "3";
+        case SrsHevcLevel_31: return "3.1";
+        case SrsHevcLevel_4: return "4";
+        case SrsHevcLevel_41: return "4.1";
+        case SrsHevcLevel_5: return "5";
+        case SrsHevcLevel_51: return "5.1";
+        case SrsHevcLevel_52: return "5.2";
+        case SrsHevcLevel_6: return "6";
+        case SrsHevcLevel_61: return "6.1";
+        case SrsHevcLevel_62: return "6.2";
+        default: return "Other";
+    }
+}
+
 SrsSample::SrsSample()
 {
     size = 0;
@@ -451,6 +550,8 @@ SrsVideoCodecConfig::SrsVideoCodecConfig()
     NAL_unit_length = 0;
     avc_profile = SrsAvcProfileReserved;
     avc_level = SrsAvcLevelReserved;
+    hevc_profile = SrsHevcProfileReserved;
+    hevc_level = SrsHevcLevelReserved;
     
     payload_format = SrsAvcPayloadFormatGuess;
 }
@@ -542,6 +643,22 @@ srs_error_t SrsVideoFrame::add_sample(char* bytes, int size)
         return srs_error_wrap(err, "add frame");
     }
     
+    // For HEVC, the IRAP(BLA, IDR or CRA) is keyframe.
+    SrsVideoCodecConfig* c = vcodec();
+    if (c && c->id == SrsVideoCodecIdHEVC) {
+        SrsHevcNaluType hevc_nalu_type = SrsHevcNaluTypeParse(bytes[0]);
+        
+        if (hevc_nalu_type >= SrsHevcNaluTypeCodedSliceBlaWlp && hevc_nalu_type <= SrsHevcNaluTypeReservedIrap23) {
+            has_idr = true;
+        } else if (hevc_nalu_type >= SrsHevcNaluTypeVps && hevc_nalu_type <= SrsHevcNaluTypePps) {
+            has_sps_pps = true;
+        } else if (hevc_nalu_type == SrsHevcNaluTypeAccessUnitDelimiter) {
+            has_aud = true;
+        }
+        
+        return err;
+    }
+    
     // for video, parse the nalu type, set the IDR flag.
     SrsAvcNaluType nal_unit_type = (SrsAvcNaluType)(bytes[0] & 0x1f);
     
@@ -653,7 +770,7 @@ srs_error_t SrsFormat::on_video(int64_t timestamp, char* data, int size)
     SrsVideoCodecId codec_id = (SrsVideoCodecId)(frame_type & 0x0f);
     
     // TODO: Support other codecs.
-    if (codec_id != SrsVideoCodecIdAVC) {
+    if (codec_id != SrsVideoCodecIdAVC && codec_id != SrsVideoCodecIdHEVC) {
         return err;
     }
     
@@ -723,9 +840,9 @@ srs_error_t SrsFormat::video_avc_demux(SrsBuffer* stream, int64_t timestamp)
         return err;
     }
     
-    // only support h.264/avc
-    if (codec_id != SrsVideoCodecIdAVC) {
-        return srs_error_new(ERROR_HLS_DECODE_ERROR, "avc only support video h.264/avc, actual=%d", codec_id);
+    // only support h.264/avc and h.265/hevc
+    if (codec_id != SrsVideoCodecIdAVC && codec_id != SrsVideoCodecIdHEVC) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "only support video h.264/avc or h.265/hevc, actual=%d", codec_id);
     }
     vcodec->id = codec_id;
     
@@ -744,7 +861,11 @@ srs_error_t SrsFormat::video_avc_demux(SrsBuffer* stream, int64_t timestamp)
     raw = stream->data() + stream->pos();
     nb_raw = stream->size() - stream->pos();
     
-    if (avc_packet_type == SrsVideoAvcFrameTraitSequenceHeader) {
+    if (avc_packet_type == SrsVideoAvcFrameTraitSequenceHeader && codec_id == SrsVideoCodecIdHEVC) {
+        if ((err = hevc_demux_hvcc(stream)) != srs_success) {
+            return srs_error_wrap(err, "demux hvcC");
+        }
+    } else if (avc_packet_type == SrsVideoAvcFrameTraitSequenceHeader) {
         // TODO: FIXME: Maybe we should ignore any error for parsing sps/pps.
         if ((err = avc_demux_sps_pps(stream)) != srs_success) {
             return srs_error_wrap(err, "demux SPS/PPS");
@@ -760,6 +881,217 @@ srs_error_t SrsFormat::video_avc_demux(SrsBuffer* stream, int64_t timestamp)
     return err;
 }
 
+srs_error_t SrsFormat::hevc_demux_hvcc(SrsBuffer* stream)
+{
+    int avc_extra_size = stream->size() - stream->pos();
+    if (avc_extra_size > 0) {
+        char *copy_stream_from = stream->data() + stream->pos();
+        vcodec->avc_extra_data = std::vector<char>(copy_stream_from, copy_stream_from + avc_extra_size);
+    }
+    
+    // HEVCDecoderConfigurationRecord
+    // 8.3.3.1.2 Syntax, ISO_IEC_14496-15-2017.pdf, page 87
+    if (!stream->require(23)) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc decode sequence header");
+    }
+    // configurationVersion
+    stream->read_1bytes();
+    // general_profile_space(2), general_tier_flag(1), general_profile_idc(5)
+    vcodec->hevc_profile = (SrsHevcProfile)(stream->read_1bytes() & 0x1f);
+    // general_profile_compatibility_flags(32), general_constraint_indicator_flags(48)
+    stream->skip(4 + 6);
+    vcodec->hevc_level = (SrsHevcLevel)(uint8_t)stream->read_1bytes();
+    // min_spatial_segmentation_idc(16), parallelismType(8), chromaFormat(8), bitDepthLumaMinus8(8),
+    // bitDepthChromaMinus8(8), avgFrameRate(16)
+    stream->skip(2 + 1 + 1 + 1 + 1 + 2);
+    // constantFrameRate(2), numTemporalLayers(3), temporalIdNested(1), lengthSizeMinusOne(2)
+    vcodec->NAL_unit_length = stream->read_1bytes() & 0x03;
+    
+    // The arrays of VPS, SPS, PPS and SEI, we only use the first VPS, SPS and PPS.
+    uint8_t numOfArrays = stream->read_1bytes();
+    for (int i = 0; i < numOfArrays; i++) {
+        if (!stream->require(3)) {
+            return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc decode array %d", i);
+        }
+        // array_completeness(1), reserved(1), NAL_unit_type(6)
+        SrsHevcNaluType nal_unit_type = (SrsHevcNaluType)(stream->read_1bytes() & 0x3f);
+        uint16_t numNalus = stream->read_2bytes();
+        
+        std::vector<char>* nalu = NULL;
+        if (nal_unit_type == SrsHevcNaluTypeVps) {
+            nalu = &vcodec->videoParameterSetNALUnit;
+        } else if (nal_unit_type == SrsHevcNaluTypeSps) {
+            nalu = &vcodec->sequenceParameterSetNALUnit;
+        } else if (nal_unit_type == SrsHevcNaluTypePps) {
+            nalu = &vcodec->pictureParameterSetNALUnit;
+        }
+        
+        for (int j = 0; j < numNalus; j++) {
+            if (!stream->require(2)) {
+                return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc decode nalu size");
+            }
+            uint16_t nalUnitLength = stream->read_2bytes();
+            if (!stream->require(nalUnitLength)) {
+                return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc decode nalu %d bytes", nalUnitLength);
+            }
+            
+            if (nalu && j == 0 && nalUnitLength > 0) {
+                nalu->resize(nalUnitLength);
+                stream->read_bytes(&(*nalu)[0], nalUnitLength);
+            } else {
+                stream->skip(nalUnitLength);
+            }
+        }
+    }
+    
+    return hevc_demux_sps();
+}
+
+srs_error_t SrsFormat::hevc_demux_sps()
+{
+    srs_error_t err = srs_success;
+    
+    if (vcodec->sequenceParameterSetNALUnit.empty()) {
+        return err;
+    }
+    
+    SrsBuffer stream(&vcodec->sequenceParameterSetNALUnit[0], (int)vcodec->sequenceParameterSetNALUnit.size());
+    
+    // The NAL unit header is 2 bytes, 7.3.1.2 NAL unit header syntax, T-REC-H.265-201802, page 34.
+    if (!stream.require(2)) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "decode hevc SPS");
+    }
+    SrsHevcNaluType nal_unit_type = SrsHevcNaluTypeParse(stream.read_1bytes());
+    if (nal_unit_type != SrsHevcNaluTypeSps) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "for sps, nal_unit_type shall be equal to 33");
+    }
+    stream.skip(1);
+    if (stream.empty()) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc sps empty rbsp");
+    }
+    
+    // Drop the emulation_prevention_three_byte, XX 00 00 03 XX.
+    std::vector<char> rbsp(stream.left());
+    int nb_rbsp = 0;
+    int nb_zeros = 0;
+    while (!stream.empty()) {
+        char v = stream.read_1bytes();
+        if (nb_zeros >= 2 && v == 0x03) {
+            nb_zeros = 0;
+            continue;
+        }
+        nb_zeros = (v == 0x00)? nb_zeros + 1 : 0;
+        rbsp[nb_rbsp++] = v;
+    }
+    
+    return hevc_demux_sps_rbsp(&rbsp[0], nb_rbsp);
+}
+
+srs_error_t SrsFormat::hevc_demux_sps_rbsp(char* rbsp, int nb_rbsp)
+{
+    srs_error_t err = srs_success;
+    
+    // we donot parse the detail of sps.
+    // @see https://github.com/ossrs/srs/issues/474
+    if (!avc_parse_sps) {
+        return err;
+    }
+    
+    // 7.3.2.2 Sequence parameter set RBSP syntax, T-REC-H.265-201802, page 35.
+    SrsBuffer stream(rbsp, nb_rbsp);
+    
+    // sps_video_parameter_set_id(4), sps_max_sub_layers_minus1(3), sps_temporal_id_nesting_flag(1)
+    if (!stream.require(1)) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc sps shall atleast 1bytes");
+    }
+    int sps_max_sub_layers_minus1 = (stream.read_1bytes() >> 1) & 0x07;
+    
+    // The profile_tier_level, which are all byte aligned.
+    // 7.3.3 Profile, tier and level syntax, T-REC-H.265-201802, page 37.
+    if (!stream.require(12)) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc sps profile_tier_level");
+    }
+    stream.skip(12);
+    
+    // sub_layer_profile_present_flag(1), sub_layer_level_present_flag(1), then padding to 16bits.
+    int nb_sub_layers = 0;
+    if (sps_max_sub_layers_minus1 > 0) {
+        if (!stream.require(2)) {
+            return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc sps sub_layer flags");
+        }
+        uint16_t flags = stream.read_2bytes();
+        for (int i = 0; i < sps_max_sub_layers_minus1; i++) {
+            bool profile_present = (flags >> (15 - 2 * i)) & 0x01;
+            bool level_present = (flags >> (14 - 2 * i)) & 0x01;
+            nb_sub_layers += (profile_present? 11 : 0) + (level_present? 1 : 0);
+        }
+    }
+    if (!stream.require(nb_sub_layers)) {
+        return srs_error_new(ERROR_HLS_DECODE_ERROR, "hevc sps sub_layers %d bytes", nb_sub_layers);
+    }
+    stream.skip(nb_sub_layers);
+    
+    SrsBitBuffer bs(&stream);
+    
+    int32_t sps_seq_parameter_set_id = -1;
+    if ((err = srs_avc_nalu_read_uev(&bs, sps_seq_parameter_set_id)) != srs_success) {
+        return srs_error_wrap(err, "read sps_seq_parameter_set_id");
+    }
+    
+    int32_t chroma_format_idc = -1;
+    if ((err = srs_avc_nalu_read_uev(&bs, chroma_format_idc)) != srs_success) {
+        return srs_error_wrap(err, "read chroma_format_idc");
+    }
+    if (chroma_format_idc == 3) {
+        int8_t separate_colour_plane_flag = -1;
+        if ((err = srs_avc_nalu_read_bit(&bs, separate_colour_plane_flag)) != srs_success) {
+            return srs_error_wrap(err, "read separate_colour_plane_flag");
+        }
+    }
+    
+    int32_t pic_width_in_luma_samples = -1;
+    if ((err = srs_avc_nalu_read_uev(&bs, pic_width_in_luma_samples)) != srs_success) {
+        return srs_error_wrap(err, "read pic_width_in_luma_samples");
+    }
+    
+    int32_t pic_height_in_luma_samples = -1;
+    if ((err = srs_avc_nalu_read_uev(&bs, pic_height_in_luma_samples)) != srs_success) {
+        return srs_error_wrap(err, "read pic_height_in_luma_samples");
+    }
+    
+    vcodec->width = pic_width_in_luma_samples;
+    vcodec->height = pic_height_in_luma_samples;
+    
+    // Crop the picture by conformance window, for example, 1920x1088 to 1920x1080.
+    int8_t conformance_window_flag = -1;
+    if ((err = srs_avc_nalu_read_bit(&bs, conformance_window_flag)) != srs_success) {
+        return srs_error_wrap(err, "read conformance_window_flag");
+    }
+    if (conformance_window_flag) {
+        int32_t left = 0, right = 0, top = 0, bottom = 0;
+        if ((err = srs_avc_nalu_read_uev(&bs, left)) != srs_success) {
+            return srs_error_wrap(err, "read conf_win_left_offset");
+        }
+        if ((err = srs_avc_nalu_read_uev(&bs, right)) != srs_success) {
+            return srs_error_wrap(err, "read conf_win_right_offset");
+        }
+        if ((err = srs_avc_nalu_read_uev(&bs, top)) != srs_success) {
+            return srs_error_wrap(err, "read conf_win_top_offset");
+        }
+        if ((err = srs_avc_nalu_read_uev(&bs, bottom)) != srs_success) {
+            return srs_error_wrap(err, "read conf_win_bottom_offset");
+        }
+        
+        // Table 6-1 - SubWidthC, and SubHeightC values, T-REC-H.265-201802, page 26.
+        int sub_width = (chroma_format_idc == 1 || chroma_format_idc == 2)? 2 : 1;
+        int sub_height = (chroma_format_idc == 1)? 2 : 1;
+        vcodec->width -= sub_width * (left + right);
+        vcodec->height -= sub_height * (top + bottom);
+    }
+    
+    return err;
+}
+
 // For media server, we don't care the codec, so we just try to parse sps-pps, and we could ignore any error if fail.
 // LCOV_EXCL_START
 
@@ -1158,15 +1490,8 @@ srs_error_t SrsFormat::avc_demux_annexb_format(SrsBuffer* stream)
         char* p = stream->data() + stream->pos();
         
         // get the last matched NALU
-        while (!stream->empty()) {
-            if (srs_avc_startswith_annexb(stream, NULL)) {
-                break;
-            }
-            
-            stream->skip(1);
-        }
-        
-        char* pp = stream->data() + stream->pos();
+        char* pp = srs_avc_find_annexb(p, stream->data() + stream->size());
+        stream->skip((int)(pp - p));
         
         // skip the empty.
         if (pp - p <= 0) {
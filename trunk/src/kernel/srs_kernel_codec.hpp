@@ -245,6 +245,17 @@ public:
      * check codec h264.
      */
     static bool h264(char* data, int size);
+    /**
+     * check codec h265, the enhanced FLV codec id 12.
+     */
+    static bool hevc(char* data, int size);
+    /**
+     * check whether the frame is disposable, which is never referenced by other frames, for
+     * example, the H.264 non-reference B-frame, so it's safe to drop it when overload.
+     * @param nalu_length the lengthSizeMinusOne of H.264 sequence header, -1 if unknown. The
+     *      NALUs are only parsed when it's known, else only check the frame type.
+     */
+    static bool disposable(char* data, int size, int8_t nalu_length);
     /**
      * check the video RTMP/flv header info,
      * @return true if video RTMP/flv header is ok.
@@ -504,6 +515,74 @@ enum SrsAvcLevel
 };
 std::string srs_avc_level2str(SrsAvcLevel level);
 
+/**
+ * The NALU type for HEVC/H.265, the nal_unit_type in NAL unit header.
+ * @see Table 7-1 - NAL unit type codes and NAL unit type classes, T-REC-H.265-201802, page 61.
+ */
+enum SrsHevcNaluType
+{
+    // Coded slice segment of a non-TSA, non-STSA trailing picture.
+    SrsHevcNaluTypeCodedSliceTrailN = 0,
+    SrsHevcNaluTypeCodedSliceTrailR = 1,
+    // Coded slice segment of a BLA, IDR or CRA picture, the IRAP pictures in range [16, 23].
+    SrsHevcNaluTypeCodedSliceBlaWlp = 16,
+    SrsHevcNaluTypeCodedSliceBlaWradl = 17,
+    SrsHevcNaluTypeCodedSliceBlaNlp = 18,
+    SrsHevcNaluTypeCodedSliceIdrWradl = 19,
+    SrsHevcNaluTypeCodedSliceIdrNlp = 20,
+    SrsHevcNaluTypeCodedSliceCra = 21,
+    SrsHevcNaluTypeReservedIrap23 = 23,
+    // Video, sequence and picture parameter set.
+    SrsHevcNaluTypeVps = 32,
+    SrsHevcNaluTypeSps = 33,
+    SrsHevcNaluTypePps = 34,
+    // Access unit delimiter.
+    SrsHevcNaluTypeAccessUnitDelimiter = 35,
+    // Supplemental enhancement information.
+    SrsHevcNaluTypeSeiPrefix = 39,
+    SrsHevcNaluTypeSeiSuffix = 40,
+};
+// Parse the HEVC NALU type from the first byte of NAL unit header, forbidden_zero_bit(1) nal_unit_type(6).
+#define SrsHevcNaluTypeParse(code) (SrsHevcNaluType)(((code) & 0x7e) >> 1)
+
+/**
+ * The profile for HEVC/H.265, the general_profile_idc.
+ * @see A.3 Profiles, T-REC-H.265-201802, page 268.
+ */
+enum SrsHevcProfile
+{
+    SrsHevcProfileReserved = 0,
+    SrsHevcProfileMain = 1,
+    SrsHevcProfileMain10 = 2,
+    SrsHevcProfileMainStillPicture = 3,
+    SrsHevcProfileRext = 4,
+};
+std::string srs_hevc_profile2str(SrsHevcProfile profile);
+
+/**
+ * The level for HEVC/H.265, the general_level_idc, which is 30 times the level number.
+ * @see A.4 Tiers and levels, T-REC-H.265-201802, page 283.
+ */
+enum SrsHevcLevel
+{
+    SrsHevcLevelReserved = 0,
+    
+    SrsHevcLevel_1 = 30,
+    SrsHevcLevel_2 = 60,
+    SrsHevcLevel_21 = 63,
+    SrsHevcLevel_3 = 90,
+    SrsHevcLevel_31 = 93,
+    SrsHevcLevel_4 = 120,
+    SrsHevcLevel_41 = 123,
+    SrsHevcLevel_5 = 150,
+    SrsHevcLevel_51 = 153,
+    SrsHevcLevel_52 = 156,
+    SrsHevcLevel_6 = 180,
+    SrsHevcLevel_61 = 183,
+    SrsHevcLevel_62 = 186,
+};
+std::string srs_hevc_level2str(SrsHevcLevel level);
+
 /**
  * A sample is the unit of frame.
  * It's a NALU for H.264.
@@ -623,6 +702,14 @@ public:
     // Note that we may resize the vector, so the under-layer bytes may change.
     std::vector<char> sequenceParameterSetNALUnit;
     std::vector<char> pictureParameterSetNALUnit;
+public:
+    /**
+     * hevc specified, the VPS/SPS/PPS is stored in the sps/pps above, and the avc_extra_data
+     * is the HEVCDecoderConfigurationRecord.
+     */
+    SrsHevcProfile hevc_profile;
+    SrsHevcLevel hevc_level;
+    std::vector<char> videoParameterSetNALUnit;
 public:
     // the avc payload format.
     SrsAvcPayloadFormat payload_format;
@@ -742,6 +829,11 @@ private:
     //          Demux the sps/pps from sequence header.
     //          Demux the samples from NALUs.
     virtual srs_error_t video_avc_demux(SrsBuffer* stream, int64_t timestamp);
+private:
+    // Parse the H.265 VPS/SPS/PPS from HEVCDecoderConfigurationRecord.
+    virtual srs_error_t hevc_demux_hvcc(SrsBuffer* stream);
+    virtual srs_error_t hevc_demux_sps();
+    virtual srs_error_t hevc_demux_sps_rbsp(char* rbsp, int nb_rbsp);
 private:
     // Parse the H.264 SPS/PPS.
     virtual srs_error_t avc_demux_sps_pps(SrsBuffer* stream);
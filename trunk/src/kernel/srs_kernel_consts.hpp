@@ -112,6 +112,11 @@
 #define SRS_CONSTS_LOOPBACK "0.0.0.0"
 #define SRS_CONSTS_LOOPBACK6 "::"
 
+// The range of configured coroutine stack size in bytes, the min size is safe for the
+// coroutines of SRS, and the max size is the default stack of pthread.
+#define SRS_CONSTS_MIN_STACK_SIZE (32 * 1024)
+#define SRS_CONSTS_MAX_STACK_SIZE (8 * 1024 * 1024)
+
 // The signal defines.
 // To reload the config file and apply new config.
 #define SRS_SIGNAL_RELOAD SIGHUP
@@ -101,6 +101,7 @@
 #define ERROR_SOCKET_SETREUSEADDR           1079
 #define ERROR_SOCKET_SETCLOSEEXEC           1080
 #define ERROR_SOCKET_ACCEPT                 1081
+#define ERROR_SYSTEM_OVERLOAD               1082
 
 ///////////////////////////////////////////////////////
 // RTMP protocol error.
@@ -272,6 +273,11 @@
 #define ERROR_INOTIFY_OPENFD                3094
 #define ERROR_INOTIFY_WATCH                 3095
 #define ERROR_HTTP_URL_UNESCAPE             3096
+#define ERROR_SHM_OPEN                      3097
+#define ERROR_SHM_MMAP                      3098
+#define ERROR_SHM_INVALID                   3099
+#define ERROR_SHM_CLOSED                    3100
+#define ERROR_SHM_TIMEOUT                   3101
 
 ///////////////////////////////////////////////////////
 // HTTP/StreamCaster protocol error.
@@ -13,6 +13,7 @@
 
 #include <fcntl.h>
 #include <sstream>
+#include <algorithm>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
@@ -28,6 +29,95 @@ using namespace std;
 
 SrsPps* _srs_pps_objs_msgs = NULL;
 
+SrsPayloadPool* _srs_payload_pool = NULL;
+
+SrsPayloadPool::SrsPayloadPool(int64_t max_cached_bytes, int max_payload)
+{
+    cached_bytes_ = 0;
+    max_cached_bytes_ = max_cached_bytes;
+    nn_hit = nn_miss = 0;
+
+    // The size classes are 512, 640, 768, 896, 1024, 1280, ..., max_payload.
+    capacities_.push_back(512);
+    for (int base = 512; base < max_payload; base *= 2) {
+        for (int i = 1; i <= 4; i++) {
+            capacities_.push_back(base + base / 4 * i);
+        }
+    }
+    payloads_.resize(capacities_.size());
+}
+
+SrsPayloadPool::~SrsPayloadPool()
+{
+    for (int i = 0; i < (int)payloads_.size(); i++) {
+        std::vector<char*>& free_payloads = payloads_[i];
+        for (int j = 0; j < (int)free_payloads.size(); j++) {
+            char* payload = free_payloads[j];
+            srs_freepa(payload);
+        }
+    }
+}
+
+char* SrsPayloadPool::alloc(int size, int* pclass)
+{
+    *pclass = -1;
+
+    // Always alloc from heap for large payload, or pool disabled.
+    if (max_cached_bytes_ <= 0 || size > capacities_.back()) {
+        nn_miss++;
+        return new char[size];
+    }
+
+    int clazz = (int)(std::lower_bound(capacities_.begin(), capacities_.end(), size) - capacities_.begin());
+    *pclass = clazz;
+
+    std::vector<char*>& free_payloads = payloads_[clazz];
+    if (free_payloads.empty()) {
+        nn_miss++;
+        return new char[capacities_[clazz]];
+    }
+
+    char* payload = free_payloads.back();
+    free_payloads.pop_back();
+    cached_bytes_ -= capacities_[clazz];
+    nn_hit++;
+
+    return payload;
+}
+
+void SrsPayloadPool::free(char* payload, int clazz)
+{
+    if (!payload) {
+        return;
+    }
+
+    // Free the payload if not from pool, or pool is full.
+    if (clazz < 0 || clazz >= (int)capacities_.size() || cached_bytes_ + capacities_[clazz] > max_cached_bytes_) {
+        srs_freepa(payload);
+        return;
+    }
+
+    payloads_[clazz].push_back(payload);
+    cached_bytes_ += capacities_[clazz];
+}
+
+int64_t SrsPayloadPool::cached_bytes()
+{
+    return cached_bytes_;
+}
+
+// Free the payload to the global pool if possible.
+void srs_payload_pool_free(char*& payload, int& clazz)
+{
+    if (_srs_payload_pool && clazz >= 0) {
+        _srs_payload_pool->free(payload, clazz);
+        payload = NULL;
+    } else {
+        srs_freepa(payload);
+    }
+    clazz = -1;
+}
+
 SrsMessageHeader::SrsMessageHeader()
 {
     message_type = 0;
@@ -144,25 +234,30 @@ SrsCommonMessage::SrsCommonMessage()
 {
     payload = NULL;
     size = 0;
+    payload_class_ = -1;
 }
 
 SrsCommonMessage::~SrsCommonMessage()
 {
-    srs_freepa(payload);
+    srs_payload_pool_free(payload, payload_class_);
 }
 
 void SrsCommonMessage::create_payload(int size)
 {
-    srs_freepa(payload);
+    srs_payload_pool_free(payload, payload_class_);
     
-    payload = new char[size];
+    if (_srs_payload_pool) {
+        payload = _srs_payload_pool->alloc(size, &payload_class_);
+    } else {
+        payload = new char[size];
+    }
     srs_verbose("create payload for RTMP message. size=%d", size);
 }
 
 srs_error_t SrsCommonMessage::create(SrsMessageHeader* pheader, char* body, int size)
 {
     // drop previous payload.
-    srs_freepa(payload);
+    srs_payload_pool_free(payload, payload_class_);
     
     this->header = *pheader;
     this->payload = body;
@@ -186,15 +281,16 @@ SrsSharedPtrMessage::SrsSharedPtrPayload::SrsSharedPtrPayload()
 {
     payload = NULL;
     size = 0;
+    payload_class = -1;
     shared_count = 0;
 }
 
 SrsSharedPtrMessage::SrsSharedPtrPayload::~SrsSharedPtrPayload()
 {
-    srs_freepa(payload);
+    srs_payload_pool_free(payload, payload_class);
 }
 
-SrsSharedPtrMessage::SrsSharedPtrMessage() : timestamp(0), stream_id(0), size(0), payload(NULL)
+SrsSharedPtrMessage::SrsSharedPtrMessage() : timestamp(0), stream_id(0), enqueue_time(0), size(0), payload(NULL)
 {
     ptr = NULL;
 
@@ -219,12 +315,16 @@ srs_error_t SrsSharedPtrMessage::create(SrsCommonMessage* msg)
     if ((err = create(&msg->header, msg->payload, msg->size)) != srs_success) {
         return srs_error_wrap(err, "create message");
     }
+
+    // Transfer the payload with its size class, to free it to pool when all messages are freed.
+    ptr->payload_class = msg->payload_class_;
     
     // to prevent double free of payload:
     // initialize already attach the payload of msg,
     // detach the payload to transfer the owner to shared ptr.
     msg->payload = NULL;
     msg->size = 0;
+    msg->payload_class_ = -1;
     
     return err;
 }
@@ -333,6 +433,7 @@ SrsSharedPtrMessage* SrsSharedPtrMessage::copy()
     
     copy->timestamp = timestamp;
     copy->stream_id = stream_id;
+    copy->enqueue_time = enqueue_time;
 
     return copy;
 }
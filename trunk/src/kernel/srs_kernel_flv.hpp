@@ -182,6 +182,42 @@ public:
     void initialize_video(int size, uint32_t time, int stream);
 };
 
+// The pool for the payload of RTMP messages, to reuse the payload by size class,
+// which avoid malloc and free for each message, for example, on the publish side.
+// Each size class is 1/4 of power of 2, so the memory wasted is less than 25%.
+// @remark The payload larger than the max size class is never pooled.
+// @remark It's not thread-safe, only for ST coroutines.
+class SrsPayloadPool
+{
+private:
+    // The capacity of each size class, in bytes.
+    std::vector<int> capacities_;
+    // The free payloads of each size class.
+    std::vector< std::vector<char*> > payloads_;
+    // The bytes of free payloads in pool.
+    int64_t cached_bytes_;
+    // The max bytes of free payloads in pool, 0 to disable the pool.
+    int64_t max_cached_bytes_;
+public:
+    // The number of payloads allocated from pool, and from heap.
+    int64_t nn_hit;
+    int64_t nn_miss;
+public:
+    SrsPayloadPool(int64_t max_cached_bytes, int max_payload);
+    virtual ~SrsPayloadPool();
+public:
+    // Alloc a payload with at least size bytes.
+    // @param pclass Output the size class of payload, -1 if not from pool.
+    virtual char* alloc(int size, int* pclass);
+    // Free the payload, which is allocated by alloc in the size class.
+    virtual void free(char* payload, int clazz);
+    // Get the bytes of free payloads in pool.
+    virtual int64_t cached_bytes();
+};
+
+// The global payload pool for RTMP messages, NULL to disable it.
+extern SrsPayloadPool* _srs_payload_pool;
+
 // The message is raw data RTMP message, bytes oriented,
 // protcol always recv RTMP message, and can send RTMP message or RTMP packet.
 // The common message is read from underlay protocol sdk.
@@ -202,6 +238,10 @@ public:
     // @remark, not all message payload can be decoded to packet. for example,
     //       video/audio packet use raw bytes, no video/audio packet.
     char* payload;
+private:
+    friend class SrsSharedPtrMessage;
+    // The size class of payload in pool, -1 if not allocated from pool.
+    int payload_class_;
 public:
     SrsCommonMessage();
     virtual ~SrsCommonMessage();
@@ -261,6 +301,8 @@ public:
     // Four-byte field that identifies the stream of the message. These
     // bytes are set in big-endian format.
     int32_t stream_id;
+    // The time when enqueued to consumer, to stat the latency of queue, 0 if not in queue.
+    srs_utime_t enqueue_time;
     // 4.2. Message Payload
 public:
     // The current message parsed size,
@@ -284,6 +326,8 @@ private:
         char* payload;
         // The size of payload.
         int size;
+        // The size class of payload in pool, -1 if not allocated from pool.
+        int payload_class;
         // The reference count
         int shared_count;
     public:
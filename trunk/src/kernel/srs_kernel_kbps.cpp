@@ -6,6 +6,8 @@
 
 #include <srs_kernel_kbps.hpp>
 
+#include <string.h>
+
 #include <srs_kernel_utility.hpp>
 
 SrsRateSample::SrsRateSample()
@@ -91,6 +93,129 @@ int SrsPps::r10s()
     return sample_10s_.rate;
 }
 
+SrsHistogram::SrsHistogram()
+{
+    memset(buckets_, 0, sizeof(buckets_));
+    nn_ = sum_ = 0;
+    min_ = max_ = 0;
+
+    memset(last_buckets_, 0, sizeof(last_buckets_));
+    last_nn_ = last_sum_ = 0;
+    last_min_ = last_max_ = 0;
+}
+
+SrsHistogram::~SrsHistogram()
+{
+}
+
+void SrsHistogram::record(srs_utime_t v)
+{
+    if (v < 0) {
+        return;
+    }
+
+    buckets_[bucket(v)]++;
+
+    if (!nn_ || v < min_) {
+        min_ = v;
+    }
+    if (v > max_) {
+        max_ = v;
+    }
+
+    nn_++;
+    sum_ += v;
+}
+
+void SrsHistogram::update()
+{
+    memcpy(last_buckets_, buckets_, sizeof(buckets_));
+    last_nn_ = nn_;
+    last_sum_ = sum_;
+    last_min_ = min_;
+    last_max_ = max_;
+
+    memset(buckets_, 0, sizeof(buckets_));
+    nn_ = sum_ = 0;
+    min_ = max_ = 0;
+}
+
+int64_t SrsHistogram::count()
+{
+    return last_nn_;
+}
+
+srs_utime_t SrsHistogram::min()
+{
+    return last_min_;
+}
+
+srs_utime_t SrsHistogram::max()
+{
+    return last_max_;
+}
+
+srs_utime_t SrsHistogram::average()
+{
+    return last_nn_? last_sum_ / last_nn_ : 0;
+}
+
+srs_utime_t SrsHistogram::percentile(double p)
+{
+    if (!last_nn_) {
+        return 0;
+    }
+
+    // The rank of value, at least the first one.
+    int64_t rank = srs_max(1, (int64_t)(last_nn_ * p / 100 + 0.5));
+
+    int64_t nn = 0;
+    for (int i = 0; i < SRS_HISTOGRAM_BUCKETS; i++) {
+        nn += last_buckets_[i];
+        if (nn >= rank) {
+            return srs_min(upper(i), last_max_);
+        }
+    }
+
+    return last_max_;
+}
+
+int SrsHistogram::bucket(srs_utime_t v)
+{
+    uint64_t n = (uint64_t)v;
+
+    // The small values are linear.
+    if (n < (1 << SRS_HISTOGRAM_SUB_BITS)) {
+        return (int)n;
+    }
+
+    // Overflow to the last bucket.
+    if (n >= (1ULL << 32)) {
+        return SRS_HISTOGRAM_BUCKETS - 1;
+    }
+
+    // The power of 2 is the highest bit, and the sub-bucket is the following bits.
+    int power = 63 - __builtin_clzll(n);
+    int shift = power - SRS_HISTOGRAM_SUB_BITS;
+    int sub = (int)(n >> shift) & ((1 << SRS_HISTOGRAM_SUB_BITS) - 1);
+
+    return ((shift + 1) << SRS_HISTOGRAM_SUB_BITS) + sub;
+}
+
+srs_utime_t SrsHistogram::upper(int index)
+{
+    int sub_buckets = 1 << SRS_HISTOGRAM_SUB_BITS;
+    if (index < sub_buckets) {
+        return index;
+    }
+
+    int shift = (index >> SRS_HISTOGRAM_SUB_BITS) - 1;
+    int sub = index & (sub_buckets - 1);
+
+    // The range is [(sub_buckets + sub) << shift, (sub_buckets + sub + 1) << shift).
+    return (srs_utime_t)((((uint64_t)sub_buckets + sub + 1) << shift) - 1);
+}
+
 SrsWallClock::SrsWallClock()
 {
 }
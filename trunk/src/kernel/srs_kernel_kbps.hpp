@@ -55,6 +55,53 @@ public:
     int r10s();
 };
 
+// The bits of sub-buckets for each power of 2, so the relative error of histogram is 1/8.
+#define SRS_HISTOGRAM_SUB_BITS 3
+// The number of buckets, for values in [0, 2^32)us, about 71 minutes.
+#define SRS_HISTOGRAM_BUCKETS ((32 - SRS_HISTOGRAM_SUB_BITS + 1) << SRS_HISTOGRAM_SUB_BITS)
+
+// A HDR-style histogram of latency, in fixed log-linear buckets, which is cheap to record without
+// allocation, so it's ok to run in production. The stat is of the last duration, which is updated
+// by timer, for example, every 5s.
+class SrsHistogram
+{
+private:
+    // The buckets of current duration.
+    uint32_t buckets_[SRS_HISTOGRAM_BUCKETS];
+    int64_t nn_;
+    int64_t sum_;
+    srs_utime_t min_;
+    srs_utime_t max_;
+private:
+    // The buckets of last duration.
+    uint32_t last_buckets_[SRS_HISTOGRAM_BUCKETS];
+    int64_t last_nn_;
+    int64_t last_sum_;
+    srs_utime_t last_min_;
+    srs_utime_t last_max_;
+public:
+    SrsHistogram();
+    virtual ~SrsHistogram();
+public:
+    // Record a latency, ignore if negative.
+    void record(srs_utime_t v);
+    // Finish the current duration, and reset it.
+    void update();
+public:
+    // The stat of last duration.
+    int64_t count();
+    srs_utime_t min();
+    srs_utime_t max();
+    srs_utime_t average();
+    // Get the percentile in (0, 100], for example, 99 for p99, which is the upper bound of bucket.
+    srs_utime_t percentile(double p);
+public:
+    // Get the index of bucket for value.
+    static int bucket(srs_utime_t v);
+    // Get the upper bound of bucket.
+    static srs_utime_t upper(int index);
+};
+
 /**
  * A time source to provide wall clock.
  */
@@ -336,6 +336,8 @@ srs_error_t SrsMp4Box::discovery(SrsBuffer* buf, SrsMp4Box** ppbox)
         case SrsMp4BoxTypeSTSZ: box = new SrsMp4SampleSizeBox(); break;
         case SrsMp4BoxTypeAVC1: box = new SrsMp4VisualSampleEntry(); break;
         case SrsMp4BoxTypeAVCC: box = new SrsMp4AvccBox(); break;
+        case SrsMp4BoxTypeHVC1: box = new SrsMp4VisualSampleEntry(SrsMp4BoxTypeHVC1); break;
+        case SrsMp4BoxTypeHVCC: box = new SrsMp4HvcCBox(); break;
         case SrsMp4BoxTypeMP4A: box = new SrsMp4AudioSampleEntry(); break;
         case SrsMp4BoxTypeESDS: box = new SrsMp4EsdsBox(); break;
         case SrsMp4BoxTypeUDTA: box = new SrsMp4UserDataBox(); break;
@@ -349,6 +351,9 @@ srs_error_t SrsMp4Box::discovery(SrsBuffer* buf, SrsMp4Box** ppbox)
         case SrsMp4BoxTypeTFDT: box = new SrsMp4TrackFragmentDecodeTimeBox(); break;
         case SrsMp4BoxTypeTRUN: box = new SrsMp4TrackFragmentRunBox(); break;
         case SrsMp4BoxTypeSIDX: box = new SrsMp4SegmentIndexBox(); break;
+        case SrsMp4BoxTypeMFRA: box = new SrsMp4MovieFragmentRandomAccessBox(); break;
+        case SrsMp4BoxTypeTFRA: box = new SrsMp4TrackFragmentRandomAccessBox(); break;
+        case SrsMp4BoxTypeMFRO: box = new SrsMp4MovieFragmentRandomAccessOffsetBox(); break;
         // Skip some unknown boxes.
         case SrsMp4BoxTypeFREE: case SrsMp4BoxTypeSKIP: case SrsMp4BoxTypePASP:
         case SrsMp4BoxTypeUUID: default:
@@ -757,6 +762,11 @@ void SrsMp4MovieFragmentBox::set_traf(SrsMp4TrackFragmentBox* v)
     boxes.push_back(v);
 }
 
+void SrsMp4MovieFragmentBox::add_traf(SrsMp4TrackFragmentBox* v)
+{
+    boxes.push_back(v);
+}
+
 SrsMp4MovieFragmentHeaderBox::SrsMp4MovieFragmentHeaderBox()
 {
     type = SrsMp4BoxTypeMFHD;
@@ -1645,6 +1655,11 @@ void SrsMp4MovieExtendsBox::set_trex(SrsMp4TrackExtendsBox* v)
     boxes.push_back(v);
 }
 
+void SrsMp4MovieExtendsBox::add_trex(SrsMp4TrackExtendsBox* v)
+{
+    boxes.push_back(v);
+}
+
 SrsMp4TrackExtendsBox::SrsMp4TrackExtendsBox()
 {
     type = SrsMp4BoxTypeTREX;
@@ -1798,6 +1813,7 @@ SrsVideoCodecId SrsMp4TrackBox::vide_codec()
     SrsMp4SampleEntry* entry = box->entrie_at(0);
     switch(entry->type) {
         case SrsMp4BoxTypeAVC1: return SrsVideoCodecIdAVC;
+        case SrsMp4BoxTypeHVC1: return SrsVideoCodecIdHEVC;
         default: return SrsVideoCodecIdForbidden;
     }
 }
@@ -2997,9 +3013,9 @@ stringstream& SrsMp4SampleEntry::dumps_detail(stringstream& ss, SrsMp4DumpContex
     return ss;
 }
 
-SrsMp4VisualSampleEntry::SrsMp4VisualSampleEntry() : width(0), height(0)
+SrsMp4VisualSampleEntry::SrsMp4VisualSampleEntry(SrsMp4BoxType boxType) : width(0), height(0)
 {
-    type = SrsMp4BoxTypeAVC1;
+    type = boxType;
     
     pre_defined0 = 0;
     reserved0 = 0;
@@ -3029,6 +3045,18 @@ void SrsMp4VisualSampleEntry::set_avcC(SrsMp4AvccBox* v)
     boxes.push_back(v);
 }
 
+SrsMp4HvcCBox* SrsMp4VisualSampleEntry::hvcC()
+{
+    SrsMp4Box* box = get(SrsMp4BoxTypeHVCC);
+    return dynamic_cast<SrsMp4HvcCBox*>(box);
+}
+
+void SrsMp4VisualSampleEntry::set_hvcC(SrsMp4HvcCBox* v)
+{
+    remove(SrsMp4BoxTypeHVCC);
+    boxes.push_back(v);
+}
+
 int SrsMp4VisualSampleEntry::nb_header()
 {
     return SrsMp4SampleEntry::nb_header()+2+2+12+2+2+4+4+4+2+32+2+2;
@@ -3148,6 +3176,62 @@ stringstream& SrsMp4AvccBox::dumps_detail(stringstream& ss, SrsMp4DumpContext dc
     return ss;
 }
 
+SrsMp4HvcCBox::SrsMp4HvcCBox()
+{
+    type = SrsMp4BoxTypeHVCC;
+}
+
+SrsMp4HvcCBox::~SrsMp4HvcCBox()
+{
+}
+
+int SrsMp4HvcCBox::nb_header()
+{
+    return SrsMp4Box::nb_header() + (int)hevc_config.size();
+}
+
+srs_error_t SrsMp4HvcCBox::encode_header(SrsBuffer* buf)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = SrsMp4Box::encode_header(buf)) != srs_success) {
+        return srs_error_wrap(err, "encode header");
+    }
+    
+    if (!hevc_config.empty()) {
+        buf->write_bytes(&hevc_config[0], (int)hevc_config.size());
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4HvcCBox::decode_header(SrsBuffer* buf)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = SrsMp4Box::decode_header(buf)) != srs_success) {
+        return srs_error_wrap(err, "decode header");
+    }
+    
+    int nb_config = left_space(buf);
+    if (nb_config) {
+        hevc_config.resize(nb_config);
+        buf->read_bytes(&hevc_config[0], nb_config);
+    }
+    
+    return err;
+}
+
+stringstream& SrsMp4HvcCBox::dumps_detail(stringstream& ss, SrsMp4DumpContext dc)
+{
+    SrsMp4Box::dumps_detail(ss, dc);
+    
+    ss << ", HEVC Config: " << (int)hevc_config.size() << "B" << endl;
+    srs_mp4_padding(ss, dc.indent());
+    srs_mp4_print_bytes(ss, (const char*)&hevc_config[0], (int)hevc_config.size(), dc.indent());
+    return ss;
+}
+
 SrsMp4AudioSampleEntry::SrsMp4AudioSampleEntry() : samplerate(0)
 {
     type = SrsMp4BoxTypeMP4A;
@@ -4691,6 +4775,196 @@ stringstream& SrsMp4SegmentIndexBox::dumps_detail(stringstream& ss, SrsMp4DumpCo
     return ss;
 }
 
+SrsMp4MovieFragmentRandomAccessBox::SrsMp4MovieFragmentRandomAccessBox()
+{
+    type = SrsMp4BoxTypeMFRA;
+}
+
+SrsMp4MovieFragmentRandomAccessBox::~SrsMp4MovieFragmentRandomAccessBox()
+{
+}
+
+void SrsMp4MovieFragmentRandomAccessBox::add_tfra(SrsMp4TrackFragmentRandomAccessBox* v)
+{
+    boxes.push_back(v);
+}
+
+SrsMp4MovieFragmentRandomAccessOffsetBox* SrsMp4MovieFragmentRandomAccessBox::mfro()
+{
+    SrsMp4Box* box = get(SrsMp4BoxTypeMFRO);
+    return dynamic_cast<SrsMp4MovieFragmentRandomAccessOffsetBox*>(box);
+}
+
+void SrsMp4MovieFragmentRandomAccessBox::set_mfro(SrsMp4MovieFragmentRandomAccessOffsetBox* v)
+{
+    remove(SrsMp4BoxTypeMFRO);
+    boxes.push_back(v);
+}
+
+SrsMp4TrackFragmentRandomAccessBox::SrsMp4TrackFragmentRandomAccessBox()
+{
+    type = SrsMp4BoxTypeTFRA;
+    track_ID = 0;
+}
+
+SrsMp4TrackFragmentRandomAccessBox::~SrsMp4TrackFragmentRandomAccessBox()
+{
+}
+
+int SrsMp4TrackFragmentRandomAccessBox::nb_header()
+{
+    // The time and moof_offset, then 1 byte for each of traf_number, trun_number and sample_number.
+    int size = (version? 16:8) + 3;
+    return SrsMp4FullBox::nb_header() + 4 + 4 + 4 + size * (int)entries.size();
+}
+
+srs_error_t SrsMp4TrackFragmentRandomAccessBox::encode_header(SrsBuffer* buf)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = SrsMp4FullBox::encode_header(buf)) != srs_success) {
+        return srs_error_wrap(err, "encode header");
+    }
+    
+    buf->write_4bytes(track_ID);
+    // The reserved 26bits, and length_size_of_traf_num, trun_num, sample_num are all 0, that is 1 byte.
+    buf->write_4bytes(0);
+    buf->write_4bytes((uint32_t)entries.size());
+    
+    for (int i = 0; i < (int)entries.size(); i++) {
+        SrsMp4TfraEntry& entry = entries.at(i);
+        if (version) {
+            buf->write_8bytes(entry.time);
+            buf->write_8bytes(entry.moof_offset);
+        } else {
+            buf->write_4bytes((uint32_t)entry.time);
+            buf->write_4bytes((uint32_t)entry.moof_offset);
+        }
+        buf->write_1bytes((uint8_t)entry.traf_number);
+        buf->write_1bytes((uint8_t)entry.trun_number);
+        buf->write_1bytes((uint8_t)entry.sample_number);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4TrackFragmentRandomAccessBox::decode_header(SrsBuffer* buf)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = SrsMp4FullBox::decode_header(buf)) != srs_success) {
+        return srs_error_wrap(err, "decode header");
+    }
+    
+    if (!buf->require(12)) {
+        return srs_error_new(ERROR_MP4_BOX_REQUIRE_SPACE, "tfra requires 12 only %d bytes", buf->left());
+    }
+    
+    track_ID = buf->read_4bytes();
+    uint32_t v = buf->read_4bytes();
+    int nn_traf = ((v >> 4) & 0x03) + 1;
+    int nn_trun = ((v >> 2) & 0x03) + 1;
+    int nn_sample = (v & 0x03) + 1;
+    uint32_t nb_entries = buf->read_4bytes();
+    
+    int size = (version? 16:8) + nn_traf + nn_trun + nn_sample;
+    if (!buf->require(size * nb_entries)) {
+        return srs_error_new(ERROR_MP4_BOX_REQUIRE_SPACE, "tfra requires %d only %d bytes", size * nb_entries, buf->left());
+    }
+    
+    for (uint32_t i = 0; i < nb_entries; i++) {
+        SrsMp4TfraEntry entry;
+        if (version) {
+            entry.time = buf->read_8bytes();
+            entry.moof_offset = buf->read_8bytes();
+        } else {
+            entry.time = buf->read_4bytes();
+            entry.moof_offset = buf->read_4bytes();
+        }
+        
+        entry.traf_number = entry.trun_number = entry.sample_number = 0;
+        for (int j = 0; j < nn_traf; j++) {
+            entry.traf_number = (entry.traf_number << 8) | buf->read_1bytes();
+        }
+        for (int j = 0; j < nn_trun; j++) {
+            entry.trun_number = (entry.trun_number << 8) | buf->read_1bytes();
+        }
+        for (int j = 0; j < nn_sample; j++) {
+            entry.sample_number = (entry.sample_number << 8) | buf->read_1bytes();
+        }
+        entries.push_back(entry);
+    }
+    
+    return err;
+}
+
+stringstream& SrsMp4TrackFragmentRandomAccessBox::dumps_detail(stringstream& ss, SrsMp4DumpContext dc)
+{
+    SrsMp4FullBox::dumps_detail(ss, dc);
+    
+    ss << ", track=#" << track_ID << ", entries=" << entries.size();
+    
+    for (int i = 0; i < (int)entries.size() && i < SrsMp4SummaryCount; i++) {
+        SrsMp4TfraEntry& entry = entries.at(i);
+        
+        ss << endl;
+        srs_mp4_padding(ss, dc.indent());
+        ss << "#" << i << ", time=" << entry.time << ", moof=" << entry.moof_offset
+            << ", traf=" << entry.traf_number << ", trun=" << entry.trun_number << ", sample=" << entry.sample_number;
+    }
+    
+    return ss;
+}
+
+SrsMp4MovieFragmentRandomAccessOffsetBox::SrsMp4MovieFragmentRandomAccessOffsetBox()
+{
+    type = SrsMp4BoxTypeMFRO;
+    mfra_size = 0;
+}
+
+SrsMp4MovieFragmentRandomAccessOffsetBox::~SrsMp4MovieFragmentRandomAccessOffsetBox()
+{
+}
+
+int SrsMp4MovieFragmentRandomAccessOffsetBox::nb_header()
+{
+    return SrsMp4FullBox::nb_header() + 4;
+}
+
+srs_error_t SrsMp4MovieFragmentRandomAccessOffsetBox::encode_header(SrsBuffer* buf)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = SrsMp4FullBox::encode_header(buf)) != srs_success) {
+        return srs_error_wrap(err, "encode header");
+    }
+    
+    buf->write_4bytes(mfra_size);
+    
+    return err;
+}
+
+srs_error_t SrsMp4MovieFragmentRandomAccessOffsetBox::decode_header(SrsBuffer* buf)
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = SrsMp4FullBox::decode_header(buf)) != srs_success) {
+        return srs_error_wrap(err, "decode header");
+    }
+    
+    mfra_size = buf->read_4bytes();
+    
+    return err;
+}
+
+stringstream& SrsMp4MovieFragmentRandomAccessOffsetBox::dumps_detail(stringstream& ss, SrsMp4DumpContext dc)
+{
+    SrsMp4FullBox::dumps_detail(ss, dc);
+    
+    ss << ", size=" << mfra_size;
+    return ss;
+}
+
 SrsMp4Sample::SrsMp4Sample()
 {
     type = SrsFrameTypeForbidden;
@@ -5825,17 +6099,23 @@ srs_error_t SrsMp4Encoder::flush()
             SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
             stbl->set_stsd(stsd);
             
-            SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry();
+            bool is_hevc = vcodec == SrsVideoCodecIdHEVC;
+            SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry(is_hevc? SrsMp4BoxTypeHVC1 : SrsMp4BoxTypeAVC1);
             stsd->append(avc1);
             
             avc1->width = width;
             avc1->height = height;
             avc1->data_reference_index = 1;
             
-            SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
-            avc1->set_avcC(avcC);
-            
-            avcC->avc_config = pavcc;
+            if (is_hevc) {
+                SrsMp4HvcCBox* hvcC = new SrsMp4HvcCBox();
+                avc1->set_hvcC(hvcC);
+                hvcC->hevc_config = pavcc;
+            } else {
+                SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
+                avc1->set_avcC(avcC);
+                avcC->avc_config = pavcc;
+            }
         }
         
         if (nb_audios || !pasc.empty()) {
@@ -6045,6 +6325,539 @@ srs_error_t SrsMp4Encoder::do_write_sample(SrsMp4Sample* ps, uint8_t* sample, ui
     return err;
 }
 
+SrsMp4FragmentedEncoder::SrsMp4FragmentedEncoder()
+{
+    writer = NULL;
+    fragment = 0;
+    sequence_number = 0;
+    nb_written = 0;
+    moov_written = false;
+    vtid = atid = 0;
+    vsamples = new SrsMp4SampleManager();
+    asamples = new SrsMp4SampleManager();
+    width = height = 0;
+    
+    acodec = SrsAudioCodecIdForbidden;
+    sample_rate = SrsAudioSampleRateForbidden;
+    sound_bits = SrsAudioSampleBitsForbidden;
+    channels = SrsAudioChannelsForbidden;
+    vcodec = SrsVideoCodecIdForbidden;
+}
+
+SrsMp4FragmentedEncoder::~SrsMp4FragmentedEncoder()
+{
+    srs_freep(vsamples);
+    srs_freep(asamples);
+}
+
+srs_error_t SrsMp4FragmentedEncoder::initialize(ISrsWriter* w, srs_utime_t f)
+{
+    writer = w;
+    fragment = (uint32_t)srsu2ms(f);
+    return srs_success;
+}
+
+srs_error_t SrsMp4FragmentedEncoder::write_sample(
+    SrsFormat* format, SrsMp4HandlerType ht, uint16_t ft, uint16_t ct, uint32_t dts, uint32_t pts,
+    uint8_t* sample, uint32_t nb_sample
+) {
+    srs_error_t err = srs_success;
+    
+    // For SPS/PPS or ASC, copy it to moov.
+    bool vsh = (ht == SrsMp4HandlerTypeVIDE) && (ct == (uint16_t)SrsVideoAvcFrameTraitSequenceHeader);
+    bool ash = (ht == SrsMp4HandlerTypeSOUN) && (ct == (uint16_t)SrsAudioAacFrameTraitSequenceHeader);
+    if (vsh || ash) {
+        return copy_sequence_header(format, vsh, sample, nb_sample);
+    }
+    
+    bool video = (ht == SrsMp4HandlerTypeVIDE);
+    if (!video && ht != SrsMp4HandlerTypeSOUN) {
+        return err;
+    }
+    
+    // Reap the fragment at video keyframe, or any audio frame for pure audio stream.
+    SrsMp4SampleManager* samples = pavcc.empty()? asamples : vsamples;
+    bool reap = !samples->samples.empty() && dts - samples->samples[0]->dts >= fragment;
+    if (reap && (pavcc.empty() || (video && ft == SrsVideoAvcFrameTypeKeyFrame))) {
+        if ((err = write_fragment()) != srs_success) {
+            return srs_error_wrap(err, "write fragment");
+        }
+    }
+    
+    // Ignore the samples of track without sequence header, the track is fixed after moov.
+    if (moov_written && ((video && !vtid) || (!video && !atid))) {
+        return err;
+    }
+    
+    SrsMp4Sample* ps = new SrsMp4Sample();
+    ps->type = video? SrsFrameTypeVideo : SrsFrameTypeAudio;
+    ps->frame_type = video? (SrsVideoAvcFrameType)ft : SrsVideoAvcFrameTypeKeyFrame;
+    ps->tbn = 1000;
+    ps->dts = dts;
+    ps->pts = pts;
+    
+    // We should copy the sample data, which is shared ptr from video/audio message.
+    ps->data = new uint8_t[nb_sample];
+    memcpy(ps->data, sample, nb_sample);
+    ps->nb_data = nb_sample;
+    
+    if (video) {
+        ps->index = (uint32_t)vsamples->samples.size();
+        vsamples->append(ps);
+    } else {
+        ps->index = (uint32_t)asamples->samples.size();
+        asamples->append(ps);
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentedEncoder::flush()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = write_fragment()) != srs_success) {
+        return srs_error_wrap(err, "write fragment");
+    }
+    
+    if (tfra_entries.empty()) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOF, "Missing audio and video fragment");
+    }
+    
+    // Write mfra, the index is the video track, or audio track for pure audio.
+    SrsMp4MovieFragmentRandomAccessBox* mfra = new SrsMp4MovieFragmentRandomAccessBox();
+    SrsAutoFree(SrsMp4MovieFragmentRandomAccessBox, mfra);
+    
+    SrsMp4TrackFragmentRandomAccessBox* tfra = new SrsMp4TrackFragmentRandomAccessBox();
+    mfra->add_tfra(tfra);
+    
+    tfra->version = 1;
+    tfra->track_ID = vtid? vtid : atid;
+    tfra->entries = tfra_entries;
+    
+    SrsMp4MovieFragmentRandomAccessOffsetBox* mfro = new SrsMp4MovieFragmentRandomAccessOffsetBox();
+    mfra->set_mfro(mfro);
+    mfro->mfra_size = (uint32_t)mfra->nb_bytes();
+    
+    if ((err = srs_mp4_write_box(writer, mfra)) != srs_success) {
+        return srs_error_wrap(err, "write mfra");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentedEncoder::copy_sequence_header(SrsFormat* format, bool vsh, uint8_t* sample, uint32_t nb_sample)
+{
+    srs_error_t err = srs_success;
+    
+    std::vector<char>& sh = vsh? pavcc : pasc;
+    if (!sh.empty()) {
+        if (nb_sample == (uint32_t)sh.size() && srs_bytes_equals(sample, &sh[0], (int)sh.size())) {
+            return err;
+        }
+        
+        return srs_error_new(vsh? ERROR_MP4_AVCC_CHANGE : ERROR_MP4_ASC_CHANGE, "doesn't support sequence header change");
+    }
+    
+    sh = std::vector<char>(sample, sample + nb_sample);
+    if (vsh && format && format->vcodec) {
+        width = format->vcodec->width;
+        height = format->vcodec->height;
+    }
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentedEncoder::write_moov()
+{
+    srs_error_t err = srs_success;
+    
+    if (pavcc.empty() && pasc.empty()) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "Missing audio and video track");
+    }
+    
+    // Write ftyp box.
+    if (true) {
+        SrsMp4FileTypeBox* ftyp = new SrsMp4FileTypeBox();
+        SrsAutoFree(SrsMp4FileTypeBox, ftyp);
+        
+        ftyp->major_brand = SrsMp4BoxBrandISO5;
+        ftyp->minor_version = 512;
+        ftyp->set_compatible_brands(SrsMp4BoxBrandISO5, SrsMp4BoxBrandISO6, SrsMp4BoxBrandAVC1, SrsMp4BoxBrandMP41);
+        
+        if ((err = srs_mp4_write_box(writer, ftyp)) != srs_success) {
+            return srs_error_wrap(err, "write ftyp");
+        }
+        nb_written += ftyp->nb_bytes();
+    }
+    
+    SrsMp4MovieBox* moov = new SrsMp4MovieBox();
+    SrsAutoFree(SrsMp4MovieBox, moov);
+    
+    SrsMp4MovieHeaderBox* mvhd = new SrsMp4MovieHeaderBox();
+    moov->set_mvhd(mvhd);
+    
+    mvhd->timescale = 1000; // Use tbn ms.
+    mvhd->duration_in_tbn = 0;
+    mvhd->next_track_ID = 1; // Starts from 1, increase when use it.
+    
+    SrsMp4MovieExtendsBox* mvex = new SrsMp4MovieExtendsBox();
+    
+    if (!pavcc.empty()) {
+        SrsMp4TrackBox* trak = new SrsMp4TrackBox();
+        moov->add_trak(trak);
+        
+        SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
+        trak->set_tkhd(tkhd);
+        
+        vtid = tkhd->track_ID = mvhd->next_track_ID++;
+        tkhd->duration = 0;
+        tkhd->width = (width << 16);
+        tkhd->height = (height << 16);
+        
+        SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
+        trak->set_mdia(mdia);
+        
+        SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
+        mdia->set_mdhd(mdhd);
+        
+        mdhd->timescale = 1000;
+        mdhd->duration = 0;
+        mdhd->set_language0('u');
+        mdhd->set_language1('n');
+        mdhd->set_language2('d');
+        
+        SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
+        mdia->set_hdlr(hdlr);
+        
+        hdlr->handler_type = SrsMp4HandlerTypeVIDE;
+        hdlr->name = "VideoHandler";
+        
+        SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
+        mdia->set_minf(minf);
+        
+        SrsMp4VideoMeidaHeaderBox* vmhd = new SrsMp4VideoMeidaHeaderBox();
+        minf->set_vmhd(vmhd);
+        
+        SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
+        minf->set_dinf(dinf);
+        
+        SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
+        dinf->set_dref(dref);
+        
+        SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
+        dref->append(url);
+        
+        SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
+        minf->set_stbl(stbl);
+        
+        SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
+        stbl->set_stsd(stsd);
+        
+        bool is_hevc = vcodec == SrsVideoCodecIdHEVC;
+        SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry(is_hevc? SrsMp4BoxTypeHVC1 : SrsMp4BoxTypeAVC1);
+        stsd->append(avc1);
+        
+        avc1->width = width;
+        avc1->height = height;
+        avc1->data_reference_index = 1;
+        
+        if (is_hevc) {
+            SrsMp4HvcCBox* hvcC = new SrsMp4HvcCBox();
+            avc1->set_hvcC(hvcC);
+            hvcC->hevc_config = pavcc;
+        } else {
+            SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
+            avc1->set_avcC(avcC);
+            avcC->avc_config = pavcc;
+        }
+        
+        stbl->set_stts(new SrsMp4DecodingTime2SampleBox());
+        stbl->set_stsc(new SrsMp4Sample2ChunkBox());
+        stbl->set_stsz(new SrsMp4SampleSizeBox());
+        stbl->set_stco(new SrsMp4ChunkOffsetBox());
+        
+        SrsMp4TrackExtendsBox* trex = new SrsMp4TrackExtendsBox();
+        mvex->add_trex(trex);
+        
+        trex->track_ID = vtid;
+        trex->default_sample_description_index = 1;
+    }
+    
+    if (!pasc.empty()) {
+        SrsMp4TrackBox* trak = new SrsMp4TrackBox();
+        moov->add_trak(trak);
+        
+        SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
+        tkhd->volume = 0x0100;
+        trak->set_tkhd(tkhd);
+        
+        atid = tkhd->track_ID = mvhd->next_track_ID++;
+        tkhd->duration = 0;
+        
+        SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
+        trak->set_mdia(mdia);
+        
+        SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
+        mdia->set_mdhd(mdhd);
+        
+        mdhd->timescale = 1000;
+        mdhd->duration = 0;
+        mdhd->set_language0('u');
+        mdhd->set_language1('n');
+        mdhd->set_language2('d');
+        
+        SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
+        mdia->set_hdlr(hdlr);
+        
+        hdlr->handler_type = SrsMp4HandlerTypeSOUN;
+        hdlr->name = "SoundHandler";
+        
+        SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
+        mdia->set_minf(minf);
+        
+        SrsMp4SoundMeidaHeaderBox* smhd = new SrsMp4SoundMeidaHeaderBox();
+        minf->set_smhd(smhd);
+        
+        SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
+        minf->set_dinf(dinf);
+        
+        SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
+        dinf->set_dref(dref);
+        
+        SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
+        dref->append(url);
+        
+        SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
+        minf->set_stbl(stbl);
+        
+        SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
+        stbl->set_stsd(stsd);
+        
+        SrsMp4AudioSampleEntry* mp4a = new SrsMp4AudioSampleEntry();
+        mp4a->data_reference_index = 1;
+        mp4a->samplerate = uint32_t(srs_flv_srates[sample_rate]) << 16;
+        if (sound_bits == SrsAudioSampleBits16bit) {
+            mp4a->samplesize = 16;
+        } else {
+            mp4a->samplesize = 8;
+        }
+        if (channels == SrsAudioChannelsStereo) {
+            mp4a->channelcount = 2;
+        } else {
+            mp4a->channelcount = 1;
+        }
+        stsd->append(mp4a);
+        
+        SrsMp4EsdsBox* esds = new SrsMp4EsdsBox();
+        mp4a->set_esds(esds);
+        
+        SrsMp4ES_Descriptor* es = esds->es;
+        es->ES_ID = 0x02;
+        
+        SrsMp4DecoderConfigDescriptor& desc = es->decConfigDescr;
+        desc.objectTypeIndication = SrsMp4ObjectTypeAac;
+        desc.streamType = SrsMp4StreamTypeAudioStream;
+        srs_freep(desc.decSpecificInfo);
+        
+        SrsMp4DecoderSpecificInfo* asc = new SrsMp4DecoderSpecificInfo();
+        desc.decSpecificInfo = asc;
+        asc->asc = pasc;
+        
+        stbl->set_stts(new SrsMp4DecodingTime2SampleBox());
+        stbl->set_stsc(new SrsMp4Sample2ChunkBox());
+        stbl->set_stsz(new SrsMp4SampleSizeBox());
+        stbl->set_stco(new SrsMp4ChunkOffsetBox());
+        
+        SrsMp4TrackExtendsBox* trex = new SrsMp4TrackExtendsBox();
+        mvex->add_trex(trex);
+        
+        trex->track_ID = atid;
+        trex->default_sample_description_index = 1;
+    }
+    
+    moov->set_mvex(mvex);
+    
+    if ((err = srs_mp4_write_box(writer, moov)) != srs_success) {
+        return srs_error_wrap(err, "write moov");
+    }
+    nb_written += moov->nb_bytes();
+    
+    moov_written = true;
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentedEncoder::write_fragment()
+{
+    srs_error_t err = srs_success;
+    
+    if (!moov_written && (err = write_moov()) != srs_success) {
+        return srs_error_wrap(err, "write moov");
+    }
+    
+    // Drop the samples of track without sequence header, which is cached before moov.
+    if (!vtid && !vsamples->samples.empty()) {
+        srs_freep(vsamples);
+        vsamples = new SrsMp4SampleManager();
+    }
+    if (!atid && !asamples->samples.empty()) {
+        srs_freep(asamples);
+        asamples = new SrsMp4SampleManager();
+    }
+    
+    if (vsamples->samples.empty() && asamples->samples.empty()) {
+        return err;
+    }
+    
+    SrsMp4MovieFragmentBox* moof = new SrsMp4MovieFragmentBox();
+    SrsAutoFree(SrsMp4MovieFragmentBox, moof);
+    
+    SrsMp4MovieFragmentHeaderBox* mfhd = new SrsMp4MovieFragmentHeaderBox();
+    moof->set_mfhd(mfhd);
+    
+    mfhd->sequence_number = ++sequence_number;
+    
+    // The samples in mdat, video then audio.
+    SrsMp4SampleManager* tracks[] = {vsamples, asamples};
+    uint32_t tids[] = {vtid, atid};
+    SrsMp4TrackFragmentBox* trafs[] = {NULL, NULL};
+    for (int i = 0; i < 2; i++) {
+        if (tracks[i]->samples.empty()) {
+            continue;
+        }
+        
+        trafs[i] = new SrsMp4TrackFragmentBox();
+        moof->add_traf(trafs[i]);
+        
+        if ((err = write_traf(trafs[i], tracks[i], tids[i])) != srs_success) {
+            return srs_error_wrap(err, "write traf");
+        }
+    }
+    
+    SrsMp4MediaDataBox* mdat = new SrsMp4MediaDataBox();
+    SrsAutoFree(SrsMp4MediaDataBox, mdat);
+    
+    // Update the data offset of trun, which is relative to moof.
+    uint64_t moof_bytes = moof->nb_bytes();
+    mdat->nb_data = 0;
+    for (int i = 0; i < 2; i++) {
+        if (!trafs[i]) {
+            continue;
+        }
+        
+        trafs[i]->trun()->data_offset = (int32_t)(moof_bytes + mdat->sz_header() + mdat->nb_data);
+        
+        vector<SrsMp4Sample*>::iterator it;
+        for (it = tracks[i]->samples.begin(); it != tracks[i]->samples.end(); ++it) {
+            mdat->nb_data += (*it)->nb_data;
+        }
+    }
+    
+    // The random access point of fragment, the first sample of video, or audio for pure audio.
+    SrsMp4SampleManager* samples = vtid? vsamples : asamples;
+    if (!samples->samples.empty()) {
+        SrsMp4TfraEntry entry;
+        entry.time = samples->samples[0]->pts;
+        entry.moof_offset = nb_written;
+        entry.traf_number = entry.trun_number = entry.sample_number = 1;
+        tfra_entries.push_back(entry);
+    }
+    
+    if ((err = srs_mp4_write_box(writer, moof)) != srs_success) {
+        return srs_error_wrap(err, "write moof");
+    }
+    
+    // Write mdat header, then the samples.
+    if (true) {
+        int nb_data = mdat->sz_header();
+        uint8_t* data = new uint8_t[nb_data];
+        SrsAutoFreeA(uint8_t, data);
+        
+        SrsBuffer* buffer = new SrsBuffer((char*)data, nb_data);
+        SrsAutoFree(SrsBuffer, buffer);
+        
+        if ((err = mdat->encode(buffer)) != srs_success) {
+            return srs_error_wrap(err, "encode mdat");
+        }
+        
+        if ((err = writer->write(data, nb_data, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write mdat");
+        }
+    }
+    
+    for (int i = 0; i < 2; i++) {
+        vector<SrsMp4Sample*>::iterator it;
+        for (it = tracks[i]->samples.begin(); it != tracks[i]->samples.end(); ++it) {
+            SrsMp4Sample* sample = *it;
+            if ((err = writer->write(sample->data, sample->nb_data, NULL)) != srs_success) {
+                return srs_error_wrap(err, "write sample");
+            }
+        }
+    }
+    nb_written += moof_bytes + mdat->nb_bytes();
+    
+    // Free the samples of fragment, so the memory is bounded.
+    srs_freep(vsamples);
+    vsamples = new SrsMp4SampleManager();
+    srs_freep(asamples);
+    asamples = new SrsMp4SampleManager();
+    
+    return err;
+}
+
+srs_error_t SrsMp4FragmentedEncoder::write_traf(SrsMp4TrackFragmentBox* traf, SrsMp4SampleManager* samples, uint32_t tid)
+{
+    srs_error_t err = srs_success;
+    
+    SrsMp4TrackFragmentHeaderBox* tfhd = new SrsMp4TrackFragmentHeaderBox();
+    traf->set_tfhd(tfhd);
+    
+    tfhd->track_id = tid;
+    tfhd->flags = SrsMp4TfhdFlagsDefaultBaseIsMoof;
+    
+    SrsMp4TrackFragmentDecodeTimeBox* tfdt = new SrsMp4TrackFragmentDecodeTimeBox();
+    traf->set_tfdt(tfdt);
+    
+    tfdt->version = 1;
+    tfdt->base_media_decode_time = samples->samples[0]->dts;
+    
+    SrsMp4TrackFragmentRunBox* trun = new SrsMp4TrackFragmentRunBox();
+    traf->set_trun(trun);
+    
+    trun->flags = SrsMp4TrunFlagsDataOffset | SrsMp4TrunFlagsSampleDuration
+        | SrsMp4TrunFlagsSampleSize | SrsMp4TrunFlagsSampleFlag | SrsMp4TrunFlagsSampleCtsOffset;
+    
+    // The duration of sample is the delta to next sample, and the last one use the previous duration.
+    uint32_t sample_duration = 0;
+    for (int i = 0; i < (int)samples->samples.size(); i++) {
+        SrsMp4Sample* sample = samples->samples[i];
+        SrsMp4TrunEntry* entry = new SrsMp4TrunEntry(trun);
+        
+        if (i + 1 < (int)samples->samples.size()) {
+            sample_duration = (uint32_t)(samples->samples[i + 1]->dts - sample->dts);
+        }
+        entry->sample_duration = sample_duration? sample_duration : 40;
+        entry->sample_size = sample->nb_data;
+        
+        // The sample_depends_on is 2 for sync sample, otherwise 1 with sample_is_non_sync_sample.
+        if (sample->type == SrsFrameTypeAudio || sample->frame_type == SrsVideoAvcFrameTypeKeyFrame) {
+            entry->sample_flags = 0x02000000;
+        } else {
+            entry->sample_flags = 0x01010000;
+        }
+        
+        entry->sample_composition_time_offset = (int64_t)(sample->pts - sample->dts);
+        if (entry->sample_composition_time_offset < 0) {
+            trun->version = 1;
+        }
+        
+        trun->entries.push_back(entry);
+    }
+    
+    return err;
+}
+
 SrsMp4M2tsInitEncoder::SrsMp4M2tsInitEncoder()
 {
     writer = NULL;
@@ -6141,17 +6954,23 @@ srs_error_t SrsMp4M2tsInitEncoder::write(SrsFormat* format, bool video, int tid)
             SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
             stbl->set_stsd(stsd);
             
-            SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry();
+            bool is_hevc = format->vcodec->id == SrsVideoCodecIdHEVC;
+            SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry(is_hevc? SrsMp4BoxTypeHVC1 : SrsMp4BoxTypeAVC1);
             stsd->append(avc1);
             
             avc1->width = format->vcodec->width;
             avc1->height = format->vcodec->height;
             avc1->data_reference_index = 1;
             
-            SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
-            avc1->set_avcC(avcC);
-            
-            avcC->avc_config = format->vcodec->avc_extra_data;
+            if (is_hevc) {
+                SrsMp4HvcCBox* hvcC = new SrsMp4HvcCBox();
+                avc1->set_hvcC(hvcC);
+                hvcC->hevc_config = format->vcodec->avc_extra_data;
+            } else {
+                SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
+                avc1->set_avcC(avcC);
+                avcC->avc_config = format->vcodec->avc_extra_data;
+            }
             
             SrsMp4DecodingTime2SampleBox* stts = new SrsMp4DecodingTime2SampleBox();
             stbl->set_stts(stts);
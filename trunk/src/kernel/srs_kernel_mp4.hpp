@@ -33,6 +33,7 @@ class SrsMp4AvccBox;
 class SrsMp4DecoderSpecificInfo;
 class SrsMp4VisualSampleEntry;
 class SrsMp4AvccBox;
+class SrsMp4HvcCBox;
 class SrsMp4AudioSampleEntry;
 class SrsMp4EsdsBox;
 class SrsMp4ChunkOffsetBox;
@@ -56,6 +57,8 @@ class SrsMp4TrackFragmentDecodeTimeBox;
 class SrsMp4TrackFragmentRunBox;
 class SrsMp4EditBox;
 class SrsMp4EditListBox;
+class SrsMp4TrackFragmentRandomAccessBox;
+class SrsMp4MovieFragmentRandomAccessOffsetBox;
 
 // 4.2 Object Structure
 // ISO_IEC_14496-12-base-format-2012.pdf, page 16
@@ -96,6 +99,8 @@ enum SrsMp4BoxType
     SrsMp4BoxTypeSTZ2 = 0x73747a32, // 'stz2'
     SrsMp4BoxTypeAVC1 = 0x61766331, // 'avc1'
     SrsMp4BoxTypeAVCC = 0x61766343, // 'avcC'
+    SrsMp4BoxTypeHVC1 = 0x68766331, // 'hvc1'
+    SrsMp4BoxTypeHVCC = 0x68766343, // 'hvcC'
     SrsMp4BoxTypeMP4A = 0x6d703461, // 'mp4a'
     SrsMp4BoxTypeESDS = 0x65736473, // 'esds'
     SrsMp4BoxTypeUDTA = 0x75647461, // 'udta'
@@ -110,6 +115,9 @@ enum SrsMp4BoxType
     SrsMp4BoxTypeTFDT = 0x74666474, // 'tfdt'
     SrsMp4BoxTypeTRUN = 0x7472756e, // 'trun'
     SrsMp4BoxTypeSIDX = 0x73696478, // 'sidx'
+    SrsMp4BoxTypeMFRA = 0x6d667261, // 'mfra'
+    SrsMp4BoxTypeTFRA = 0x74667261, // 'tfra'
+    SrsMp4BoxTypeMFRO = 0x6d66726f, // 'mfro'
 };
 
 // 8.4.3.3 Semantics
@@ -315,6 +323,8 @@ public:
     // Get the traf.
     virtual SrsMp4TrackFragmentBox* traf();
     virtual void set_traf(SrsMp4TrackFragmentBox* v);
+    // Add a traf, for fragment with multiple tracks.
+    virtual void add_traf(SrsMp4TrackFragmentBox* v);
 };
 
 // 8.8.5 Movie Fragment Header Box (mfhd)
@@ -707,6 +717,8 @@ public:
     // Get the track extends box.
     virtual SrsMp4TrackExtendsBox* trex();
     virtual void set_trex(SrsMp4TrackExtendsBox* v);
+    // Add a track extends box, for movie with multiple tracks.
+    virtual void add_trex(SrsMp4TrackExtendsBox* v);
 };
 
 // 8.8.3 Track Extends Box(trex)
@@ -1257,12 +1269,15 @@ public:
     uint16_t depth;
     int16_t pre_defined2;
 public:
-    SrsMp4VisualSampleEntry();
+    SrsMp4VisualSampleEntry(SrsMp4BoxType boxType = SrsMp4BoxTypeAVC1);
     virtual ~SrsMp4VisualSampleEntry();
 public:
     // For avc1, get the avcc box.
     virtual SrsMp4AvccBox* avcC();
     virtual void set_avcC(SrsMp4AvccBox* v);
+    // For hvc1, get the hvcC box.
+    virtual SrsMp4HvcCBox* hvcC();
+    virtual void set_hvcC(SrsMp4HvcCBox* v);
 protected:
     virtual int nb_header();
     virtual srs_error_t encode_header(SrsBuffer* buf);
@@ -1288,6 +1303,23 @@ public:
     virtual std::stringstream& dumps_detail(std::stringstream& ss, SrsMp4DumpContext dc);
 };
 
+// 8.4.1 HEVC Video Stream Definition (hvcC)
+// ISO_IEC_14496-15-2017.pdf, page 85
+class SrsMp4HvcCBox : public SrsMp4Box
+{
+public:
+    std::vector<char> hevc_config;
+public:
+    SrsMp4HvcCBox();
+    virtual ~SrsMp4HvcCBox();
+protected:
+    virtual int nb_header();
+    virtual srs_error_t encode_header(SrsBuffer* buf);
+    virtual srs_error_t decode_header(SrsBuffer* buf);
+public:
+    virtual std::stringstream& dumps_detail(std::stringstream& ss, SrsMp4DumpContext dc);
+};
+
 // 8.5.2 Sample Description Box (mp4a)
 // ISO_IEC_14496-12-base-format-2012.pdf, page 45
 class SrsMp4AudioSampleEntry : public SrsMp4SampleEntry
@@ -1836,6 +1868,75 @@ public:
     virtual std::stringstream& dumps_detail(std::stringstream& ss, SrsMp4DumpContext dc);
 };
 
+// 8.8.9 Movie Fragment Random Access Box (mfra)
+// ISO_IEC_14496-12-base-format-2012.pdf, page 70
+// The Movie Fragment Random Access Box provides a table which may assist readers in finding random access
+// points in a file using movie fragments, usually placed at or near the end of the file.
+class SrsMp4MovieFragmentRandomAccessBox : public SrsMp4Box
+{
+public:
+    SrsMp4MovieFragmentRandomAccessBox();
+    virtual ~SrsMp4MovieFragmentRandomAccessBox();
+public:
+    // Add a tfra for a track.
+    virtual void add_tfra(SrsMp4TrackFragmentRandomAccessBox* v);
+    // Get the mfro, which must be the last box in mfra.
+    virtual SrsMp4MovieFragmentRandomAccessOffsetBox* mfro();
+    virtual void set_mfro(SrsMp4MovieFragmentRandomAccessOffsetBox* v);
+};
+
+// The entry for tfra, a random access sample of track.
+// ISO_IEC_14496-12-base-format-2012.pdf, page 71
+struct SrsMp4TfraEntry
+{
+    // The presentation time of the sync sample, in the timescale of track.
+    uint64_t time;
+    // The offset of moof, from the beginning of file.
+    uint64_t moof_offset;
+    // The traf, trun and sample number, start from 1.
+    uint32_t traf_number;
+    uint32_t trun_number;
+    uint32_t sample_number;
+};
+
+// 8.8.10 Track Fragment Random Access Box (tfra)
+// ISO_IEC_14496-12-base-format-2012.pdf, page 71
+// Each entry contains the location and the presentation time of the sync sample.
+// @remark We always use 1 byte for traf_number, trun_number and sample_number.
+class SrsMp4TrackFragmentRandomAccessBox : public SrsMp4FullBox
+{
+public:
+    uint32_t track_ID;
+    std::vector<SrsMp4TfraEntry> entries;
+public:
+    SrsMp4TrackFragmentRandomAccessBox();
+    virtual ~SrsMp4TrackFragmentRandomAccessBox();
+protected:
+    virtual int nb_header();
+    virtual srs_error_t encode_header(SrsBuffer* buf);
+    virtual srs_error_t decode_header(SrsBuffer* buf);
+public:
+    virtual std::stringstream& dumps_detail(std::stringstream& ss, SrsMp4DumpContext dc);
+};
+
+// 8.8.11 Movie Fragment Random Access Offset Box (mfro)
+// ISO_IEC_14496-12-base-format-2012.pdf, page 72
+// The size of the enclosing mfra box, to find the mfra by seeking from the end of file.
+class SrsMp4MovieFragmentRandomAccessOffsetBox : public SrsMp4FullBox
+{
+public:
+    uint32_t mfra_size;
+public:
+    SrsMp4MovieFragmentRandomAccessOffsetBox();
+    virtual ~SrsMp4MovieFragmentRandomAccessOffsetBox();
+protected:
+    virtual int nb_header();
+    virtual srs_error_t encode_header(SrsBuffer* buf);
+    virtual srs_error_t decode_header(SrsBuffer* buf);
+public:
+    virtual std::stringstream& dumps_detail(std::stringstream& ss, SrsMp4DumpContext dc);
+};
+
 // Generally, a MP4 sample contains a frame, for example, a video frame or audio frame.
 class SrsMp4Sample
 {
@@ -2074,6 +2175,68 @@ private:
     virtual srs_error_t do_write_sample(SrsMp4Sample* ps, uint8_t* sample, uint32_t nb_sample);
 };
 
+// A fMP4 encoder, to write a fragmented MP4 file with audio and video tracks, for example, DVR.
+// The ftyp and moov are written before the first fragment, then the samples are written in moof
+// and mdat fragments, and the mfra is written when flush, for player to seek.
+// @remark Only the samples of current fragment are cached, so the memory is bounded, and the file
+//      is still playable if not flushed, for example, the server crashed.
+class SrsMp4FragmentedEncoder
+{
+private:
+    ISrsWriter* writer;
+    // The duration in ms of fragment, reap at video keyframe when exceed it.
+    uint32_t fragment;
+    // The sequence number of fragment, start from 1.
+    uint32_t sequence_number;
+    // The bytes written to writer, the offset of moof for mfra.
+    uint64_t nb_written;
+    // Whether the moov is written, the tracks are fixed after it.
+    bool moov_written;
+    // The track id of video and audio, zero if no track.
+    uint32_t vtid;
+    uint32_t atid;
+    // The samples of current fragment.
+    SrsMp4SampleManager* vsamples;
+    SrsMp4SampleManager* asamples;
+    // The random access entries of each fragment, for mfra.
+    std::vector<SrsMp4TfraEntry> tfra_entries;
+public:
+    // The audio codec, sample rate, sound bits and channels, the same to SrsMp4Encoder.
+    SrsAudioCodecId acodec;
+    SrsAudioSampleRate sample_rate;
+    SrsAudioSampleBits sound_bits;
+    SrsAudioChannels channels;
+    // The video codec.
+    SrsVideoCodecId vcodec;
+private:
+    // The sequence header, the asc and avcc.
+    std::vector<char> pasc;
+    std::vector<char> pavcc;
+    // The size width/height of video.
+    uint32_t width;
+    uint32_t height;
+public:
+    SrsMp4FragmentedEncoder();
+    virtual ~SrsMp4FragmentedEncoder();
+public:
+    // Initialize the encoder with a writer w.
+    // @param fragment The duration of fragment in srs_utime_t.
+    virtual srs_error_t initialize(ISrsWriter* w, srs_utime_t fragment);
+    // Write a sample, the same to SrsMp4Encoder, reap the fragment if exceed the duration.
+    virtual srs_error_t write_sample(SrsFormat* format, SrsMp4HandlerType ht, uint16_t ft, uint16_t ct,
+        uint32_t dts, uint32_t pts, uint8_t* sample, uint32_t nb_sample);
+    // Flush the last fragment, then write the mfra.
+    virtual srs_error_t flush();
+private:
+    virtual srs_error_t copy_sequence_header(SrsFormat* format, bool vsh, uint8_t* sample, uint32_t nb_sample);
+    // Write the ftyp and moov, with the tracks of sequence header.
+    virtual srs_error_t write_moov();
+    // Write the cached samples in moof and mdat.
+    virtual srs_error_t write_fragment();
+    // Write the samples info of track to traf.
+    virtual srs_error_t write_traf(SrsMp4TrackFragmentBox* traf, SrsMp4SampleManager* samples, uint32_t tid);
+};
+
 // A fMP4 encoder, to write the init.mp4 with sequence header.
 class SrsMp4M2tsInitEncoder
 {
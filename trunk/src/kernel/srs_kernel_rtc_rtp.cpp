@@ -760,6 +760,7 @@ SrsRtpPacket::SrsRtpPacket()
 
     nalu_type = SrsAvcNaluTypeReserved;
     frame_type = SrsFrameTypeReserved;
+    recv_time = 0;
     cached_payload_size = 0;
     decode_handler = NULL;
 
@@ -830,6 +831,7 @@ SrsRtpPacket* SrsRtpPacket::copy()
     cp->shared_buffer_ = shared_buffer_? shared_buffer_->copy2() : NULL;
     cp->actual_buffer_size_ = actual_buffer_size_;
     cp->frame_type = frame_type;
+    cp->recv_time = recv_time;
 
     cp->cached_payload_size = cached_payload_size;
     // For performance issue, do not copy the unused field.
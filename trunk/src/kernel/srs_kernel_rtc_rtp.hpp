@@ -288,6 +288,8 @@ public:
     SrsAvcNaluType nalu_type;
     // The frame type, for RTMP bridger or SFU source.
     SrsFrameType frame_type;
+    // The time when received from publisher, to stat the latency, 0 if not received from RTC.
+    srs_utime_t recv_time;
 // Fast cache for performance.
 private:
     // The cached payload size for packet.
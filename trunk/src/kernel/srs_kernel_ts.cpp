@@ -15,7 +15,7 @@
 #include <sstream>
 using namespace std;
 
-#include <openssl/aes.h>
+#include <openssl/evp.h>
 #include <cstring>
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
@@ -25,7 +25,9 @@ using namespace std;
 #include <srs_kernel_buffer.hpp>
 #include <srs_core_autofree.hpp>
 
-#define HLS_AES_ENCRYPT_BLOCK_LENGTH SRS_TS_PACKET_SIZE * 4
+// The initial size of cipher buffer, grows to the max size of write batch.
+#define HLS_AES_ENCRYPT_BUFFER_SIZE SRS_TS_PACKET_SIZE * 64
+#define HLS_AES_BLOCK_SIZE 16
 
 // the mpegts header specifed the video/audio pid.
 #define TS_PMT_NUMBER 1
@@ -43,6 +45,7 @@ string srs_ts_stream2string(SrsTsStream stream)
         case SrsTsStreamAudioAC3: return "AC3";
         case SrsTsStreamAudioDTS: return "AudioDTS";
         case SrsTsStreamVideoH264: return "H.264";
+        case SrsTsStreamVideoHEVC: return "H.265";
         case SrsTsStreamVideoMpeg4: return "MP4";
         case SrsTsStreamAudioMpeg4: return "MP4A";
         default: return "Other";
@@ -54,9 +57,11 @@ SrsTsChannel::SrsTsChannel()
     pid = 0;
     apply = SrsTsPidApplyReserved;
     stream = SrsTsStreamReserved;
+    program = 0;
     msg = NULL;
     continuity_counter = 0;
     context = NULL;
+    nn_last_msg = 0;
 }
 
 SrsTsChannel::~SrsTsChannel()
@@ -104,6 +109,12 @@ srs_error_t SrsTsMessage::dump(SrsBuffer* stream, int* pnb_bytes)
             return srs_error_new(ERROR_STREAM_CASTER_TS_PSE, "ts: dump PSE bytes failed, requires=%dB", nb_bytes);
         }
         
+        // Pre-size the payload for the first bytes, to avoid reallocating when append packets.
+        if (payload->length() == 0) {
+            int nn_hint = channel? channel->nn_last_msg : 0;
+            payload->reserve(srs_max(nn_hint, (int)PES_packet_length));
+        }
+        
         payload->append(stream->data() + stream->pos(), nb_bytes);
         stream->skip(nb_bytes);
     }
@@ -181,10 +192,15 @@ SrsTsContext::SrsTsContext()
     sync_byte = 0x47; // ts default sync byte.
     vcodec = SrsVideoCodecIdReserved;
     acodec = SrsAudioCodecIdReserved1;
+    packets = NULL;
+    packet = new SrsTsPacket(this);
 }
 
 SrsTsContext::~SrsTsContext()
 {
+    srs_freepa(packets);
+    srs_freep(packet);
+
     std::map<int, SrsTsChannel*>::iterator it;
     for (it = pids.begin(); it != pids.end(); ++it) {
         SrsTsChannel* channel = it->second;
@@ -226,7 +242,7 @@ SrsTsChannel* SrsTsContext::get(int pid)
     return pids[pid];
 }
 
-void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream)
+void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream, int program)
 {
     SrsTsChannel* channel = NULL;
     
@@ -241,6 +257,7 @@ void SrsTsContext::set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream)
     channel->pid = pid;
     channel->apply = apply_pid;
     channel->stream = stream;
+    channel->program = program;
 }
 
 srs_error_t SrsTsContext::decode(SrsBuffer* stream, ISrsTsHandler* handler)
@@ -250,9 +267,6 @@ srs_error_t SrsTsContext::decode(SrsBuffer* stream, ISrsTsHandler* handler)
     // parse util EOF of stream.
     // for example, parse multiple times for the PES_packet_length(0) packet.
     while (!stream->empty()) {
-        SrsTsPacket* packet = new SrsTsPacket(this);
-        SrsAutoFree(SrsTsPacket, packet);
-        
         SrsTsMessage* msg = NULL;
         if ((err = packet->decode(stream, &msg)) != srs_success) {
             return srs_error_wrap(err, "ts: ts packet decode");
@@ -263,6 +277,11 @@ srs_error_t SrsTsContext::decode(SrsBuffer* stream, ISrsTsHandler* handler)
         }
         SrsAutoFree(SrsTsMessage, msg);
         
+        // Use the size of message as hint, to pre-size the next message of channel.
+        if (msg->channel) {
+            msg->channel->nn_last_msg = msg->payload->length();
+        }
+        
         if ((err = handler->on_ts_message(msg)) != srs_success) {
             return srs_error_wrap(err, "ts: handle ts message");
         }
@@ -282,6 +301,10 @@ srs_error_t SrsTsContext::encode(ISrsStreamWriter* writer, SrsTsMessage* msg, Sr
             vs = SrsTsStreamVideoH264;
             video_pid = TS_VIDEO_AVC_PID;
             break;
+        case SrsVideoCodecIdHEVC:
+            vs = SrsTsStreamVideoHEVC;
+            video_pid = TS_VIDEO_AVC_PID;
+            break;
         case SrsVideoCodecIdDisabled:
             vs = SrsTsStreamReserved;
             break;
@@ -293,7 +316,6 @@ srs_error_t SrsTsContext::encode(ISrsStreamWriter* writer, SrsTsMessage* msg, Sr
         case SrsVideoCodecIdOn2VP6:
         case SrsVideoCodecIdOn2VP6WithAlphaChannel:
         case SrsVideoCodecIdScreenVideoVersion2:
-        case SrsVideoCodecIdHEVC:
         case SrsVideoCodecIdAV1:
             vs = SrsTsStreamReserved;
             break;
@@ -358,7 +380,7 @@ srs_error_t SrsTsContext::encode_pat_pmt(ISrsStreamWriter* writer, int16_t vpid,
 {
     srs_error_t err = srs_success;
     
-    if (vs != SrsTsStreamVideoH264 && as != SrsTsStreamAudioAAC && as != SrsTsStreamAudioMp3) {
+    if (vs != SrsTsStreamVideoH264 && vs != SrsTsStreamVideoHEVC && as != SrsTsStreamAudioAAC && as != SrsTsStreamAudioMp3) {
         return srs_error_new(ERROR_HLS_NO_STREAM, "ts: no PID, vs=%d, as=%d", vs, as);
     }
     
@@ -415,6 +437,23 @@ srs_error_t SrsTsContext::encode_pat_pmt(ISrsStreamWriter* writer, int16_t vpid,
     return err;
 }
 
+// Write the 33bits PTS or DTS of PES header, see SrsTsPayloadPES::encode_33bits_dts_pts
+static inline char* srs_ts_write_33bits(char* p, uint8_t fb, int64_t v)
+{
+    int32_t val = int32_t(fb << 4 | (((v >> 30) & 0x07) << 1) | 1);
+    *p++ = val;
+
+    val = int32_t((((v >> 15) & 0x7fff) << 1) | 1);
+    *p++ = (val >> 8);
+    *p++ = val;
+
+    val = int32_t((((v) & 0x7fff) << 1) | 1);
+    *p++ = (val >> 8);
+    *p++ = val;
+
+    return p;
+}
+
 srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio)
 {
     srs_error_t err = srs_success;
@@ -428,7 +467,137 @@ srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg
         return err;
     }
     
-    if (sid != SrsTsStreamVideoH264 && sid != SrsTsStreamAudioMp3 && sid != SrsTsStreamAudioAAC) {
+    if (sid != SrsTsStreamVideoH264 && sid != SrsTsStreamVideoHEVC && sid != SrsTsStreamAudioMp3 && sid != SrsTsStreamAudioAAC) {
+        srs_info("ts: ignore the unknown stream, sid=%d", sid);
+        return err;
+    }
+    
+    SrsTsChannel* channel = get(pid);
+    srs_assert(channel);
+
+    if (!packets) {
+        packets = new char[SRS_TS_PACKETS_CACHE];
+    }
+    int nb_packets = 0;
+    
+    char* start = msg->payload->bytes();
+    char* end = start + msg->payload->length();
+    char* p = start;
+
+    // For pure audio, always write pcr, see encode_pes_packets.
+    int64_t pcr = (msg->write_pcr || (pure_audio && msg->is_audio()))? msg->dts : -1;
+    // The PES header is 9B fixed header, with 5B PTS, or 10B PTS and DTS.
+    int nb_pes_header = (msg->dts == msg->pts)? 14 : 19;
+    
+    while (p < end) {
+        // Flush the cache when full.
+        if (nb_packets + SRS_TS_PACKET_SIZE > SRS_TS_PACKETS_CACHE) {
+            if ((err = writer->write(packets, nb_packets, NULL)) != srs_success) {
+                return srs_error_wrap(err, "ts: write packets");
+            }
+            nb_packets = 0;
+        }
+
+        char* pkt = packets + nb_packets;
+        nb_packets += SRS_TS_PACKET_SIZE;
+
+        bool first = (p == start);
+
+        // The 4B TS header, the 2B adaptation field with 6B PCR for first packet, and the PES header.
+        int nb_af = (first && pcr >= 0)? 8 : 0;
+        int nb_pes = first? nb_pes_header : 0;
+
+        int left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - 4 - nb_af - nb_pes);
+        int nb_stuffings = SRS_TS_PACKET_SIZE - 4 - nb_af - nb_pes - left;
+        if (nb_stuffings > 0) {
+            // The adaptation field for padding consumes 2B at least, see SrsTsPacket::padding.
+            nb_af += nb_af? nb_stuffings : 2 + srs_max(0, nb_stuffings - 2);
+            left = (int)srs_min(end - p, SRS_TS_PACKET_SIZE - 4 - nb_af - nb_pes);
+        }
+
+        // 4B TS header.
+        char* q = pkt;
+        int16_t pidv = (pid & 0x1FFF) | (first? 0x4000 : 0);
+        *q++ = sync_byte;
+        *q++ = (char)(pidv >> 8);
+        *q++ = (char)pidv;
+        *q++ = (channel->continuity_counter++ & 0x0F) | ((nb_af? SrsTsAdaptationFieldTypeBoth : SrsTsAdaptationFieldTypePayloadOnly) << 4);
+
+        // The adaptation field, with PCR and stuffings.
+        if (nb_af) {
+            bool has_pcr = first && pcr >= 0;
+            *q++ = (char)(nb_af - 1);
+            *q++ = has_pcr? (char)(((msg->is_discontinuity? 1 : 0) << 7) | 0x10) : 0;
+
+            if (has_pcr) {
+                // @remark, use pcr base and ignore the extension, see SrsTsAdaptationField::encode
+                int64_t pcrv = (0x3F << 9) & 0x7E00;
+                pcrv |= (pcr << 15) & 0xFFFFFFFF8000LL;
+                *q++ = (char)(pcrv >> 40);
+                *q++ = (char)(pcrv >> 32);
+                *q++ = (char)(pcrv >> 24);
+                *q++ = (char)(pcrv >> 16);
+                *q++ = (char)(pcrv >> 8);
+                *q++ = (char)pcrv;
+            }
+
+            int nb_reserved = nb_af - (has_pcr? 8 : 2);
+            memset(q, 0xFF, nb_reserved);
+            q += nb_reserved;
+        }
+
+        // The PES header, see SrsTsPayloadPES::encode
+        if (first) {
+            int size = msg->payload->length();
+            int PES_header_data_length = nb_pes_header - 9;
+            int32_t pplv = (size > 0xFFFF)? 0 : size + 3 + PES_header_data_length;
+            pplv = (pplv > 0xFFFF)? 0 : pplv;
+
+            *q++ = 0x00;
+            *q++ = 0x00;
+            *q++ = 0x01;
+            *q++ = (char)msg->sid;
+            *q++ = (char)(pplv >> 8);
+            *q++ = (char)pplv;
+            // The const2bits is 0x02.
+            *q++ = (char)0x80;
+            *q++ = (char)(((msg->dts == msg->pts)? 0x02 : 0x03) << 6);
+            *q++ = (char)PES_header_data_length;
+
+            if (msg->dts == msg->pts) {
+                q = srs_ts_write_33bits(q, 0x02, msg->pts);
+            } else {
+                q = srs_ts_write_33bits(q, 0x03, msg->pts);
+                q = srs_ts_write_33bits(q, 0x01, msg->dts);
+            }
+        }
+
+        srs_assert(q + left == pkt + SRS_TS_PACKET_SIZE);
+        memcpy(q, p, left);
+        p += left;
+    }
+
+    if (nb_packets > 0 && (err = writer->write(packets, nb_packets, NULL)) != srs_success) {
+        return srs_error_wrap(err, "ts: write packets");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsTsContext::encode_pes_packets(ISrsStreamWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio)
+{
+    srs_error_t err = srs_success;
+    
+    // Sometimes, the context is not ready(PAT/PMT write failed), error in this situation.
+    if (!ready) {
+        return srs_error_new(ERROR_TS_CONTEXT_NOT_READY, "ts: not ready");
+    }
+
+    if (msg->payload->length() == 0) {
+        return err;
+    }
+    
+    if (sid != SrsTsStreamVideoH264 && sid != SrsTsStreamVideoHEVC && sid != SrsTsStreamAudioMp3 && sid != SrsTsStreamAudioAAC) {
         srs_info("ts: ignore the unknown stream, sid=%d", sid);
         return err;
     }
@@ -543,6 +712,10 @@ srs_error_t SrsTsPacket::decode(SrsBuffer* stream, SrsTsMessage** ppmsg)
     
     int pos = stream->pos();
     
+    // The packet is reused by context, so reset the optional fields.
+    srs_freep(adaptation_field);
+    srs_freep(payload);
+    
     // 4B ts packet header.
     if (!stream->require(4)) {
         return srs_error_new(ERROR_STREAM_CASTER_TS_HEADER, "ts: decode packet");
@@ -754,7 +927,7 @@ SrsTsPacket* SrsTsPacket::create_pmt(SrsTsContext* context,
     pmt->last_section_number = 0;
     
     // must got one valid codec.
-    srs_assert(vs == SrsTsStreamVideoH264 || as == SrsTsStreamAudioAAC || as == SrsTsStreamAudioMp3);
+    srs_assert(vs == SrsTsStreamVideoH264 || vs == SrsTsStreamVideoHEVC || as == SrsTsStreamAudioAAC || as == SrsTsStreamAudioMp3);
     
     // if mp3 or aac specified, use audio to carry pcr.
     if (as == SrsTsStreamAudioAAC || as == SrsTsStreamAudioMp3) {
@@ -764,8 +937,8 @@ SrsTsPacket* SrsTsPacket::create_pmt(SrsTsContext* context,
         pmt->infos.push_back(new SrsTsPayloadPMTESInfo(as, apid));
     }
     
-    // if h.264 specified, use video to carry pcr.
-    if (vs == SrsTsStreamVideoH264) {
+    // if h.264 or h.265 specified, use video to carry pcr.
+    if (vs == SrsTsStreamVideoH264 || vs == SrsTsStreamVideoHEVC) {
         pmt->PCR_PID = vpid;
         pmt->infos.push_back(new SrsTsPayloadPMTESInfo(vs, vpid));
     }
@@ -2490,14 +2663,15 @@ srs_error_t SrsTsPayloadPMT::psi_decode(SrsBuffer* stream)
         // update the apply pid table
         switch (info->stream_type) {
             case SrsTsStreamVideoH264:
+            case SrsTsStreamVideoHEVC:
             case SrsTsStreamVideoMpeg4:
-                packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type);
+                packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type, program_number);
                 break;
             case SrsTsStreamAudioAAC:
             case SrsTsStreamAudioAC3:
             case SrsTsStreamAudioDTS:
             case SrsTsStreamAudioMp3:
-                packet->context->set(info->elementary_PID, SrsTsPidApplyAudio, info->stream_type);
+                packet->context->set(info->elementary_PID, SrsTsPidApplyAudio, info->stream_type, program_number);
                 break;
             default:
                 srs_warn("ts: drop pid=%#x, stream=%#x", info->elementary_PID, info->stream_type);
@@ -2573,14 +2747,15 @@ srs_error_t SrsTsPayloadPMT::psi_encode(SrsBuffer* stream)
         // update the apply pid table
         switch (info->stream_type) {
             case SrsTsStreamVideoH264:
+            case SrsTsStreamVideoHEVC:
             case SrsTsStreamVideoMpeg4:
-                packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type);
+                packet->context->set(info->elementary_PID, SrsTsPidApplyVideo, info->stream_type, program_number);
                 break;
             case SrsTsStreamAudioAAC:
             case SrsTsStreamAudioAC3:
             case SrsTsStreamAudioDTS:
             case SrsTsStreamAudioMp3:
-                packet->context->set(info->elementary_PID, SrsTsPidApplyAudio, info->stream_type);
+                packet->context->set(info->elementary_PID, SrsTsPidApplyAudio, info->stream_type, program_number);
                 break;
             default:
                 srs_warn("ts: drop pid=%#x, stream=%#x", info->elementary_PID, info->stream_type);
@@ -2642,48 +2817,66 @@ SrsVideoCodecId SrsTsContextWriter::video_codec()
     return vcodec;
 }
 
+void SrsTsContextWriter::set_video_codec(SrsVideoCodecId v)
+{
+    vcodec = v;
+}
+
 SrsEncFileWriter::SrsEncFileWriter()
 {
-    memset(iv,0,16);
-    
-    buf = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH];
-    memset(buf, 0, HLS_AES_ENCRYPT_BLOCK_LENGTH);
+    ctx = EVP_CIPHER_CTX_new();
+    configured = false;
     
+    capacity = HLS_AES_ENCRYPT_BUFFER_SIZE;
+    buf = new char[capacity];
     nb_buf = 0;
-    key = (unsigned char*)new AES_KEY();
 }
 
 SrsEncFileWriter::~SrsEncFileWriter()
 {
     srs_freepa(buf);
     
-    AES_KEY* k = (AES_KEY*)key;
-    srs_freep(k);
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ctx);
 }
 
 srs_error_t SrsEncFileWriter::write(void* data, size_t count, ssize_t* pnwrite)
 {
     srs_error_t err = srs_success;
     
-    srs_assert(count == SRS_TS_PACKET_SIZE);
+    if ((err = encrypt(data, (int)count)) != srs_success) {
+        return srs_error_wrap(err, "encrypt");
+    }
+    
+    if ((err = flush_cipher()) != srs_success) {
+        return srs_error_wrap(err, "write cipher");
+    }
 
-    if (nb_buf < HLS_AES_ENCRYPT_BLOCK_LENGTH) {
-        memcpy(buf + nb_buf, (char*)data, SRS_TS_PACKET_SIZE);
-        nb_buf += SRS_TS_PACKET_SIZE;
+    if (pnwrite) {
+        *pnwrite = count;
     }
     
-    if (nb_buf == HLS_AES_ENCRYPT_BLOCK_LENGTH) {
-        nb_buf = 0;
-        
-        char* cipher = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH];
-        SrsAutoFreeA(char, cipher);
-        
-        AES_KEY* k = (AES_KEY*)key;
-        AES_cbc_encrypt((unsigned char *)buf, (unsigned char *)cipher, HLS_AES_ENCRYPT_BLOCK_LENGTH, k, iv, AES_ENCRYPT);
-        
-        if ((err = SrsFileWriter::write(cipher, HLS_AES_ENCRYPT_BLOCK_LENGTH, pnwrite)) != srs_success) {
-            return srs_error_wrap(err, "write cipher");
+    return err;
+}
+
+srs_error_t SrsEncFileWriter::writev(const iovec* iov, int iovcnt, ssize_t* pnwrite)
+{
+    srs_error_t err = srs_success;
+    
+    ssize_t nwrite = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        const iovec* piov = iov + i;
+        if ((err = encrypt(piov->iov_base, (int)piov->iov_len)) != srs_success) {
+            return srs_error_wrap(err, "encrypt");
         }
+        nwrite += piov->iov_len;
+    }
+    
+    if ((err = flush_cipher()) != srs_success) {
+        return srs_error_wrap(err, "write cipher");
+    }
+    
+    if (pnwrite) {
+        *pnwrite = nwrite;
     }
     
     return err;
@@ -2693,42 +2886,98 @@ srs_error_t SrsEncFileWriter::config_cipher(unsigned char* key, unsigned char* i
 {
     srs_error_t err = srs_success;
     
-    memcpy(this->iv, iv, 16);
-  
-    AES_KEY* k = (AES_KEY*)this->key;
-    if (AES_set_encrypt_key(key, 16 * 8, k)) {
+    // Reset the context for new segment, with the new key and iv.
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    if (EVP_EncryptInit_ex(c, EVP_aes_128_cbc(), NULL, key, iv) != 1) {
+        configured = false;
         return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "set aes key failed");
     }
     
+    configured = true;
+    nb_buf = 0;
+    
     return err;
 }
 
 void SrsEncFileWriter::close()
 {
-    if(nb_buf > 0) {
-        int nb_padding = 16 - (nb_buf % 16);
-        if (nb_padding > 0) {
-            memset(buf + nb_buf, nb_padding, nb_padding);
-        }
-        
-        char* cipher = new char[nb_buf + nb_padding];
-        SrsAutoFreeA(char, cipher);
-        
-        AES_KEY* k = (AES_KEY*)key;
-        AES_cbc_encrypt((unsigned char *)buf, (unsigned char *)cipher, nb_buf + nb_padding, k, iv, AES_ENCRYPT);
+    srs_error_t err = srs_success;
+    
+    // Write the last block with PKCS7 padding.
+    if (configured) {
+        configured = false;
         
-        srs_error_t err = srs_success;
-        if ((err = SrsFileWriter::write(cipher, nb_buf + nb_padding, NULL)) != srs_success) {
-            srs_warn("ignore err %s", srs_error_desc(err).c_str());
-            srs_error_reset(err);
+        int nn = 0;
+        EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+        if (EVP_EncryptFinal_ex(c, (unsigned char*)buf, &nn) != 1) {
+            srs_warn("ignore aes final failed");
+        } else {
+            nb_buf = nn;
+            if ((err = flush_cipher()) != srs_success) {
+                srs_warn("ignore err %s", srs_error_desc(err).c_str());
+                srs_error_reset(err);
+            }
         }
-
-        nb_buf = 0;
     }
     
     SrsFileWriter::close();
 }
 
+void SrsEncFileWriter::reserve(int size)
+{
+    // The cipher text might be one block larger than plain text.
+    int required = nb_buf + size + HLS_AES_BLOCK_SIZE;
+    if (required <= capacity) {
+        return;
+    }
+    
+    int nn = srs_max(capacity * 2, required);
+    char* nbuf = new char[nn];
+    memcpy(nbuf, buf, nb_buf);
+    
+    srs_freepa(buf);
+    buf = nbuf;
+    capacity = nn;
+}
+
+srs_error_t SrsEncFileWriter::encrypt(const void* data, int size)
+{
+    srs_error_t err = srs_success;
+    
+    if (!configured) {
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "aes key not configured");
+    }
+    
+    reserve(size);
+    
+    int nn = 0;
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    if (EVP_EncryptUpdate(c, (unsigned char*)buf + nb_buf, &nn, (const unsigned char*)data, size) != 1) {
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "aes encrypt %d bytes", size);
+    }
+    nb_buf += nn;
+    
+    return err;
+}
+
+srs_error_t SrsEncFileWriter::flush_cipher()
+{
+    srs_error_t err = srs_success;
+    
+    if (nb_buf <= 0) {
+        return err;
+    }
+    
+    int nn = nb_buf;
+    nb_buf = 0;
+    
+    if ((err = SrsFileWriter::write(buf, nn, NULL)) != srs_success) {
+        return srs_error_wrap(err, "write %d bytes", nn);
+    }
+    
+    return err;
+}
+
 SrsTsMessageCache::SrsTsMessageCache()
 {
     audio = NULL;
@@ -2791,7 +3040,12 @@ srs_error_t SrsTsMessageCache::cache_video(SrsVideoFrame* frame, int64_t dts)
     video->sid = SrsTsPESStreamIdVideoCommon;
     
     // write video to cache.
-    if ((err = do_cache_avc(frame)) != srs_success) {
+    SrsVideoCodecConfig* c = frame->vcodec();
+    if (c && c->id == SrsVideoCodecIdHEVC) {
+        if ((err = do_cache_hevc(frame)) != srs_success) {
+            return srs_error_wrap(err, "ts: cache hevc");
+        }
+    } else if ((err = do_cache_avc(frame)) != srs_success) {
         return srs_error_wrap(err, "ts: cache avc");
     }
     
@@ -3021,6 +3275,67 @@ srs_error_t SrsTsMessageCache::do_cache_avc(SrsVideoFrame* frame)
     return err;
 }
 
+srs_error_t SrsTsMessageCache::do_cache_hevc(SrsVideoFrame* frame)
+{
+    srs_error_t err = srs_success;
+    
+    // Whether aud inserted.
+    bool aud_inserted = false;
+    
+    // Insert a default AUD NALU when no AUD in samples, which is required by H.265 in TS.
+    // 7.3.2.5 Access unit delimiter RBSP syntax, T-REC-H.265-201802, page 45.
+    // The NAL unit header is nal_unit_type=35, nuh_layer_id=0, nuh_temporal_id_plus1=1,
+    // and pic_type u(3) is 2 for I, P and B slices, followed by the rbsp_trailing_bits.
+    if (!frame->has_aud) {
+        static uint8_t default_aud_nalu[] = { 0x46, 0x01, 0x50 };
+        srs_avc_insert_aud(video->payload, aud_inserted);
+        video->payload->append((const char*)default_aud_nalu, 3);
+    }
+    
+    SrsVideoCodecConfig* codec = frame->vcodec();
+    srs_assert(codec);
+    
+    bool is_vps_sps_pps_appended = false;
+    
+    // all sample use cont nalu header, except the vps-sps-pps before IRAP frame.
+    for (int i = 0; i < frame->nb_samples; i++) {
+        SrsSample* sample = &frame->samples[i];
+        int32_t size = sample->size;
+        
+        if (!sample->bytes || size <= 0) {
+            return srs_error_new(ERROR_HLS_AVC_SAMPLE_SIZE, "ts: invalid hevc sample length=%d", size);
+        }
+        
+        // 6bits, 7.3.1.2 NAL unit header syntax, T-REC-H.265-201802, page 34.
+        SrsHevcNaluType nal_unit_type = SrsHevcNaluTypeParse(sample->bytes[0]);
+        bool is_irap = nal_unit_type >= SrsHevcNaluTypeCodedSliceBlaWlp && nal_unit_type <= SrsHevcNaluTypeReservedIrap23;
+        
+        // Insert vps/sps/pps before IRAP when there is no vps/sps/pps in samples.
+        // The vps/sps/pps is parsed from sequence header(generally the first flv packet).
+        if (is_irap && !frame->has_sps_pps && !is_vps_sps_pps_appended) {
+            if (!codec->videoParameterSetNALUnit.empty()) {
+                srs_avc_insert_aud(video->payload, aud_inserted);
+                video->payload->append(&codec->videoParameterSetNALUnit[0], (int)codec->videoParameterSetNALUnit.size());
+            }
+            if (!codec->sequenceParameterSetNALUnit.empty()) {
+                srs_avc_insert_aud(video->payload, aud_inserted);
+                video->payload->append(&codec->sequenceParameterSetNALUnit[0], (int)codec->sequenceParameterSetNALUnit.size());
+            }
+            if (!codec->pictureParameterSetNALUnit.empty()) {
+                srs_avc_insert_aud(video->payload, aud_inserted);
+                video->payload->append(&codec->pictureParameterSetNALUnit[0], (int)codec->pictureParameterSetNALUnit.size());
+            }
+            is_vps_sps_pps_appended = true;
+        }
+        
+        // Insert the NALU to video in annexb.
+        srs_avc_insert_aud(video->payload, aud_inserted);
+        video->payload->append(sample->bytes, sample->size);
+    }
+    
+    return err;
+}
+
 SrsTsTransmuxer::SrsTsTransmuxer()
 {
     writer = NULL;
@@ -3108,9 +3423,11 @@ srs_error_t SrsTsTransmuxer::write_video(int64_t timestamp, char* data, int size
         return err;
     }
     
-    if (format->vcodec->id != SrsVideoCodecIdAVC) {
+    if (format->vcodec->id != SrsVideoCodecIdAVC && format->vcodec->id != SrsVideoCodecIdHEVC) {
         return err;
     }
+    // Follow the video codec of stream, the PMT is rewritten when codec changed.
+    tscw->set_video_codec(format->vcodec->id);
     
     // ignore sequence header
     if (format->video->frame_type == SrsVideoAvcFrameTypeKeyFrame && format->video->avc_packet_type == SrsVideoAvcFrameTraitSequenceHeader) {
@@ -32,6 +32,9 @@ class SrsTsContext;
 // Transport Stream packets are 188 bytes in length.
 #define SRS_TS_PACKET_SIZE          188
 
+// The size of cache to encode TS packets, flush to writer when full, about 64KB.
+#define SRS_TS_PACKETS_CACHE (352 * SRS_TS_PACKET_SIZE)
+
 // The aggregate pure audio for hls, in ts tbn(ms * 90).
 #define SRS_CONSTS_HLS_PURE_AUDIO_AGGREGATE 720 * 90
 
@@ -130,6 +133,7 @@ enum SrsTsStream
     // ITU-T Rec. H.222.0 | ISO/IEC 13818-1 Reserved
     // 0x15-0x7F
     SrsTsStreamVideoH264 = 0x1b,
+    SrsTsStreamVideoHEVC = 0x24,
     // User Private
     // 0x80-0xFF
     SrsTsStreamAudioAC3 = 0x81,
@@ -143,8 +147,13 @@ struct SrsTsChannel
     int pid;
     SrsTsPidApply apply;
     SrsTsStream stream;
+    // The program_number of PMT, which the elementary stream belongs to.
+    int program;
     SrsTsMessage* msg;
     SrsTsContext* context;
+    // for decoder, the size of last message, to pre-size the payload of next message,
+    // because the PES_packet_length of video is generally 0.
+    int nn_last_msg;
     // for encoder.
     uint8_t continuity_counter;
     
@@ -299,11 +308,16 @@ private:
     std::map<int, SrsTsChannel*> pids;
     bool pure_audio;
     int8_t sync_byte;
+    // decoder, the packet to parse ts packets in place, reused for each ts packet.
+    SrsTsPacket* packet;
     // encoder
 private:
     // when any codec changed, write the PAT/PMT.
     SrsVideoCodecId vcodec;
     SrsAudioCodecId acodec;
+    // The cache to encode TS packets of PES, to avoid allocating packet and writing
+    // for each 188 bytes, see SRS_TS_PACKETS_CACHE.
+    char* packets;
 public:
     SrsTsContext();
     virtual ~SrsTsContext();
@@ -321,12 +335,15 @@ public:
     // @return the apply channel; NULL for invalid.
     virtual SrsTsChannel* get(int pid);
     // Set the pid apply, the parsed pid.
-    virtual void set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream = SrsTsStreamReserved);
+    // @param program The program_number of PMT, for elementary stream.
+    virtual void set(int pid, SrsTsPidApply apply_pid, SrsTsStream stream = SrsTsStreamReserved, int program = 0);
     // decode methods
 public:
-    // The stream contains only one ts packet.
+    // The stream contains only one ts packet, which is parsed in place, and the PES payload
+    // is assembled to a pre-sized buffer of message.
     // @param handler the ts message handler to process the msg.
     // @remark we will consume all bytes in stream.
+    // @remark All ingesters, the UDP caster, the HLS ingester and the SRT bridge, use this demuxer.
     virtual srs_error_t decode(SrsBuffer* stream, ISrsTsHandler* handler);
     // encode methods
 public:
@@ -342,7 +359,12 @@ public:
     virtual void set_sync_byte(int8_t sb);
 private:
     virtual srs_error_t encode_pat_pmt(ISrsStreamWriter* writer, int16_t vpid, SrsTsStream vs, int16_t apid, SrsTsStream as);
+    // Encode the PES to TS packets in cache directly, without any packet object, and
+    // write to writer in big chunk.
     virtual srs_error_t encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio);
+    // Encode the PES by SrsTsPacket for each TS packet, which is the reference encoder
+    // for utest to verify and benchmark the encode_pes.
+    virtual srs_error_t encode_pes_packets(ISrsStreamWriter* writer, SrsTsMessage* msg, int16_t pid, SrsTsStream sid, bool pure_audio);
 };
 
 // The packet in ts stream,
@@ -1259,9 +1281,12 @@ public:
 public:
     // get the video codec of ts muxer.
     virtual SrsVideoCodecId video_codec();
+    // Update the video codec, for example, the stream switch from h.264 to h.265.
+    virtual void set_video_codec(SrsVideoCodecId v);
 };
 
-// Used for HLS Encryption
+// Used for HLS Encryption, AES-128 CBC with PKCS7 padding by OpenSSL EVP.
+// @remark The cipher context is reset by config_cipher for each segment, to rotate the key and iv.
 class SrsEncFileWriter: public SrsFileWriter
 {
 public:
@@ -1269,15 +1294,27 @@ public:
     virtual ~SrsEncFileWriter();
 public:
     virtual srs_error_t write(void* data, size_t count, ssize_t* pnwrite);
+    // Encrypt all iovs as a batch, and write the cipher text to file once.
+    virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
     virtual void close();
 public:
     srs_error_t config_cipher(unsigned char* key, unsigned char* iv);
 private:
-    unsigned char* key;
-    unsigned char iv[16];
+    // Grow the cipher buffer, to encrypt size bytes of plain text.
+    void reserve(int size);
+    // Encrypt the plain text, append the cipher text to buffer.
+    srs_error_t encrypt(const void* data, int size);
+    // Write the cipher text in buffer to file.
+    srs_error_t flush_cipher();
+private:
+    // The EVP_CIPHER_CTX of current segment.
+    void* ctx;
+    bool configured;
 private:
+    // The cipher text buffer, reused by all writes.
     char* buf;
     int nb_buf;
+    int capacity;
 };
 
 // TS messages cache, to group frames to TS message,
@@ -1300,6 +1337,7 @@ private:
     virtual srs_error_t do_cache_mp3(SrsAudioFrame* frame);
     virtual srs_error_t do_cache_aac(SrsAudioFrame* frame);
     virtual srs_error_t do_cache_avc(SrsVideoFrame* frame);
+    virtual srs_error_t do_cache_hevc(SrsVideoFrame* frame);
 };
 
 // Transmux the RTMP stream to HTTP-TS stream.
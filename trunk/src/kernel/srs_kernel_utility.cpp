@@ -23,6 +23,10 @@
 #include <algorithm>
 using namespace std;
 
+#ifdef SRS_AVC_ANNEXB_SIMD
+#include <immintrin.h>
+#endif
+
 #include <srs_core_autofree.hpp>
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
@@ -719,6 +723,118 @@ bool srs_avc_startswith_annexb(SrsBuffer* stream, int* pnb_start_code)
     return false;
 }
 
+char* srs_avc_find_annexb_scalar(char* p, char* end)
+{
+    uint8_t* q = (uint8_t*)p;
+    uint8_t* last = (uint8_t*)end;
+    
+    // Skip 3 bytes when q[2] is neither 00 nor 01, because none of q, q+1, q+2 could be a start code.
+    while (q + 2 < last) {
+        if (q[2] > 1) {
+            q += 3;
+        } else if (q[2] == 0) {
+            q++;
+        } else if (q[0] == 0 && q[1] == 0) {
+            return (char*)q;
+        } else {
+            q += 3;
+        }
+    }
+    
+    return end;
+}
+
+#ifdef SRS_AVC_ANNEXB_SIMD
+char* srs_avc_find_annexb_sse2(char* p, char* end)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    
+    // Match 00 00 01 at each of 16 positions, by loading three overlapped vectors.
+    while (end - p >= 18) {
+        __m128i b0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), zero);
+        __m128i b1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 1)), zero);
+        __m128i b2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 2)), one);
+        
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_and_si128(b0, b1), b2));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+    
+    return srs_avc_find_annexb_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+char* srs_avc_find_annexb_avx2(char* p, char* end)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    
+    while (end - p >= 34) {
+        __m256i b0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), zero);
+        __m256i b1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 1)), zero);
+        __m256i b2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 2)), one);
+        
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_and_si256(b0, b1), b2));
+        if (mask) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+    
+    return srs_avc_find_annexb_sse2(p, end);
+}
+
+bool srs_cpu_supports_avx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+typedef char* (*srs_avc_find_annexb_t)(char* p, char* end);
+
+static srs_avc_find_annexb_t srs_avc_find_annexb_select()
+{
+#ifdef SRS_AVC_ANNEXB_SIMD
+    if (srs_cpu_supports_avx2()) {
+        return srs_avc_find_annexb_avx2;
+    }
+    return srs_avc_find_annexb_sse2;
+#else
+    return srs_avc_find_annexb_scalar;
+#endif
+}
+
+// The implementation to find annexb start code, selected by CPU at the first time.
+static srs_avc_find_annexb_t _srs_avc_find_annexb = NULL;
+
+char* srs_avc_find_annexb(char* p, char* end, int* pnb_start_code)
+{
+    if (!_srs_avc_find_annexb) {
+        _srs_avc_find_annexb = srs_avc_find_annexb_select();
+    }
+    
+    char* q = _srs_avc_find_annexb(p, end);
+    if (q == end) {
+        return end;
+    }
+    
+    // Include the leading zeros, for start code "N[00] 00 00 01".
+    char* start = q;
+    while (start > p && start[-1] == 0x00) {
+        start--;
+    }
+    
+    if (pnb_start_code) {
+        *pnb_start_code = (int)(q - start) + 3;
+    }
+    
+    return start;
+}
+
 bool srs_aac_startswith_adts(SrsBuffer* stream)
 {
     if (!stream) {
@@ -112,6 +112,28 @@ extern std::string srs_path_filext(std::string path);
 // @param pnb_start_code output the size of start code, must >=3. NULL to ignore.
 extern bool srs_avc_startswith_annexb(SrsBuffer* stream, int* pnb_start_code = NULL);
 
+// Find the next avc NALU start code "N[00] 00 00 01" in bytes [p, end), in bulk by SSE2 or AVX2,
+// which is selected at runtime by CPU, or scalar for other CPUs.
+// @param pnb_start_code output the size of start code, must >=3. NULL to ignore.
+// @return The position of start code including the leading zeros, or end if not found.
+// @remark Never copy the bytes, so the NALU is the slice between two start codes.
+extern char* srs_avc_find_annexb(char* p, char* end, int* pnb_start_code = NULL);
+
+// The SIMD to find annexb start code, for x86_64 with compiler supports the target attribute.
+#if defined(__x86_64__) && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+    #define SRS_AVC_ANNEXB_SIMD
+#endif
+
+// The implementations to find the "00 00 01" in [p, end), return the position or end if not found.
+// @remark Use srs_avc_find_annexb instead, these are exported for utest and benchmark.
+extern char* srs_avc_find_annexb_scalar(char* p, char* end);
+#ifdef SRS_AVC_ANNEXB_SIMD
+extern char* srs_avc_find_annexb_sse2(char* p, char* end);
+extern char* srs_avc_find_annexb_avx2(char* p, char* end);
+// Whether CPU supports AVX2.
+extern bool srs_cpu_supports_avx2();
+#endif
+
 // Whether stream starts with the aac ADTS from ISO_IEC_14496-3-AAC-2001.pdf, page 75, 1.A.2.2 ADTS.
 // The start code must be '1111 1111 1111'B, that is 0xFFF
 extern bool srs_aac_startswith_adts(SrsBuffer* stream);
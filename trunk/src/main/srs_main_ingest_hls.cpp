@@ -271,11 +271,10 @@ int SrsIngestHlsInput::parseTs(ISrsTsHandler* handler, char* body, int nb_body)
     int nb_packet = (int)nb_body / SRS_TS_PACKET_SIZE;
     for (int i = 0; i < nb_packet; i++) {
         char* p = (char*)body + (i * SRS_TS_PACKET_SIZE);
-        SrsBuffer* stream = new SrsBuffer(p, SRS_TS_PACKET_SIZE);
-        SrsAutoFree(SrsBuffer, stream);
+        SrsBuffer stream(p, SRS_TS_PACKET_SIZE);
         
         // process each ts packet
-        if ((err = context->decode(stream, handler)) != srs_success) {
+        if ((err = context->decode(&stream, handler)) != srs_success) {
             // TODO: FIXME: Use error
             ret = srs_error_code(err);
             srs_freep(err);
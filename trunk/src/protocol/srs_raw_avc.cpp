@@ -41,13 +41,9 @@ srs_error_t SrsRawH264Stream::annexb_demux(SrsBuffer* stream, char** pframe, int
         int start = stream->pos() + pnb_start_code;
         
         // find the last frame prefixed by annexb format.
-        stream->skip(pnb_start_code);
-        while (!stream->empty()) {
-            if (srs_avc_startswith_annexb(stream, NULL)) {
-                break;
-            }
-            stream->skip(1);
-        }
+        char* end = stream->data() + stream->size();
+        char* next = srs_avc_find_annexb(stream->data() + start, end);
+        stream->skip((int)(next - stream->data()) - stream->pos());
         
         // demux the frame.
         *pnb_frame = stream->pos() - start;
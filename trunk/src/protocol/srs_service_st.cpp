@@ -10,6 +10,9 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <poll.h>
+#include <errno.h>
+#include <unistd.h>
 using namespace std;
 
 #include <srs_core_autofree.hpp>
@@ -414,11 +417,84 @@ int srs_sendmsg(srs_netfd_t stfd, const struct msghdr *msg, int flags, srs_utime
     return st_sendmsg((st_netfd_t)stfd, msg, flags, (st_utime_t)timeout);
 }
 
+#ifdef __linux__
+int srs_recvmmsg(srs_netfd_t stfd, struct mmsghdr *msgvec, unsigned int vlen, int flags, srs_utime_t timeout)
+{
+    int osfd = st_netfd_fileno((st_netfd_t)stfd);
+    
+    while (true) {
+        int r0 = ::recvmmsg(osfd, msgvec, vlen, flags | MSG_DONTWAIT, NULL);
+        if (r0 >= 0) {
+            return r0;
+        }
+        
+        if (errno == EINTR) {
+            continue;
+        }
+        
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return -1;
+        }
+        
+        // Wait in ST util the fd is readable.
+        if (st_netfd_poll((st_netfd_t)stfd, POLLIN, (st_utime_t)timeout) < 0) {
+            return -1;
+        }
+    }
+}
+#endif
+
 srs_netfd_t srs_accept(srs_netfd_t stfd, struct sockaddr *addr, int *addrlen, srs_utime_t timeout)
 {
     return (srs_netfd_t)st_accept((st_netfd_t)stfd, addr, addrlen, (st_utime_t)timeout);
 }
 
+int srs_accept_batch(srs_netfd_t stfd, srs_netfd_t* fds, int nn_fds, srs_utime_t timeout)
+{
+    int osfd = st_netfd_fileno((st_netfd_t)stfd);
+    int nn = 0;
+    
+    while (nn < nn_fds) {
+#ifdef __linux__
+        int fd = ::accept4(osfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+        int fd = ::accept(osfd, NULL, NULL);
+        if (fd >= 0) {
+            fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+        }
+#endif
+        if (fd >= 0) {
+            st_netfd_t cfd = st_netfd_open_socket(fd);
+            if (!cfd) {
+                ::close(fd);
+                return nn ? nn : -1;
+            }
+            fds[nn++] = (srs_netfd_t)cfd;
+            continue;
+        }
+        
+        if (errno == EINTR) {
+            continue;
+        }
+        
+        // Return the accepted clients, and the error will be got in next time.
+        if (nn > 0) {
+            return nn;
+        }
+        
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return -1;
+        }
+        
+        // Wait in ST util there is any client.
+        if (st_netfd_poll((st_netfd_t)stfd, POLLIN, (st_utime_t)timeout) < 0) {
+            return -1;
+        }
+    }
+    
+    return nn;
+}
+
 ssize_t srs_read(srs_netfd_t stfd, void *buf, size_t nbyte, srs_utime_t timeout)
 {
     return st_read((st_netfd_t)stfd, buf, nbyte, (st_utime_t)timeout);
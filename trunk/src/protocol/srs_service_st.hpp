@@ -77,8 +77,17 @@ extern int srs_recvfrom(srs_netfd_t stfd, void *buf, int len, struct sockaddr *f
 extern int srs_sendto(srs_netfd_t stfd, void *buf, int len, const struct sockaddr *to, int tolen, srs_utime_t timeout);
 extern int srs_recvmsg(srs_netfd_t stfd, struct msghdr *msg, int flags, srs_utime_t timeout);
 extern int srs_sendmsg(srs_netfd_t stfd, const struct msghdr *msg, int flags, srs_utime_t timeout);
+#ifdef __linux__
+// Receive a batch of messages by recvmmsg, wait in ST util readable or timeout.
+// @return The number of messages received, or -1 with errno for error.
+extern int srs_recvmmsg(srs_netfd_t stfd, struct mmsghdr *msgvec, unsigned int vlen, int flags, srs_utime_t timeout);
+#endif
 
 extern srs_netfd_t srs_accept(srs_netfd_t stfd, struct sockaddr *addr, int *addrlen, srs_utime_t timeout);
+// Accept a batch of clients util the backlog is empty, wait in ST util there is any client or timeout.
+// The accepted fds are always nonblocking and close-on-exec, by accept4 on linux.
+// @return The number of clients accepted, or -1 with errno for error.
+extern int srs_accept_batch(srs_netfd_t stfd, srs_netfd_t* fds, int nn_fds, srs_utime_t timeout);
 
 extern ssize_t srs_read(srs_netfd_t stfd, void *buf, size_t nbyte, srs_utime_t timeout);
 
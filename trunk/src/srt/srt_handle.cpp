@@ -204,7 +204,7 @@ void srt_handle::handle_push_data(SRT_SOCKSTATUS status, const std::string& subp
 
     srt_conn_ptr->update_timestamp(srt_now_ms);
 
-    srt2rtmp::get_instance()->insert_data_message(data, ret, subpath);
+    srt2rtmp::get_instance()->on_ts_data(data, ret, subpath);
     
     //send data to subscriber(players)
     //streamid, play map<SRTSOCKET, SRT_CONN_PTR>
@@ -288,7 +288,7 @@ void srt_handle::close_push_conn(SRTSOCKET srtsocket) {
             _push_conn_map.erase(push_iter);
         }
         _conn_map.erase(iter);
-        srt2rtmp::get_instance()->insert_ctrl_message(SRT_MSG_CLOSE_TYPE, conn_ptr->get_subpath());
+        srt2rtmp::get_instance()->on_close(conn_ptr->get_subpath());
         conn_ptr->close();
     }
 
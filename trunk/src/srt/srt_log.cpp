@@ -1,5 +1,5 @@
 #include "srt_log.hpp"
-#include "srt_to_rtmp.hpp"
+#include <srs_kernel_log.hpp>
 #include <string>
 #include <stdint.h>
 #include <stdarg.h>
@@ -30,7 +30,32 @@ char* get_srt_log_buffer() {
 }
 
 void srt_log_output(LOGGER_LEVEL level, const char* buffer) {
-    std::string log_content(buffer);
-    srt2rtmp::get_instance()->insert_log_message(level, log_content);
+    // The SRT server runs in ST coroutine, so write to SRS log directly.
+    switch (level) {
+        case SRT_LOGGER_INFO_LEVEL:
+        {
+            srs_info("%s", buffer);
+            break;
+        }
+        case SRT_LOGGER_TRACE_LEVEL:
+        {
+            srs_trace("%s", buffer);
+            break;
+        }
+        case SRT_LOGGER_WARN_LEVEL:
+        {
+            srs_warn("%s", buffer);
+            break;
+        }
+        case SRT_LOGGER_ERROR_LEVEL:
+        {
+            srs_error("%s", buffer);
+            break;
+        }
+        default:
+        {
+            srs_trace("%s", buffer);
+        }
+    }
     return;
 }
@@ -8,13 +8,13 @@
 #include "srt_handle.hpp"
 #include "srt_log.hpp"
 #include <srt/udt.h>
-#include <thread>
 #include <netdb.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 #include <stdexcept>
 
 #include <srs_kernel_log.hpp>
@@ -23,14 +23,40 @@
 #include <srs_app_config.hpp>
 #include <srs_app_utility.hpp>
 
+// The timeout of waiter thread to block on SRT epoll, in ms, to check whether quit.
+#define SRT_EPOLL_WAIT_TIMEOUT 1000
+// The timeout of coroutine to wait for events, to check the alive of connections.
+#define SRT_EPOLL_CHECK_TIMEOUT (1 * SRS_UTIME_SECONDS)
+
 srt_server::srt_server(unsigned short port):_listen_port(port)
     ,_server_socket(-1)
+    ,trd_(NULL)
+    ,waiter_(NULL)
+    ,notify_fd_(NULL)
+    ,quit_(false)
 {
+    notify_pipe_[0] = notify_pipe_[1] = -1;
+    ack_pipe_[0] = ack_pipe_[1] = -1;
 }
 
 srt_server::~srt_server()
 {
+    stop();
+    srs_freep(trd_);
 
+    // The read end of notify pipe is closed with the ST fd.
+    if (notify_fd_) {
+        srs_close_stfd(notify_fd_);
+        notify_pipe_[0] = -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (notify_pipe_[i] >= 0) {
+            ::close(notify_pipe_[i]);
+        }
+        if (ack_pipe_[i] >= 0) {
+            ::close(ack_pipe_[i]);
+        }
+    }
 }
 
 int srt_server::init_srt_parameter() {
@@ -174,19 +200,54 @@ int srt_server::start()
         return ret;
     }
 
-    run_flag = true;
     srt_log_trace("srt server is starting... port(%d)", _listen_port);
-    thread_run_ptr = std::make_shared<std::thread>(&srt_server::on_work, this);
+
+    if (::pipe(notify_pipe_) < 0 || ::pipe(ack_pipe_) < 0) {
+        srt_log_error("srt server create pipe error, errno=%d", errno);
+        return -1;
+    }
+    if ((notify_fd_ = srs_netfd_open(notify_pipe_[0])) == NULL) {
+        srt_log_error("srt server open notify fd error");
+        return -1;
+    }
+
+    quit_ = false;
+    waiter_ = new std::thread(&srt_server::wait_events, this);
+
+    srs_freep(trd_);
+    trd_ = new SrsSTCoroutine("srt", this);
+
+    srs_error_t err = srs_success;
+    if ((err = trd_->start()) != srs_success) {
+        srt_log_error("srt server start coroutine error, %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+        return -1;
+    }
     return 0;
 }
 
 void srt_server::stop()
 {
-    run_flag = false;
-    if (!thread_run_ptr) {
+    if (!trd_) {
         return;
     }
-    thread_run_ptr->join();
+    trd_->stop();
+
+    // Wakeup the waiter thread if it's waiting for ack, then wait for it to quit.
+    if (waiter_) {
+        quit_ = true;
+        if (::write(ack_pipe_[1], "q", 1) != 1) {
+            srt_log_warn("srt server wakeup waiter error, errno=%d", errno);
+        }
+        waiter_->join();
+        srs_freep(waiter_);
+    }
+
+    // New API at 2020-01-28, >1.4.1
+    // @see https://github.com/Haivision/srt/commit/b8c70ec801a56bea151ecce9c09c4ebb720c2f68#diff-fb66028e8746fea578788532533a296bR786
+#if (SRT_VERSION_MAJOR<<24 | SRT_VERSION_MINOR<<16 | SRT_VERSION_PATCH<<8) > 0x01040100
+    srt_epoll_clear_usocks(_pollid);
+#endif
 
     return;
 }
@@ -262,48 +323,93 @@ void srt_server::srt_handle_data(SRT_SOCKSTATUS status, SRTSOCKET input_fd, cons
     return;
 }
 
-void srt_server::on_work()
+srs_error_t srt_server::cycle()
 {
-    const unsigned int SRT_FD_MAX = 100;
+    srs_error_t err = srs_success;
+
     srt_log_trace("srt server is working port(%d)", _listen_port);
-    while (run_flag)
-    {
-        SRTSOCKET read_fds[SRT_FD_MAX];
-        SRTSOCKET write_fds[SRT_FD_MAX];
+    while (true) {
+        if ((err = trd_->pull()) != srs_success) {
+            return srs_error_wrap(err, "srt server");
+        }
+
+        // Wait for the events notified by waiter thread, or timeout to check the alive.
+        char c = 0;
+        if (srs_read(notify_fd_, &c, 1, SRT_EPOLL_CHECK_TIMEOUT) == 1) {
+            on_work();
+
+            // Handled the events, the waiter thread is able to poll again.
+            if (::write(ack_pipe_[1], &c, 1) != 1) {
+                return srs_error_new(ERROR_SOCKET_WRITE, "srt ack");
+            }
+        }
+
+        _handle_ptr->check_alive();
+        srt2rtmp::get_instance()->check_rtmp_alive();
+    }
+
+    return err;
+}
+
+void srt_server::wait_events()
+{
+    const unsigned int SRT_FD_MAX = 100;
+    SRTSOCKET read_fds[SRT_FD_MAX];
+    SRTSOCKET write_fds[SRT_FD_MAX];
+
+    while (!quit_) {
         int rfd_num = SRT_FD_MAX;
         int wfd_num = SRT_FD_MAX;
 
-        int ret = srt_epoll_wait(_pollid, read_fds, &rfd_num, write_fds, &wfd_num, -1,
+        // Block on the SRT epoll, the events are level triggered, so the coroutine gets them again.
+        int ret = srt_epoll_wait(_pollid, read_fds, &rfd_num, write_fds, &wfd_num, SRT_EPOLL_WAIT_TIMEOUT,
                         nullptr, nullptr, nullptr, nullptr);
-        if (ret < 0) {
+        if (ret <= 0 || quit_) {
             continue;
         }
-        _handle_ptr->check_alive();
 
-        for (int index = 0; index < rfd_num; index++) {
-            SRT_SOCKSTATUS status = srt_getsockstate(read_fds[index]);
-            if (_server_socket == read_fds[index]) {
-                srt_handle_connection(status, read_fds[index], "read fd");
-            } else {
-                srt_handle_data(status, read_fds[index], "read fd");
-            }
+        // Notify the coroutine, and wait for it to handle the events.
+        char c = 'e';
+        if (::write(notify_pipe_[1], &c, 1) != 1 || ::read(ack_pipe_[0], &c, 1) != 1) {
+            break;
         }
-        
-        for (int index = 0; index < wfd_num; index++) {
-            SRT_SOCKSTATUS status = srt_getsockstate(write_fds[index]);
-            if (_server_socket == write_fds[index]) {
-                srt_handle_connection(status, write_fds[index], "write fd");
-            } else {
-                srt_handle_data(status, write_fds[index], "write fd");
-            }
+    }
+}
+
+int srt_server::on_work()
+{
+    const unsigned int SRT_FD_MAX = 100;
+    SRTSOCKET read_fds[SRT_FD_MAX];
+    SRTSOCKET write_fds[SRT_FD_MAX];
+    int rfd_num = SRT_FD_MAX;
+    int wfd_num = SRT_FD_MAX;
+
+    // Never block the ST thread, the waiter thread has already waited for the events.
+    int ret = srt_epoll_wait(_pollid, read_fds, &rfd_num, write_fds, &wfd_num, 0,
+                    nullptr, nullptr, nullptr, nullptr);
+    if (ret < 0) {
+        return 0;
+    }
+
+    for (int index = 0; index < rfd_num; index++) {
+        SRT_SOCKSTATUS status = srt_getsockstate(read_fds[index]);
+        if (_server_socket == read_fds[index]) {
+            srt_handle_connection(status, read_fds[index], "read fd");
+        } else {
+            srt_handle_data(status, read_fds[index], "read fd");
+        }
+    }
+    
+    for (int index = 0; index < wfd_num; index++) {
+        SRT_SOCKSTATUS status = srt_getsockstate(write_fds[index]);
+        if (_server_socket == write_fds[index]) {
+            srt_handle_connection(status, write_fds[index], "write fd");
+        } else {
+            srt_handle_data(status, write_fds[index], "write fd");
         }
     }
 
-    // New API at 2020-01-28, >1.4.1
-    // @see https://github.com/Haivision/srt/commit/b8c70ec801a56bea151ecce9c09c4ebb720c2f68#diff-fb66028e8746fea578788532533a296bR786
-#if (SRT_VERSION_MAJOR<<24 | SRT_VERSION_MINOR<<16 | SRT_VERSION_PATCH<<8) > 0x01040100
-    srt_epoll_clear_usocks(_pollid);
-#endif
+    return rfd_num + wfd_num;
 }
 
 SrtServerAdapter::SrtServerAdapter()
@@ -333,10 +439,6 @@ srs_error_t SrtServerAdapter::run()
         srt_log_trace("srt server is enabled...");
         unsigned short srt_port = _srs_config->get_srt_listen_port();
         srt_log_trace("srt server listen port:%d", srt_port);
-        err = srt2rtmp::get_instance()->init();
-        if (err != srs_success) {
-            return srs_error_wrap(err, "srt start srt2rtmp error");
-        }
 
         srt_ptr = std::make_shared<srt_server>(srt_port);
         if (!srt_ptr) {
@@ -356,4 +458,7 @@ srs_error_t SrtServerAdapter::run()
 void SrtServerAdapter::stop()
 {
     // TODO: FIXME: If forked processes, we should do cleanup.
+    if (srt_ptr) {
+        srt_ptr->stop();
+    }
 }
@@ -11,20 +11,24 @@
 
 #include <srt/srt.h>
 
-#include <thread>
 #include <memory>
+#include <thread>
 
 #include <srs_app_hybrid.hpp>
+#include <srs_app_st.hpp>
 
 class srt_handle;
 
-class srt_server {
+// The SRT server, which runs in a ST coroutine, so the SRT data is delivered to live source in the
+// same thread, without lock or queue. Because the SRT epoll has no fd for ST to wait on, a waiter
+// thread blocks on the SRT epoll, and notifies the coroutine by a pipe when there are events.
+class srt_server : public ISrsCoroutineHandler {
 public:
     srt_server(unsigned short port);
     ~srt_server();
 
-    int start();//init srt handl and create srt main thread loop
-    void stop();//stop srt main thread loop
+    int start();//init srt handl and start srt coroutine loop
+    void stop();//stop srt coroutine loop
 
 private:
     //init srt socket and srt epoll
@@ -32,8 +36,12 @@ private:
     int init_srt_parameter();
     void init_srt_log();
     
-    //srt main epoll loop
-    void on_work();
+    //srt main epoll loop, the cycle of coroutine
+    virtual srs_error_t cycle();
+    //poll srt epoll without blocking, return the number of handled events
+    int on_work();
+    //the waiter thread, block on srt epoll and notify the coroutine
+    void wait_events();
     //accept new srt connection
     void srt_handle_connection(SRT_SOCKSTATUS status, SRTSOCKET input_fd, const std::string& dscr);
     //get srt data read/write
@@ -43,8 +51,14 @@ private:
     unsigned short _listen_port;
     SRTSOCKET _server_socket;
     int _pollid;
-    bool run_flag;
-    std::shared_ptr<std::thread> thread_run_ptr;
+    SrsCoroutine* trd_;
+    // The waiter thread writes to notify pipe when events, then reads the ack pipe, which is
+    // written by coroutine after handled the events, so only one of them polls the SRT epoll.
+    std::thread* waiter_;
+    int notify_pipe_[2];
+    int ack_pipe_[2];
+    srs_netfd_t notify_fd_;
+    volatile bool quit_;
     std::shared_ptr<srt_handle> _handle_ptr;
 };
 
@@ -11,9 +11,10 @@
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_buffer.hpp>
 #include <srs_kernel_utility.hpp>
-#include <srs_app_rtmp_conn.hpp>
 #include <srs_app_config.hpp>
+#include <srs_app_publisher.hpp>
 #include <srs_kernel_stream.hpp>
+#include <srs_rtmp_stack.hpp>
 #include <list>
 
 std::shared_ptr<srt2rtmp> srt2rtmp::s_srt2rtmp_ptr;
@@ -30,80 +31,25 @@ srt2rtmp::srt2rtmp():_lastcheck_ts(0) {
 }
 
 srt2rtmp::~srt2rtmp() {
-    release();
 }
 
-srs_error_t srt2rtmp::init() {
-    srs_error_t err = srs_success;
-
-    if (_trd_ptr.get() != nullptr) {
-        return srs_error_wrap(err, "don't start thread again");
-    }
-
-    _trd_ptr = std::make_shared<SrsSTCoroutine>("srt2rtmp", this);
-
-    if ((err = _trd_ptr->start()) != srs_success) {
-        return srs_error_wrap(err, "start thread");
-    }
-
-    srs_trace("srt2rtmp start coroutine...");
-
-    return err;
-}
-
-void srt2rtmp::release() {
-    if (!_trd_ptr) {
-        return;
+void srt2rtmp::on_ts_data(unsigned char* data_p, unsigned int len, const std::string& key_path) {
+    RTMP_CLIENT_PTR rtmp_ptr;
+    auto iter = _rtmp_client_map.find(key_path);
+    if (iter == _rtmp_client_map.end()) {
+        srs_trace("new rtmp client for srt upstream, key_path:%s", key_path.c_str());
+        rtmp_ptr = std::make_shared<rtmp_client>(key_path);
+        _rtmp_client_map.insert(std::make_pair(key_path, rtmp_ptr));
+    } else {
+        rtmp_ptr = iter->second;
     }
-    _trd_ptr->stop();
-    _trd_ptr = nullptr;
-}
-
-void srt2rtmp::insert_data_message(unsigned char* data_p, unsigned int len, const std::string& key_path) {
-    std::unique_lock<std::mutex> locker(_mutex);
-
-    SRT_DATA_MSG_PTR msg_ptr = std::make_shared<SRT_DATA_MSG>(data_p, len, key_path);
-    _msg_queue.push(msg_ptr);
-    //_notify_cond.notify_one();
-    return;
-}
-
-void srt2rtmp::insert_ctrl_message(unsigned int msg_type, const std::string& key_path) {
-    std::unique_lock<std::mutex> locker(_mutex);
 
-    SRT_DATA_MSG_PTR msg_ptr = std::make_shared<SRT_DATA_MSG>(key_path, msg_type);
-    _msg_queue.push(msg_ptr);
-    //_notify_cond.notify_one();
-    return;
-}
-
-void srt2rtmp::insert_log_message(LOGGER_LEVEL level, const std::string& log_content) {
-    std::unique_lock<std::mutex> locker(_mutex);
-
-    SRT_DATA_MSG_PTR msg_ptr = std::make_shared<SRT_DATA_MSG>(level, log_content);
-    msg_ptr->set_msg_type(SRT_MSG_LOG_TYPE);
-    _msg_queue.push(msg_ptr);
+    // Parse the data in place, in the same coroutine as SRT, without copy or queue.
+    rtmp_ptr->receive_ts_data((char*)data_p, (int)len);
 
     return;
 }
 
-SRT_DATA_MSG_PTR srt2rtmp::get_data_message() {
-    std::unique_lock<std::mutex> locker(_mutex);
-    SRT_DATA_MSG_PTR msg_ptr;
-
-    if (_msg_queue.empty())
-    {
-        return msg_ptr;
-    }
-    //while (_msg_queue.empty()) {
-    //    _notify_cond.wait(locker);
-    //}
-
-    msg_ptr = _msg_queue.front();
-    _msg_queue.pop();
-    return msg_ptr;
-}
-
 void srt2rtmp::check_rtmp_alive() {
     const int64_t CHECK_INTERVAL    = 5*1000;
     const int64_t ALIVE_TIMEOUT_MAX = 5*1000;
@@ -134,7 +80,7 @@ void srt2rtmp::check_rtmp_alive() {
     return;
 }
 
-void srt2rtmp::handle_close_rtmpsession(const std::string& key_path) {
+void srt2rtmp::on_close(const std::string& key_path) {
     RTMP_CLIENT_PTR rtmp_ptr;
     auto iter = _rtmp_client_map.find(key_path);
     if (iter == _rtmp_client_map.end()) {
@@ -150,99 +96,11 @@ void srt2rtmp::handle_close_rtmpsession(const std::string& key_path) {
     return;
 }
 
-//the cycle is running in srs coroutine
-srs_error_t srt2rtmp::cycle() {
-    srs_error_t err = srs_success;
-    _lastcheck_ts = 0;
-
-    while(true) {
-        SRT_DATA_MSG_PTR msg_ptr = get_data_message();
-
-        if (!msg_ptr) {
-            srs_usleep((30 * SRS_UTIME_MILLISECONDS));
-        } else {
-            switch (msg_ptr->msg_type()) {
-                case SRT_MSG_DATA_TYPE:
-                {
-                    handle_ts_data(msg_ptr);
-                    break;
-                }
-                case SRT_MSG_CLOSE_TYPE:
-                {
-                    handle_close_rtmpsession(msg_ptr->get_path());
-                    break;
-                }
-                case SRT_MSG_LOG_TYPE:
-                {
-                    handle_log_data(msg_ptr);
-                    break;
-                }
-                default:
-                {
-                    srs_error("srt to rtmp get wrong message type(%u), path:%s",
-                        msg_ptr->msg_type(), msg_ptr->get_path().c_str());
-                    assert(0);
-                }
-            }
-            
-        }
-        check_rtmp_alive();
-        if ((err = _trd_ptr->pull()) != srs_success) {
-            return srs_error_wrap(err, "forwarder");
-        }
-    }
-}
-
-void srt2rtmp::handle_ts_data(SRT_DATA_MSG_PTR data_ptr) {
-    RTMP_CLIENT_PTR rtmp_ptr;
-    auto iter = _rtmp_client_map.find(data_ptr->get_path());
-    if (iter == _rtmp_client_map.end()) {
-        srs_trace("new rtmp client for srt upstream, key_path:%s", data_ptr->get_path().c_str());
-        rtmp_ptr = std::make_shared<rtmp_client>(data_ptr->get_path());
-        _rtmp_client_map.insert(std::make_pair(data_ptr->get_path(), rtmp_ptr));
-    } else {
-        rtmp_ptr = iter->second;
-    }
-
-    rtmp_ptr->receive_ts_data(data_ptr);
-
-    return;
-}
-
-void srt2rtmp::handle_log_data(SRT_DATA_MSG_PTR data_ptr) {
-    switch (data_ptr->get_log_level()) {
-        case SRT_LOGGER_INFO_LEVEL:
-        {
-            srs_info(data_ptr->get_log_string());
-            break;
-        }
-        case SRT_LOGGER_TRACE_LEVEL:
-        {
-            srs_trace(data_ptr->get_log_string());
-            break;
-        }
-        case SRT_LOGGER_WARN_LEVEL:
-        {
-            srs_warn(data_ptr->get_log_string());
-            break;
-        }
-        case SRT_LOGGER_ERROR_LEVEL:
-        {
-            srs_error(data_ptr->get_log_string());
-            break;
-        }
-        default:
-        {
-            srs_trace(data_ptr->get_log_string());
-        }
-    }
-    return;
-}
-
 rtmp_client::rtmp_client(std::string key_path):_key_path(key_path)
     , _connect_flag(false) {
+    _publisher = new SrsLivePublisher();
     const std::string DEF_VHOST = "DEFAULT_VHOST";
-    _ts_demux_ptr = std::make_shared<ts_demux>();
+    _ts_context_ptr = std::make_shared<SrsTsContext>();
     _avc_ptr    = std::make_shared<SrsRawH264Stream>();
     _aac_ptr    = std::make_shared<SrsRawAacStream>();
     std::vector<std::string> ret_vec;
@@ -290,18 +148,15 @@ rtmp_client::rtmp_client(std::string key_path):_key_path(key_path)
 }
 
 rtmp_client::~rtmp_client() {
-
+    srs_freep(_publisher);
 }
 
 void rtmp_client::close() {
-    _connect_flag = false;
-    if (!_rtmp_conn_ptr) {
-        return;
+    if (_connect_flag) {
+        srs_trace("rtmp client close url:%s", _url.c_str());
     }
-    srs_trace("rtmp client close url:%s", _url.c_str());
-    _rtmp_conn_ptr->close();
-    _rtmp_conn_ptr = nullptr;
-    
+    _connect_flag = false;
+    _publisher->unpublish();
 }
 
 int64_t rtmp_client::get_last_live_ts() {
@@ -314,37 +169,35 @@ std::string rtmp_client::get_url() {
 
 srs_error_t rtmp_client::connect() {
     srs_error_t err = srs_success;
-    srs_utime_t cto = SRS_CONSTS_RTMP_TIMEOUT;
-    srs_utime_t sto = SRS_CONSTS_RTMP_PULSE;
 
     _last_live_ts = now_ms();
     if (_connect_flag) {
         return srs_success;
     }
 
-    if (_rtmp_conn_ptr.get() != nullptr) {
-        return srs_error_wrap(err, "repeated connect %s failed, cto=%dms, sto=%dms.", 
-                            _url.c_str(), srsu2msi(cto), srsu2msi(sto));
+    // Publish to live source directly, the SRT streamid is converted to a RTMP url.
+    if ((err = _publisher->publish(_url, "127.0.0.1")) != srs_success) {
+        return srs_error_wrap(err, "srt: publish %s", _url.c_str());
     }
 
-    _rtmp_conn_ptr = std::make_shared<SrsSimpleRtmpClient>(_url, cto, sto);
-
-    if ((err = _rtmp_conn_ptr->connect()) != srs_success) {
-        close();
-        return srs_error_wrap(err, "connect %s failed, cto=%dms, sto=%dms.", 
-                            _url.c_str(), srsu2msi(cto), srsu2msi(sto));
-    }
-    
-    if ((err = _rtmp_conn_ptr->publish(SRS_CONSTS_RTMP_PROTOCOL_CHUNK_SIZE)) != srs_success) {
-        close();
-        return srs_error_wrap(err, "rtmp client in srt2rtmp  publish fail url:%s", _url.c_str());
-    }
     _connect_flag = true;
     return err;
 }
 
-void rtmp_client::receive_ts_data(SRT_DATA_MSG_PTR data_ptr) {
-    _ts_demux_ptr->decode(data_ptr, shared_from_this());//on_data_callback is the decode callback
+void rtmp_client::receive_ts_data(char* data, int len) {
+    srs_error_t err = srs_success;
+
+    // The SRT payload is generally 7 ts packets, parse each ts packet in place.
+    int nb_packet = len / SRS_TS_PACKET_SIZE;
+    for (int i = 0; i < nb_packet; i++) {
+        SrsBuffer stream(data + (i * SRS_TS_PACKET_SIZE), SRS_TS_PACKET_SIZE);
+
+        // on_ts_message is the decode callback
+        if ((err = _ts_context_ptr->decode(&stream, this)) != srs_success) {
+            srs_warn("srt: parse ts packet err=%s", srs_error_desc(err).c_str());
+            srs_error_reset(err);
+        }
+    }
     return;
 }
 
@@ -450,25 +303,19 @@ srs_error_t rtmp_client::write_audio_raw_frame(char* frame, int frame_size, SrsR
 
 srs_error_t rtmp_client::rtmp_write_packet(char type, uint32_t timestamp, char* data, int size) {
     srs_error_t err = srs_success;
-    SrsSharedPtrMessage* msg = NULL;
 
-    if (!_rtmp_conn_ptr) {
-        //when rtmp connection is closed, it's not error and just return;
+    if (!_connect_flag) {
+        //when source is unpublished, it's not error and just return;
         srs_freepa(data);
         return err;
     }
 
-    if ((err = srs_rtmp_create_msg(type, timestamp, data, size, _rtmp_conn_ptr->sid(), &msg)) != srs_success) {
-        return srs_error_wrap(err, "create message fail, url:%s", _url.c_str());
-    }
-    srs_assert(msg);
-    
-    // send out encoded msg.
-    if ((err = _rtmp_conn_ptr->send_and_free_message(msg)) != srs_success) {
+    // The data is transferred to the live source without copy.
+    if ((err = _publisher->on_flv_tag(type, timestamp, data, size)) != srs_success) {
         close();
-        return srs_error_wrap(err, "rtmp client in srt2rtmp send message fail, url:%s", _url.c_str());
+        return srs_error_wrap(err, "srt publish message fail, url:%s", _url.c_str());
     }
-    
+
     return err;
 }
 
@@ -668,30 +515,32 @@ srs_error_t rtmp_client::on_ts_audio(std::shared_ptr<SrsBuffer> avs_ptr, uint64_
     return err;
 }
 
-void rtmp_client::on_data_callback(SRT_DATA_MSG_PTR data_ptr, unsigned int media_type,
-                                uint64_t dts, uint64_t pts)
+srs_error_t rtmp_client::on_ts_message(SrsTsMessage* msg)
 {
     srs_error_t err = srs_success;
-    if (!data_ptr || (data_ptr->get_data() == nullptr) || (data_ptr->data_len() == 0)) {
-        assert(0);
-        return;
+    if (!msg->channel || msg->payload->length() == 0) {
+        return err;
     }
 
-    auto avs_ptr = std::make_shared<SrsBuffer>((char*)data_ptr->get_data(), data_ptr->data_len());
+    // The payload is owned by msg, which is freed after this callback.
+    auto avs_ptr = std::make_shared<SrsBuffer>(msg->payload->bytes(), msg->payload->length());
+    uint64_t dts = (uint64_t)msg->dts;
+    uint64_t pts = (uint64_t)msg->pts;
 
-    if (media_type == STREAM_TYPE_VIDEO_H264) {
+    if (msg->channel->stream == SrsTsStreamVideoH264) {
         err = on_ts_video(avs_ptr, dts, pts);
-    } else if (media_type == STREAM_TYPE_AUDIO_AAC) {
+    } else if (msg->channel->stream == SrsTsStreamAudioAAC) {
         err = on_ts_audio(avs_ptr, dts, pts);
     } else {
-        srs_error("mpegts demux unkown stream type:0x%02x, only support h264+aac", media_type);
-        return;
+        srs_error("mpegts demux unkown stream type:0x%02x, only support h264+aac", msg->channel->stream);
+        return err;
     }
 
     if (err != srs_success) {
-        srs_error("send media data error:", srs_error_code(err));
+        srs_error("send media data error:%d", srs_error_code(err));
+        srs_freep(err);
     }
-    return;
+    return srs_success;
 }
 
 rtmp_packet_queue::rtmp_packet_queue():_queue_timeout(QUEUE_DEF_TIMEOUT)
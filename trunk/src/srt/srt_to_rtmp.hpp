@@ -11,25 +11,19 @@
 
 #include <memory>
 #include <string>
-#include <thread>
-#include <queue>
 #include <map>
-#include <mutex>
-#include <condition_variable>
 #include <srs_kernel_ts.hpp>
-#include <srs_app_rtmp_conn.hpp>
 #include <srs_raw_avc.hpp>
 #include <srs_protocol_utility.hpp>
 #include <unordered_map>
 
-#include "srt_data.hpp"
-#include "ts_demux.hpp"
 #include "srt_log.hpp"
 
+class SrsLivePublisher;
+
 #define SRT_VIDEO_MSG_TYPE 0x01
 #define SRT_AUDIO_MSG_TYPE 0x02
 
-typedef std::shared_ptr<SrsSimpleRtmpClient> RTMP_CONN_PTR;
 typedef std::shared_ptr<SrsRawH264Stream> AVC_PTR;
 typedef std::shared_ptr<SrsRawAacStream> AAC_PTR;
 
@@ -66,20 +60,27 @@ private:
     std::multimap<int64_t, rtmp_packet_info_s> _send_map;//key:dts, value:rtmp_packet_info
 };
 
-class rtmp_client : public ts_media_data_callback_I, public std::enable_shared_from_this<rtmp_client> {
+typedef std::shared_ptr<SrsTsContext> TS_CONTEXT_PTR;
+
+// The SRT publisher, which demux the TS over SRT and deliver the frames to the live source
+// directly, in the same ST thread, without RTMP over loopback.
+class rtmp_client : public ISrsTsHandler, public std::enable_shared_from_this<rtmp_client> {
 public:
     rtmp_client(std::string key_path);
     ~rtmp_client();
 
-    void receive_ts_data(SRT_DATA_MSG_PTR data_ptr);
+    void receive_ts_data(char* data, int len);
     int64_t get_last_live_ts();
     std::string get_url();
 
+    // Start publishing to the live source, ignore if already published.
     srs_error_t connect();
+    // Stop publishing the live source.
     void close();
 
 private:
-    virtual void on_data_callback(SRT_DATA_MSG_PTR data_ptr, unsigned int media_type, uint64_t dts, uint64_t pts);
+    // Interface ISrsTsHandler, the TS message is demuxed by the context shared with other ingesters.
+    virtual srs_error_t on_ts_message(SrsTsMessage* msg);
 
 private:
     srs_error_t on_ts_video(std::shared_ptr<SrsBuffer> avs_ptr, uint64_t dts, uint64_t pts);
@@ -93,6 +94,7 @@ private:
     srs_error_t rtmp_write_work();
 
 private:
+    // Deliver the FLV packet to live source, the data is freed by this function.
     virtual srs_error_t rtmp_write_packet(char type, uint32_t timestamp, char* data, int size);
 
 private:
@@ -101,7 +103,7 @@ private:
     std::string _vhost;
     std::string _appname;
     std::string _streamname;
-    TS_DEMUX_PTR _ts_demux_ptr;
+    TS_CONTEXT_PTR _ts_context_ptr;
 
 private:
     AVC_PTR _avc_ptr;
@@ -114,7 +116,7 @@ private:
     std::string _aac_specific_config;
     AAC_PTR _aac_ptr;
 private:
-    RTMP_CONN_PTR _rtmp_conn_ptr;
+    SrsLivePublisher* _publisher;
     bool _connect_flag;
     int64_t _last_live_ts;
 
@@ -124,33 +126,22 @@ private:
 
 typedef std::shared_ptr<rtmp_client> RTMP_CLIENT_PTR;
 
-class srt2rtmp : public ISrsCoroutineHandler {
+// The manager of SRT publishers, driven by the SRT server coroutine.
+class srt2rtmp {
 public:
     static std::shared_ptr<srt2rtmp> get_instance();
     srt2rtmp();
     virtual ~srt2rtmp();
 
-    srs_error_t init();
-    void release();
-
-    void insert_data_message(unsigned char* data_p, unsigned int len, const std::string& key_path);
-    void insert_ctrl_message(unsigned int msg_type, const std::string& key_path);
-    void insert_log_message(LOGGER_LEVEL level, const std::string& log_content);
-
-private:
-    SRT_DATA_MSG_PTR get_data_message();
-    virtual srs_error_t cycle();
-    void handle_ts_data(SRT_DATA_MSG_PTR data_ptr);
-    void handle_close_rtmpsession(const std::string& key_path);
-    void handle_log_data(SRT_DATA_MSG_PTR data_ptr);
+    // When got TS data from SRT publisher, which is generally 7 TS packets.
+    void on_ts_data(unsigned char* data_p, unsigned int len, const std::string& key_path);
+    // When SRT publisher is closed.
+    void on_close(const std::string& key_path);
+    // Close the publishers which has no data for a while.
     void check_rtmp_alive();
 
 private:
     static std::shared_ptr<srt2rtmp> s_srt2rtmp_ptr;
-    std::shared_ptr<SrsCoroutine> _trd_ptr;
-    std::mutex _mutex;
-    //std::condition_variable_any _notify_cond;
-    std::queue<SRT_DATA_MSG_PTR> _msg_queue;
 
     std::unordered_map<std::string, RTMP_CLIENT_PTR> _rtmp_client_map;
     int64_t _lastcheck_ts;
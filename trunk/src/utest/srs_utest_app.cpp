@@ -5,6 +5,9 @@
 //
 #include <srs_utest_app.hpp>
 
+#include <alloca.h>
+#include <st.h>
+
 using namespace std;
 
 #include <srs_kernel_error.hpp>
@@ -13,8 +16,31 @@ using namespace std;
 #include <srs_app_config.hpp>
 
 #include <srs_app_st.hpp>
+#include <srs_app_admission.hpp>
+#include <srs_app_threads.hpp>
 #include <srs_service_conn.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_app_source.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_app_shm.hpp>
+#include <srs_app_edge.hpp>
+#include <srs_kernel_balance.hpp>
+#include <srs_app_hls.hpp>
+#include <srs_app_dash.hpp>
+#include <srs_app_publisher.hpp>
+#include <srs_app_mpegts_udp.hpp>
+#include <srs_rtmp_stack.hpp>
+#include <srs_kernel_codec.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_utest_config.hpp>
+
+#include <unistd.h>
+#include <sys/time.h>
 
 class MockIDResource : public ISrsResource
 {
@@ -127,6 +153,86 @@ VOID TEST(AppResourceManagerTest, FindByFastID)
     }
 }
 
+VOID TEST(AppResourceManagerTest, RemoveByIndex)
+{
+    srs_error_t err = srs_success;
+
+    if (true) {
+        SrsResourceManager m("test");
+        HELPER_EXPECT_SUCCESS(m.start());
+
+        MockIDResource* r1 = new MockIDResource(1);
+        MockIDResource* r2 = new MockIDResource(2);
+        MockIDResource* r3 = new MockIDResource(3);
+        m.add_with_id("r1", r1);
+        m.add_with_name("r2", r2);
+        m.add_with_fast_id(103, r3);
+        m.add_with_name("r3", r3);
+        EXPECT_EQ(3, (int)m.size());
+
+        // The last resource is moved to the position of removed one.
+        m.remove(r1); srs_usleep(0);
+        EXPECT_EQ(2, (int)m.size());
+        EXPECT_TRUE(m.find_by_id("r1") == NULL);
+        EXPECT_EQ(3, ((MockIDResource*)m.at(0))->id);
+        EXPECT_EQ(2, ((MockIDResource*)m.at(1))->id);
+
+        m.remove(r3); srs_usleep(0);
+        EXPECT_EQ(1, (int)m.size());
+        EXPECT_TRUE(m.find_by_fast_id(103) == NULL);
+        EXPECT_TRUE(m.find_by_name("r3") == NULL);
+        EXPECT_EQ(2, ((MockIDResource*)m.find_by_name("r2"))->id);
+
+        m.remove(r2); srs_usleep(0);
+        EXPECT_TRUE(m.empty());
+    }
+
+    // The key is used by another resource, which should not be removed.
+    if (true) {
+        SrsResourceManager m("test");
+        HELPER_EXPECT_SUCCESS(m.start());
+
+        MockIDResource* r1 = new MockIDResource(1);
+        MockIDResource* r2 = new MockIDResource(2);
+        m.add_with_name("name", r1);
+        m.add_with_name("name", r2);
+        m.add_with_name("name", r2);
+        EXPECT_EQ(2, (int)m.size());
+
+        m.remove(r1); srs_usleep(0);
+        EXPECT_EQ(2, ((MockIDResource*)m.find_by_name("name"))->id);
+
+        // Remove twice is ignored.
+        m.remove(r2); m.remove(r2); srs_usleep(0);
+        EXPECT_TRUE(m.find_by_name("name") == NULL);
+        EXPECT_TRUE(m.empty());
+    }
+
+    // The removed resource is not alive, even it's not disposed.
+    if (true) {
+        SrsResourceManager m("test");
+        HELPER_EXPECT_SUCCESS(m.start());
+
+        MockIDResource* r1 = new MockIDResource(1);
+        MockIDResource* r2 = new MockIDResource(2);
+        m.add_with_id("r1", r1);
+        m.add_with_id("r2", r2);
+        EXPECT_EQ(2, (int)m.alive());
+
+        // Remove twice, before the manager disposes it.
+        m.remove(r1); m.remove(r1);
+        EXPECT_EQ(2, (int)m.size());
+        EXPECT_EQ(1, (int)m.alive());
+
+        srs_usleep(0);
+        EXPECT_EQ(1, (int)m.size());
+        EXPECT_EQ(1, (int)m.alive());
+
+        m.remove(r2); srs_usleep(0);
+        EXPECT_EQ(0, (int)m.alive());
+    }
+}
+
 VOID TEST(AppCoroutineTest, Dummy)
 {
     SrsDummyCoroutine dc;
@@ -404,6 +510,427 @@ VOID TEST(AppCoroutineTest, StartThread)
     srs_freep(err);
 }
 
+class MockStackHandler : public ISrsCoroutineHandler {
+public:
+    int usage;
+public:
+    MockStackHandler(int v) : usage(v) {
+    }
+    virtual ~MockStackHandler() {
+    }
+public:
+    virtual srs_error_t cycle() {
+        char* buf = (char*)alloca(usage);
+        memset(buf, 0xf, usage);
+        if (buf[0] != 0xf) {
+            return srs_error_new(-1, "stack");
+        }
+        return srs_success;
+    }
+};
+
+VOID TEST(AppCoroutineTest, StackWatermark)
+{
+    srs_error_t err;
+
+    SrsCoroutineStacks stacks;
+    stacks.set_stack_size("stack-test", 128 * 1024);
+    EXPECT_EQ(128 * 1024, stacks.stack_size("stack-test"));
+    EXPECT_EQ(0, stacks.stack_size("none"));
+    EXPECT_EQ(-1, stacks.watermark("stack-test"));
+
+    SrsCoroutineStacks* ov = _srs_stacks;
+    _srs_stacks = &stacks;
+    int ov_watermark = st_set_stack_watermark(1);
+    int ov_pool = st_set_stack_pool(1);
+
+    // The stack is zeroed, so the usage is the high water-level.
+    if (true) {
+        MockStackHandler h(16 * 1024);
+        SrsFastCoroutine trd("stack-test", &h);
+        HELPER_EXPECT_SUCCESS(trd.start());
+        trd.stop();
+    }
+    int watermark = stacks.watermark("stack-test");
+    EXPECT_GE(watermark, 16 * 1024);
+    EXPECT_LT(watermark, 128 * 1024);
+
+    // The stack is reused, and only the dirty portion is zeroed.
+    if (true) {
+        MockStackHandler h(32 * 1024);
+        SrsFastCoroutine trd("stack-test", &h);
+        HELPER_EXPECT_SUCCESS(trd.start());
+        trd.stop();
+    }
+    EXPECT_GE(stacks.watermark("stack-test"), 32 * 1024);
+    EXPECT_GT(stacks.watermark("stack-test"), watermark);
+
+    // Never decrease the high water-level.
+    stacks.on_stack_usage("stack-test", 0, 100);
+    EXPECT_GE(stacks.watermark("stack-test"), 32 * 1024);
+    stacks.on_stack_usage("stack-test", 0, -1);
+    EXPECT_GE(stacks.watermark("stack-test"), 32 * 1024);
+
+    st_set_stack_pool(ov_pool);
+    st_set_stack_watermark(ov_watermark);
+    _srs_stacks = ov;
+}
+
+// The active threads of ST, the utime function is only allowed to set when no thread.
+extern "C" int _st_active_count;
+
+// The mock clock of ST, which is the real clock plus the offset, so never steps back.
+st_utime_t mock_st_offset = 0;
+st_utime_t mock_st_utime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec + mock_st_offset;
+}
+
+// Turn the clock of ST to the time, then run the expired threads.
+void mock_st_turn_to(st_utime_t t)
+{
+    st_utime_t now = st_utime();
+    if (t > now) {
+        mock_st_offset += t - now;
+    }
+
+    // The idle thread checks the clock, and the expired threads run before us.
+    st_usleep(0);
+    st_usleep(0);
+}
+
+struct MockStSleeper
+{
+    st_utime_t timeout;
+    st_utime_t due;
+    bool done;
+    int r0;
+};
+
+void* mock_st_sleep(void* arg)
+{
+    MockStSleeper* s = (MockStSleeper*)arg;
+    s->due = st_utime_last_clock() + s->timeout;
+    s->r0 = st_usleep(s->timeout);
+    s->done = true;
+    return NULL;
+}
+
+VOID TEST(AppCoroutineTest, TimingWheel)
+{
+    static bool mocked = false;
+    if (!mocked) {
+        int count = _st_active_count;
+        _st_active_count = 0;
+        EXPECT_EQ(0, st_set_utime_function(mock_st_utime));
+        _st_active_count = count;
+        mocked = true;
+    }
+
+    // The timeout in ticks of 1ms, at the boundaries of level 0 of 256 slots, and levels of 64 slots.
+    int ticks[] = {255, 256, 16383, 16384, 1048575, 1048576, 255, 256, 16384, 1048576};
+    int nn_ticks = (int)(sizeof(ticks) / sizeof(int));
+    int nn_sleepers = 6;
+
+    MockStSleeper sleepers[sizeof(ticks) / sizeof(int)];
+    st_thread_t trds[sizeof(ticks) / sizeof(int)];
+
+    // Update the clock of ST, which the due of threads is based on.
+    st_usleep(0);
+    for (int i = 0; i < nn_ticks; i++) {
+        MockStSleeper* s = &sleepers[i];
+        s->timeout = ticks[i] * 1000;
+        s->due = 0;
+        s->done = false;
+        s->r0 = 0;
+        trds[i] = st_thread_create(mock_st_sleep, s, 1, 0);
+        ASSERT_TRUE(trds[i] != NULL);
+    }
+
+    // Insert all threads to wheel.
+    st_usleep(0);
+    for (int i = 0; i < nn_ticks; i++) {
+        EXPECT_FALSE(sleepers[i].done);
+        EXPECT_GT(sleepers[i].due, 0);
+    }
+
+    // Cancel the threads in each level, which never wakeup others.
+    for (int i = nn_sleepers; i < nn_ticks; i++) {
+        st_thread_interrupt(trds[i]);
+    }
+    st_usleep(0);
+    for (int i = 0; i < nn_ticks; i++) {
+        EXPECT_EQ(i >= nn_sleepers, sleepers[i].done);
+        EXPECT_EQ(i >= nn_sleepers ? -1 : 0, sleepers[i].r0);
+    }
+
+    // Each thread is expired exactly at due, after the higher levels cascade.
+    for (int i = 0; i < nn_sleepers; i++) {
+        MockStSleeper* s = &sleepers[i];
+
+        mock_st_turn_to(s->due - 1000);
+        EXPECT_FALSE(s->done) << "ticks=" << ticks[i];
+
+        mock_st_turn_to(s->due);
+        EXPECT_TRUE(s->done) << "ticks=" << ticks[i];
+        EXPECT_EQ(0, s->r0);
+
+        if (i + 1 < nn_sleepers) {
+            EXPECT_FALSE(sleepers[i + 1].done) << "ticks=" << ticks[i + 1];
+        }
+    }
+
+    for (int i = 0; i < nn_ticks; i++) {
+        st_thread_join(trds[i], NULL);
+    }
+}
+
+VOID TEST(AppAdmissionTest, TokenBucket)
+{
+    srs_utime_t now = 10 * SRS_UTIME_SECONDS;
+    SrsTokenBucket bucket(10, 2, now);
+    EXPECT_TRUE(bucket.full(now));
+
+    EXPECT_TRUE(bucket.consume(now));
+    EXPECT_TRUE(bucket.consume(now));
+    EXPECT_FALSE(bucket.consume(now));
+    EXPECT_FALSE(bucket.full(now));
+
+    // Refill a token in 100ms, for rate 10/s.
+    EXPECT_FALSE(bucket.consume(now + 50 * SRS_UTIME_MILLISECONDS));
+    EXPECT_TRUE(bucket.consume(now + 100 * SRS_UTIME_MILLISECONDS));
+    EXPECT_FALSE(bucket.consume(now + 100 * SRS_UTIME_MILLISECONDS));
+
+    // Never exceed the burst.
+    EXPECT_TRUE(bucket.full(now + 10 * SRS_UTIME_SECONDS));
+    EXPECT_TRUE(bucket.consume(now + 10 * SRS_UTIME_SECONDS));
+    EXPECT_TRUE(bucket.consume(now + 10 * SRS_UTIME_SECONDS));
+    EXPECT_FALSE(bucket.consume(now + 10 * SRS_UTIME_SECONDS));
+}
+
+class MockCpuHandler : public ISrsCoroutineHandler {
+public:
+    MockCpuHandler() {
+    }
+    virtual ~MockCpuHandler() {
+    }
+public:
+    virtual srs_error_t cycle() {
+        // Burn CPU for about 10ms, and switch out for some times.
+        for (int i = 0; i < 5; i++) {
+            srs_utime_t starttime = srs_update_system_time();
+            while (srs_update_system_time() - starttime < 2 * SRS_UTIME_MILLISECONDS) {
+            }
+            srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+        }
+        return srs_success;
+    }
+};
+
+VOID TEST(AppCoroutineTest, CpuAccounting)
+{
+    srs_error_t err;
+
+    SrsCoroutineCpu cpu;
+    SrsCoroutineCpu* ov = _srs_cpu;
+    _srs_cpu = &cpu;
+    HELPER_EXPECT_SUCCESS(cpu.initialize());
+
+    SrsContextId cid;
+    cid.set_value("cpu-test-cid");
+
+    if (true) {
+        MockCpuHandler h;
+        SrsFastCoroutine trd("cpu-test", &h, cid);
+        HELPER_EXPECT_SUCCESS(trd.start());
+        trd.stop();
+    }
+
+    // The slot is kept for the last duration, although the coroutine is done.
+    cpu.sample();
+    if (true) {
+        std::vector<SrsCpuSlot*> slots;
+        cpu.top(1, slots);
+        ASSERT_EQ(1, (int)slots.size());
+
+        SrsCpuSlot* slot = slots.at(0);
+        EXPECT_STREQ("cpu-test-cid", slot->cid.c_str());
+        EXPECT_STREQ("cpu-test", slot->name.c_str());
+        EXPECT_EQ(0, slot->refs);
+        EXPECT_GT(slot->delta, (uint64_t)0);
+        EXPECT_GT(cpu.percent(slot->delta), 10);
+        EXPECT_LE(cpu.percent(slot->delta), 100);
+    }
+
+    // The stopped slot is freed in next duration.
+    cpu.sample();
+    if (true) {
+        std::vector<SrsCpuSlot*> slots;
+        cpu.top(-1, slots);
+        EXPECT_TRUE(slots.empty());
+    }
+
+    _srs_cpu = ov;
+}
+
+class MockAdmissionHandler : public ISrsAdmissionHandler
+{
+public:
+    int nn_admitted;
+public:
+    MockAdmissionHandler() : nn_admitted(0) {
+    }
+    virtual ~MockAdmissionHandler() {
+    }
+public:
+    virtual srs_error_t on_admit_client(int /*type*/, srs_netfd_t /*stfd*/) {
+        nn_admitted++;
+        return srs_success;
+    }
+};
+
+VOID TEST(AppAdmissionTest, AdmitClients)
+{
+    srs_error_t err;
+
+    // Disabled, accept all clients.
+    if (true) {
+        SrsAdmission admission;
+        EXPECT_FALSE(admission.enabled());
+        for (int i = 0; i < 100; i++) {
+            EXPECT_EQ(SrsAdmissionAccept, admission.admit("127.0.0.1", 0, NULL));
+            EXPECT_EQ(SrsAdmissionAccept, admission.admit("", 0, NULL));
+        }
+        EXPECT_EQ(200, admission.nn_accepted_);
+    }
+
+    // Always accept the client without ip.
+    if (true) {
+        SrsAdmission admission;
+        admission.setup(NULL, 1, 1, 1, 1, 10, 3 * SRS_UTIME_SECONDS);
+        EXPECT_TRUE(admission.enabled());
+
+        srs_update_system_time();
+        for (int i = 0; i < 10; i++) {
+            EXPECT_EQ(SrsAdmissionAccept, admission.admit("", 0, NULL));
+        }
+        EXPECT_TRUE(admission.ips_.empty());
+    }
+
+    // Reject the client which reconnects too fast.
+    if (true) {
+        SrsAdmission admission;
+        admission.setup(NULL, 1000, 1000, 1, 2, 10, 3 * SRS_UTIME_SECONDS);
+
+        srs_update_system_time();
+        EXPECT_EQ(SrsAdmissionAccept, admission.admit("10.0.0.1", 0, NULL));
+        EXPECT_EQ(SrsAdmissionAccept, admission.admit("10.0.0.1", 0, NULL));
+        EXPECT_EQ(SrsAdmissionReject, admission.admit("10.0.0.1", 0, NULL));
+        EXPECT_EQ(SrsAdmissionAccept, admission.admit("10.0.0.2", 0, NULL));
+    }
+
+    // Defer the clients if no global token, then admit them in the global rate.
+    if (true) {
+        MockAdmissionHandler handler;
+        SrsAdmission admission;
+        admission.setup(&handler, 10, 1, 100, 100, 2, 3 * SRS_UTIME_SECONDS);
+
+        srs_utime_t now = srs_update_system_time();
+        EXPECT_EQ(SrsAdmissionAccept, admission.admit("10.0.0.1", 0, NULL));
+        EXPECT_EQ(SrsAdmissionDefer, admission.admit("10.0.0.2", 0, NULL));
+        EXPECT_EQ(SrsAdmissionDefer, admission.admit("10.0.0.3", 0, NULL));
+        EXPECT_EQ(SrsAdmissionReject, admission.admit("10.0.0.4", 0, NULL));
+        EXPECT_EQ(2, admission.nn_deferred());
+
+        // A token for each 100ms.
+        HELPER_EXPECT_SUCCESS(admission.consume_deferred(now + 100 * SRS_UTIME_MILLISECONDS));
+        EXPECT_EQ(1, handler.nn_admitted);
+        EXPECT_EQ(1, admission.nn_deferred());
+
+        // Expired if wait for too long.
+        HELPER_EXPECT_SUCCESS(admission.consume_deferred(now + 4 * SRS_UTIME_SECONDS));
+        EXPECT_EQ(1, handler.nn_admitted);
+        EXPECT_EQ(0, admission.nn_deferred());
+    }
+}
+
+VOID TEST(AppCircuitBreakerTest, Signals)
+{
+    srs_error_t err;
+
+    // Disabled, never break.
+    if (true) {
+        SrsCircuitBreaker breaker;
+        breaker.on_signals(100, 0, 0, 0, 0);
+        EXPECT_FALSE(breaker.hybrid_high_water_level());
+        HELPER_EXPECT_SUCCESS(breaker.on_publish());
+    }
+
+    // The CPU only.
+    if (true) {
+        SrsCircuitBreaker breaker;
+        breaker.setup(0, 0, 0, 0);
+        breaker.on_signals(50, 10 * SRS_UTIME_SECONDS, 1024, 0, 100);
+        EXPECT_FALSE(breaker.hybrid_high_water_level());
+
+        breaker.on_signals(96, 0, 0, 0, 0);
+        EXPECT_TRUE(breaker.hybrid_high_water_level());
+        EXPECT_TRUE(breaker.hybrid_critical_water_level());
+        EXPECT_FALSE(breaker.hybrid_dying_water_level());
+    }
+
+    // The event loop lag.
+    if (true) {
+        SrsCircuitBreaker breaker;
+        breaker.setup(200 * SRS_UTIME_MILLISECONDS, 0, 0, 0);
+        breaker.on_signals(10, 100 * SRS_UTIME_MILLISECONDS, 0, 0, 0);
+        EXPECT_FALSE(breaker.hybrid_high_water_level());
+
+        breaker.on_signals(10, 185 * SRS_UTIME_MILLISECONDS, 0, 0, 0);
+        EXPECT_TRUE(breaker.hybrid_high_water_level());
+        EXPECT_FALSE(breaker.hybrid_critical_water_level());
+    }
+
+    // The memory, queue and send buffer, dying if exceed limits for 5 times.
+    if (true) {
+        SrsCircuitBreaker breaker;
+        breaker.setup(0, 1024, 10 * SRS_UTIME_SECONDS, 1000);
+        for (int i = 0; i < 5; i++) {
+            HELPER_EXPECT_SUCCESS(breaker.on_publish());
+            breaker.on_signals(10, 0, 2048, 0, 0);
+        }
+        EXPECT_TRUE(breaker.hybrid_dying_water_level());
+        HELPER_EXPECT_FAILED(breaker.on_publish());
+
+        breaker.on_signals(10, 0, 0, 9700 * SRS_UTIME_MILLISECONDS, 0);
+        EXPECT_FALSE(breaker.hybrid_dying_water_level());
+        EXPECT_TRUE(breaker.hybrid_critical_water_level());
+
+        breaker.on_signals(10, 0, 0, 0, 0);
+        breaker.on_signals(10, 0, 0, 0, 950);
+        EXPECT_TRUE(breaker.hybrid_high_water_level());
+        EXPECT_FALSE(breaker.hybrid_critical_water_level());
+    }
+
+    // Drop the disposable frames if critical.
+    if (true) {
+        SrsCircuitBreaker breaker;
+        breaker.setup(0, 0, 0, 0);
+
+        char data = 0x37;
+        EXPECT_FALSE(breaker.on_consume(0, &data, 1, true, 3));
+
+        breaker.on_signals(96, 0, 0, 0, 0);
+        EXPECT_TRUE(breaker.on_consume(0, &data, 1, true, 3));
+        EXPECT_FALSE(breaker.on_consume(0, &data, 1, false, 3));
+
+        data = 0x17;
+        EXPECT_FALSE(breaker.on_consume(0, &data, 1, true, 3));
+    }
+}
+
 VOID TEST(AppFragmentTest, CheckDuration)
 {
 	if (true) {
@@ -743,3 +1270,882 @@ VOID TEST(AppSecurity, CheckSecurity)
     //       4. deny if matches deny strategy.
 }
 
+
+srs_error_t mock_gop_cache_video(SrsGopCache* gop, bool keyframe, uint32_t timestamp, int size)
+{
+    char* payload = new char[size];
+    memset(payload, 0, size);
+    payload[0] = keyframe? 0x17 : 0x27;
+    payload[1] = 0x01;
+
+    SrsMessageHeader h;
+    h.initialize_video(size, timestamp, 1);
+    SrsSharedPtrMessage msg;
+    srs_error_t err = msg.create(&h, payload, size);
+    if (err != srs_success) {
+        return err;
+    }
+
+    return gop->cache(&msg);
+}
+
+VOID TEST(AppGopCacheTest, LimitSizeAndDuration)
+{
+    srs_error_t err;
+
+    // No limit by default.
+    if (true) {
+        SrsGopCache gop;
+        HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, true, 0, 1024));
+        for (int i = 1; i < 100; i++) {
+            HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, false, i * 40, 1024));
+        }
+        EXPECT_EQ(100 * 1024, gop.bytes());
+        EXPECT_FALSE(gop.empty());
+    }
+
+    // Drop the gop when exceed the size, util next keyframe.
+    if (true) {
+        SrsGopCacheStat* stat = srs_get_gop_cache_stat();
+        int64_t overflows = stat->overflows;
+        int64_t bytes = stat->bytes;
+
+        SrsGopCache gop;
+        gop.set_limit(10 * 1024, 0);
+
+        HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, true, 0, 1024));
+        for (int i = 1; i < 10; i++) {
+            HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, false, i * 40, 1024));
+        }
+        EXPECT_EQ(10 * 1024, gop.bytes());
+        EXPECT_EQ(bytes + 10 * 1024, stat->bytes);
+
+        HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, false, 400, 1024));
+        EXPECT_TRUE(gop.empty());
+        EXPECT_EQ(0, gop.bytes());
+        EXPECT_EQ(bytes, stat->bytes);
+        EXPECT_EQ(overflows + 1, stat->overflows);
+
+        HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, false, 440, 1024));
+        EXPECT_TRUE(gop.empty());
+
+        HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, true, 480, 1024));
+        EXPECT_EQ(1024, gop.bytes());
+        EXPECT_EQ(480 * SRS_UTIME_MILLISECONDS, gop.start_time());
+    }
+
+    // Drop the gop when exceed the duration.
+    if (true) {
+        SrsGopCache gop;
+        gop.set_limit(0, 1 * SRS_UTIME_SECONDS);
+
+        HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, true, 0, 100));
+        HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, false, 1000, 100));
+        EXPECT_EQ(200, gop.bytes());
+
+        HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, false, 1040, 100));
+        EXPECT_TRUE(gop.empty());
+
+        HELPER_EXPECT_SUCCESS(mock_gop_cache_video(&gop, true, 2000, 100));
+        EXPECT_EQ(100, gop.bytes());
+    }
+}
+
+
+VOID TEST(AppShmTest, RingWriteAndRead)
+{
+    srs_error_t err;
+
+    string dir = "/tmp";
+    string url = "/live/utest-shm";
+    string path = srs_shm_ring_path(dir, url);
+    ::unlink(path.c_str());
+
+    char payload[10 * 1024];
+    memset(payload, 0xef, sizeof(payload));
+
+    // Read the sequence headers and messages from the keyframe.
+    if (true) {
+        SrsShmRing writer;
+        HELPER_EXPECT_SUCCESS(writer.create(path, url, 0));
+        EXPECT_TRUE(writer.owner());
+        EXPECT_TRUE(writer.alive());
+
+        // Never be alive for ourself.
+        EXPECT_FALSE(srs_shm_ring_alive(dir, url));
+
+        // Never attach to ourself, so pretend to be owned by the parent process.
+        SrsShmRing self;
+        HELPER_EXPECT_FAILED(self.attach(path, url));
+        writer.header_->pid = ::getppid();
+        EXPECT_TRUE(srs_shm_ring_alive(dir, url));
+
+        HELPER_EXPECT_SUCCESS(writer.write_slot(SrsShmSlotVideoSh, RTMP_MSG_VideoMessage, 0, payload, 100));
+        HELPER_EXPECT_SUCCESS(writer.write_slot(SrsShmSlotAudioSh, RTMP_MSG_AudioMessage, 0, payload, 10));
+        HELPER_EXPECT_SUCCESS(writer.write(RTMP_MSG_VideoMessage, 0, payload, 100, false));
+        HELPER_EXPECT_SUCCESS(writer.write(RTMP_MSG_VideoMessage, 40, payload, 100, true));
+        HELPER_EXPECT_SUCCESS(writer.write(RTMP_MSG_AudioMessage, 50, payload, 10, false));
+
+        SrsShmRing reader;
+        HELPER_EXPECT_SUCCESS(reader.attach(path, url));
+        EXPECT_FALSE(reader.owner());
+
+        vector<SrsCommonMessage*> shs;
+        HELPER_EXPECT_SUCCESS(reader.read_slots(shs));
+        ASSERT_EQ(2, (int)shs.size());
+        EXPECT_TRUE(shs[0]->header.is_video());
+        EXPECT_EQ(100, shs[0]->size);
+        EXPECT_TRUE(shs[1]->header.is_audio());
+        EXPECT_EQ(10, shs[1]->size);
+        srs_freep(shs[0]);
+        srs_freep(shs[1]);
+
+        SrsCommonMessage* msg = NULL;
+        HELPER_EXPECT_SUCCESS(reader.read(&msg));
+        ASSERT_TRUE(msg != NULL);
+        EXPECT_TRUE(msg->header.is_video());
+        EXPECT_EQ(40, msg->header.timestamp);
+        EXPECT_EQ(0, memcmp(payload, msg->payload, 100));
+        srs_freep(msg);
+
+        HELPER_EXPECT_SUCCESS(reader.read(&msg));
+        ASSERT_TRUE(msg != NULL);
+        EXPECT_TRUE(msg->header.is_audio());
+        EXPECT_EQ(50, msg->header.timestamp);
+        srs_freep(msg);
+
+        HELPER_EXPECT_SUCCESS(reader.read(&msg));
+        EXPECT_TRUE(msg == NULL);
+    }
+
+    // The owner removes the file when closed.
+    EXPECT_NE(0, ::access(path.c_str(), F_OK));
+
+    // Read across the tail of ring, and skip to keyframe when overrun.
+    if (true) {
+        SrsShmRing writer;
+        HELPER_EXPECT_SUCCESS(writer.create(path, url, 0));
+        writer.header_->pid = ::getppid();
+
+        SrsShmRing reader;
+        HELPER_EXPECT_SUCCESS(reader.attach(path, url));
+
+        // The ring is 256KB, read 100 messages of 10KB.
+        SrsCommonMessage* msg = NULL;
+        for (int i = 0; i < 100; i++) {
+            HELPER_EXPECT_SUCCESS(writer.write(RTMP_MSG_VideoMessage, i, payload, sizeof(payload), i == 0));
+            HELPER_EXPECT_SUCCESS(reader.read(&msg));
+            ASSERT_TRUE(msg != NULL);
+            EXPECT_EQ(i, msg->header.timestamp);
+            EXPECT_EQ((int)sizeof(payload), msg->size);
+            srs_freep(msg);
+        }
+        EXPECT_EQ(0, reader.nn_overrun());
+
+        // Overrun, skip to the last keyframe in the safe window, which is 1/4 of ring.
+        for (int i = 100; i < 120; i++) {
+            HELPER_EXPECT_SUCCESS(writer.write(RTMP_MSG_VideoMessage, i, payload, sizeof(payload), i == 115));
+        }
+        HELPER_EXPECT_SUCCESS(reader.read(&msg));
+        ASSERT_TRUE(msg != NULL);
+        EXPECT_EQ(1, reader.nn_overrun());
+        EXPECT_EQ(115, msg->header.timestamp);
+        srs_freep(msg);
+
+        // Overrun, skip to the writer if the keyframe is out of the safe window.
+        for (int i = 120; i < 140; i++) {
+            HELPER_EXPECT_SUCCESS(writer.write(RTMP_MSG_VideoMessage, i, payload, sizeof(payload), i == 120));
+        }
+        HELPER_EXPECT_SUCCESS(reader.read(&msg));
+        EXPECT_TRUE(msg == NULL);
+        EXPECT_EQ(2, reader.nn_overrun());
+
+        // Message larger than 1/4 of ring is dropped.
+        HELPER_EXPECT_FAILED(writer.write(RTMP_MSG_VideoMessage, 0, payload, 64 * 1024, false));
+    }
+
+    // Never attach to the ring of dead owner.
+    if (true) {
+        SrsShmRing writer;
+        HELPER_EXPECT_SUCCESS(writer.create(path, url, 0));
+        writer.header_->pid = 0x7fffffff;
+
+        SrsShmRing reader;
+        HELPER_EXPECT_FAILED(reader.attach(path, url));
+    }
+
+    // Never attach to the closed ring.
+    if (true) {
+        SrsShmRing writer;
+        HELPER_EXPECT_SUCCESS(writer.create(path, url, 0));
+        writer.header_->pid = ::getppid();
+        writer.header_->closed = 1;
+
+        SrsShmRing reader;
+        HELPER_EXPECT_FAILED(reader.attach(path, url));
+    }
+
+    // The stale ring of dead owner is replaced.
+    if (true) {
+        SrsShmRing* stale = new SrsShmRing();
+        HELPER_EXPECT_SUCCESS(stale->create(path, url, 0));
+
+        SrsShmRing writer;
+        HELPER_EXPECT_SUCCESS(writer.create(path, url, 0));
+
+        // The stale ring never removes the file of new owner.
+        srs_freep(stale);
+        EXPECT_EQ(0, ::access(path.c_str(), F_OK));
+    }
+    ::unlink(path.c_str());
+}
+
+VOID TEST(AppShmTest, CanPublishWithoutSideEffect)
+{
+    srs_error_t err;
+
+    MockSrsConfig conf;
+    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost __defaultVhost__{shm_fanout{enabled on;dir /tmp;}}"));
+
+    SrsConfig* config = _srs_config;
+    _srs_config = &conf;
+
+    SrsRequest* req = new SrsRequest();
+    req->vhost = "__defaultVhost__";
+    req->app = "live";
+    req->stream = "utest-shm-x";
+
+    // The stream is played from sibling process, which is quit.
+    SrsLiveSource source;
+    source.req = req;
+    source._can_publish = false;
+    source.play_edge->state = SrsEdgeStateIngestConnected;
+
+    // The check never stops the play of stream.
+    EXPECT_TRUE(source.can_publish(false));
+    EXPECT_TRUE(source.can_publish(false));
+    EXPECT_EQ(SrsEdgeStateIngestConnected, source.play_edge->state);
+
+    source.play_edge->state = SrsEdgeStateInit;
+    _srs_config = config;
+}
+
+VOID TEST(AppEdgeTest, HotStandbySwitch)
+{
+    srs_error_t err;
+
+    // The vhost without edge config, so the upstream of feeder always fails.
+    SrsRequest req;
+    req.vhost = "utest.hot.standby"; req.app = "live"; req.stream = "livestream";
+    SrsLbRoundRobin lb;
+
+    SrsEdgeIngester ingester;
+    SrsEdgeFeeder* active = new SrsEdgeFeeder();
+    SrsEdgeFeeder* standby = new SrsEdgeFeeder();
+    ingester.feeders.push_back(active);
+    ingester.feeders.push_back(standby);
+    active->initialize(&req, &lb, standby);
+    standby->initialize(&req, &lb, active);
+
+    // Both feeders are pulling stream, and cached the keyframe.
+    active->connected_ = active->has_keyframe = true;
+    active->set_active(true);
+    standby->connected_ = standby->has_keyframe = true;
+    EXPECT_TRUE(active->ready());
+    EXPECT_TRUE(standby->ready());
+
+    // Never switch when the active is alive.
+    EXPECT_TRUE(ingester.select_standby(active) == NULL);
+    EXPECT_TRUE(ingester.select_standby(NULL) == active);
+
+    // Kill the active feeder, its upstream fails.
+    HELPER_EXPECT_SUCCESS(active->start());
+    srs_usleep(10 * SRS_UTIME_MILLISECONDS);
+    EXPECT_FALSE(active->connected());
+    EXPECT_FALSE(active->ready());
+    EXPECT_TRUE(active->origin().empty());
+
+    // Switch to the standby, and never switch back to the failed one.
+    EXPECT_TRUE(ingester.select_standby(active) == standby);
+    standby->connected_ = false;
+    EXPECT_TRUE(ingester.select_standby(standby) == NULL);
+}
+
+VOID TEST(AppHlsTest, PartNotifier)
+{
+    EXPECT_STREQ("live/livestream-5.part0.ts", SrsHlsSegment::part_of("live/livestream-5.ts", 0).c_str());
+    EXPECT_STREQ("live/livestream-5.tsx.part3", SrsHlsSegment::part_of("live/livestream-5.tsx", 3).c_str());
+
+    // Only the part is waited for, when not found.
+    EXPECT_TRUE(SrsHlsSegment::is_part("live/livestream-5.part0.ts"));
+    EXPECT_TRUE(SrsHlsSegment::is_part("live/livestream-5.tsx.part12"));
+    EXPECT_FALSE(SrsHlsSegment::is_part("live/livestream-5.ts"));
+    EXPECT_FALSE(SrsHlsSegment::is_part("live/livestream.m3u8"));
+    EXPECT_FALSE(SrsHlsSegment::is_part("live/livestream-5.part.ts"));
+    EXPECT_FALSE(SrsHlsSegment::is_part("live/livestream.party.ts"));
+
+    SrsHlsPartNotifier notifier;
+    string m3u8 = "/tmp/live/livestream.m3u8";
+
+    // Not LL-HLS playlist, serve it directly.
+    int code = 0;
+    notifier.wait_part(m3u8, 5, 1, &code);
+    EXPECT_EQ(SRS_CONSTS_HTTP_OK, code);
+
+    // Writing the part 2 of segment 5.
+    notifier.update(m3u8, 5, 1, "/tmp/live/livestream-5.part2.ts", 10 * SRS_UTIME_MILLISECONDS);
+
+    // The ready part, or the whole segment.
+    notifier.wait_part(m3u8, 5, 1, &code);
+    EXPECT_EQ(SRS_CONSTS_HTTP_OK, code);
+    notifier.wait_part(m3u8, 5, 0, &code);
+    EXPECT_EQ(SRS_CONSTS_HTTP_OK, code);
+    notifier.wait_part(m3u8, 4, -1, &code);
+    EXPECT_EQ(SRS_CONSTS_HTTP_OK, code);
+
+    // The request too far in future.
+    notifier.wait_part(m3u8, 8, 0, &code);
+    EXPECT_EQ(SRS_CONSTS_HTTP_BadRequest, code);
+
+    // Timeout for the part is not ready in 3 target durations.
+    srs_utime_t starttime = srs_update_system_time();
+    notifier.wait_part(m3u8, 5, 2, &code);
+    EXPECT_EQ(SRS_CONSTS_HTTP_ServiceUnavailable, code);
+    EXPECT_GE(srs_update_system_time() - starttime, 20 * SRS_UTIME_MILLISECONDS);
+
+    // The whole segment 5 is not ready.
+    notifier.wait_part(m3u8, 5, -1, &code);
+    EXPECT_EQ(SRS_CONSTS_HTTP_ServiceUnavailable, code);
+
+    // Serve directly when unpublished.
+    notifier.unpublish(m3u8);
+    notifier.wait_part(m3u8, 5, 2, &code);
+    EXPECT_EQ(SRS_CONSTS_HTTP_OK, code);
+}
+
+string mock_read_file(string path)
+{
+    SrsFileReader fr;
+    if (fr.open(path) != srs_success) {
+        return "";
+    }
+
+    string content(fr.filesize(), 0);
+    fr.read((void*)content.data(), content.length(), NULL);
+    return content;
+}
+
+VOID TEST(AppHlsTest, PartStartsWithPatPmt)
+{
+    srs_error_t err;
+
+    MockSrsConfig conf;
+    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost __defaultVhost__{}"));
+
+    SrsConfig* config = _srs_config;
+    _srs_config = &conf;
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    req.stream = "utest-ll";
+
+    SrsHlsMuxer muxer;
+    HELPER_EXPECT_SUCCESS(muxer.update_config(&req, "", "/tmp/srs-utest-hls", "[app]/[stream].m3u8",
+        "[app]/[stream]-[seq].ts", 10 * SRS_UTIME_SECONDS, 60 * SRS_UTIME_SECONDS, false, 2.0, true, false,
+        false, 0, "", "", "", true, 100 * SRS_UTIME_MILLISECONDS));
+    HELPER_EXPECT_SUCCESS(muxer.segment_open());
+
+    // Write a video frame to each part, the later part is not the start of segment.
+    SrsTsMessageCache cache;
+    for (int i = 0; i < 3; i++) {
+        char data[] = {0x00, 0x00, 0x00, 0x01, 0x09, (char)0xf0};
+        SrsTsMessage* msg = new SrsTsMessage();
+        msg->sid = SrsTsPESStreamIdVideoCommon;
+        msg->dts = msg->pts = i * 90 * 200;
+        msg->write_pcr = (i == 0);
+        msg->payload->append(data, sizeof(data));
+
+        cache.video = msg;
+        HELPER_EXPECT_SUCCESS(muxer.flush_video(&cache));
+        HELPER_EXPECT_SUCCESS(muxer.part_close());
+    }
+
+    // Each part starts with PAT, then PMT.
+    ASSERT_EQ(3, (int)muxer.current->parts.size());
+    for (int i = 0; i < 3; i++) {
+        string part = mock_read_file(muxer.current->parts.at(i)->fullpath);
+        ASSERT_GE((int)part.length(), 3 * 188);
+        EXPECT_EQ(0, (int)part.length() % 188);
+        EXPECT_EQ(0x47, (uint8_t)part.at(0));
+        EXPECT_EQ(0x0000, ((uint8_t)part.at(1) & 0x1f) << 8 | (uint8_t)part.at(2));
+        EXPECT_EQ(0x1001, ((uint8_t)part.at(189) & 0x1f) << 8 | (uint8_t)part.at(190));
+    }
+
+    muxer.dispose();
+    _srs_config = config;
+}
+
+VOID TEST(AppDashTest, Fmp4M3u8Writer)
+{
+    srs_error_t err;
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    req.stream = "livestream";
+
+    SrsFmp4M3u8Writer writer;
+    HELPER_EXPECT_SUCCESS(writer.initialize(&req));
+    HELPER_EXPECT_SUCCESS(writer.on_publish("/tmp/srs-utest-fmp4", "live/livestream", 2 * SRS_UTIME_SECONDS));
+
+    SrsFormat format;
+    format.vcodec = new SrsVideoCodecConfig();
+    format.vcodec->width = 1280;
+    format.vcodec->height = 720;
+    format.acodec = new SrsAudioCodecConfig();
+
+    SrsFragmentWindow fragments;
+    for (int i = 0; i < 2; i++) {
+        SrsFragment* fragment = new SrsFragment();
+        fragment->set_path("/tmp/srs-utest-fmp4/live/livestream/video-" + srs_int2str(100 + i) + ".m4s");
+        fragment->append(i * 3000);
+        fragment->append(i * 3000 + 2500);
+        fragments.append(fragment);
+    }
+    HELPER_EXPECT_SUCCESS(writer.write(true, &format, &fragments, 5));
+
+    string media = mock_read_file("/tmp/srs-utest-fmp4/live/livestream/video.m3u8");
+    EXPECT_TRUE(media.find("#EXT-X-TARGETDURATION:3\n") != string::npos);
+    EXPECT_TRUE(media.find("#EXT-X-MEDIA-SEQUENCE:5\n") != string::npos);
+    EXPECT_TRUE(media.find("#EXT-X-MAP:URI=\"video-init.mp4\"\n") != string::npos);
+    EXPECT_TRUE(media.find("#EXTINF:2.500,\nvideo-100.m4s\n#EXTINF:2.500,\nvideo-101.m4s\n") != string::npos);
+
+    // The codecs is unknown, so never write it.
+    string master = mock_read_file("/tmp/srs-utest-fmp4/live/livestream.m3u8");
+    EXPECT_TRUE(master.find("URI=\"livestream/audio.m3u8\"") != string::npos);
+    EXPECT_TRUE(master.find("RESOLUTION=1280x720,AUDIO=\"audio\"\nlivestream/video.m3u8\n") != string::npos);
+    EXPECT_TRUE(master.find("CODECS") == string::npos);
+
+    // The codecs and bandwidth of stream, for the fragment of 250000 bytes in 2.5s.
+    if (true) {
+        uint8_t avcc[] = {0x01, 0x4d, 0x40, 0x1f, 0xff};
+        format.vcodec->id = SrsVideoCodecIdAVC;
+        format.vcodec->avc_extra_data.assign((char*)avcc, (char*)avcc + sizeof(avcc));
+        format.acodec->id = SrsAudioCodecIdAAC;
+        format.acodec->aac_object = SrsAacObjectTypeAacHE;
+
+        SrsFileWriter fw;
+        HELPER_EXPECT_SUCCESS(fw.open("/tmp/srs-utest-fmp4/live/livestream/video-101.m4s"));
+        string data(250000, 'x');
+        HELPER_EXPECT_SUCCESS(fw.write((void*)data.data(), data.length(), NULL));
+        fw.close();
+
+        HELPER_EXPECT_SUCCESS(writer.write(true, &format, &fragments, 5));
+        master = mock_read_file("/tmp/srs-utest-fmp4/live/livestream.m3u8");
+        EXPECT_TRUE(master.find("BANDWIDTH=800000,CODECS=\"avc1.4d401f,mp4a.40.5\"") != string::npos);
+    }
+
+    fragments.dispose();
+}
+
+VOID TEST(AppDashTest, Fmp4Codecs)
+{
+    SrsVideoCodecConfig vcodec;
+    EXPECT_STREQ("", srs_fmp4_video_codecs(&vcodec).c_str());
+
+    // The main profile of HEVC, Main tier, level 3.1, with progressive source flag.
+    uint8_t hvcc[] = {0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5d, 0xf0};
+    vcodec.id = SrsVideoCodecIdHEVC;
+    vcodec.avc_extra_data.assign((char*)hvcc, (char*)hvcc + sizeof(hvcc));
+    EXPECT_STREQ("hvc1.1.6.L93.90", srs_fmp4_video_codecs(&vcodec).c_str());
+
+    // The high tier of Main10 profile.
+    hvcc[1] = 0x22; hvcc[2] = 0x20; hvcc[6] = 0xb0; hvcc[12] = 0x78;
+    vcodec.avc_extra_data.assign((char*)hvcc, (char*)hvcc + sizeof(hvcc));
+    EXPECT_STREQ("hvc1.2.4.H120.B0", srs_fmp4_video_codecs(&vcodec).c_str());
+
+    SrsAudioCodecConfig acodec;
+    EXPECT_STREQ("", srs_fmp4_audio_codecs(&acodec).c_str());
+    acodec.id = SrsAudioCodecIdAAC;
+    acodec.aac_object = SrsAacObjectTypeAacLC;
+    EXPECT_STREQ("mp4a.40.2", srs_fmp4_audio_codecs(&acodec).c_str());
+}
+
+class MockLiveSourceHandler : public ISrsLiveSourceHandler
+{
+public:
+    int nn_publish;
+    int nn_unpublish;
+public:
+    MockLiveSourceHandler() : nn_publish(0), nn_unpublish(0) {
+    }
+    virtual ~MockLiveSourceHandler() {
+    }
+public:
+    virtual srs_error_t on_publish(SrsLiveSource* /*s*/, SrsRequest* /*r*/) {
+        nn_publish++;
+        return srs_success;
+    }
+    virtual void on_unpublish(SrsLiveSource* /*s*/, SrsRequest* /*r*/) {
+        nn_unpublish++;
+    }
+};
+
+class MockLivePublisher : public SrsLivePublisher
+{
+public:
+    MockLiveSourceHandler* handler;
+public:
+    MockLivePublisher(MockLiveSourceHandler* h) : handler(h) {
+    }
+    virtual ~MockLivePublisher() {
+    }
+public:
+    virtual ISrsLiveSourceHandler* source_handler() {
+        return handler;
+    }
+};
+
+VOID TEST(AppPublisherTest, PublishAndExpire)
+{
+    srs_error_t err;
+
+    // Never publish without stream name.
+    if (true) {
+        SrsLivePublisher pub;
+        err = pub.publish("rtmp://127.0.0.1/live/", "127.0.0.1");
+        EXPECT_EQ(ERROR_RTMP_STREAM_NAME_EMPTY, srs_error_code(err));
+        srs_freep(err);
+        EXPECT_FALSE(pub.publishing());
+        EXPECT_TRUE(pub.request() == NULL);
+    }
+
+    // Never publish without app, the tcUrl is parsed as the host only.
+    if (true) {
+        SrsLivePublisher pub;
+        err = pub.publish("rtmp://127.0.0.1/livestream", "127.0.0.1");
+        EXPECT_EQ(ERROR_RTMP_REQ_TCURL, srs_error_code(err));
+        srs_freep(err);
+        EXPECT_FALSE(pub.publishing());
+    }
+
+    // Drop message when not publishing, and the data of FLV tag is freed.
+    if (true) {
+        SrsLivePublisher pub;
+        HELPER_EXPECT_FAILED(pub.on_flv_tag(SrsFrameTypeAudio, 0, new char[2], 2));
+
+        SrsCommonMessage msg;
+        msg.header.initialize_video(0, 0, 1);
+        HELPER_EXPECT_FAILED(pub.on_message(&msg));
+    }
+
+    // Kickoff the publisher by expire.
+    if (true) {
+        SrsLivePublisher pub;
+        pub.expire();
+
+        SrsCommonMessage msg;
+        msg.header.initialize_video(0, 0, 1);
+        err = pub.on_message(&msg);
+        EXPECT_EQ(ERROR_THREAD_INTERRUPED, srs_error_code(err));
+        srs_freep(err);
+
+        // Unpublish is always ok.
+        pub.unpublish();
+        pub.unpublish();
+    }
+
+    // Publish to the source, then kickoff the publisher by expire and unpublish.
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost __defaultVhost__{}"));
+
+        SrsConfig* config = _srs_config;
+        SrsLiveSourceManager* sources = _srs_sources;
+        _srs_config = &conf;
+        _srs_sources = new SrsLiveSourceManager();
+
+        MockLiveSourceHandler handler;
+        MockLivePublisher pub(&handler);
+        HELPER_EXPECT_SUCCESS(pub.publish("rtmp://127.0.0.1/live/livestream", "127.0.0.1"));
+        EXPECT_TRUE(pub.publishing());
+        ASSERT_TRUE(pub.request() != NULL);
+        EXPECT_STREQ("/live/livestream", pub.request()->get_stream_url().c_str());
+        EXPECT_EQ(1, handler.nn_publish);
+
+        // Publish again is ignored.
+        HELPER_EXPECT_SUCCESS(pub.publish("rtmp://127.0.0.1/live/livestream", "127.0.0.1"));
+        EXPECT_EQ(1, handler.nn_publish);
+
+        // The stream is busy for another publisher.
+        if (true) {
+            MockLivePublisher busy(&handler);
+            err = busy.publish("rtmp://127.0.0.1/live/livestream", "127.0.0.1");
+            EXPECT_EQ(ERROR_SYSTEM_STREAM_BUSY, srs_error_code(err));
+            srs_freep(err);
+            EXPECT_FALSE(busy.publishing());
+        }
+
+        char* data = new char[2];
+        data[0] = (char)0xaf; data[1] = 0x01;
+        HELPER_EXPECT_SUCCESS(pub.on_flv_tag(SrsFrameTypeAudio, 0, data, 2));
+
+        pub.expire();
+        SrsCommonMessage msg;
+        msg.header.initialize_video(0, 0, 1);
+        err = pub.on_message(&msg);
+        EXPECT_EQ(ERROR_THREAD_INTERRUPED, srs_error_code(err));
+        srs_freep(err);
+
+        pub.unpublish();
+        EXPECT_FALSE(pub.publishing());
+        EXPECT_TRUE(pub.request() == NULL);
+        EXPECT_EQ(1, handler.nn_unpublish);
+
+        // Publish again after unpublish.
+        HELPER_EXPECT_SUCCESS(pub.publish("rtmp://127.0.0.1/live/livestream", "127.0.0.1"));
+        EXPECT_EQ(2, handler.nn_publish);
+        pub.unpublish();
+        EXPECT_EQ(2, handler.nn_unpublish);
+
+        _srs_sources->destroy();
+        srs_freep(_srs_sources);
+        _srs_sources = sources;
+        _srs_config = config;
+    }
+}
+
+VOID TEST(AppMpegtsUdpTest, FlowKeyAndUrl)
+{
+    // All senders are demuxed to one flow, without variables of sender.
+    EXPECT_STREQ("", srs_mpegts_udp_flow_key("rtmp://127.0.0.1/live/livestream", "10.0.0.1", 5000).c_str());
+    EXPECT_STREQ("", srs_mpegts_udp_flow_key("rtmp://127.0.0.1/live/[program]", "10.0.0.1", 5000).c_str());
+
+    // Demux by the address of sender.
+    EXPECT_STREQ("10.0.0.1", srs_mpegts_udp_flow_key("rtmp://127.0.0.1/live/[ip]", "10.0.0.1", 5000).c_str());
+    EXPECT_STREQ(":5000", srs_mpegts_udp_flow_key("rtmp://127.0.0.1/live/[port]", "10.0.0.1", 5000).c_str());
+    EXPECT_STREQ("10.0.0.1:5000", srs_mpegts_udp_flow_key("rtmp://127.0.0.1/live/[ip]-[port]", "10.0.0.1", 5000).c_str());
+
+    EXPECT_STREQ("rtmp://127.0.0.1/live/livestream", srs_mpegts_udp_build_url("rtmp://127.0.0.1/live/livestream", "10.0.0.1", 5000, 1).c_str());
+    EXPECT_STREQ("rtmp://127.0.0.1/live/10.0.0.1-1", srs_mpegts_udp_build_url("rtmp://127.0.0.1/live/[ip]-[program]", "10.0.0.1", 5000, 1).c_str());
+    EXPECT_STREQ("rtmp://127.0.0.1/10.0.0.1/5000", srs_mpegts_udp_build_url("rtmp://127.0.0.1/[ip]/[port]", "10.0.0.1", 5000, 0).c_str());
+}
+
+VOID TEST(AppMpegtsUdpTest, ExpireIdlePrograms)
+{
+    SrsMpegtsUdpFlow flow("rtmp://127.0.0.1/live/[program]", "10.0.0.1", 5000);
+    flow.streams[1] = new SrsMpegtsUdpStream("rtmp://127.0.0.1/live/1", "10.0.0.1");
+    flow.streams[2] = new SrsMpegtsUdpStream("rtmp://127.0.0.1/live/2", "10.0.0.1");
+
+    // All programs are alive.
+    flow.expire(5 * SRS_UTIME_SECONDS);
+    EXPECT_EQ(2, (int)flow.streams.size());
+
+    // The sender stops the program 1, while the flow is alive.
+    flow.streams[1]->last_message = srs_get_system_time() - 10 * SRS_UTIME_SECONDS;
+    EXPECT_TRUE(flow.streams[1]->is_idle(5 * SRS_UTIME_SECONDS));
+    EXPECT_FALSE(flow.is_idle(5 * SRS_UTIME_SECONDS));
+
+    flow.expire(5 * SRS_UTIME_SECONDS);
+    EXPECT_EQ(1, (int)flow.streams.size());
+    EXPECT_TRUE(flow.streams.find(1) == flow.streams.end());
+    EXPECT_TRUE(flow.streams.find(2) != flow.streams.end());
+}
+
+VOID TEST(AppMetricsTest, OpenMetricsText)
+{
+    if (true) {
+        vector<string> labels;
+        labels.push_back("vhost");
+        labels.push_back("stream");
+        labels.push_back("client");
+        EXPECT_EQ(SrsMetricsLabelVhost | SrsMetricsLabelStream, srs_metrics_labels_parse(labels));
+    }
+
+    // The value of label must be escaped.
+    if (true) {
+        string labels;
+        srs_metrics_label(labels, "vhost", "v");
+        srs_metrics_label(labels, "app", "a\"b\\c\nd");
+        EXPECT_STREQ("vhost=\"v\",app=\"a\\\"b\\\\c\\nd\"", labels.c_str());
+    }
+
+    if (true) {
+        string out;
+        srs_metrics_family(out, "srs_send_bytes", "counter", "The bytes sent.");
+        srs_metrics_sample(out, "srs_send_bytes_total", "", 100);
+        srs_metrics_sample(out, "srs_send_bytes_total", "vhost=\"v\"", -1);
+        srs_metrics_number(out, "srs_cpu_percent", "", 12.5);
+        EXPECT_STREQ("# TYPE srs_send_bytes counter\n# HELP srs_send_bytes The bytes sent.\n"
+            "srs_send_bytes_total 100\nsrs_send_bytes_total{vhost=\"v\"} -1\nsrs_cpu_percent 12.50\n", out.c_str());
+    }
+}
+
+class MockStatisticConn : public ISrsExpire, public ISrsKbpsDelta
+{
+public:
+    int nb_remarks;
+    int64_t in;
+    int64_t out;
+public:
+    MockStatisticConn() {
+        nb_remarks = 0;
+        in = out = 0;
+    }
+    virtual ~MockStatisticConn() {
+    }
+public:
+    virtual void expire() {
+    }
+    virtual void remark(int64_t* pin, int64_t* pout) {
+        nb_remarks++;
+        *pin = in; *pout = out;
+        in = out = 0;
+    }
+};
+
+VOID TEST(AppStatisticTest, ClientHandles)
+{
+    srs_error_t err;
+
+    SrsStatistic* stat = SrsStatistic::instance();
+    SrsRequest req;
+    req.vhost = "__defaultVhost__"; req.app = "live"; req.stream = "utest-handles";
+
+    MockStatisticConn c0, c1;
+    HELPER_EXPECT_SUCCESS(stat->on_client("utest-handle-0", &req, &c0, SrsRtmpConnFMLEPublish));
+    HELPER_EXPECT_SUCCESS(stat->on_client("utest-handle-1", &req, &c1, SrsRtmpConnPlay));
+
+    int64_t h0 = stat->find_handle("utest-handle-0");
+    int64_t h1 = stat->find_handle("utest-handle-1");
+    EXPECT_TRUE(h0 >= 0);
+    EXPECT_TRUE(h1 >= 0);
+    EXPECT_NE(h0, h1);
+    EXPECT_EQ(-1, stat->find_handle("utest-handle-none"));
+
+    SrsStatisticClient* client = stat->find_client(h0);
+    ASSERT_TRUE(client != NULL);
+    EXPECT_STREQ("utest-handle-0", client->id.c_str());
+    EXPECT_TRUE(client == stat->find_client("utest-handle-0"));
+
+    // Update the frames of stream by handle.
+    uint64_t nb_frames = client->stream->nb_frames;
+    HELPER_EXPECT_SUCCESS(stat->on_video_frames(h0, 10));
+    EXPECT_EQ(nb_frames + 10, client->stream->nb_frames);
+
+    // The delta of clients is collected when sample.
+    c0.in = 100; c1.out = 200;
+    stat->kbps_sample();
+    EXPECT_EQ(1, c0.nb_remarks);
+    EXPECT_EQ(1, c1.nb_remarks);
+
+    // Only the page of clients is dumped.
+    if (true) {
+        SrsJsonArray* arr = SrsJsonAny::array();
+        SrsAutoFree(SrsJsonArray, arr);
+        HELPER_EXPECT_SUCCESS(stat->dumps_clients(arr, 0, 1));
+        EXPECT_EQ(1, arr->count());
+    }
+
+    // The last delta is collected when disconnect, and the handle is invalid.
+    stat->on_disconnect("utest-handle-0");
+    EXPECT_EQ(2, c0.nb_remarks);
+    EXPECT_TRUE(stat->find_client(h0) == NULL);
+
+    // The stale handle is ignored.
+    SrsStatisticClient* player = stat->find_client(h1);
+    ASSERT_TRUE(player != NULL);
+    HELPER_EXPECT_SUCCESS(stat->on_video_frames(h0, 10));
+    EXPECT_EQ(nb_frames + 10, player->stream->nb_frames);
+
+    // The slot is reused, but the handle is different.
+    MockStatisticConn c2;
+    HELPER_EXPECT_SUCCESS(stat->on_client("utest-handle-2", &req, &c2, SrsRtmpConnPlay));
+    int64_t h2 = stat->find_handle("utest-handle-2");
+    EXPECT_NE(h0, h2);
+    EXPECT_EQ(h0 & 0xffffffff, h2 & 0xffffffff);
+    EXPECT_TRUE(stat->find_client(h0) == NULL);
+    EXPECT_TRUE(stat->find_client(h2) != NULL);
+    EXPECT_TRUE(stat->find_client(h1) != NULL);
+
+    stat->on_disconnect("utest-handle-1");
+    stat->on_disconnect("utest-handle-2");
+    EXPECT_TRUE(stat->find_client(h1) == NULL);
+    EXPECT_TRUE(stat->find_client(h2) == NULL);
+}
+
+// Get the value of sample in metrics, -1 if not found.
+int64_t mock_metrics_value(const string& out, string sample)
+{
+    size_t pos = out.find(sample + " ");
+    if (pos == string::npos) {
+        return -1;
+    }
+    return ::atoll(out.c_str() + pos + sample.length() + 1);
+}
+
+VOID TEST(AppMetricsTest, MonotonicCounters)
+{
+    SrsStatistic stat;
+
+    SrsRequest r1, r2, r3;
+    r1.vhost = r2.vhost = r3.vhost = "__defaultVhost__";
+    r1.app = r2.app = r3.app = "live";
+    r1.stream = "s1"; r2.stream = "s2"; r3.stream = "s3";
+
+    SrsStatisticStream* s1 = stat.create_stream(stat.create_vhost(&r1), &r1);
+    stat.on_stream_publish(&r1, "p1");
+    s1->nb_frames = 10;
+
+    string out;
+    stat.dumps_metrics(out, SrsMetricsLabelStream, 1);
+    EXPECT_EQ(10, mock_metrics_value(out, "srs_stream_frames_total{stream=\"s1\"}"));
+
+    // The streams are aggregated to overflow, when series is full.
+    SrsStatisticStream* s2 = stat.create_stream(stat.create_vhost(&r2), &r2);
+    stat.on_stream_publish(&r2, "p2");
+    s2->nb_frames = 5;
+    SrsStatisticStream* s3 = stat.create_stream(stat.create_vhost(&r3), &r3);
+    stat.on_stream_publish(&r3, "p3");
+    s3->nb_frames = 7;
+
+    out = ""; stat.dumps_metrics(out, SrsMetricsLabelStream, 1);
+    EXPECT_EQ(10, mock_metrics_value(out, "srs_stream_frames_total{stream=\"s1\"}"));
+    EXPECT_EQ(12, mock_metrics_value(out, "srs_stream_frames_total{overflow=\"true\"}"));
+    EXPECT_EQ(2, mock_metrics_value(out, "srs_stream_active{overflow=\"true\"}"));
+
+    // The series of stream is stable.
+    s1->nb_frames = 20;
+    out = ""; stat.dumps_metrics(out, SrsMetricsLabelStream, 1);
+    EXPECT_EQ(20, mock_metrics_value(out, "srs_stream_frames_total{stream=\"s1\"}"));
+    EXPECT_EQ(12, mock_metrics_value(out, "srs_stream_frames_total{overflow=\"true\"}"));
+
+    // The counter never goes backwards, when stream leaves.
+    stat.on_stream_close(&r2);
+    s3->nb_frames = 8;
+    out = ""; stat.dumps_metrics(out, SrsMetricsLabelStream, 1);
+    EXPECT_EQ(13, mock_metrics_value(out, "srs_stream_frames_total{overflow=\"true\"}"));
+    EXPECT_EQ(1, mock_metrics_value(out, "srs_stream_active{overflow=\"true\"}"));
+
+    // The series is removed when all streams left, and the overflow is still stable.
+    stat.on_stream_close(&r1);
+    out = ""; stat.dumps_metrics(out, SrsMetricsLabelStream, 1);
+    EXPECT_EQ(-1, mock_metrics_value(out, "srs_stream_frames_total{stream=\"s1\"}"));
+    EXPECT_EQ(-1, mock_metrics_value(out, "srs_stream_frames_total{stream=\"s3\"}"));
+    EXPECT_EQ(13, mock_metrics_value(out, "srs_stream_frames_total{overflow=\"true\"}"));
+
+    // The stream named others never collides with the series of overflow.
+    SrsRequest r4;
+    r4.vhost = "__defaultVhost__"; r4.app = "live"; r4.stream = "others";
+    SrsStatisticStream* s4 = stat.create_stream(stat.create_vhost(&r4), &r4);
+    stat.on_stream_publish(&r4, "p4");
+    s4->nb_frames = 3;
+    out = ""; stat.dumps_metrics(out, SrsMetricsLabelStream, 2);
+    EXPECT_EQ(3, mock_metrics_value(out, "srs_stream_frames_total{stream=\"others\"}"));
+    EXPECT_EQ(13, mock_metrics_value(out, "srs_stream_frames_total{overflow=\"true\"}"));
+
+    // The closed streams are not freed by stat.
+    srs_freep(s1);
+    srs_freep(s2);
+}
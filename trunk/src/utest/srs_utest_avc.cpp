@@ -9,6 +9,10 @@
 #include <srs_kernel_buffer.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_core_autofree.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_kernel_file.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_kernel_codec.hpp>
 
 VOID TEST(SrsAVCTest, H264ParseAnnexb)
 {
@@ -106,6 +110,190 @@ VOID TEST(SrsAVCTest, H264ParseAnnexb)
     }
 }
 
+// The naive implementation to find 00 00 01, as reference.
+static char* mock_find_annexb(char* p, char* end)
+{
+    for (char* q = p; q + 2 < end; q++) {
+        if (q[0] == 0x00 && q[1] == 0x00 && q[2] == 0x01) {
+            return q;
+        }
+    }
+    return end;
+}
+
+VOID TEST(SrsAVCTest, H264FindAnnexb)
+{
+    // Start code with or without leading zeros.
+    if (true) {
+        char buf[] = {0x09, 0x00, 0x00, 0x00, 0x01, 0x09};
+        int nb_start_code = 0;
+        EXPECT_EQ(buf + 1, srs_avc_find_annexb(buf, buf + sizeof(buf), &nb_start_code));
+        EXPECT_EQ(4, nb_start_code);
+
+        EXPECT_EQ(buf + 2, srs_avc_find_annexb(buf + 2, buf + sizeof(buf), &nb_start_code));
+        EXPECT_EQ(3, nb_start_code);
+
+        EXPECT_EQ(buf + sizeof(buf), srs_avc_find_annexb(buf + 3, buf + sizeof(buf), &nb_start_code));
+        EXPECT_EQ(buf + 4, srs_avc_find_annexb(buf, buf + 4, &nb_start_code));
+    }
+
+    // Every implementation should equal to the naive one, for start code at each position.
+    for (int size = 0; size < 100; size++) {
+        for (int pos = 0; pos < size; pos++) {
+            vector<char> buf(size, (char)0xff);
+            buf[pos] = 0x01;
+            if (pos > 0) buf[pos - 1] = 0x00;
+            if (pos > 1) buf[pos - 2] = 0x00;
+
+            char* p = size? &buf[0] : NULL;
+            char* end = p + size;
+            char* expect = mock_find_annexb(p, end);
+            EXPECT_EQ(expect, srs_avc_find_annexb_scalar(p, end)) << "size=" << size << ", pos=" << pos;
+#ifdef SRS_AVC_ANNEXB_SIMD
+            EXPECT_EQ(expect, srs_avc_find_annexb_sse2(p, end)) << "size=" << size << ", pos=" << pos;
+            if (srs_cpu_supports_avx2()) {
+                EXPECT_EQ(expect, srs_avc_find_annexb_avx2(p, end)) << "size=" << size << ", pos=" << pos;
+            }
+#endif
+        }
+    }
+
+    // Random bytes with many 00 and 01.
+    if (true) {
+        srand(0x5a);
+        vector<char> buf(4096);
+        for (int i = 0; i < (int)buf.size(); i++) {
+            buf[i] = (char)(rand() % 3);
+        }
+
+        char* end = &buf[0] + buf.size();
+        for (char* p = &buf[0]; p < end;) {
+            char* expect = mock_find_annexb(p, end);
+            EXPECT_EQ(expect, srs_avc_find_annexb_scalar(p, end));
+#ifdef SRS_AVC_ANNEXB_SIMD
+            EXPECT_EQ(expect, srs_avc_find_annexb_sse2(p, end));
+            if (srs_cpu_supports_avx2()) {
+                EXPECT_EQ(expect, srs_avc_find_annexb_avx2(p, end));
+            }
+#endif
+            p = (expect == end)? end : expect + 1;
+        }
+    }
+}
+
+// Split all NALUs in bytes, return the number of NALUs.
+static int mock_split_annexb(char* (*find)(char*, char*), char* p, char* end)
+{
+    int nn = 0;
+    while (p < end) {
+        char* q = find(p, end);
+        if (q == end) {
+            break;
+        }
+        nn++;
+        p = q + 3;
+    }
+    return nn;
+}
+
+VOID TEST(SrsAVCTest, H264FindAnnexbBenchmark)
+{
+    srs_error_t err;
+
+    string annexb;
+    int nn_nalus = 0;
+
+    // Convert the video of captured stream to annexb.
+    SrsFileReader fr;
+    if ((err = fr.open("doc/source.flv")) != srs_success) {
+        srs_freep(err);
+
+        // Use random NALUs if no captured stream.
+        srand(0x5a);
+        for (int i = 0; i < 300; i++) {
+            annexb.append("\x00\x00\x00\x01", 4);
+            int nb_nalu = 100 + rand() % 20000;
+            for (int j = 0; j < nb_nalu; j++) {
+                annexb.push_back((char)(2 + rand() % 254));
+            }
+            nn_nalus++;
+        }
+    }
+
+    SrsFlvDecoder dec;
+    char header[9], pts[4];
+    if (annexb.empty()) {
+        HELPER_ASSERT_SUCCESS(dec.initialize(&fr));
+        HELPER_ASSERT_SUCCESS(dec.read_header(header));
+        HELPER_ASSERT_SUCCESS(dec.read_previous_tag_size(pts));
+    }
+
+    while (fr.is_open()) {
+        char type = 0; int32_t size = 0; uint32_t time = 0;
+        if ((err = dec.read_tag_header(&type, &size, &time)) != srs_success) {
+            srs_freep(err);
+            break;
+        }
+
+        vector<char> data(size + 1);
+        HELPER_ASSERT_SUCCESS(dec.read_tag_data(&data[0], size));
+        HELPER_ASSERT_SUCCESS(dec.read_previous_tag_size(pts));
+
+        // Only AVC NALUs, which is in IBMF format with 4 bytes size.
+        if (type != SrsFrameTypeVideo || size <= 5 || data[1] != SrsVideoAvcFrameTraitNALU) {
+            continue;
+        }
+
+        SrsBuffer b(&data[5], size - 5);
+        while (b.require(4)) {
+            int nb_nalu = b.read_4bytes();
+            if (nb_nalu <= 0 || !b.require(nb_nalu)) {
+                break;
+            }
+            annexb.append("\x00\x00\x00\x01", 4);
+            annexb.append(b.data() + b.pos(), nb_nalu);
+            b.skip(nb_nalu);
+            nn_nalus++;
+        }
+    }
+    if (annexb.empty()) {
+        return;
+    }
+
+    char* p = (char*)annexb.data();
+    char* end = p + annexb.length();
+
+    const char* names[] = {"scalar", "sse2", "avx2"};
+    char* (*finds[])(char*, char*) = {
+        srs_avc_find_annexb_scalar,
+#ifdef SRS_AVC_ANNEXB_SIMD
+        srs_avc_find_annexb_sse2, srs_avc_find_annexb_avx2,
+#endif
+    };
+    int nn_finds = sizeof(finds) / sizeof(finds[0]);
+#ifdef SRS_AVC_ANNEXB_SIMD
+    if (!srs_cpu_supports_avx2()) {
+        nn_finds--;
+    }
+#endif
+
+    // The start code might be emulated in NALU, so there might be more NALUs.
+    int expect = mock_split_annexb(mock_find_annexb, p, end);
+    EXPECT_LE(nn_nalus, expect);
+
+    const int nn_loops = 10;
+    for (int i = 0; i < nn_finds; i++) {
+        srs_utime_t starttime = srs_update_system_time();
+        for (int j = 0; j < nn_loops; j++) {
+            EXPECT_EQ(expect, mock_split_annexb(finds[i], p, end));
+        }
+        srs_utime_t cost = srs_update_system_time() - starttime;
+
+        printf("Annexb split %d NALUs in %dKB by %s, %.2fMB/s\n", expect, (int)annexb.length() / 1024, names[i],
+            (annexb.length() * nn_loops / 1024.0 / 1024) / (srs_max(1, cost) / 1000000.0));
+    }
+}
+
 VOID TEST(SrsAVCTest, H264SequenceHeader)
 {
     srs_error_t err;
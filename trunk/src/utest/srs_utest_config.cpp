@@ -2023,6 +2023,40 @@ VOID TEST(ConfigUnitTest, CheckDefaultValuesVhost)
 	    EXPECT_EQ(10 * SRS_UTIME_MILLISECONDS, conf.get_send_min_interval("v"));
     }
 
+    if (true) {
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+	    EXPECT_EQ(0, conf.get_gop_cache_max_size(""));
+	    EXPECT_EQ(0, conf.get_gop_cache_max_duration(""));
+
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{play{gop_cache_max_size 2048;gop_cache_max_duration 10;}}"));
+	    EXPECT_EQ(2048 * 1024, conf.get_gop_cache_max_size("v"));
+	    EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_gop_cache_max_duration("v"));
+    }
+
+    if (true) {
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+	    EXPECT_FALSE(conf.get_shm_fanout_enabled(""));
+	    EXPECT_STREQ("/dev/shm", conf.get_shm_fanout_dir("").c_str());
+	    EXPECT_EQ(8 * 1024 * 1024, conf.get_shm_fanout_size(""));
+
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{shm_fanout{enabled on;dir /tmp;size 1024;}}"));
+	    EXPECT_TRUE(conf.get_shm_fanout_enabled("v"));
+	    EXPECT_STREQ("/tmp", conf.get_shm_fanout_dir("v").c_str());
+	    EXPECT_EQ(1024 * 1024, conf.get_shm_fanout_size("v"));
+
+	    HELPER_ASSERT_FAILED(conf.parse(_MIN_OK_CONF "vhost v{shm_fanout{xxx on;}}"));
+    }
+
+    if (true) {
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+	    EXPECT_FALSE(conf.get_vhost_edge_hot_standby(""));
+	    EXPECT_STREQ("round_robin", conf.get_vhost_edge_load_balance("").c_str());
+
+	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v{cluster{mode remote;origin 127.0.0.1 127.0.0.2;hot_standby on;load_balance fastest;}}"));
+	    EXPECT_TRUE(conf.get_vhost_edge_hot_standby("v"));
+	    EXPECT_STREQ("fastest", conf.get_vhost_edge_load_balance("v").c_str());
+    }
+
     if (true) {
 	    HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
 	    EXPECT_EQ(0, (int)conf.get_vhost_http_remux_fast_cache(""));
@@ -2875,6 +2909,26 @@ VOID TEST(ConfigMainTest, CheckStreamCaster)
 
         EXPECT_EQ(8080, conf.get_stream_caster_rtp_port_max(arr.at(0)));
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "stream_caster;"));
+
+        vector<SrsConfDirective*> arr = conf.get_stream_casters();
+        ASSERT_EQ(1, (int)arr.size());
+
+        EXPECT_EQ(30 * SRS_UTIME_SECONDS, conf.get_stream_caster_idle_timeout(arr.at(0)));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "stream_caster {idle_timeout 10;}"));
+
+        vector<SrsConfDirective*> arr = conf.get_stream_casters();
+        ASSERT_EQ(1, (int)arr.size());
+
+        EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_stream_caster_idle_timeout(arr.at(0)));
+    }
 }
 
 VOID TEST(ConfigMainTest, CheckVhostConfig2)
@@ -3549,6 +3603,22 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
         EXPECT_STREQ("xxx3", conf.get_hls_key_url("ossrs.net").c_str());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{hls_ll on;hls_part_duration 0.3;}}"));
+        EXPECT_TRUE(conf.get_hls_ll("ossrs.net"));
+        EXPECT_EQ(300*SRS_UTIME_MILLISECONDS, conf.get_hls_part_duration("ossrs.net"));
+        EXPECT_FALSE(conf.get_hls_ll("other.net"));
+        EXPECT_EQ(500*SRS_UTIME_MILLISECONDS, conf.get_hls_part_duration("other.net"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hls{hls_fmp4 on;}}"));
+        EXPECT_TRUE(conf.get_hls_fmp4("ossrs.net"));
+        EXPECT_FALSE(conf.get_hls_fmp4("other.net"));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{hds{enabled on;hds_path xxx;hds_fragment 10;hds_window 10;}}"));
@@ -3570,6 +3640,15 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
         EXPECT_EQ(1, (int)conf.get_dvr_time_jitter("ossrs.net"));
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost ossrs.net{dvr{dvr_fmp4 on;dvr_fmp4_fragment 1.5;}}"));
+        EXPECT_TRUE(conf.get_dvr_fmp4("ossrs.net"));
+        EXPECT_EQ(1500*SRS_UTIME_MILLISECONDS, conf.get_dvr_fmp4_fragment("ossrs.net"));
+        EXPECT_FALSE(conf.get_dvr_fmp4("other.net"));
+        EXPECT_EQ(2*SRS_UTIME_SECONDS, conf.get_dvr_fmp4_fragment("other.net"));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_api{enabled on;listen xxx;crossdomain off;raw_api {enabled on;allow_reload on;allow_query on;allow_update on;}}"));
@@ -3625,3 +3704,209 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
     }
 }
 
+VOID TEST(ConfigMainTest, VhostConfigSnapshot)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v1{atc on;} vhost v2{reduce_sequence_header on; queue_length 20;}"));
+
+        EXPECT_TRUE(conf.get_vhost("v1") != NULL);
+        EXPECT_TRUE(conf.get_vhost("v2") != NULL);
+        EXPECT_TRUE(conf.get_vhost("v3") == NULL);
+
+        SrsVhostConfig* v1 = conf.get_vhost_config("v1");
+        EXPECT_TRUE(v1->enabled);
+        EXPECT_TRUE(v1->atc);
+        EXPECT_FALSE(v1->reduce_sequence_header);
+        EXPECT_TRUE(v1->parse_sps);
+        EXPECT_TRUE(v1->rtc_nack_enabled);
+        EXPECT_TRUE(v1->rtc_nack_no_copy);
+        EXPECT_EQ(conf.get_mw_msgs("v1", v1->rtc_realtime, true), v1->rtc_mw_msgs);
+
+        SrsVhostConfig* v2 = conf.get_vhost_config("v2");
+        EXPECT_FALSE(v2->atc);
+        EXPECT_TRUE(v2->reduce_sequence_header);
+        EXPECT_EQ(20 * SRS_UTIME_SECONDS, v2->queue_length);
+
+        // Use the default values, when vhost not found.
+        SrsVhostConfig* v3 = conf.get_vhost_config("v3");
+        EXPECT_FALSE(v3->enabled);
+        EXPECT_EQ(conf.get_queue_length("v3"), v3->queue_length);
+    }
+
+    // Fallback to the default vhost.
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost __defaultVhost__{atc on;} vhost v1{atc off;}"));
+
+        EXPECT_TRUE(conf.get_vhost("v2") == conf.get_vhost("__defaultVhost__"));
+        EXPECT_TRUE(conf.get_vhost("v2", false) == NULL);
+        EXPECT_TRUE(conf.get_vhost_config("v2")->atc);
+        EXPECT_FALSE(conf.get_vhost_config("v1")->atc);
+    }
+
+    // Rebuild the vhosts when config changed.
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v1{atc on;}"));
+
+        uint64_t generation = conf.generation();
+        EXPECT_TRUE(conf.get_vhost_config("v1")->enabled);
+
+        bool applied = false;
+        HELPER_EXPECT_SUCCESS(conf.raw_create_vhost("v2", applied));
+        EXPECT_TRUE(applied);
+        EXPECT_NE(generation, conf.generation());
+        EXPECT_TRUE(conf.get_vhost("v2", false) != NULL);
+        EXPECT_TRUE(conf.get_vhost_config("v2")->enabled);
+
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "vhost v1{atc off;}"));
+        EXPECT_TRUE(conf.get_vhost("v2", false) == NULL);
+        EXPECT_FALSE(conf.get_vhost_config("v1")->atc);
+    }
+}
+
+VOID TEST(ConfigMainTest, CoroutineStack)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_EQ(1024, conf.get_coroutine_stack_pool());
+        EXPECT_FALSE(conf.get_coroutine_stack_guard());
+        EXPECT_FALSE(conf.get_coroutine_stack_watermark());
+        EXPECT_TRUE(conf.get_coroutine_stack_sizes() == NULL);
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "coroutine_stack{pool -1; guard on; watermark on; sizes{rtc_sender 131072; pli 32768;}}"));
+        EXPECT_EQ(-1, conf.get_coroutine_stack_pool());
+        EXPECT_TRUE(conf.get_coroutine_stack_guard());
+        EXPECT_TRUE(conf.get_coroutine_stack_watermark());
+
+        SrsConfDirective* sizes = conf.get_coroutine_stack_sizes();
+        ASSERT_TRUE(sizes != NULL);
+        EXPECT_EQ(2, (int)sizes->directives.size());
+        EXPECT_STREQ("rtc_sender", sizes->at(0)->name.c_str());
+        EXPECT_STREQ("131072", sizes->at(0)->arg0().c_str());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "coroutine_stack{size 1;}"));
+    }
+
+    // Reject the illegal stack sizes.
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "coroutine_stack{sizes{rtc_sender 64KB;}}"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "coroutine_stack{sizes{rtc_sender -65536;}}"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "coroutine_stack{sizes{rtc_sender 16384;}}"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "coroutine_stack{sizes{rtc_sender 65537;}}"));
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "coroutine_stack{sizes{rtc_sender 134217728;}}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, CircuitBreakerLimits)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_EQ(0, conf.get_lag_limit());
+        EXPECT_EQ(0, conf.get_memory_limit());
+        EXPECT_EQ(0, conf.get_queue_limit());
+        EXPECT_EQ(0, conf.get_sndbuf_limit());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "circuit_breaker{lag_limit 200; memory_limit 4096; queue_limit 10000; sndbuf_limit 5000;}"));
+        EXPECT_EQ(200 * SRS_UTIME_MILLISECONDS, conf.get_lag_limit());
+        EXPECT_EQ(4096, conf.get_memory_limit());
+        EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_queue_limit());
+        EXPECT_EQ(5000, conf.get_sndbuf_limit());
+    }
+}
+
+VOID TEST(ConfigMainTest, HttpApiMetrics)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_http_api_metrics_enabled());
+        EXPECT_EQ(3, (int)conf.get_http_api_metrics_labels().size());
+        EXPECT_EQ(1000, conf.get_http_api_metrics_max_streams());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_api{metrics{enabled on; labels vhost app; max_streams 100;}}"));
+        EXPECT_TRUE(conf.get_http_api_metrics_enabled());
+        EXPECT_EQ(2, (int)conf.get_http_api_metrics_labels().size());
+        EXPECT_EQ(100, conf.get_http_api_metrics_max_streams());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "http_api{metrics{labels vhost client;}}"));
+    }
+}
+
+VOID TEST(ConfigMainTest, Admission)
+{
+    srs_error_t err;
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_FALSE(conf.get_admission_enabled());
+        EXPECT_EQ(1000, conf.get_admission_rate());
+        EXPECT_EQ(2000, conf.get_admission_burst());
+        EXPECT_EQ(10, conf.get_admission_ip_rate());
+        EXPECT_EQ(30, conf.get_admission_ip_burst());
+        EXPECT_EQ(10000, conf.get_admission_max_deferred());
+        EXPECT_EQ(3 * SRS_UTIME_SECONDS, conf.get_admission_defer_timeout());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "admission{enabled on; rate 100; burst 200; ip_rate 1; ip_burst 3; max_deferred 50; defer_timeout 1000;}"));
+        EXPECT_TRUE(conf.get_admission_enabled());
+        EXPECT_EQ(100, conf.get_admission_rate());
+        EXPECT_EQ(200, conf.get_admission_burst());
+        EXPECT_EQ(1, conf.get_admission_ip_rate());
+        EXPECT_EQ(3, conf.get_admission_ip_burst());
+        EXPECT_EQ(50, conf.get_admission_max_deferred());
+        EXPECT_EQ(1 * SRS_UTIME_SECONDS, conf.get_admission_defer_timeout());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "admission{ips 1;}"));
+    }
+}
+
@@ -22,6 +22,8 @@ using namespace std;
 #include <srs_kernel_mp4.hpp>
 #include <srs_core_autofree.hpp>
 
+#include <openssl/evp.h>
+
 #define MAX_MOCK_DATA_SIZE 1024 * 1024
 
 MockSrsFile::MockSrsFile()
@@ -602,6 +604,64 @@ VOID TEST(KernelCodecTest, IsH264)
     EXPECT_FALSE(SrsFlvVideo::h264(&data, 1));
 }
 
+/**
+* test the codec,
+* whether disposable frame, which is never referenced
+*/
+VOID TEST(KernelCodecTest, IsDisposable)
+{
+    if (true) {
+        char data = 0x37;
+        EXPECT_TRUE(SrsFlvVideo::disposable(&data, 1, 3));
+        EXPECT_FALSE(SrsFlvVideo::disposable(&data, 0, 3));
+    }
+
+    // H.264 B-frame, nal_ref_idc is 0.
+    if (true) {
+        uint8_t data[] = {0x27, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x01, 0x88};
+        EXPECT_TRUE(SrsFlvVideo::disposable((char*)data, sizeof(data), 3));
+        EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data) - 1, 3));
+    }
+
+    // H.264 P-frame, nal_ref_idc is 2.
+    if (true) {
+        uint8_t data[] = {0x27, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x41, 0x88};
+        EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data), 3));
+    }
+
+    // H.264 B-frame with 2bytes NALU length.
+    if (true) {
+        uint8_t data[] = {0x27, 0x01, 0x00, 0x00, 0x00, 0x00, 0x02, 0x09, 0xf0, 0x00, 0x02, 0x01, 0x88};
+        EXPECT_TRUE(SrsFlvVideo::disposable((char*)data, sizeof(data), 1));
+        EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data), 3));
+        EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data) - 1, 1));
+        data[11] = 0x41;
+        EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data), 1));
+    }
+
+    // The NALU length is unknown, only check the frame type.
+    if (true) {
+        uint8_t data[] = {0x27, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x01, 0x88};
+        EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data), -1));
+        data[0] = 0x37;
+        EXPECT_TRUE(SrsFlvVideo::disposable((char*)data, sizeof(data), -1));
+    }
+
+    // H.264 B-frame after AUD.
+    if (true) {
+        uint8_t data[] = {0x27, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x09, 0xf0, 0x00, 0x00, 0x00, 0x02, 0x01, 0x88};
+        EXPECT_TRUE(SrsFlvVideo::disposable((char*)data, sizeof(data), 3));
+    }
+
+    // H.264 keyframe and sequence header.
+    if (true) {
+        uint8_t data[] = {0x17, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x05, 0x88};
+        EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data), 3));
+        data[0] = 0x27; data[1] = 0x00;
+        EXPECT_FALSE(SrsFlvVideo::disposable((char*)data, sizeof(data), 3));
+    }
+}
+
 /**
 * test the codec,
 * whether H.264 video sequence header
@@ -1609,6 +1669,101 @@ VOID TEST(KernelFLVTest, CoverFLVVodError)
 /**
 * test the stream utility, access pos
 */
+VOID TEST(KernelFLVTest, PayloadPool)
+{
+    // The size class is 1/4 of power of 2.
+    if (true) {
+        SrsPayloadPool pool(2 * 1024 * 1024, 1024 * 1024);
+
+        int clazz = -1;
+        char* p = pool.alloc(100, &clazz);
+        EXPECT_EQ(0, clazz);
+        pool.free(p, clazz);
+        EXPECT_EQ(512, pool.cached_bytes());
+
+        p = pool.alloc(513, &clazz);
+        EXPECT_EQ(1, clazz);
+        pool.free(p, clazz);
+        EXPECT_EQ(512 + 640, pool.cached_bytes());
+
+        p = pool.alloc(1024 * 1024, &clazz);
+        EXPECT_NE(-1, clazz);
+        pool.free(p, clazz);
+
+        // Large payload never use pool.
+        p = pool.alloc(1024 * 1024 + 1, &clazz);
+        EXPECT_EQ(-1, clazz);
+        pool.free(p, clazz);
+        EXPECT_EQ(512 + 640 + 1024 * 1024, pool.cached_bytes());
+    }
+
+    // Reuse the payload in the same size class.
+    if (true) {
+        SrsPayloadPool pool(1024 * 1024, 1024 * 1024);
+
+        int clazz = -1;
+        char* p0 = pool.alloc(1000, &clazz);
+        pool.free(p0, clazz);
+        EXPECT_EQ(0, pool.nn_hit);
+        EXPECT_EQ(1, pool.nn_miss);
+
+        char* p1 = pool.alloc(900, &clazz);
+        EXPECT_EQ(p0, p1);
+        EXPECT_EQ(1, pool.nn_hit);
+        EXPECT_EQ(0, pool.cached_bytes());
+        pool.free(p1, clazz);
+    }
+
+    // Free to heap when pool is full.
+    if (true) {
+        SrsPayloadPool pool(1024, 1024 * 1024);
+
+        int c0 = -1, c1 = -1;
+        char* p0 = pool.alloc(1000, &c0);
+        char* p1 = pool.alloc(1000, &c1);
+        pool.free(p0, c0);
+        pool.free(p1, c1);
+        EXPECT_EQ(1024, pool.cached_bytes());
+    }
+
+    // Disabled pool.
+    if (true) {
+        SrsPayloadPool pool(0, 1024 * 1024);
+
+        int clazz = 0;
+        char* p = pool.alloc(1000, &clazz);
+        EXPECT_EQ(-1, clazz);
+        pool.free(p, clazz);
+        EXPECT_EQ(0, pool.cached_bytes());
+    }
+
+    // The payload of common message is transfered to shared message, and freed when the last one is freed.
+    if (true) {
+        SrsPayloadPool* pool = _srs_payload_pool;
+        SrsPayloadPool mock(1024 * 1024, 1024 * 1024);
+        _srs_payload_pool = &mock;
+
+        SrsCommonMessage* msg = new SrsCommonMessage();
+        msg->create_payload(1000);
+        msg->size = 1000;
+        msg->header.initialize_video(1000, 0, 1);
+
+        SrsSharedPtrMessage* m0 = new SrsSharedPtrMessage();
+        EXPECT_TRUE(srs_success == m0->create(msg));
+        srs_freep(msg);
+        EXPECT_EQ(0, mock.cached_bytes());
+
+        SrsSharedPtrMessage* m1 = m0->copy();
+        srs_freep(m0);
+        EXPECT_EQ(0, mock.cached_bytes());
+
+        srs_freep(m1);
+        EXPECT_EQ(1024, mock.cached_bytes());
+
+        _srs_payload_pool = pool;
+    }
+}
+
 VOID TEST(KernelStreamTest, StreamPos)
 {
     char data[1024];
@@ -3201,6 +3356,35 @@ VOID TEST(KernelLBRRTest, CoverAll)
     }
 }
 
+VOID TEST(KernelLBRRTest, Fastest)
+{
+    vector<string> servers;
+    servers.push_back("s0");
+    servers.push_back("s1");
+    servers.push_back("s2");
+
+    SrsLbFastest lb;
+    EXPECT_EQ(-1, lb.latency("s0"));
+
+    // Measure all servers first.
+    EXPECT_TRUE("s0" == lb.select(servers));
+    lb.sample("s0", 100 * SRS_UTIME_MILLISECONDS);
+    EXPECT_TRUE("s1" == lb.select(servers));
+    lb.sample("s1", 50 * SRS_UTIME_MILLISECONDS);
+    EXPECT_TRUE("s2" == lb.select(servers));
+    lb.sample("s2", 80 * SRS_UTIME_MILLISECONDS);
+
+    // Always select the fastest one.
+    EXPECT_TRUE("s1" == lb.select(servers));
+    EXPECT_EQ(1, (int)lb.current());
+    EXPECT_TRUE("s1" == lb.select(servers));
+
+    // Penalty for failure, switch to the next fastest.
+    lb.sample("s1", 5 * SRS_UTIME_SECONDS);
+    EXPECT_EQ((50 * 3 + 5000) * SRS_UTIME_MILLISECONDS / 4, lb.latency("s1"));
+    EXPECT_TRUE("s2" == lb.select(servers));
+}
+
 VOID TEST(KernelCodecTest, CoverAll)
 {
     if (true) {
@@ -3829,6 +4013,99 @@ VOID TEST(KernelCodecTest, VideoFormat)
     }
 }
 
+VOID TEST(KernelCodecTest, HEVCVideoFormat)
+{
+    srs_error_t err;
+    
+    uint8_t hvcc720p[] = {
+        0x1c, 0x00, 0x00, 0x00, 0x00,
+        // HEVCDecoderConfigurationRecord, Main profile, level 3.1, lengthSizeMinusOne 3.
+        0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5d, 0xf0, 0x00, 0xfc,
+        0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f, 0x03,
+        // VPS
+        0xa0, 0x00, 0x01, 0x00, 0x18,
+        0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03,
+        0x00, 0x00, 0x03, 0x00, 0x5d, 0x95, 0x98, 0x09,
+        // SPS
+        0xa1, 0x00, 0x01, 0x00, 0x18,
+        0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+        0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2d, 0x14,
+        // PPS
+        0xa2, 0x00, 0x01, 0x00, 0x07,
+        0x44, 0x01, 0xc1, 0x72, 0xb4, 0x62, 0x40
+    };
+    uint8_t hvcc1080p[] = {
+        0x1c, 0x00, 0x00, 0x00, 0x00,
+        // HEVCDecoderConfigurationRecord, Main profile, level 3.1, lengthSizeMinusOne 3.
+        0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5d, 0xf0, 0x00, 0xfc,
+        0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f, 0x03,
+        // VPS
+        0xa0, 0x00, 0x01, 0x00, 0x18,
+        0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03,
+        0x00, 0x00, 0x03, 0x00, 0x5d, 0x95, 0x98, 0x09,
+        // SPS
+        0xa1, 0x00, 0x01, 0x00, 0x19,
+        0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+        0x00, 0x5d, 0xa0, 0x03, 0xc0, 0x80, 0x11, 0x07, 0xcb,
+        // PPS
+        0xa2, 0x00, 0x01, 0x00, 0x07,
+        0x44, 0x01, 0xc1, 0x72, 0xb4, 0x62, 0x40
+    };
+    // The IDR_W_RADL frame.
+    uint8_t raw[] = {
+        0x1c, 0x01, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x08, 0x26, 0x01, 0xaf, 0x06, 0xb8, 0x63, 0xef, 0x3a
+    };
+    
+    if (true) {
+        SrsFormat f;
+        HELPER_EXPECT_SUCCESS(f.initialize());
+        
+        EXPECT_TRUE(SrsFlvVideo::hevc((char*)hvcc720p, sizeof(hvcc720p)));
+        EXPECT_TRUE(SrsFlvVideo::sh((char*)hvcc720p, sizeof(hvcc720p)));
+        EXPECT_TRUE(SrsFlvVideo::acceptable((char*)hvcc720p, sizeof(hvcc720p)));
+        EXPECT_FALSE(SrsFlvVideo::h264((char*)hvcc720p, sizeof(hvcc720p)));
+        
+        HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)hvcc720p, sizeof(hvcc720p)));
+        EXPECT_TRUE(f.is_avc_sequence_header());
+        EXPECT_EQ(SrsVideoCodecIdHEVC, f.vcodec->id);
+        EXPECT_EQ(SrsHevcProfileMain, f.vcodec->hevc_profile);
+        EXPECT_EQ(SrsHevcLevel_31, f.vcodec->hevc_level);
+        EXPECT_STREQ("3.1", srs_hevc_level2str(f.vcodec->hevc_level).c_str());
+        EXPECT_EQ(3, f.vcodec->NAL_unit_length);
+        EXPECT_EQ(1280, f.vcodec->width);
+        EXPECT_EQ(720, f.vcodec->height);
+        EXPECT_EQ(24, (int)f.vcodec->videoParameterSetNALUnit.size());
+        EXPECT_EQ(24, (int)f.vcodec->sequenceParameterSetNALUnit.size());
+        EXPECT_EQ(7, (int)f.vcodec->pictureParameterSetNALUnit.size());
+        
+        HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)raw, sizeof(raw)));
+        EXPECT_EQ(1, f.video->nb_samples);
+        EXPECT_TRUE(f.video->has_idr);
+        EXPECT_FALSE(f.video->has_aud);
+        EXPECT_FALSE(f.video->has_sps_pps);
+    }
+    
+    // The 1920x1088 is cropped to 1920x1080 by conformance window.
+    if (true) {
+        SrsFormat f;
+        HELPER_EXPECT_SUCCESS(f.initialize());
+        
+        HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)hvcc1080p, sizeof(hvcc1080p)));
+        EXPECT_EQ(1920, f.vcodec->width);
+        EXPECT_EQ(1080, f.vcodec->height);
+    }
+    
+    // Error for truncated hvcC.
+    if (true) {
+        SrsFormat f;
+        HELPER_EXPECT_SUCCESS(f.initialize());
+        
+        HELPER_EXPECT_FAILED(f.on_video(0, (char*)hvcc720p, 20));
+        HELPER_EXPECT_FAILED(f.on_video(0, (char*)hvcc720p, 40));
+    }
+}
+
 VOID TEST(KernelFileTest, FileWriteReader)
 {
 	srs_error_t err;
@@ -4064,6 +4341,80 @@ VOID TEST(KernelFileWriterTest, WriteSpecialCase)
 	}
 }
 
+string mock_enc_data;
+int mock_enc_writes = 0;
+
+ssize_t mock_enc_write(int /*fildes*/, const void* buf, size_t nbyte) {
+	mock_enc_data.append((const char*)buf, nbyte);
+	mock_enc_writes++;
+	return nbyte;
+}
+
+VOID TEST(KernelFileWriterTest, EncFileWriter)
+{
+	srs_error_t err;
+
+	unsigned char key[16], iv[16];
+	for (int i = 0; i < 16; i++) {
+		key[i] = (unsigned char)i;
+		iv[i] = (unsigned char)(0xf0 + i);
+	}
+
+	char plain[SRS_TS_PACKET_SIZE * 5];
+	for (int i = 0; i < (int)sizeof(plain); i++) {
+		plain[i] = (char)i;
+	}
+
+	// Should fail if no key.
+	if (true) {
+		SrsEncFileWriter f;
+		HELPER_EXPECT_SUCCESS(f.open("/dev/null"));
+		HELPER_EXPECT_FAILED(f.write(plain, sizeof(plain), NULL));
+	}
+
+	// Each write or writev is encrypted and written once, padded by PKCS7 when close.
+	for (int nn_plain = (int)sizeof(plain) - 4; nn_plain <= (int)sizeof(plain); nn_plain += 4) {
+		mock_enc_data = "";
+		mock_enc_writes = 0;
+		MockSystemIO _mockio(NULL, mock_enc_write);
+
+		SrsEncFileWriter f;
+		HELPER_EXPECT_SUCCESS(f.open("/dev/null"));
+		HELPER_EXPECT_SUCCESS(f.config_cipher(key, iv));
+
+		ssize_t nn = 0;
+		HELPER_EXPECT_SUCCESS(f.write(plain, SRS_TS_PACKET_SIZE, &nn));
+		EXPECT_EQ(SRS_TS_PACKET_SIZE, nn);
+		EXPECT_EQ(1, mock_enc_writes);
+
+		iovec iovs[2];
+		iovs[0].iov_base = plain + SRS_TS_PACKET_SIZE;
+		iovs[0].iov_len = SRS_TS_PACKET_SIZE;
+		iovs[1].iov_base = plain + SRS_TS_PACKET_SIZE * 2;
+		iovs[1].iov_len = nn_plain - SRS_TS_PACKET_SIZE * 2;
+		HELPER_EXPECT_SUCCESS(f.writev(iovs, 2, &nn));
+		EXPECT_EQ(nn_plain - SRS_TS_PACKET_SIZE, nn);
+		EXPECT_EQ(2, mock_enc_writes);
+
+		f.close();
+		EXPECT_EQ(3, mock_enc_writes);
+		EXPECT_EQ((nn_plain / 16 + 1) * 16, (int)mock_enc_data.length());
+
+		// Decrypt and compare with the plain text.
+		EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+		EXPECT_EQ(1, EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv));
+
+		vector<unsigned char> out(mock_enc_data.length() + 16);
+		int nn_out = 0, nn_final = 0;
+		EXPECT_EQ(1, EVP_DecryptUpdate(ctx, &out[0], &nn_out, (const unsigned char*)mock_enc_data.data(), (int)mock_enc_data.length()));
+		EXPECT_EQ(1, EVP_DecryptFinal_ex(ctx, &out[0] + nn_out, &nn_final));
+		EVP_CIPHER_CTX_free(ctx);
+
+		EXPECT_EQ(nn_plain, nn_out + nn_final);
+		EXPECT_TRUE(srs_bytes_equals(&out[0], plain, nn_plain));
+	}
+}
+
 VOID TEST(KernelFileReaderTest, WriteSpecialCase)
 {
 	srs_error_t err;
@@ -4799,7 +5150,7 @@ VOID TEST(KernelTSTest, CoverContextEncode)
         srs_error_t err = ctx.encode(&f, &m, SrsVideoCodecIdDisabled, SrsAudioCodecIdDisabled);
         HELPER_EXPECT_FAILED(err);
         
-        err = ctx.encode(&f, &m, SrsVideoCodecIdHEVC, SrsAudioCodecIdOpus);
+        err = ctx.encode(&f, &m, SrsVideoCodecIdOn2VP6, SrsAudioCodecIdOpus);
         HELPER_EXPECT_FAILED(err);
 
         err = ctx.encode(&f, &m, SrsVideoCodecIdAV1, SrsAudioCodecIdOpus);
@@ -4830,6 +5181,294 @@ VOID TEST(KernelTSTest, CoverContextEncode)
     }
 }
 
+// The writer to count bytes, for benchmark.
+class MockTsCountWriter : public ISrsStreamWriter
+{
+public:
+    int64_t nn_bytes;
+    int nn_writes;
+public:
+    MockTsCountWriter() {
+        nn_bytes = 0;
+        nn_writes = 0;
+    }
+    virtual ~MockTsCountWriter() {
+    }
+public:
+    virtual srs_error_t write(void* /*buf*/, size_t size, ssize_t* nwrite) {
+        nn_bytes += size;
+        nn_writes++;
+        if (nwrite) {
+            *nwrite = size;
+        }
+        return srs_success;
+    }
+};
+
+VOID TEST(KernelTSTest, EncodePESPackets)
+{
+    srs_error_t err;
+
+    // The packets must be identical to the reference encoder, for all size of PES.
+    int sizes[] = {1, 2, 3, 160, 161, 162, 163, 164, 165, 166, 168, 169, 170, 171, 175, 176, 177, 183, 184, 185,
+        340, 350, 351, 352, 353, 354, 355, 356, 357, 358, 4096, 65535, 65536, 100000};
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+        for (int j = 0; j < 4; j++) {
+            SrsTsMessage m;
+            m.sid = SrsTsPESStreamIdVideoCommon;
+            m.dts = 90000;
+            m.pts = (j & 0x01)? 90000 + 3600 : 90000;
+            m.write_pcr = (j & 0x02);
+            m.is_discontinuity = (j == 3);
+
+            string payload(sizes[i], 0);
+            for (int k = 0; k < sizes[i]; k++) {
+                payload[k] = (char)k;
+            }
+            m.payload->append(payload.data(), (int)payload.length());
+
+            MockSrsFileWriter f0, f1;
+            SrsTsContext c0, c1;
+            HELPER_ASSERT_SUCCESS(c0.encode_pat_pmt(&f0, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+            HELPER_ASSERT_SUCCESS(c1.encode_pat_pmt(&f1, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+
+            // Encode twice, to check the continuity counter.
+            for (int k = 0; k < 2; k++) {
+                HELPER_ASSERT_SUCCESS(c0.encode_pes_packets(&f0, &m, 0x100, SrsTsStreamVideoH264, false));
+                HELPER_ASSERT_SUCCESS(c1.encode_pes(&f1, &m, 0x100, SrsTsStreamVideoH264, false));
+            }
+
+            ASSERT_EQ(f0.filesize(), f1.filesize()) << "size=" << sizes[i];
+            EXPECT_TRUE(0 == memcmp(f0.data(), f1.data(), (size_t)f0.filesize())) << "size=" << sizes[i] << ", j=" << j;
+        }
+    }
+
+    // Benchmark for a 1MB keyframe.
+    if (true) {
+        SrsTsMessage m;
+        m.sid = SrsTsPESStreamIdVideoCommon;
+        m.write_pcr = true;
+        string payload(1024 * 1024, 'x');
+        m.payload->append(payload.data(), (int)payload.length());
+
+        MockTsCountWriter w0, w1;
+        SrsTsContext c0, c1;
+        HELPER_ASSERT_SUCCESS(c0.encode_pat_pmt(&w0, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+        HELPER_ASSERT_SUCCESS(c1.encode_pat_pmt(&w1, 0x100, SrsTsStreamVideoH264, 0x101, SrsTsStreamAudioAAC));
+        w0.nn_writes = w1.nn_writes = 0;
+
+        const int nn_frames = 30;
+        srs_utime_t starttime = srs_update_system_time();
+        for (int i = 0; i < nn_frames; i++) {
+            HELPER_ASSERT_SUCCESS(c0.encode_pes_packets(&w0, &m, 0x100, SrsTsStreamVideoH264, false));
+        }
+        srs_utime_t packets_cost = srs_update_system_time() - starttime;
+
+        starttime = srs_update_system_time();
+        for (int i = 0; i < nn_frames; i++) {
+            HELPER_ASSERT_SUCCESS(c1.encode_pes(&w1, &m, 0x100, SrsTsStreamVideoH264, false));
+        }
+        srs_utime_t cost = srs_update_system_time() - starttime;
+
+        EXPECT_EQ(w0.nn_bytes, w1.nn_bytes);
+        EXPECT_LT(w1.nn_writes * 100, w0.nn_writes);
+
+        printf("TS encode %dMB, packets %.2fMB/s in %d writes, packetizer %.2fMB/s in %d writes\n", nn_frames,
+            nn_frames / (srs_max(1, packets_cost) / 1000000.0), w0.nn_writes,
+            nn_frames / (srs_max(1, cost) / 1000000.0), w1.nn_writes);
+    }
+}
+
+// The handler to collect the size and dts of ts messages.
+class MockTsCollector : public ISrsTsHandler
+{
+public:
+    std::vector<int> sizes;
+    std::vector<int64_t> dts;
+    int64_t nn_bytes;
+    // The number of messages and the program_number, by the pid.
+    std::map<int, int> pids;
+    std::map<int, int> programs;
+public:
+    MockTsCollector() {
+        nn_bytes = 0;
+    }
+    virtual ~MockTsCollector() {
+    }
+public:
+    virtual srs_error_t on_ts_message(SrsTsMessage* m) {
+        sizes.push_back(m->payload->length());
+        dts.push_back(m->dts);
+        nn_bytes += m->payload->length();
+        pids[m->channel->pid]++;
+        programs[m->channel->pid] = m->channel->program;
+        return srs_success;
+    }
+};
+
+// Write the PSI packet, such as PAT or PMT, to a TS packet.
+srs_error_t mock_ts_write_psi(ISrsStreamWriter* writer, SrsTsPacket* pkt)
+{
+    srs_error_t err = srs_success;
+
+    char buf[SRS_TS_PACKET_SIZE];
+    int nb_buf = pkt->size();
+    memset(buf + nb_buf, 0xFF, SRS_TS_PACKET_SIZE - nb_buf);
+
+    SrsBuffer stream(buf, nb_buf);
+    if ((err = pkt->encode(&stream)) != srs_success) {
+        return srs_error_wrap(err, "encode");
+    }
+
+    return writer->write(buf, SRS_TS_PACKET_SIZE, NULL);
+}
+
+VOID TEST(KernelTSTest, DecodePESPackets)
+{
+    srs_error_t err;
+
+    // Demux the ts stream encoded by context, the PES is assembled to a pre-sized payload.
+    if (true) {
+        int frames[] = {1, 183, 184, 1000, 65535, 65536, 100000, 32};
+
+        MockSrsFileWriter f;
+        SrsTsContext enc;
+        for (int i = 0; i < (int)(sizeof(frames) / sizeof(int)); i++) {
+            SrsTsMessage m;
+            m.sid = SrsTsPESStreamIdVideoCommon;
+            m.dts = m.pts = 90000 + i * 3600;
+            m.write_pcr = (i == 0);
+            string payload(frames[i], (char)i);
+            m.payload->append(payload.data(), (int)payload.length());
+            HELPER_ASSERT_SUCCESS(enc.encode(&f, &m, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC));
+        }
+
+        SrsTsContext ctx;
+        MockTsCollector h;
+        for (int pos = 0; pos < f.filesize(); pos += SRS_TS_PACKET_SIZE) {
+            SrsBuffer stream(f.data() + pos, SRS_TS_PACKET_SIZE);
+            HELPER_ASSERT_SUCCESS(ctx.decode(&stream, &h));
+        }
+
+        // The last PES is reaped, for the PES_packet_length is not 0.
+        ASSERT_EQ((int)(sizeof(frames) / sizeof(int)), (int)h.sizes.size());
+        for (int i = 0; i < (int)h.sizes.size(); i++) {
+            EXPECT_EQ(frames[i], h.sizes[i]);
+            EXPECT_EQ(90000 + i * 3600, h.dts[i]);
+        }
+
+        SrsTsChannel* channel = ctx.get(0x100);
+        ASSERT_TRUE(channel != NULL);
+        EXPECT_EQ(32, channel->nn_last_msg);
+    }
+
+    // Benchmark for a 50Mbps stream, 1MB keyframe and 100KB frames.
+    if (true) {
+        MockSrsFileWriter f;
+        SrsTsContext enc;
+        for (int i = 0; i < 60; i++) {
+            SrsTsMessage m;
+            m.sid = SrsTsPESStreamIdVideoCommon;
+            m.dts = m.pts = 90000 + i * 3600;
+            m.write_pcr = true;
+            string payload((i % 30)? 100 * 1024 : 1024 * 1024, 'x');
+            m.payload->append(payload.data(), (int)payload.length());
+            HELPER_ASSERT_SUCCESS(enc.encode(&f, &m, SrsVideoCodecIdAVC, SrsAudioCodecIdAAC));
+        }
+
+        SrsTsContext ctx;
+        MockTsCollector h;
+        srs_utime_t starttime = srs_update_system_time();
+        for (int pos = 0; pos < f.filesize(); pos += SRS_TS_PACKET_SIZE) {
+            SrsBuffer stream(f.data() + pos, SRS_TS_PACKET_SIZE);
+            HELPER_ASSERT_SUCCESS(ctx.decode(&stream, &h));
+        }
+        srs_utime_t cost = srs_update_system_time() - starttime;
+
+        // The last PES whose PES_packet_length is 0, is not reaped until next unit start.
+        EXPECT_EQ(59, (int)h.sizes.size());
+        printf("TS decode %.2fMB in %d messages, %.2fMB/s\n", f.filesize() / 1024.0 / 1024,
+            (int)h.sizes.size(), f.filesize() / 1024.0 / 1024 / (srs_max(1, cost) / 1000000.0));
+    }
+
+    // Benchmark for a multiple programs stream, 4 programs of 15Mbps, about 2s and 60Mbps+ in total.
+    if (true) {
+        const int nn_programs = 4;
+        const int nn_frames = 50;
+
+        MockSrsFileWriter f;
+        SrsTsContext enc;
+        int64_t nn_payload = 0;
+        for (int i = 0; i < nn_frames; i++) {
+            // Write the PAT and PMTs of all programs every 1s.
+            if ((i % 25) == 0) {
+                SrsTsPacket* pat = SrsTsPacket::create_pat(&enc, 1, 0x1001);
+                SrsAutoFree(SrsTsPacket, pat);
+                for (int j = 1; j < nn_programs; j++) {
+                    ((SrsTsPayloadPAT*)pat->payload)->programs.push_back(new SrsTsPayloadPATProgram(j + 1, 0x1001 + j));
+                }
+                HELPER_ASSERT_SUCCESS(mock_ts_write_psi(&f, pat));
+
+                for (int j = 0; j < nn_programs; j++) {
+                    SrsTsPacket* pmt = SrsTsPacket::create_pmt(&enc, j + 1, 0x1001 + j,
+                        0x100 + j * 0x10, SrsTsStreamVideoH264, 0x101 + j * 0x10, SrsTsStreamAudioAAC);
+                    SrsAutoFree(SrsTsPacket, pmt);
+                    HELPER_ASSERT_SUCCESS(mock_ts_write_psi(&f, pmt));
+                }
+                enc.ready = true;
+            }
+
+            // Interleave the 300KB keyframe or 75KB frame, and two 400B audio frames of programs.
+            for (int j = 0; j < nn_programs; j++) {
+                SrsTsMessage m;
+                m.sid = SrsTsPESStreamIdVideoCommon;
+                m.dts = m.pts = 90000 + i * 3600;
+                m.write_pcr = (i % 25) == 0;
+                string payload((i % 25)? 75 * 1024 : 300 * 1024, (char)j);
+                m.payload->append(payload.data(), (int)payload.length());
+                HELPER_ASSERT_SUCCESS(enc.encode_pes(&f, &m, 0x100 + j * 0x10, SrsTsStreamVideoH264, false));
+                nn_payload += payload.length();
+
+                for (int k = 0; k < 2; k++) {
+                    SrsTsMessage a;
+                    a.sid = SrsTsPESStreamIdAudioCommon;
+                    a.dts = a.pts = 90000 + i * 3600 + k * 1800;
+                    string payload(400, (char)k);
+                    a.payload->append(payload.data(), (int)payload.length());
+                    HELPER_ASSERT_SUCCESS(enc.encode_pes(&f, &a, 0x101 + j * 0x10, SrsTsStreamAudioAAC, false));
+                    nn_payload += payload.length();
+                }
+            }
+        }
+
+        // The stream is 2s, so the bitrate is at least 50Mbps.
+        EXPECT_GE(f.filesize() * 8 / 2, 50 * 1000 * 1000);
+
+        SrsTsContext ctx;
+        MockTsCollector h;
+        srs_utime_t starttime = srs_update_system_time();
+        for (int pos = 0; pos < f.filesize(); pos += SRS_TS_PACKET_SIZE) {
+            SrsBuffer stream(f.data() + pos, SRS_TS_PACKET_SIZE);
+            HELPER_ASSERT_SUCCESS(ctx.decode(&stream, &h));
+        }
+        srs_utime_t cost = srs_update_system_time() - starttime;
+
+        // Each PID is demuxed to its program, and the last video PES whose PES_packet_length is 0 is not reaped.
+        EXPECT_EQ(nn_programs * 2, (int)h.pids.size());
+        for (int j = 0; j < nn_programs; j++) {
+            EXPECT_EQ(nn_frames - 1, h.pids[0x100 + j * 0x10]);
+            EXPECT_EQ(nn_frames * 2, h.pids[0x101 + j * 0x10]);
+            EXPECT_EQ(j + 1, h.programs[0x100 + j * 0x10]);
+            EXPECT_EQ(j + 1, h.programs[0x101 + j * 0x10]);
+        }
+        EXPECT_EQ(nn_payload - nn_programs * 75 * 1024, h.nn_bytes);
+
+        printf("TS decode %d programs %.2fMB in %d messages, %.2fMbps stream, %.2fMB/s\n", nn_programs,
+            f.filesize() / 1024.0 / 1024, (int)h.sizes.size(), f.filesize() * 8 / 2 / 1000000.0,
+            f.filesize() / 1024.0 / 1024 / (srs_max(1, cost) / 1000000.0));
+    }
+}
+
 VOID TEST(KernelTSTest, CoverContextDecode)
 {
 	srs_error_t err;
@@ -4940,6 +5579,73 @@ VOID TEST(KernelTSTest, CoverTransmuxer)
     }
 }
 
+VOID TEST(KernelTSTest, HEVCTransmuxer)
+{
+    srs_error_t err;
+    
+    uint8_t hvcc[] = {
+        0x1c, 0x00, 0x00, 0x00, 0x00,
+        // HEVCDecoderConfigurationRecord, Main profile, level 3.1, lengthSizeMinusOne 3.
+        0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5d, 0xf0, 0x00, 0xfc,
+        0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f, 0x03,
+        // VPS
+        0xa0, 0x00, 0x01, 0x00, 0x18,
+        0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03,
+        0x00, 0x00, 0x03, 0x00, 0x5d, 0x95, 0x98, 0x09,
+        // SPS
+        0xa1, 0x00, 0x01, 0x00, 0x18,
+        0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+        0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2d, 0x14,
+        // PPS
+        0xa2, 0x00, 0x01, 0x00, 0x07,
+        0x44, 0x01, 0xc1, 0x72, 0xb4, 0x62, 0x40
+    };
+    // The IDR_W_RADL frame.
+    uint8_t raw[] = {
+        0x1c, 0x01, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x08, 0x26, 0x01, 0xaf, 0x06, 0xb8, 0x63, 0xef, 0x3a
+    };
+    
+    // Insert the AUD and VPS/SPS/PPS before the IRAP frame.
+    if (true) {
+        SrsFormat f;
+        HELPER_EXPECT_SUCCESS(f.initialize());
+        HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)hvcc, sizeof(hvcc)));
+        HELPER_EXPECT_SUCCESS(f.on_video(0, (char*)raw, sizeof(raw)));
+        
+        SrsTsMessageCache c;
+        HELPER_EXPECT_SUCCESS(c.cache_video(f.video, 0));
+        ASSERT_TRUE(c.video != NULL);
+        
+        SrsSimpleStream* payload = c.video->payload;
+        // AUD(4+3), VPS(3+24), SPS(3+24), PPS(3+7), IDR(3+8)
+        ASSERT_EQ(4+3 + 3+24 + 3+24 + 3+7 + 3+8, payload->length());
+        
+        char* p = payload->bytes();
+        EXPECT_TRUE(srs_bytes_equals(p, (void*)"\x00\x00\x00\x01\x46\x01\x50", 7));
+        EXPECT_TRUE(srs_bytes_equals(p + 7, (void*)"\x00\x00\x01\x40\x01", 5));
+        EXPECT_TRUE(srs_bytes_equals(p + 7 + 27, (void*)"\x00\x00\x01\x42\x01", 5));
+        EXPECT_TRUE(srs_bytes_equals(p + 7 + 54, (void*)"\x00\x00\x01\x44\x01", 5));
+        EXPECT_TRUE(srs_bytes_equals(p + 7 + 64, (void*)"\x00\x00\x01\x26\x01", 5));
+    }
+    
+    // The PMT is H.265 stream type.
+    if (true) {
+        SrsTsTransmuxer m;
+        MockSrsFileWriter fw;
+        HELPER_EXPECT_SUCCESS(m.initialize(&fw));
+        
+        HELPER_EXPECT_SUCCESS(m.write_video(0, (char*)hvcc, sizeof(hvcc)));
+        HELPER_EXPECT_SUCCESS(m.write_video(40, (char*)raw, sizeof(raw)));
+        EXPECT_EQ(SrsVideoCodecIdHEVC, m.tscw->video_codec());
+        EXPECT_TRUE(fw.filesize() > 0);
+        
+        SrsTsChannel* channel = m.context->get(0x100);
+        ASSERT_TRUE(channel != NULL);
+        EXPECT_EQ(SrsTsStreamVideoHEVC, channel->stream);
+    }
+}
+
 VOID TEST(KernelMP4Test, CoverMP4All)
 {
 	if (true) {
@@ -1820,3 +1820,147 @@ VOID TEST(KernelMp4Test, SrsMp4M2tsInitEncoder)
     }
 }
 
+
+VOID TEST(KernelMp4Test, HEVCSampleEntry)
+{
+    srs_error_t err;
+
+    MockSrsFileWriter fw;
+    HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+    SrsMp4M2tsInitEncoder enc;
+    HELPER_ASSERT_SUCCESS(enc.initialize(&fw));
+
+    SrsFormat fmt;
+    HELPER_ASSERT_SUCCESS(fmt.initialize());
+
+    uint8_t raw[] = {
+        0x1c, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5d, 0xf0, 0x00, 0xfc,
+        0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f, 0x01,
+        0xa1, 0x00, 0x01, 0x00, 0x18,
+        0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03,
+        0x00, 0x5d, 0xa0, 0x02, 0x80, 0x80, 0x2d, 0x14
+    };
+    HELPER_ASSERT_SUCCESS(fmt.on_video(0, (char*)raw, sizeof(raw)));
+    HELPER_ASSERT_SUCCESS(enc.write(&fmt, true, 1));
+
+    // Parse the moov, the video sample entry should be hvc1 with hvcC.
+    SrsBuffer b(fw.data(), (int)fw.filesize());
+    while (!b.empty()) {
+        int pos = b.pos();
+
+        SrsMp4Box* box = NULL;
+        HELPER_ASSERT_SUCCESS(SrsMp4Box::discovery(&b, &box));
+        SrsAutoFree(SrsMp4Box, box);
+        HELPER_ASSERT_SUCCESS(box->decode(&b));
+
+        if (box->type == SrsMp4BoxTypeMOOV) {
+            SrsMp4MovieBox* moov = dynamic_cast<SrsMp4MovieBox*>(box);
+            SrsMp4TrackBox* trak = moov->video();
+            ASSERT_TRUE(trak != NULL);
+            EXPECT_EQ(SrsVideoCodecIdHEVC, trak->vide_codec());
+
+            SrsMp4SampleEntry* entry = trak->stsd()->entrie_at(0);
+            EXPECT_EQ(SrsMp4BoxTypeHVC1, entry->type);
+
+            SrsMp4VisualSampleEntry* hvc1 = dynamic_cast<SrsMp4VisualSampleEntry*>(entry);
+            ASSERT_TRUE(hvc1->hvcC() != NULL);
+            EXPECT_TRUE(hvc1->avcC() == NULL);
+            EXPECT_EQ(sizeof(raw) - 5, hvc1->hvcC()->hevc_config.size());
+            EXPECT_EQ(1280, hvc1->width);
+            EXPECT_EQ(720, hvc1->height);
+        }
+
+        b.skip(pos + (int)box->sz() - b.pos());
+    }
+}
+
+
+VOID TEST(KernelMp4Test, SrsMp4FragmentedEncoder)
+{
+    srs_error_t err;
+
+    MockSrsFileWriter fw;
+    HELPER_ASSERT_SUCCESS(fw.open("test.mp4"));
+
+    SrsMp4FragmentedEncoder enc;
+    HELPER_ASSERT_SUCCESS(enc.initialize(&fw, 1 * SRS_UTIME_SECONDS));
+
+    SrsFormat fmt;
+    HELPER_ASSERT_SUCCESS(fmt.initialize());
+
+    // Sequence headers of video and audio.
+    if (true) {
+        uint8_t raw[] = {
+            0x17,
+            0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20,
+            0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00,
+            0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+        };
+        HELPER_ASSERT_SUCCESS(fmt.on_video(0, (char*)raw, sizeof(raw)));
+        enc.vcodec = SrsVideoCodecIdAVC;
+        HELPER_ASSERT_SUCCESS(enc.write_sample(&fmt, SrsMp4HandlerTypeVIDE, SrsVideoAvcFrameTypeKeyFrame,
+            SrsVideoAvcFrameTraitSequenceHeader, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw));
+    }
+    if (true) {
+        uint8_t raw[] = {0xaf, 0x00, 0x12, 0x10};
+        HELPER_ASSERT_SUCCESS(fmt.on_audio(0, (char*)raw, sizeof(raw)));
+        enc.acodec = SrsAudioCodecIdAAC;
+        enc.sample_rate = SrsAudioSampleRate44100;
+        enc.sound_bits = SrsAudioSampleBits16bit;
+        enc.channels = SrsAudioChannelsStereo;
+        HELPER_ASSERT_SUCCESS(enc.write_sample(&fmt, SrsMp4HandlerTypeSOUN, 0x00,
+            SrsAudioAacFrameTraitSequenceHeader, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw));
+    }
+
+    // Write 3s stream, keyframe every 1s, so there are 3 fragments.
+    uint8_t frame[] = {0x00, 0x00, 0x00, 0x02, 0x65, 0x88};
+    for (uint32_t dts = 0; dts < 3000; dts += 100) {
+        SrsVideoAvcFrameType ft = (dts % 1000)? SrsVideoAvcFrameTypeInterFrame : SrsVideoAvcFrameTypeKeyFrame;
+        HELPER_ASSERT_SUCCESS(enc.write_sample(&fmt, SrsMp4HandlerTypeVIDE, ft, SrsVideoAvcFrameTraitNALU,
+            dts, dts, frame, sizeof(frame)));
+        HELPER_ASSERT_SUCCESS(enc.write_sample(&fmt, SrsMp4HandlerTypeSOUN, 0x00, SrsAudioAacFrameTraitRawData,
+            dts, dts, frame, sizeof(frame)));
+
+        // The samples of previous fragments must be freed.
+        EXPECT_LE((int)enc.vsamples->samples.size(), 10);
+        EXPECT_LE((int)enc.asamples->samples.size(), 10);
+    }
+    EXPECT_EQ(2, (int)enc.tfra_entries.size());
+
+    HELPER_ASSERT_SUCCESS(enc.flush());
+    EXPECT_EQ(3, (int)enc.tfra_entries.size());
+    EXPECT_TRUE(enc.vsamples->samples.empty());
+    EXPECT_TRUE(enc.asamples->samples.empty());
+
+    // Parse the boxes of file, should be ftyp, moov, moof+mdat for each fragment, then mfra.
+    vector<SrsMp4BoxType> types;
+    SrsBuffer b(fw.data(), (int)fw.filesize());
+    while (!b.empty()) {
+        int pos = b.pos();
+
+        SrsMp4Box* box = NULL;
+        HELPER_ASSERT_SUCCESS(SrsMp4Box::discovery(&b, &box));
+        SrsAutoFree(SrsMp4Box, box);
+        HELPER_ASSERT_SUCCESS(box->decode(&b));
+        types.push_back(box->type);
+
+        if (box->type == SrsMp4BoxTypeMFRA) {
+            SrsMp4MovieFragmentRandomAccessBox* mfra = dynamic_cast<SrsMp4MovieFragmentRandomAccessBox*>(box);
+            ASSERT_TRUE(mfra->mfro() != NULL);
+            EXPECT_EQ((uint32_t)box->sz(), mfra->mfro()->mfra_size);
+        }
+
+        b.skip(pos + (int)box->sz() - b.pos());
+    }
+
+    ASSERT_EQ(9, (int)types.size());
+    EXPECT_EQ(SrsMp4BoxTypeFTYP, types[0]);
+    EXPECT_EQ(SrsMp4BoxTypeMOOV, types[1]);
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(SrsMp4BoxTypeMOOF, types[2 + 2 * i]);
+        EXPECT_EQ(SrsMp4BoxTypeMDAT, types[3 + 2 * i]);
+    }
+    EXPECT_EQ(SrsMp4BoxTypeMFRA, types[8]);
+}
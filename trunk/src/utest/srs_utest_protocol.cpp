@@ -6457,3 +6457,56 @@ VOID TEST(ProtocolKbpsTest, WriteLargeIOVs)
     }
 }
 
+VOID TEST(ProtocolKbpsTest, Histogram)
+{
+    // The buckets are linear for small values, then 8 sub-buckets for each power of 2.
+    if (true) {
+        EXPECT_EQ(0, SrsHistogram::bucket(0));
+        EXPECT_EQ(7, SrsHistogram::bucket(7));
+        EXPECT_EQ(8, SrsHistogram::bucket(8));
+        EXPECT_EQ(15, SrsHistogram::bucket(15));
+        EXPECT_EQ(16, SrsHistogram::bucket(16));
+        EXPECT_EQ(16, SrsHistogram::bucket(17));
+        EXPECT_EQ(17, SrsHistogram::upper(16));
+        EXPECT_EQ(SRS_HISTOGRAM_BUCKETS - 1, SrsHistogram::bucket(1LL<<32));
+        EXPECT_EQ(SRS_HISTOGRAM_BUCKETS - 1, SrsHistogram::bucket(1LL<<40));
+    }
+
+    // The value is in the range of its bucket.
+    if (true) {
+        for (srs_utime_t v = 0; v < 100000; v += 7) {
+            int index = SrsHistogram::bucket(v);
+            EXPECT_LE(v, SrsHistogram::upper(index));
+            if (index > 0) {
+                EXPECT_GT(v, SrsHistogram::upper(index - 1));
+            }
+        }
+    }
+
+    // The stat is of the last duration.
+    if (true) {
+        SrsHistogram h;
+        h.record(-1);
+        for (int i = 1; i <= 100; i++) {
+            h.record(i);
+        }
+        EXPECT_EQ(0, h.count());
+        EXPECT_EQ(0, h.percentile(99));
+
+        h.update();
+        EXPECT_EQ(100, h.count());
+        EXPECT_EQ(1, h.min());
+        EXPECT_EQ(100, h.max());
+        EXPECT_EQ(50, h.average());
+        EXPECT_EQ(1, h.percentile(0.1));
+        EXPECT_EQ(51, h.percentile(50));
+        EXPECT_EQ(100, h.percentile(99));
+        EXPECT_EQ(100, h.percentile(100));
+
+        h.update();
+        EXPECT_EQ(0, h.count());
+        EXPECT_EQ(0, h.max());
+        EXPECT_EQ(0, h.percentile(99));
+    }
+}
+